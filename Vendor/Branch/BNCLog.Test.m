@@ -993,3 +993,739 @@ extern void BNCLogSetOutputToURLRecordWrapSize(NSURL *_Nullable url, long maxRec
 }
 
 @end
+
+#pragma mark - Test Disabled Levels
+
+static NSInteger globalEvaluationCount = 0;
+
+static NSString* BNCLogTestEvaluatedString() {
+    globalEvaluationCount++;
+    return @"Evaluated";
+}
+
+@interface BNCLogLevelTest : BNCTestCase
+@end
+
+@implementation BNCLogLevelTest
+
+- (void) testDisabledMessagesAreNotEvaluated {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetOutputFunction(TestLogProcedure);
+    BNCLogSetDisplayLevel(BNCLogLevelWarning);
+    BNCLogSetOutputLevel(BNCLogLevelWarning);
+    XCTAssertFalse(BNCLogLevelIsEnabled(BNCLogLevelDebug));
+    XCTAssertTrue(BNCLogLevelIsEnabled(BNCLogLevelWarning));
+    XCTAssertTrue(BNCLogLevelIsEnabled(BNCLogLevelError));
+
+    globalTestLogString = nil;
+    globalEvaluationCount = 0;
+    BNCLogDebug(@"Debug: %@.", BNCLogTestEvaluatedString());
+    BNCLogWriteMessage(BNCLogLevelDebug, @"File.m", 1, @"Debug message.");
+    BNCLogFlushMessages();
+    XCTAssertEqual(globalEvaluationCount, 0);
+    XCTAssertNil(globalTestLogString);
+
+    BNCLogWarning(@"Warning: %@.", BNCLogTestEvaluatedString());
+    BNCLogFlushMessages();
+    XCTAssertEqual(globalEvaluationCount, 1);
+    XCTAssert([globalTestLogString bnc_isEqualToMaskedString:
+        @"[branch.io] BNCLog.Test.m(****) Warning: Warning: Evaluated."]);
+
+    BNCLogSetOutputLevel(BNCLogLevelAll);
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testDisabledMessagePerformance {
+    BNCLogSetDisplayLevel(BNCLogLevelWarning);
+    BNCLogSetOutputLevel(BNCLogLevelWarning);
+    NSData *data = [NSMutableData dataWithLength:64*1024];
+    [self measureBlock:^{
+        for (int i = 0; i < 100000; i++) {
+            BNCLogDebug(@"Response %d: %@.", i,
+                [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
+        }
+    }];
+    BNCLogSetOutputLevel(BNCLogLevelAll);
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+}
+
+@end
+
+#pragma mark - Test Batching
+
+static dispatch_semaphore_t globalOutputEntered = nil;
+static dispatch_semaphore_t globalOutputRelease = nil;
+static long globalFlushCount = 0; // Changed and read on the log queue.
+
+static void BlockingLogProcedure(NSDate*timestamp, BNCLogLevel level, NSString* message) {
+    if (globalOutputRelease) {
+        dispatch_semaphore_signal(globalOutputEntered);
+        dispatch_semaphore_wait(globalOutputRelease, DISPATCH_TIME_FOREVER);
+        globalOutputRelease = nil;
+    }
+}
+
+static void CountingFlushProcedure() {
+    globalFlushCount++;
+}
+
+@interface BNCLogBatchTest : BNCTestCase
+@end
+
+@implementation BNCLogBatchTest
+
+- (NSURL*) logFileURL {
+    NSString *name = [NSString stringWithFormat:@"BNCLogBatchTest-%@.log", [NSUUID UUID].UUIDString];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+}
+
+- (void) testMessagesFromManyThreads {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURL(URL);
+
+    // Enough messages to wrap the message buffer several times:
+    enum { kThreads = 4, kMessages = 5000 };
+    dispatch_apply(kThreads, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t thread) {
+        for (long i = 0; i < kMessages; i++)
+            BNCLogDebug(@"Thread %ld message %ld.", (long) thread, i);
+    });
+    BNCLogCloseLogFile();
+
+    NSString *string = [NSString stringWithContentsOfURL:URL encoding:NSUTF8StringEncoding error:nil];
+    NSArray<NSString*> *lines = [string componentsSeparatedByString:@"\n"];
+    XCTAssertEqual(lines.count, kThreads * kMessages + 1);
+
+    // Each thread's messages are in order:
+    long next[kThreads];
+    memset(next, 0, sizeof(next));
+    for (NSString *line in lines) {
+        NSRange range = [line rangeOfString:@"Thread "];
+        if (range.location == NSNotFound) continue;
+        long thread = -1, message = -1;
+        sscanf([line substringFromIndex:range.location].UTF8String, "Thread %ld message %ld.", &thread, &message);
+        XCTAssertTrue(thread >= 0 && thread < kThreads);
+        if (thread < 0 || thread >= kThreads) continue;
+        XCTAssertEqual(message, next[thread]);
+        next[thread] = message + 1;
+    }
+    for (long i = 0; i < kThreads; i++)
+        XCTAssertEqual(next[i], kMessages);
+
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testDropWhenFull {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    BNCLogSetOverflowPolicy(BNCLogOverflowPolicyDrop);
+
+    // Hold up the log queue in the output function, then overfill the message buffer:
+    globalOutputEntered = dispatch_semaphore_create(0);
+    globalOutputRelease = dispatch_semaphore_create(0);
+    dispatch_semaphore_t release = globalOutputRelease;
+    BNCLogSetOutputFunction(BlockingLogProcedure);
+    BNCLog(@"Hold the queue.");
+    XCTAssertEqual(dispatch_semaphore_wait(globalOutputEntered,
+        dispatch_time(DISPATCH_TIME_NOW, (int64_t)(10.0 * NSEC_PER_SEC))), 0);
+
+    uint64_t dropped = BNCLogDroppedMessageCount();
+    for (long i = 0; i < 4096 + 100; i++)
+        BNCLog(@"Message %ld.", i);
+    XCTAssertEqual(BNCLogDroppedMessageCount() - dropped, 100);
+
+    dispatch_semaphore_signal(release);
+    BNCLogSetOverflowPolicy(BNCLogOverflowPolicyBlock);
+    BNCLogSetOutputFunction(TestLogProcedure);
+    BNCLogFlushMessages();
+    BNCLog(@"Not dropped.");
+    BNCLogFlushMessages();
+    XCTAssert([globalTestLogString bnc_isEqualToMaskedString:
+        @"[branch.io] BNCLog.Test.m(****) Log: Not dropped."]);
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testGroupCommit {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURL(URL);
+    BNCLogSetFlushFunction(CountingFlushProcedure);
+
+    // Flush by bytes:
+    globalFlushCount = 0;
+    BNCLogSetGroupCommit(0.0, 1000);
+    for (long i = 0; i < 100; i++)
+        BNCLog(@"Message %ld is about a hundred bytes long with its prefix, give or take.", i);
+    BNCLogOutputFunction(); // Waits for the queue.
+    long count = globalFlushCount;
+    XCTAssertTrue(count >= 1 && count <= 10);
+
+    // Flush by time:
+    BNCLogFlushMessages();
+    globalFlushCount = 0;
+    BNCLogSetGroupCommit(0.05, 0);
+    BNCLog(@"One message.");
+    BNCLogOutputFunction();
+    XCTAssertEqual(globalFlushCount, 0);
+    [NSThread sleepForTimeInterval:0.5];
+    BNCLogOutputFunction();
+    XCTAssertEqual(globalFlushCount, 1);
+
+    BNCLogSetGroupCommit(0.0, 0);
+    BNCLogCloseLogFile();
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+#pragma mark Throughput
+
+static const long kThroughputMessages = 20000;
+
+- (void) testBatchedThroughput {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURL(URL);
+    [self measureBlock:^{
+        for (long i = 0; i < kThroughputMessages; i++)
+            BNCLogDebug(@"Message %ld.", i);
+        BNCLogFlushMessages();
+    }];
+    BNCLogCloseLogFile();
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+/// The same messages written the way they were before batching: each message is formatted, then
+/// a block for it is dispatched to a serial queue that passes it to NSLog and writes it to the file.
+- (void) testPerMessageThroughput {
+    NSURL *URL = [self logFileURL];
+    [[NSFileManager defaultManager] createFileAtPath:URL.path contents:nil attributes:nil];
+    NSFileHandle *file = [NSFileHandle fileHandleForWritingToURL:URL error:nil];
+    XCTAssertNotNil(file);
+    dispatch_queue_t queue = dispatch_queue_create("io.branch.sdk.log.test", DISPATCH_QUEUE_SERIAL);
+    [self measureBlock:^{
+        for (long i = 0; i < kThroughputMessages; i++) {
+            NSString *message = [NSString stringWithFormat:@"Message %ld.", i];
+            NSString *s = [NSString stringWithFormat:
+                @"[branch.io] %@(%d) %@: %@", @"BNCLog.Test.m", __LINE__, @"Debug", message];
+            dispatch_async(queue, ^{
+                NSLog(@"%@", s);
+                NSData *data = [[s stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding];
+                [file writeData:data];
+            });
+        }
+        dispatch_sync(queue, ^{});
+    }];
+    [file closeFile];
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+}
+
+@end
+
+#pragma mark - Test Wrap Log Index
+
+@interface BNCLogIndexTest : BNCTestCase
+@end
+
+@implementation BNCLogIndexTest
+
+- (NSURL*) logFileURL {
+    NSString *name = [NSString stringWithFormat:@"BNCLogIndexTest-%@.log", [NSUUID UUID].UUIDString];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+}
+
+- (void) removeLogFileURL:(NSURL*)URL {
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:[URL.path stringByAppendingString:@".idx"] error:nil];
+}
+
+- (long) messageNumber:(BNCLogRecord*)record {
+    long number = -1;
+    NSRange range = [record.message rangeOfString:@"Message "];
+    if (range.location != NSNotFound)
+        sscanf([record.message substringFromIndex:range.location].UTF8String, "Message %ld.", &number);
+    return number;
+}
+
+- (void) testByteWrapReopenWithIndex {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    NSURL *copyURL = [self logFileURL];
+
+    BNCLogSetOutputToURLByteWrap(URL, 4096*2);
+    for (long i = 0; i < 300; i++)
+        BNCLog(@"Message %ld.", i);
+    BNCLogCloseLogFile();
+    XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:[URL.path stringByAppendingString:@".idx"]]);
+
+    // Re-open the log with its index and a copy of the log without one:
+    XCTAssertTrue([[NSFileManager defaultManager] copyItemAtURL:URL toURL:copyURL error:nil]);
+    for (NSURL *logURL in @[ URL, copyURL ]) {
+        BNCLogSetOutputToURLByteWrap(logURL, 4096*2);
+        BNCLog(@"Message 300.");
+        BNCLogCloseLogFile();
+    }
+
+    // Both continue from the same place:
+    NSArray<BNCLogRecord*> *records =
+        [[[BNCLogFileReader alloc] initWithURL:URL error:nil] readRecords:1000];
+    NSArray<BNCLogRecord*> *copyRecords =
+        [[[BNCLogFileReader alloc] initWithURL:copyURL error:nil] readRecords:1000];
+    XCTAssertTrue(records.count > 10 && records.count < 300);
+    XCTAssertEqual(records.count, copyRecords.count);
+    for (NSUInteger i = 0; i < records.count && i < copyRecords.count; i++) {
+        XCTAssertEqual([self messageNumber:records[i]], [self messageNumber:copyRecords[i]]);
+        XCTAssertEqual([self messageNumber:records[i]], 301 - (long) records.count + (long) i);
+    }
+
+    [self removeLogFileURL:URL];
+    [self removeLogFileURL:copyURL];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testReaderWrappedFileWithoutIndex {
+    // Records 40 to 59, what's left of record 20, then records 21 to 39:
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSSSSSX";
+    formatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    NSDate *start = [formatter dateFromString:@"2018-11-02T10:00:00.000000Z"];
+    NSString *(^record)(long) = ^ NSString* (long i) {
+        NSDate *date = [start dateByAddingTimeInterval:i];
+        if (i == 50)
+            return [NSString stringWithFormat:@"%@ 4 Message 50.\nSecond line.  \n", [formatter stringFromDate:date]];
+        return [NSString stringWithFormat:@"%@ 6 Message %ld.\n", [formatter stringFromDate:date], i];
+    };
+    NSMutableString *string = [NSMutableString new];
+    for (long i = 40; i < 60; i++)
+        [string appendString:record(i)];
+    [string appendString:[record(20) substringFromIndex:10]];
+    for (long i = 21; i < 40; i++)
+        [string appendString:record(i)];
+    NSURL *URL = [self logFileURL];
+    XCTAssertTrue([[string dataUsingEncoding:NSUTF8StringEncoding] writeToURL:URL atomically:YES]);
+
+    NSError *error = nil;
+    BNCLogFileReader *reader = [[BNCLogFileReader alloc] initWithURL:URL error:&error];
+    XCTAssertNotNil(reader);
+    XCTAssertNil(error);
+
+    // Page through the records:
+    NSArray<BNCLogRecord*> *records = [reader readRecords:10];
+    XCTAssertEqual(records.count, 10);
+    XCTAssertEqual([self messageNumber:records.firstObject], 21);
+    XCTAssertEqual(records.firstObject.level, BNCLogLevelLog);
+    XCTAssertEqualObjects(records.firstObject.message, @"Message 21.");
+    XCTAssertEqualObjects(records.firstObject.date, [start dateByAddingTimeInterval:21]);
+    records = [reader readRecords:10];
+    XCTAssertEqual([self messageNumber:records.firstObject], 31);
+    XCTAssertEqual([self messageNumber:records.lastObject], 40);
+    records = [reader readRecords:100];
+    XCTAssertEqual(records.count, 19);
+    XCTAssertEqual([self messageNumber:records.lastObject], 59);
+    XCTAssertEqual([reader readRecords:10].count, 0);
+
+    // Seek by date:
+    [reader seekToDate:[start dateByAddingTimeInterval:49.5]];
+    records = [reader readRecords:2];
+    XCTAssertEqual([self messageNumber:records[0]], 50);
+    XCTAssertEqual(records[0].level, BNCLogLevelWarning);
+    XCTAssertEqualObjects(records[0].message, @"Message 50.\nSecond line.");
+    XCTAssertEqual([self messageNumber:records[1]], 51);
+
+    records = [reader recordsFromDate:[start dateByAddingTimeInterval:30]
+        toDate:[start dateByAddingTimeInterval:35]];
+    XCTAssertEqual(records.count, 5);
+    XCTAssertEqual([self messageNumber:records.firstObject], 30);
+    XCTAssertEqual([self messageNumber:records.lastObject], 34);
+
+    [reader seekToDate:[start dateByAddingTimeInterval:100]];
+    XCTAssertEqual([reader readRecords:10].count, 0);
+    [reader seekToStart];
+    XCTAssertEqual([self messageNumber:[reader readRecords:1].firstObject], 21);
+
+    [self removeLogFileURL:URL];
+    XCTAssertNil([[BNCLogFileReader alloc] initWithURL:URL error:&error]);
+    XCTAssertNotNil(error);
+}
+
+- (void) testReaderWithIndex {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+
+    NSURL *byteWrapURL = [self logFileURL];
+    BNCLogSetOutputToURLByteWrap(byteWrapURL, 4096*2);
+    for (long i = 0; i < 300; i++)
+        BNCLog(@"Message %ld.", i);
+    BNCLogCloseLogFile();
+
+    NSURL *recordWrapURL = [self logFileURL];
+    BNCLogSetOutputToURLRecordWrapSize(recordWrapURL, 23, 80);
+    for (long i = 0; i < 300; i++)
+        BNCLog(@"Message %ld.", i);
+    BNCLogCloseLogFile();
+
+    for (NSURL *URL in @[ byteWrapURL, recordWrapURL ]) {
+        BNCLogFileReader *reader = [[BNCLogFileReader alloc] initWithURL:URL error:nil];
+        NSArray<BNCLogRecord*> *records = [reader readRecords:1000];
+        XCTAssertTrue(records.count > 10 && records.count < 300);
+        for (NSUInteger i = 0; i < records.count; i++)
+            XCTAssertEqual([self messageNumber:records[i]], 300 - (long) records.count + (long) i);
+
+        // Every record can be found by its date:
+        for (NSUInteger i = 0; i < records.count; i += 7) {
+            [reader seekToDate:records[i].date];
+            XCTAssertEqualObjects([reader readRecords:1].firstObject.date, records[i].date);
+        }
+        [self removeLogFileURL:URL];
+    }
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testReaderRecordAcrossTheWrap {
+    // The end of record 40, records 41 to 49, what's left of record 20, records 21 to 39, then the
+    // start of record 40:
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSSSSSX";
+    formatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    NSDate *start = [formatter dateFromString:@"2018-11-02T10:00:00.000000Z"];
+    NSString *(^record)(long) = ^ NSString* (long i) {
+        NSDate *date = [start dateByAddingTimeInterval:i];
+        return [NSString stringWithFormat:@"%@ 6 Message %ld.\n", [formatter stringFromDate:date], i];
+    };
+    NSString *record40 = record(40);
+    NSMutableString *string = [NSMutableString new];
+    [string appendString:[record40 substringFromIndex:30]];
+    for (long i = 41; i < 50; i++)
+        [string appendString:record(i)];
+    [string appendString:[record(20) substringFromIndex:10]];
+    for (long i = 21; i < 40; i++)
+        [string appendString:record(i)];
+    [string appendString:[record40 substringToIndex:30]];
+    NSURL *URL = [self logFileURL];
+    XCTAssertTrue([[string dataUsingEncoding:NSUTF8StringEncoding] writeToURL:URL atomically:YES]);
+
+    BNCLogFileReader *reader = [[BNCLogFileReader alloc] initWithURL:URL error:nil];
+    NSArray<BNCLogRecord*> *records = [reader readRecords:100];
+    XCTAssertEqual(records.count, 29);
+    for (NSUInteger i = 0; i < records.count; i++)
+        XCTAssertEqual([self messageNumber:records[i]], 21 + (long) i);
+    XCTAssertEqualObjects(records[19].message, @"Message 40.");
+    XCTAssertEqualObjects(records[19].date, [start dateByAddingTimeInterval:40]);
+
+    [reader seekToDate:[start dateByAddingTimeInterval:39.5]];
+    XCTAssertEqual([self messageNumber:[reader readRecords:1].firstObject], 40);
+    [self removeLogFileURL:URL];
+}
+
+- (void) testReaderIgnoresAnOverflowingIndexCount {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURLByteWrap(URL, 4096*2);
+    for (long i = 0; i < 300; i++)
+        BNCLog(@"Message %ld.", i);
+    BNCLogCloseLogFile();
+
+    // An entry count that overflows to the same index size when it's multiplied by the entry size.
+    // The count follows the magic, kind, maximum size, and record size in the index header:
+    NSString *indexPath = [URL.path stringByAppendingString:@".idx"];
+    NSMutableData *indexData = [NSMutableData dataWithContentsOfFile:indexPath];
+    XCTAssertTrue(indexData.length >= 40);
+    int64_t entryCount = 0;
+    [indexData getBytes:&entryCount range:NSMakeRange(32, sizeof(entryCount))];
+    entryCount += ((int64_t) 1 << 60);
+    [indexData replaceBytesInRange:NSMakeRange(32, sizeof(entryCount)) withBytes:&entryCount];
+    XCTAssertTrue([indexData writeToFile:indexPath atomically:NO]);
+
+    NSArray<BNCLogRecord*> *records =
+        [[[BNCLogFileReader alloc] initWithURL:URL error:nil] readRecords:1000];
+    XCTAssertTrue(records.count > 10 && records.count < 300);
+    XCTAssertEqual([self messageNumber:records.lastObject], 299);
+    [self removeLogFileURL:URL];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+@end
+
+#pragma mark - Test Binary Log
+
+@interface BNCLogBinaryTest : BNCTestCase
+@end
+
+@implementation BNCLogBinaryTest
+
+- (NSURL*) logFileURL {
+    NSString *name = [NSString stringWithFormat:@"BNCLogBinaryTest-%@.log", [NSUUID UUID].UUIDString];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+}
+
+- (NSArray<BNCLogRecord*>*) recordsFromURL:(NSURL*)URL {
+    NSError *error = nil;
+    BNCLogBinaryDecoder *decoder = [[BNCLogBinaryDecoder alloc] initWithURL:URL error:&error];
+    XCTAssertNotNil(decoder);
+    XCTAssertNil(error);
+    return [decoder readRecords:NSIntegerMax];
+}
+
+- (void) testFormatsRoundTrip {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURLBinary(URL);
+
+    NSString *nilString = nil;
+    const char *nullString = NULL;
+    BNCLog(@"Integers %d %ld %lu %lld %llu %zu %#x %o %c.",
+        -5, 1234567890123L, 42UL, LLONG_MIN, ULLONG_MAX, (size_t) 7, 255, 8, 'z');
+    BNCLogWarning(@"Doubles %.3f %e %g %10.2f.", 3.14159, 1e-10, 2.5, -1.5);
+    BNCLogError(@"Strings %s %@ %@ %@ %s [%5d] [%-6s] [%*d] [%.*f].",
+        "C", @"Object", @42, nilString, nullString, 42, "ab", 4, 7, 2, 1.2345);
+    BNCLogDebug(@"Pointer %p, percent %%.", (void*) 0x1234);
+    BNCLog(@"Positional %2$@ %1$@.", @"a", @"b");
+    BNCLogCloseLogFile();
+
+    NSArray<NSString*> *truth = @[
+        [NSString stringWithFormat:@"Integers %d %ld %lu %lld %llu %zu %#x %o %c.",
+            -5, 1234567890123L, 42UL, LLONG_MIN, ULLONG_MAX, (size_t) 7, 255, 8, 'z'],
+        [NSString stringWithFormat:@"Doubles %.3f %e %g %10.2f.", 3.14159, 1e-10, 2.5, -1.5],
+        [NSString stringWithFormat:@"Strings %s %@ %@ %@ %s [%5d] [%-6s] [%*d] [%.*f].",
+            "C", @"Object", @42, nilString, nullString, 42, "ab", 4, 7, 2, 1.2345],
+        [NSString stringWithFormat:@"Pointer %p, percent %%.", (void*) 0x1234],
+        @"Positional b a.",
+    ];
+    NSArray<NSNumber*> *levels = @[
+        @(BNCLogLevelLog), @(BNCLogLevelWarning), @(BNCLogLevelError), @(BNCLogLevelDebug), @(BNCLogLevelLog)
+    ];
+    NSArray<BNCLogRecord*> *records = [self recordsFromURL:URL];
+    XCTAssertEqual(records.count, truth.count);
+    for (NSUInteger i = 0; i < records.count && i < truth.count; i++) {
+        BNCLogRecord *record = records[i];
+        NSString *prefix = [NSString stringWithFormat:@"[branch.io] BNCLog.Test.m(%ld) %@: ",
+            (long) record.line, [BNCLogStringFromLogLevel(record.level) substringFromIndex:11]];
+        XCTAssertEqualObjects(record.message, [prefix stringByAppendingString:truth[i]]);
+        XCTAssertEqual(record.level, levels[i].integerValue);
+        XCTAssertEqualObjects(record.file, @"BNCLog.Test.m");
+        XCTAssertTrue(record.line > 0);
+        XCTAssertTrue(fabs(record.date.timeIntervalSinceNow) < 60.0);
+    }
+    XCTAssertEqualObjects(records[0].format, @"Integers %d %ld %lu %lld %llu %zu %#x %o %c.");
+    XCTAssertEqualObjects(records[0].arguments[3], @(LLONG_MIN));
+    XCTAssertEqualObjects(records[0].arguments[4], @(ULLONG_MAX));
+    XCTAssertEqualObjects(records[2].arguments[3], [NSNull null]);
+
+    // Positional arguments are formatted when they're logged:
+    XCTAssertEqualObjects(records[4].format, @"%@");
+
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testAppendAndTruncatedLog {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *URL = [self logFileURL];
+    for (long session = 0; session < 2; session++) {
+        BNCLogSetOutputToURLBinary(URL);
+        for (long i = 0; i < 3; i++)
+            BNCLog(@"Session %ld message %ld.", session, i);
+        BNCLogCloseLogFile();
+    }
+
+    NSArray<BNCLogRecord*> *records = [self recordsFromURL:URL];
+    XCTAssertEqual(records.count, 6);
+    for (NSUInteger i = 0; i < records.count; i++) {
+        NSString *truth = [NSString stringWithFormat:@"Session %ld message %ld.", (long) i / 3, (long) i % 3];
+        XCTAssertTrue([records[i].message hasSuffix:truth]);
+        if (i > 0) XCTAssertTrue([records[i].date compare:records[i-1].date] != NSOrderedAscending);
+    }
+
+    // A record that's cut short ends the log:
+    NSData *data = [NSData dataWithContentsOfURL:URL];
+    data = [data subdataWithRange:NSMakeRange(0, data.length - 2)];
+    records = [[[BNCLogBinaryDecoder alloc] initWithData:data error:nil] readRecords:100];
+    XCTAssertEqual(records.count, 5);
+
+    // A text log isn't a binary log:
+    NSError *error = nil;
+    data = [@"2018-11-02T10:00:00.000000Z 6 Text.\n" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertNil([[BNCLogBinaryDecoder alloc] initWithData:data error:&error]);
+    XCTAssertNotNil(error);
+
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testBinaryLogIsSmaller {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    NSURL *textURL = [self logFileURL];
+    NSURL *binaryURL = [self logFileURL];
+    for (NSURL *URL in @[ textURL, binaryURL ]) {
+        if (URL == binaryURL)
+            BNCLogSetOutputToURLBinary(URL);
+        else
+            BNCLogSetOutputToURL(URL);
+        for (long i = 0; i < 1000; i++)
+            BNCLogDebug(@"Updated bot %ld for pull request %ld in %@.", i, i + 100, @"owner/repo");
+        BNCLogCloseLogFile();
+    }
+    NSNumber *textSize =
+        [[NSFileManager defaultManager] attributesOfItemAtPath:textURL.path error:nil][NSFileSize];
+    NSNumber *binarySize =
+        [[NSFileManager defaultManager] attributesOfItemAtPath:binaryURL.path error:nil][NSFileSize];
+    XCTAssertTrue(binarySize.longLongValue * 2 < textSize.longLongValue);
+    XCTAssertEqual([self recordsFromURL:binaryURL].count, 1000);
+
+    [[NSFileManager defaultManager] removeItemAtURL:textURL error:nil];
+    [[NSFileManager defaultManager] removeItemAtURL:binaryURL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testBinaryThroughput {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    // NSLog is written along with the binary log, so leave it out of the measurement:
+    BNCLogSetDisplayLevel(BNCLogLevelNone);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURLBinary(URL);
+    [self measureBlock:^{
+        for (long i = 0; i < 20000; i++)
+            BNCLogDebug(@"Message %ld.", i);
+        BNCLogFlushMessages();
+    }];
+    BNCLogCloseLogFile();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+- (void) testBinaryLogIsAnAdditionalOutput {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    BNCLogSetOutputFunction(TestLogProcedure);
+    NSURL *URL = [self logFileURL];
+    BNCLogSetOutputToURLBinary(URL);
+
+    // The output function still gets the formatted message:
+    globalTestLogString = nil;
+    BNCLog(@"Both outputs %d.", 1);
+    BNCLogFlushMessages();
+    XCTAssert([globalTestLogString bnc_isEqualToMaskedString:
+        @"[branch.io] BNCLog.Test.m(****) Log: Both outputs 1."]);
+
+    // Closing the binary log leaves the output function:
+    BNCLogSetOutputToURLBinary(nil);
+    XCTAssertTrue(BNCLogOutputFunction() == TestLogProcedure);
+    BNCLog(@"Only the output function.");
+    BNCLogFlushMessages();
+    XCTAssert([globalTestLogString bnc_isEqualToMaskedString:
+        @"[branch.io] BNCLog.Test.m(****) Log: Only the output function."]);
+
+    NSArray<BNCLogRecord*> *records = [self recordsFromURL:URL];
+    XCTAssertEqual(records.count, 1);
+    XCTAssertEqualObjects(records.firstObject.format, @"Both outputs %d.");
+
+    [[NSFileManager defaultManager] removeItemAtURL:URL error:nil];
+    BNCLogSetOutputFunction(origPtr);
+}
+
+@end
+
+#pragma mark - BNCLogOutputLevelTest
+
+@interface BNCLogOutputLevelTest : BNCTestCase
+@end
+
+@implementation BNCLogOutputLevelTest
+
+- (void) testOutputFunctionSeesDebugMessages {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetOutputFunction(TestLogProcedure);
+    BNCLogSetDisplayLevel(BNCLogLevelWarning);
+    XCTAssertEqual(BNCLogOutputLevel(), BNCLogLevelAll);
+    XCTAssertTrue(BNCLogLevelIsEnabled(BNCLogLevelDebug));
+
+    // By default debug messages aren't displayed but they still reach the output function:
+    globalTestLogString = nil;
+    BNCLogDebug(@"Debug message.");
+    BNCLogFlushMessages();
+    XCTAssert([globalTestLogString bnc_isEqualToMaskedString:
+        @"[branch.io] BNCLog.Test.m(****) Debug: Debug message."]);
+
+    // A raised output level passes only what's displayed:
+    BNCLogSetOutputLevel(BNCLogLevelMax);
+    XCTAssertFalse(BNCLogLevelIsEnabled(BNCLogLevelDebug));
+    globalTestLogString = nil;
+    BNCLogDebug(@"Debug message.");
+    BNCLogFlushMessages();
+    XCTAssertNil(globalTestLogString);
+    BNCLogSetOutputLevel(BNCLogLevelAll);
+
+    // Without an output function the undisplayed messages aren't formatted at all:
+    BNCLogSetOutputFunction(NULL);
+    BNCLogOutputFunction(); // Waits for the queue.
+    XCTAssertFalse(BNCLogLevelIsEnabled(BNCLogLevelDebug));
+    XCTAssertTrue(BNCLogLevelIsEnabled(BNCLogLevelWarning));
+
+    BNCLogSetDisplayLevel(BNCLogLevelAll);
+    BNCLogSetOutputFunction(origPtr);
+}
+
+@end
+
+#pragma mark - Test Logging From The Log Queue
+
+static long globalQueueMessageCount = 0; // Changed and read on the log queue.
+static BOOL globalQueueHasLogged = NO;
+
+static void CountingLogProcedure(NSDate*timestamp, BNCLogLevel level, NSString* message) {
+    if ([message containsString:@"Queue message "]) globalQueueMessageCount++;
+}
+
+static void QueueLoggingFlushProcedure() {
+    if (globalQueueHasLogged) return;
+    globalQueueHasLogged = YES;
+    // More messages than the buffer holds, logged from the log queue outside of a drain:
+    for (long i = 0; i < 4096 + 100; i++)
+        BNCLog(@"Queue message %ld.", i);
+}
+
+@interface BNCLogQueueTest : BNCTestCase
+@end
+
+@implementation BNCLogQueueTest
+
+- (void) testBlockingLogFromTheLogQueue {
+    BNCLogOutputFunctionPtr origPtr = BNCLogOutputFunction();
+    BNCLogSetDisplayLevel(BNCLogLevelWarning);
+    BNCLogSetOverflowPolicy(BNCLogOverflowPolicyBlock);
+    BNCLogSetOutputFunction(CountingLogProcedure);
+    BNCLogFlushMessages();
+    globalQueueMessageCount = 0;
+    globalQueueHasLogged = NO;
+    uint64_t dropped = BNCLogDroppedMessageCount();
+
+    BNCLogSetFlushFunction(QueueLoggingFlushProcedure);
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        BNCLogFlushMessages();
+        dispatch_semaphore_signal(semaphore);
+    });
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore,
+        dispatch_time(DISPATCH_TIME_NOW, (int64_t)(10.0 * NSEC_PER_SEC))), 0);
+
+    BNCLogSetFlushFunction(NULL);
+    BNCLogFlushMessages();
+    XCTAssertEqual(globalQueueMessageCount, 4096 + 100);
+    XCTAssertEqual(BNCLogDroppedMessageCount(), dropped);
+    BNCLogSetOutputFunction(origPtr);
+}
+
+@end
@@ -44,10 +44,42 @@ typedef NS_ENUM(NSInteger, BNCLogLevel) {
 FOUNDATION_EXPORT BNCLogLevel BNCLogDisplayLevel(void);
 
 /*!
-* @param level Sets the current display level for log messages.
+* @param level Sets the current display level for log messages. Messages below the display level
+*              aren't written to NSLog. The displayed messages are handed to NSLog in batches, so
+*              that a burst of messages costs one NSLog call. Messages below both the display level
+*              and the output level aren't formatted or written.
 */
 FOUNDATION_EXPORT void BNCLogSetDisplayLevel(BNCLogLevel level);
 
+/*!
+* @return Returns the level of the messages that are passed to the log output function.
+*/
+FOUNDATION_EXPORT BNCLogLevel BNCLogOutputLevel(void);
+
+/*!
+* @param level Sets the level of the messages that are passed to the log output function, so that
+*              the output function can keep messages that aren't displayed. The output function
+*              gets the messages at or above either the display level or the output level.
+*              Defaults to `BNCLogLevelAll`: the output function gets every message. Raise it to
+*              skip formatting the messages that the output function would throw away.
+*/
+FOUNDATION_EXPORT void BNCLogSetOutputLevel(BNCLogLevel level);
+
+/*!
+* @param level The log level to check.
+* @return Returns 'YES' if messages at `level` are displayed or passed to the output function.
+*         This is cheap enough to check before every message.
+*/
+FOUNDATION_EXPORT BOOL BNCLogLevelIsEnabled(BNCLogLevel level);
+
+/*!
+* Log statements below this level are left out when compiling. Add a preprocessor definition
+* like `BNCLogLevelMinimum=BNCLogLevelWarning` to a build to strip its debug messages.
+*/
+#ifndef BNCLogLevelMinimum
+#define BNCLogLevelMinimum  BNCLogLevelAll
+#endif
+
 /*!
 * @param level The log level to convert to a string.
 * @return Returns the string indicating the log level.
@@ -113,6 +145,14 @@ FOUNDATION_EXPORT void BNCLogSetOutputToURLRecordWrap(NSURL *_Nullable URL, long
 ///@param maxBytes Wraps the file at `maxBytes` bytes.  Must be an even number of bytes.
 FOUNDATION_EXPORT void BNCLogSetOutputToURLByteWrap(NSURL *_Nullable URL, long maxBytes);
 
+///@param URL Also writes messages to a compact binary log at URL, along with NSLog and the output
+///           function. The binary log gets the same messages as the output function. Their format
+///           strings and arguments are saved rather than the formatted text, and
+///           BNCLogBinaryDecoder or the `xcode-github-log` tool turns them back into text. Opening
+///           an existing binary log appends to it. A nil URL closes the binary log, as does
+///           BNCLogCloseLogFile.
+FOUNDATION_EXPORT void BNCLogSetOutputToURLBinary(NSURL *_Nullable URL);
+
 typedef void (*BNCLogFlushFunctionPtr)(void);
 
 ///@param flushFunction The logging functions use `flushFunction` to flush the outstanding log
@@ -123,6 +163,39 @@ FOUNDATION_EXPORT void BNCLogSetFlushFunction(BNCLogFlushFunctionPtr _Nullable f
 ///@return Returns the current flush function.
 FOUNDATION_EXPORT BNCLogFlushFunctionPtr _Nullable BNCLogFlushFunction(void);
 
+///@param descriptor    Writes `data` to the file descriptor. Output functions should use this
+///                     to write since the writes of a batch of messages are combined into one
+///                     `writev` call.
+///@param data          The bytes to write.
+FOUNDATION_EXPORT void BNCLogWriteToDescriptor(int descriptor, NSData*_Nonnull data);
+
+
+#pragma mark - Log Message Batching
+
+
+///@brief What happens to a message when the log's message buffer is full.
+typedef NS_ENUM(NSInteger, BNCLogOverflowPolicy) {
+    BNCLogOverflowPolicyBlock = 0,  //!< Wait until there's room, or drain the buffer first when logging
+                                    //!< from the log queue itself. This is the default.
+    BNCLogOverflowPolicyDrop,       //!< Drop the message and count it.
+};
+
+///@param policy Sets what happens to messages that are logged while the message buffer is full.
+FOUNDATION_EXPORT void BNCLogSetOverflowPolicy(BNCLogOverflowPolicy policy);
+
+///@return Returns the number of messages that have been dropped because the buffer was full.
+FOUNDATION_EXPORT uint64_t BNCLogDroppedMessageCount(void);
+
+///@brief Sets how often the flush function is called as messages are written.
+///
+///The flush function is called once `interval` seconds have passed or `bytes` bytes have been
+///written since it was last called, whichever comes first, so that a group of messages is made
+///durable with one `fsync`. Zero turns off that limit. By default both are zero and the flush
+///function is only called by BNCLogFlushMessages.
+///@param interval  The longest time between flushes in seconds.
+///@param bytes     The most bytes written between flushes.
+FOUNDATION_EXPORT void BNCLogSetGroupCommit(NSTimeInterval interval, long bytes);
+
 
 #pragma mark - BNCLogWriteMessage
 
@@ -154,25 +227,33 @@ FOUNDATION_EXPORT BOOL BNCLogDebuggerIsAttached(void);
 #pragma mark - Logging
 ///@info Logging
 
+///Writes a message if its level is enabled. The message's arguments are only evaluated if it's
+///written, and messages below `BNCLogLevelMinimum` are compiled out.
+#define BNCLogWriteMessageAtLevel(level, ...) \
+    do  { \
+        if ((level) >= BNCLogLevelMinimum && BNCLogLevelIsEnabled(level)) \
+            BNCLogWriteMessageFormat((level), __FILE__, __LINE__, __VA_ARGS__); \
+    } while (0)
+
 ///@param format Log an info message with the specified formatting.
 #define BNCLogDebugSDK(...) \
-    do  { BNCLogWriteMessageFormat(BNCLogLevelDebugSDK, __FILE__, __LINE__, __VA_ARGS__); } while (0)
+    BNCLogWriteMessageAtLevel(BNCLogLevelDebugSDK, __VA_ARGS__)
 
 ///@param format Log a debug message with the specified formatting.
 #define BNCLogDebug(...) \
-    do  { BNCLogWriteMessageFormat(BNCLogLevelDebug, __FILE__, __LINE__, __VA_ARGS__); } while (0)
+    BNCLogWriteMessageAtLevel(BNCLogLevelDebug, __VA_ARGS__)
 
 ///@param format Log a warning message with the specified formatting.
 #define BNCLogWarning(...) \
-    do  { BNCLogWriteMessageFormat(BNCLogLevelWarning, __FILE__, __LINE__, __VA_ARGS__); } while (0)
+    BNCLogWriteMessageAtLevel(BNCLogLevelWarning, __VA_ARGS__)
 
 ///@param format Log an error message with the specified formatting.
 #define BNCLogError(...) \
-    do  { BNCLogWriteMessageFormat(BNCLogLevelError, __FILE__, __LINE__, __VA_ARGS__); } while (0)
+    BNCLogWriteMessageAtLevel(BNCLogLevelError, __VA_ARGS__)
 
 ///@param format Log a message with the specified formatting.
 #define BNCLog(...) \
-    do  { BNCLogWriteMessageFormat(BNCLogLevelLog, __FILE__, __LINE__, __VA_ARGS__); } while (0)
+    BNCLogWriteMessageAtLevel(BNCLogLevelLog, __VA_ARGS__)
 
 ///Cause a programmatic breakpoint if breakpoints are enabled.
 #define BNCLogBreakPoint() \
@@ -240,3 +321,68 @@ FOUNDATION_EXPORT BOOL BNCLogDebuggerIsAttached(void);
 #ifdef __cplusplus
 }
 #endif
+
+
+#pragma mark - Log File Reader
+
+
+///@brief A record read from a log file.
+@interface BNCLogRecord : NSObject
+@property (strong, readonly) NSDate *_Nonnull date;
+@property (assign, readonly) BNCLogLevel level;
+@property (strong, readonly) NSString *_Nonnull message;
+
+// Binary logs also have where the message was logged and its unformatted parts:
+@property (strong, readonly) NSString *_Nullable file;
+@property (assign, readonly) NSInteger line;
+@property (strong, readonly) NSString *_Nullable format;
+///The format's arguments as NSNumbers, NSStrings, and NSNulls for NULL strings and nil objects.
+@property (strong, readonly) NSArray *_Nullable arguments;
+@end
+
+/**
+ Reads the records of a log file that was written by BNCLogSetOutputToURLRecordWrap or
+ BNCLogSetOutputToURLByteWrap, oldest first.
+
+ The reader uses the log's index to find the oldest record and to seek by date without reading the
+ whole log. If the index is missing or out of date the log is scanned instead. The log is mapped
+ rather than copied, so close the log or read a copy of it if it's still being written.
+*/
+@interface BNCLogFileReader : NSObject
+
+- (instancetype _Nullable) initWithURL:(NSURL*_Nonnull)URL
+                                 error:(NSError*_Nullable __autoreleasing*_Nullable)error
+                                 NS_DESIGNATED_INITIALIZER;
+- (instancetype _Nonnull) init NS_UNAVAILABLE;
+
+/// Moves to the oldest record.
+- (void) seekToStart;
+
+/// Moves to the first record that was written at or after `date`.
+- (void) seekToDate:(NSDate*_Nonnull)date;
+
+///@return Returns up to `count` records from the current position and moves past them. Returns an
+///        empty array at the end of the log.
+- (NSArray<BNCLogRecord*>*_Nonnull) readRecords:(NSInteger)count;
+
+///@return Returns the records written from `fromDate` up to, but not including, `toDate`.
+- (NSArray<BNCLogRecord*>*_Nonnull) recordsFromDate:(NSDate*_Nonnull)fromDate
+                                             toDate:(NSDate*_Nonnull)toDate;
+
+@property (strong, readonly) NSURL *_Nonnull URL;
+@end
+
+///@brief Turns a log written by BNCLogSetOutputToURLBinary back into records.
+@interface BNCLogBinaryDecoder : NSObject
+
+- (instancetype _Nullable) initWithData:(NSData*_Nonnull)data
+                                  error:(NSError*_Nullable __autoreleasing*_Nullable)error
+                                  NS_DESIGNATED_INITIALIZER;
+- (instancetype _Nullable) initWithURL:(NSURL*_Nonnull)URL
+                                 error:(NSError*_Nullable __autoreleasing*_Nullable)error;
+- (instancetype _Nonnull) init NS_UNAVAILABLE;
+
+///@return Returns up to `count` records, oldest first. Returns an empty array at the end of the
+///        log. A record that was cut short, like the last record after a crash, ends the log.
+- (NSArray<BNCLogRecord*>*_Nonnull) readRecords:(NSInteger)count;
+@end
@@ -11,6 +11,8 @@
 #import "BNCLog.h"
 #import <stdatomic.h>
 #import <sys/sysctl.h>
+#import <sys/stat.h>
+#import <sys/uio.h>
 
 #define _countof(array)  (sizeof(array)/sizeof(array[0]))
 
@@ -65,6 +67,30 @@ static BNCLogOutputFunctionPtr bnc_LoggingFunction = nil; // Default to just NSL
 static BNCLogFlushFunctionPtr  bnc_LogFlushFunction = nil;
 static NSDateFormatter *bnc_LogDateFormatter = nil;
 
+// While the binary log is open messages are packed rather than formatted. Read by every message.
+static _Atomic(bool) bnc_LogBinaryIsEnabled = false;
+
+// Whether there's an output function, so that the level check can skip the output level when
+// there isn't. Read by every message.
+static _Atomic(bool) bnc_LogHasOutputFunction = false;
+
+// Sets the output function. Called on the bnc_LogQueue.
+static void BNCLogSetLoggingFunction_Internal(BNCLogOutputFunctionPtr function) {
+    bnc_LoggingFunction = function;
+    atomic_store_explicit(&bnc_LogHasOutputFunction, function != NULL, memory_order_relaxed);
+}
+
+static NSString *const bnc_LogLevelNames[BNCLogLevelMax] = {
+    @"DebugSDK",
+    @"Break",
+    @"Debug",
+    @"Warning",
+    @"Error",
+    @"Assert",
+    @"Log",
+    @"None",
+};
+
 // A fallback attempt at logging if an error occurs in BNCLog.
 // BNCLog can't log itself, but if an error occurs it uses this simple define:
 extern void BNCLogInternalErrorFunction(int linenumber, NSString*format, ...);
@@ -82,16 +108,526 @@ void BNCLogInternalErrorFunction(int linenumber, NSString*format, ...) {
     BNCLogInternalErrorFunction(__LINE__, __VA_ARGS__)
 
 
+static _Atomic(BNCLogClientInitializeFunctionPtr) bnc_LogClientInitializeFunctionPtr = (BNCLogClientInitializeFunctionPtr) 0;
+
 inline static void BNCLogInitializeClient_Internal() {
+    // Only exchange the pointer if there is one, so that checking is a plain read:
+    if (!atomic_load_explicit(&bnc_LogClientInitializeFunctionPtr, memory_order_acquire)) return;
     BNCLogClientInitializeFunctionPtr initFunction = BNCLogSetClientInitializeFunction(NULL);
     if (initFunction) {
         initFunction();
     }
 }
 
-#pragma mark - Default Output Functions
+#pragma mark - Batched Writes
+
+// While messages are being written on the bnc_LogQueue, the writes of the output functions are
+// collected here and written with one `writev` call for each batch.
+
+#define kBNCLogBatchVectorMax   256
+
+static __thread BOOL bnc_LogIsDraining = NO;
+static int bnc_LogBatchDescriptor = -1;
+static int bnc_LogBatchCount = 0;
+static struct iovec bnc_LogBatchVectors[kBNCLogBatchVectorMax];
+static NSData *bnc_LogBatchData[kBNCLogBatchVectorMax]; // Keeps the vector bytes alive.
+static NSData *bnc_LogNewLineData = nil;
+
+// Group commit:
+static NSTimeInterval bnc_LogGroupCommitInterval = 0.0;
+static long bnc_LogGroupCommitBytes = 0;
+static long bnc_LogUnflushedBytes = 0;
+static NSTimeInterval bnc_LogUnflushedTime = 0.0;
+static BOOL bnc_LogGroupCommitIsScheduled = NO;
 
-static int bnc_LogDescriptor = -1;
+static void BNCLogWriteBatch_Internal() {
+    struct iovec *vector = bnc_LogBatchVectors;
+    int count = bnc_LogBatchCount;
+    while (count > 0) {
+        ssize_t n = writev(bnc_LogBatchDescriptor, vector, count);
+        if (n < 0) {
+            int e = errno;
+            if (e == EINTR) continue;
+            BNCLogInternalError(@"Can't write log messages (%d): %s.", e, strerror(e));
+            break;
+        }
+        if (bnc_LogUnflushedBytes == 0) bnc_LogUnflushedTime = [NSDate timeIntervalSinceReferenceDate];
+        bnc_LogUnflushedBytes += n;
+
+        // Skip what was written in case the write was short:
+        while (count > 0 && (size_t) n >= vector->iov_len) {
+            n -= vector->iov_len;
+            vector++;
+            count--;
+        }
+        if (count > 0) {
+            vector->iov_base = (char*) vector->iov_base + n;
+            vector->iov_len -= n;
+        }
+    }
+    for (int i = 0; i < bnc_LogBatchCount; i++)
+        bnc_LogBatchData[i] = nil;
+    bnc_LogBatchCount = 0;
+    bnc_LogBatchDescriptor = -1;
+}
+
+void BNCLogWriteToDescriptor(int descriptor, NSData *_Nonnull data) {
+    if (descriptor < 0 || data.length == 0) return;
+    if (!bnc_LogIsDraining) {
+        long n = write(descriptor, data.bytes, data.length);
+        if (n < 0) {
+            int e = errno;
+            BNCLogInternalError(@"Can't write log message (%d): %s.", e, strerror(e));
+        }
+        return;
+    }
+    if (descriptor != bnc_LogBatchDescriptor || bnc_LogBatchCount >= kBNCLogBatchVectorMax)
+        BNCLogWriteBatch_Internal();
+    data = [data copy];
+    bnc_LogBatchDescriptor = descriptor;
+    bnc_LogBatchData[bnc_LogBatchCount] = data;
+    bnc_LogBatchVectors[bnc_LogBatchCount].iov_base = (void*) data.bytes;
+    bnc_LogBatchVectors[bnc_LogBatchCount].iov_len = data.length;
+    bnc_LogBatchCount++;
+}
+
+// The displayed messages of a batch are collected here and handed to NSLog together at the end of
+// the batch, so that a burst of messages costs one NSLog call rather than one for each message.
+
+#define kBNCLogDisplayBatchMax  (64*1024)
+
+static NSMutableString *bnc_LogDisplayBatch = nil;
+
+static void BNCLogWriteDisplayBatch_Internal() {
+    if (bnc_LogDisplayBatch.length == 0) return;
+    [bnc_LogDisplayBatch deleteCharactersInRange:NSMakeRange(bnc_LogDisplayBatch.length-1, 1)];
+    NSLog(@"%@", bnc_LogDisplayBatch); // Upgrade this to unified logging when we can.
+    [bnc_LogDisplayBatch setString:@""];
+}
+
+static void BNCLogDisplayMessage_Internal(NSString *message) {
+    if (!bnc_LogDisplayBatch) bnc_LogDisplayBatch = [[NSMutableString alloc] initWithCapacity:kBNCLogDisplayBatchMax];
+    [bnc_LogDisplayBatch appendString:message];
+    [bnc_LogDisplayBatch appendString:@"\n"];
+    if (!bnc_LogIsDraining || bnc_LogDisplayBatch.length >= kBNCLogDisplayBatchMax)
+        BNCLogWriteDisplayBatch_Internal();
+}
+
+static void BNCLogWriteBinaryBatch_Internal(void);
+static void BNCLogBinaryFlush_Internal(void);
+
+static void BNCLogFlush_Internal() {
+    BNCLogWriteBatch_Internal();
+    BNCLogWriteDisplayBatch_Internal();
+    BNCLogBinaryFlush_Internal();
+    if (bnc_LogFlushFunction)
+        bnc_LogFlushFunction();
+    bnc_LogUnflushedBytes = 0;
+}
+
+static void BNCLogDrainMessages_Internal(void);
+
+static void BNCLogGroupCommitTimer(void *context) {
+    bnc_LogGroupCommitIsScheduled = NO;
+    BNCLogDrainMessages_Internal();
+}
+
+// Flushes once the group commit interval or byte count is reached.
+static void BNCLogGroupCommit_Internal() {
+    if (bnc_LogUnflushedBytes == 0 || !bnc_LogFlushFunction) return;
+    NSTimeInterval age = [NSDate timeIntervalSinceReferenceDate] - bnc_LogUnflushedTime;
+    if ((bnc_LogGroupCommitBytes > 0 && bnc_LogUnflushedBytes >= bnc_LogGroupCommitBytes) ||
+        (bnc_LogGroupCommitInterval > 0.0 && age >= bnc_LogGroupCommitInterval)) {
+        BNCLogFlush_Internal();
+        return;
+    }
+    if (bnc_LogGroupCommitInterval > 0.0 && !bnc_LogGroupCommitIsScheduled) {
+        bnc_LogGroupCommitIsScheduled = YES;
+        NSTimeInterval delay = bnc_LogGroupCommitInterval - age;
+        dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+            bnc_LogQueue, NULL, BNCLogGroupCommitTimer);
+    }
+}
+
+void BNCLogSetGroupCommit(NSTimeInterval interval, long bytes) {
+    dispatch_async(bnc_LogQueue, ^{
+        bnc_LogGroupCommitInterval = MAX(0.0, interval);
+        bnc_LogGroupCommitBytes = MAX(0, bytes);
+        BNCLogGroupCommit_Internal();
+    });
+}
+
+#pragma mark - Message Buffer
+
+// Messages are passed to the bnc_LogQueue through a bounded ring buffer that any thread can add
+// to without a lock. Each slot's sequence number tells whether it's free for the producer at that
+// position or ready for the consumer. The queue drains the ring in batches, and a drain is only
+// scheduled when one isn't already pending, so there's no block or syscall for every message.
+
+#define kBNCLogRingSize     4096  // Must be a power of two.
+
+typedef struct BNCLogMessage {
+    _Atomic(uint64_t)   sequence;
+    NSTimeInterval      timestamp;
+    BNCLogLevel         level;
+    void                *message; // A retained NSString, or a BNCLogPackedMessage for the binary log.
+} BNCLogMessage;
+
+static BNCLogMessage bnc_LogRing[kBNCLogRingSize];
+static _Atomic(uint64_t) bnc_LogRingHead = 0;   // The next position to add to.
+static uint64_t bnc_LogRingTail = 0;            // The next position to drain. Only used on the queue.
+static _Atomic(bool) bnc_LogDrainIsScheduled = false;
+static _Atomic(BNCLogOverflowPolicy) bnc_LogOverflowPolicy = BNCLogOverflowPolicyBlock;
+static _Atomic(uint64_t) bnc_LogDroppedCount = 0;
+static uint64_t bnc_LogDroppedCountReported = 0;
+static _Atomic(long) bnc_LogWaitingProducers = 0;
+static dispatch_semaphore_t bnc_LogRingSpaceSemaphore = nil;
+
+static void BNCLogRingInitialize_Internal() {
+    for (uint64_t i = 0; i < kBNCLogRingSize; i++)
+        atomic_init(&bnc_LogRing[i].sequence, i);
+    bnc_LogRingSpaceSemaphore = dispatch_semaphore_create(0);
+}
+
+static void BNCLogDrainScheduled(void *context) {
+    atomic_store(&bnc_LogDrainIsScheduled, false);
+    BNCLogDrainMessages_Internal();
+}
+
+static void BNCLogScheduleDrain() {
+    if (!atomic_exchange(&bnc_LogDrainIsScheduled, true))
+        dispatch_async_f(bnc_LogQueue, NULL, BNCLogDrainScheduled);
+}
+
+static void BNCLogEnqueueMessage(BNCLogLevel level, id message) {
+    uint64_t position = atomic_load_explicit(&bnc_LogRingHead, memory_order_relaxed);
+    BNCLogMessage *slot = NULL;
+    while (YES) {
+        slot = &bnc_LogRing[position & (kBNCLogRingSize-1)];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t difference = (int64_t) sequence - (int64_t) position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&bnc_LogRingHead, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (difference < 0) {
+            // The ring is full. A drain can't wait for itself, so it always drops:
+            if (bnc_LogIsDraining ||
+                atomic_load(&bnc_LogOverflowPolicy) == BNCLogOverflowPolicyDrop) {
+                atomic_fetch_add_explicit(&bnc_LogDroppedCount, 1, memory_order_relaxed);
+                return;
+            }
+            // Other code on the queue would wait forever for a drain, so it drains the ring itself:
+            if (dispatch_get_specific(&bnc_LogQueue)) {
+                BNCLogDrainMessages_Internal();
+                position = atomic_load_explicit(&bnc_LogRingHead, memory_order_relaxed);
+                continue;
+            }
+            BNCLogScheduleDrain();
+            atomic_fetch_add(&bnc_LogWaitingProducers, 1);
+            dispatch_semaphore_wait(bnc_LogRingSpaceSemaphore,
+                dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.010 * NSEC_PER_SEC)));
+            atomic_fetch_sub(&bnc_LogWaitingProducers, 1);
+            position = atomic_load_explicit(&bnc_LogRingHead, memory_order_relaxed);
+        } else {
+            position = atomic_load_explicit(&bnc_LogRingHead, memory_order_relaxed);
+        }
+    }
+    slot->timestamp = [NSDate timeIntervalSinceReferenceDate];
+    slot->level = level;
+    slot->message = (__bridge_retained void*) message;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    BNCLogScheduleDrain();
+}
+
+static void BNCLogSignalWaitingProducers() {
+    long waiting = atomic_load(&bnc_LogWaitingProducers);
+    for (long i = 0; i < waiting; i++)
+        dispatch_semaphore_signal(bnc_LogRingSpaceSemaphore);
+}
+
+static void BNCLogBinaryWrite_Internal(NSTimeInterval timestamp, BNCLogLevel level, id message);
+static NSString *BNCLogStringFromMessage(BNCLogLevel level, id message);
+
+static void BNCLogOutputMessage_Internal(NSTimeInterval timestamp, BNCLogLevel level, id message) {
+    BOOL isDisplayed = (level >= BNCLogDisplayLevel());
+    BOOL isOutput = isDisplayed || level >= BNCLogOutputLevel();
+    // The binary log is written along with NSLog and the output function, and gets what the
+    // output function gets:
+    if (isOutput && atomic_load_explicit(&bnc_LogBinaryIsEnabled, memory_order_relaxed))
+        BNCLogBinaryWrite_Internal(timestamp, level, message);
+    if (!isDisplayed && !(isOutput && bnc_LoggingFunction)) return;
+
+    // Messages are packed rather than formatted while the binary log is open:
+    message = BNCLogStringFromMessage(level, message);
+    if (isDisplayed)
+        BNCLogDisplayMessage_Internal(message);
+    if (isOutput && bnc_LoggingFunction)
+        bnc_LoggingFunction([NSDate dateWithTimeIntervalSinceReferenceDate:timestamp], level, message);
+}
+
+// Writes all the buffered messages. Called on the bnc_LogQueue.
+static void BNCLogDrainMessages_Internal() {
+    bnc_LogIsDraining = YES;
+    long count = 0;
+    while (YES) {
+        BNCLogMessage *slot = &bnc_LogRing[bnc_LogRingTail & (kBNCLogRingSize-1)];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence != bnc_LogRingTail + 1) break;
+        @autoreleasepool {
+            NSTimeInterval timestamp = slot->timestamp;
+            BNCLogLevel level = slot->level;
+            id message = (__bridge_transfer id) slot->message;
+            slot->message = NULL;
+            atomic_store_explicit(&slot->sequence, bnc_LogRingTail + kBNCLogRingSize, memory_order_release);
+            bnc_LogRingTail++;
+            BNCLogOutputMessage_Internal(timestamp, level, message);
+        }
+        if ((++count % 64) == 0) BNCLogSignalWaitingProducers();
+    }
+    BNCLogSignalWaitingProducers();
+
+    uint64_t dropped = atomic_load_explicit(&bnc_LogDroppedCount, memory_order_relaxed);
+    if (dropped != bnc_LogDroppedCountReported) {
+        if (BNCLogLevelIsEnabled(BNCLogLevelWarning)) {
+            NSString *message = [NSString stringWithFormat:
+                @"[branch.io] BNCLog.m(%d) Warning: %llu log messages were dropped.",
+                __LINE__, dropped - bnc_LogDroppedCountReported];
+            BNCLogOutputMessage_Internal([NSDate timeIntervalSinceReferenceDate], BNCLogLevelWarning, message);
+        }
+        bnc_LogDroppedCountReported = dropped;
+    }
+
+    BNCLogWriteBatch_Internal();
+    BNCLogWriteDisplayBatch_Internal();
+    BNCLogWriteBinaryBatch_Internal();
+    bnc_LogIsDraining = NO;
+    BNCLogGroupCommit_Internal();
+}
+
+void BNCLogSetOverflowPolicy(BNCLogOverflowPolicy policy) {
+    atomic_store(&bnc_LogOverflowPolicy, policy);
+}
+
+uint64_t BNCLogDroppedMessageCount() {
+    return atomic_load(&bnc_LogDroppedCount);
+}
+
+#pragma mark - Wrap Log Index
+
+// A wrapping log keeps an index next to it in '<log file>.idx'. The index has the write position,
+// so the log can be opened without reading it, and the offsets and times of the records so that a
+// BNCLogFileReader can seek by time. Record wrap logs have an entry for each record. Byte wrap logs
+// have an entry for the first record that starts in each page of the log.
+//
+// The index is written when the log is flushed. If the log has changed since then, the index
+// won't match the log's size and modification time and the log is read the slow way instead.
+
+#define kBNCLogIndexMagic       "BNCLIDX1"
+#define kBNCLogIndexPageSize    4096
+
+typedef NS_ENUM(int64_t, BNCLogIndexKind) {
+    BNCLogIndexKindRecordWrap = 1,
+    BNCLogIndexKindByteWrap,
+};
+
+typedef struct BNCLogIndexHeader {
+    char            magic[8];
+    int64_t         kind;
+    int64_t         maxSize;        // The maximum records or bytes of the log.
+    int64_t         recordSize;
+    int64_t         entryCount;
+    int64_t         writeOffset;    // The byte offset of the next write.
+    int64_t         fileSize;
+    int64_t         fileModified;   // In nanoseconds.
+} BNCLogIndexHeader;
+
+typedef struct BNCLogIndexEntry {
+    int64_t         offset;         // The byte offset of the record, or -1 if there's none.
+    NSTimeInterval  timestamp;
+} BNCLogIndexEntry;
+
+static int bnc_LogDescriptor = -1;        // The log file of the file output functions.
+static int bnc_LogIndexDescriptor = -1;
+static BNCLogIndexHeader bnc_LogIndexHeader;
+static BNCLogIndexEntry *bnc_LogIndexEntries = NULL;
+
+static inline int64_t BNCLogModifiedNanoseconds(const struct stat *status) {
+    return (int64_t) status->st_mtimespec.tv_sec * 1000000000 + status->st_mtimespec.tv_nsec;
+}
+
+static inline int BNCLogDigits(const char *bytes, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++)
+        value = value * 10 + (bytes[i] - '0');
+    return value;
+}
+
+// Parses a record's timestamp, like '2018-11-02T10:15:30.123456Z'. This is what
+// bnc_LogDateFormatter writes, but it's much faster than the formatter.
+static BOOL BNCLogTimestampFromBytes(const char *bytes, size_t length, NSTimeInterval *timestamp) {
+    static const char pattern[] = "dddd-dd-ddTdd:dd:dd.ddddddZ";
+    if (length < sizeof(pattern)-1) return NO;
+    for (size_t i = 0; i < sizeof(pattern)-1; i++) {
+        if (pattern[i] == 'd') {
+            if (bytes[i] < '0' || bytes[i] > '9') return NO;
+        } else if (bytes[i] != pattern[i])
+            return NO;
+    }
+    struct tm time = {0};
+    time.tm_year = BNCLogDigits(bytes, 4) - 1900;
+    time.tm_mon  = BNCLogDigits(bytes+5, 2) - 1;
+    time.tm_mday = BNCLogDigits(bytes+8, 2);
+    time.tm_hour = BNCLogDigits(bytes+11, 2);
+    time.tm_min  = BNCLogDigits(bytes+14, 2);
+    time.tm_sec  = BNCLogDigits(bytes+17, 2);
+    *timestamp = (double) timegm(&time) - NSTimeIntervalSince1970 + BNCLogDigits(bytes+20, 6) / 1000000.0;
+    return YES;
+}
+
+static void BNCLogIndexClearEntries_Internal() {
+    for (int64_t i = 0; i < bnc_LogIndexHeader.entryCount; i++)
+        bnc_LogIndexEntries[i] = (BNCLogIndexEntry) { -1, 0.0 };
+}
+
+static void BNCLogIndexClose_Internal() {
+    if (bnc_LogIndexDescriptor >= 0) {
+        close(bnc_LogIndexDescriptor);
+        bnc_LogIndexDescriptor = -1;
+    }
+    if (bnc_LogIndexEntries) {
+        free(bnc_LogIndexEntries);
+        bnc_LogIndexEntries = NULL;
+    }
+    memset(&bnc_LogIndexHeader, 0, sizeof(bnc_LogIndexHeader));
+}
+
+// Opens the index of the log at `url`. Returns YES and the write offset if the index matches the
+// log. Otherwise the index starts empty and the caller fills it in as it reads the log.
+static BOOL BNCLogIndexOpen_Internal(
+        NSURL *url,
+        BNCLogIndexKind kind,
+        int64_t maxSize,
+        int64_t recordSize,
+        off_t *writeOffset
+    ) {
+    BNCLogIndexClose_Internal();
+    int64_t entryCount =
+        (kind == BNCLogIndexKindRecordWrap) ? maxSize : maxSize / kBNCLogIndexPageSize + 1;
+    bnc_LogIndexEntries = malloc(entryCount * sizeof(BNCLogIndexEntry));
+    if (!bnc_LogIndexEntries) {
+        BNCLogInternalError(@"Can't allocate a log index of %lld entries.", entryCount);
+        return NO;
+    }
+    memcpy(bnc_LogIndexHeader.magic, kBNCLogIndexMagic, sizeof(bnc_LogIndexHeader.magic));
+    bnc_LogIndexHeader.kind = kind;
+    bnc_LogIndexHeader.maxSize = maxSize;
+    bnc_LogIndexHeader.recordSize = recordSize;
+    bnc_LogIndexHeader.entryCount = entryCount;
+    BNCLogIndexClearEntries_Internal();
+
+    NSString *path = [url.path stringByAppendingString:@".idx"];
+    bnc_LogIndexDescriptor = open(path.UTF8String, O_RDWR|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+    if (bnc_LogIndexDescriptor < 0) {
+        int e = errno;
+        BNCLogInternalError(@"Can't open log index (%d): %s.", e, strerror(e));
+        return NO;
+    }
+
+    struct stat status;
+    BNCLogIndexHeader saved;
+    if (fstat(bnc_LogDescriptor, &status) != 0 || status.st_size == 0) return NO;
+    if (pread(bnc_LogIndexDescriptor, &saved, sizeof(saved), 0) != sizeof(saved)) return NO;
+    if (memcmp(saved.magic, bnc_LogIndexHeader.magic, sizeof(saved.magic)) != 0 ||
+        saved.kind != kind ||
+        saved.maxSize != maxSize ||
+        saved.recordSize != recordSize ||
+        saved.entryCount != entryCount ||
+        saved.fileSize != status.st_size ||
+        saved.fileModified != BNCLogModifiedNanoseconds(&status) ||
+        saved.writeOffset < 0 ||
+        saved.writeOffset > saved.fileSize)
+        return NO;
+
+    ssize_t entriesSize = (ssize_t) (entryCount * sizeof(BNCLogIndexEntry));
+    if (pread(bnc_LogIndexDescriptor, bnc_LogIndexEntries, entriesSize, sizeof(saved)) != entriesSize)
+        goto error_exit;
+
+    // The newest record should be where the index says it is:
+    BNCLogIndexEntry *newest = NULL;
+    for (int64_t i = 0; i < entryCount; i++) {
+        BNCLogIndexEntry *entry = &bnc_LogIndexEntries[i];
+        if (entry->offset >= 0 && (!newest || entry->timestamp >= newest->timestamp))
+            newest = entry;
+    }
+    if (newest) {
+        char bytes[27];
+        NSTimeInterval timestamp = 0.0;
+        if (pread(bnc_LogDescriptor, bytes, sizeof(bytes), newest->offset) != sizeof(bytes) ||
+            !BNCLogTimestampFromBytes(bytes, sizeof(bytes), &timestamp) ||
+            timestamp != newest->timestamp)
+            goto error_exit;
+    }
+    *writeOffset = saved.writeOffset;
+    return YES;
+
+error_exit:
+    BNCLogIndexClearEntries_Internal();
+    return NO;
+}
+
+// Notes a record that is written at `offset`. The timestamp is the one written in the record.
+static void BNCLogIndexAddRecord_Internal(off_t offset, off_t length, NSTimeInterval timestamp) {
+    if (!bnc_LogIndexEntries || length <= 0) return;
+    if (bnc_LogIndexHeader.kind == BNCLogIndexKindRecordWrap) {
+        int64_t slot = offset / bnc_LogIndexHeader.recordSize;
+        if (slot >= 0 && slot < bnc_LogIndexHeader.entryCount)
+            bnc_LogIndexEntries[slot] = (BNCLogIndexEntry) { offset, timestamp };
+        return;
+    }
+    // Forget the records that are written over:
+    int64_t firstPage = offset / kBNCLogIndexPageSize;
+    int64_t lastPage = MIN((offset + length - 1) / kBNCLogIndexPageSize, bnc_LogIndexHeader.entryCount - 1);
+    for (int64_t page = firstPage; page <= lastPage; page++) {
+        BNCLogIndexEntry *entry = &bnc_LogIndexEntries[page];
+        if (entry->offset >= offset && entry->offset < offset + length)
+            entry->offset = -1;
+    }
+    if (firstPage < bnc_LogIndexHeader.entryCount) {
+        BNCLogIndexEntry *entry = &bnc_LogIndexEntries[firstPage];
+        if (entry->offset < 0 || entry->offset > offset)
+            *entry = (BNCLogIndexEntry) { offset, timestamp };
+    }
+}
+
+// Forgets the records at or past `size` when the log is truncated.
+static void BNCLogIndexTruncate_Internal(off_t size) {
+    if (!bnc_LogIndexEntries) return;
+    for (int64_t i = 0; i < bnc_LogIndexHeader.entryCount; i++) {
+        if (bnc_LogIndexEntries[i].offset >= size)
+            bnc_LogIndexEntries[i].offset = -1;
+    }
+}
+
+// Saves the index. Called when the log is flushed.
+static void BNCLogIndexWrite_Internal(off_t writeOffset) {
+    if (bnc_LogIndexDescriptor < 0 || bnc_LogDescriptor < 0 || !bnc_LogIndexEntries) return;
+    struct stat status;
+    if (fstat(bnc_LogDescriptor, &status) != 0) return;
+    bnc_LogIndexHeader.writeOffset = writeOffset;
+    bnc_LogIndexHeader.fileSize = status.st_size;
+    bnc_LogIndexHeader.fileModified = BNCLogModifiedNanoseconds(&status);
+    ssize_t entriesSize = (ssize_t) (bnc_LogIndexHeader.entryCount * sizeof(BNCLogIndexEntry));
+    if (pwrite(bnc_LogIndexDescriptor, &bnc_LogIndexHeader, sizeof(bnc_LogIndexHeader), 0)
+            != sizeof(bnc_LogIndexHeader) ||
+        pwrite(bnc_LogIndexDescriptor, bnc_LogIndexEntries, entriesSize, sizeof(bnc_LogIndexHeader))
+            != entriesSize) {
+        int e = errno;
+        BNCLogInternalError(@"Can't write log index (%d): %s.", e, strerror(e));
+    }
+}
+
+#pragma mark - Default Output Functions
 
 void BNCLogFunctionOutputToStdOut(
         NSDate*_Nonnull timestamp,
@@ -100,12 +636,8 @@ void BNCLogFunctionOutputToStdOut(
     ) {
     NSData *data = [message dataUsingEncoding:NSNEXTSTEPStringEncoding];
     if (!data) data = [@"<nil>" dataUsingEncoding:NSNEXTSTEPStringEncoding];
-    long n = write(STDOUT_FILENO, data.bytes, data.length);
-    if (n < 0) {
-        int e = errno;
-        BNCLogInternalError(@"Can't write log message (%d): %s.", e, strerror(e));
-    }
-    write(STDOUT_FILENO, "\n   ", sizeof('\n'));
+    BNCLogWriteToDescriptor(STDOUT_FILENO, data);
+    BNCLogWriteToDescriptor(STDOUT_FILENO, bnc_LogNewLineData);
 }
 
 void BNCLogFunctionOutputToStdErr(
@@ -115,12 +647,8 @@ void BNCLogFunctionOutputToStdErr(
     ) {
     NSData *data = [message dataUsingEncoding:NSNEXTSTEPStringEncoding];
     if (!data) data = [@"<nil>" dataUsingEncoding:NSNEXTSTEPStringEncoding];
-    long n = write(STDERR_FILENO, data.bytes, data.length);
-    if (n < 0) {
-        int e = errno;
-        BNCLogInternalError(@"Can't write log message (%d): %s.", e, strerror(e));
-    }
-    write(STDERR_FILENO, "\n   ", sizeof('\n'));
+    BNCLogWriteToDescriptor(STDERR_FILENO, data);
+    BNCLogWriteToDescriptor(STDERR_FILENO, bnc_LogNewLineData);
 }
 
 void BNCLogFunctionOutputToFileDescriptor(
@@ -139,11 +667,7 @@ void BNCLogFunctionOutputToFileDescriptor(
     if ((data.length & 1) != 0) {
         BNCLogInternalError(@"Writing un-even bytes!");
     }
-    long n = write(bnc_LogDescriptor, data.bytes, data.length);
-    if (n < 0) {
-        int e = errno;
-        BNCLogInternalError(@"Can't write log message (%d): %s.", e, strerror(e));
-    }
+    BNCLogWriteToDescriptor(bnc_LogDescriptor, data);
 }
 
 void BNCLogFlushFileDescriptor() {
@@ -152,6 +676,15 @@ void BNCLogFlushFileDescriptor() {
     }
 }
 
+// Closes the log file of the file output functions.
+static void BNCLogCloseFile_Internal() {
+    if (bnc_LogDescriptor >= 0) {
+        close(bnc_LogDescriptor);
+        bnc_LogDescriptor = -1;
+    }
+    BNCLogIndexClose_Internal();
+}
+
 void BNCLogSetOutputToURL_Interal(NSURL *_Nullable url) {
     if (url == nil) return;
     bnc_LogDescriptor = open(
@@ -165,18 +698,15 @@ void BNCLogSetOutputToURL_Interal(NSURL *_Nullable url) {
         BNCLogInternalError(@"Can't open log file (%d): %s.", e, strerror(e));
         return;
     }
-    bnc_LoggingFunction = BNCLogFunctionOutputToFileDescriptor;
+    BNCLogSetLoggingFunction_Internal(BNCLogFunctionOutputToFileDescriptor);
     bnc_LogFlushFunction = BNCLogFlushFileDescriptor;
 }
 
 void BNCLogSetOutputToURL(NSURL *_Nullable url) {
     dispatch_sync(bnc_LogQueue, ^{
-        if (bnc_LogFlushFunction)
-            bnc_LogFlushFunction();
-        if (bnc_LogDescriptor >= 0) {
-            close(bnc_LogDescriptor);
-            bnc_LogDescriptor = -1;
-        }
+        BNCLogDrainMessages_Internal();
+        BNCLogFlush_Internal();
+        BNCLogCloseFile_Internal();
         BNCLogSetOutputToURL_Interal(url);
     });
 }
@@ -195,15 +725,15 @@ void BNCLogRecordWrapWrite(NSDate*_Nonnull timestamp, BNCLogLevel level, NSStrin
     long len = MIN(stringData.length, sizeof(buffer)-1);
     memcpy(buffer, stringData.bytes, len);
 
-    off_t n = write(bnc_LogDescriptor, buffer, sizeof(buffer));
-    if (n < 0) {
-        int e = errno;
-        BNCLogInternalError(@"Can't write log message (%d): %s.", e, strerror(e));
-    }
+    NSTimeInterval recordTime = 0.0;
+    if (BNCLogTimestampFromBytes(buffer, sizeof(buffer), &recordTime))
+        BNCLogIndexAddRecord_Internal(bnc_LogOffset*bnc_LogRecordSize, sizeof(buffer), recordTime);
+    BNCLogWriteToDescriptor(bnc_LogDescriptor, [NSData dataWithBytes:buffer length:sizeof(buffer)]);
     bnc_LogOffset++;
     if (bnc_LogOffset >= bnc_LogOffsetMax) {
         bnc_LogOffset = 0;
-        n = lseek(bnc_LogDescriptor, 0, SEEK_SET);
+        BNCLogWriteBatch_Internal();
+        off_t n = lseek(bnc_LogDescriptor, 0, SEEK_SET);
         if (n < 0) {
             int e = errno;
             BNCLogInternalError(@"Can't seek in log (%d): %s.", e, strerror(e));
@@ -214,6 +744,7 @@ void BNCLogRecordWrapWrite(NSDate*_Nonnull timestamp, BNCLogLevel level, NSStrin
 void BNCLogRecordWrapFlush() {
     if (bnc_LogDescriptor >= 0) {
         fsync(bnc_LogDescriptor);
+        BNCLogIndexWrite_Internal(bnc_LogOffset*bnc_LogRecordSize);
     }
 }
 
@@ -236,7 +767,7 @@ BOOL BNCLogRecordWrapOpenURL_Internal(NSURL *url, long maxRecords, long recordSi
         BNCLogInternalError(@"Can't open log file (%d): %s.", e, strerror(e));
         return NO;
     }
-    bnc_LoggingFunction = BNCLogRecordWrapWrite;
+    BNCLogSetLoggingFunction_Internal(BNCLogRecordWrapWrite);
     bnc_LogFlushFunction = BNCLogRecordWrapFlush;
 
     // Truncate the file if the file size > max file size.
@@ -256,26 +787,42 @@ BOOL BNCLogRecordWrapOpenURL_Internal(NSURL *url, long maxRecords, long recordSi
     }
     lseek(bnc_LogDescriptor, 0, SEEK_SET);
 
+    // Use the index to find the write position if it's up to date --
+
+    off_t writeOffset = 0;
+    if (BNCLogIndexOpen_Internal(url,
+            BNCLogIndexKindRecordWrap, bnc_LogOffsetMax, bnc_LogRecordSize, &writeOffset)) {
+        bnc_LogOffset = writeOffset / bnc_LogRecordSize;
+        if (bnc_LogOffset >= bnc_LogOffsetMax) bnc_LogOffset = 0;
+        sz = lseek(bnc_LogDescriptor, bnc_LogOffset*bnc_LogRecordSize, SEEK_SET);
+        if (sz < 0) {
+            int e = errno;
+            BNCLogInternalError(@"Can't seek in log (%d): %s.", e, strerror(e));
+        }
+        return YES;
+    }
+
     // Read the records until the oldest record is found --
 
     off_t oldestOffset = 0;
-    NSDate * oldestDate = [NSDate distantFuture];
-    NSDate * lastDate = [NSDate distantFuture];
+    NSTimeInterval oldestDate = INFINITY;
+    NSTimeInterval lastDate = INFINITY;
 
     off_t offset = 0;
     char buffer[bnc_LogRecordSize];
     ssize_t bytesRead = read(bnc_LogDescriptor, &buffer, sizeof(buffer));
     while ((unsigned long) bytesRead == sizeof(buffer)) {
-        NSString *dateString =
-            [[NSString alloc] initWithBytes:buffer length:27 encoding:NSUTF8StringEncoding];
-        NSDate *date = [bnc_LogDateFormatter dateFromString:dateString];
-        if ([date compare:oldestDate] < 0 ||
-              [date compare:lastDate] < 0) {
+        NSTimeInterval date = 0.0;
+        BOOL hasDate = BNCLogTimestampFromBytes(buffer, sizeof(buffer), &date);
+        if (hasDate && (date < oldestDate || date < lastDate)) {
             oldestOffset = offset;
             oldestDate = date;
         }
+        if (hasDate) {
+            BNCLogIndexAddRecord_Internal(offset*bnc_LogRecordSize, sizeof(buffer), date);
+            lastDate = date;
+        }
         offset++;
-        if (date) lastDate = date;
         bytesRead = read(bnc_LogDescriptor, &buffer, sizeof(buffer));
     }
     if (offset < bnc_LogOffsetMax)
@@ -296,13 +843,10 @@ BOOL BNCLogRecordWrapOpenURL_Internal(NSURL *url, long maxRecords, long recordSi
 BOOL BNCLogRecordWrapOpenURL(NSURL *url, long maxRecords, long recordSize) {
     __block BOOL result = NO;
     dispatch_sync(bnc_LogQueue, ^{
-        if (bnc_LogFlushFunction)
-            bnc_LogFlushFunction();
-        if (bnc_LogDescriptor >= 0) {
-            close(bnc_LogDescriptor);
-            bnc_LogDescriptor = -1;
-        }
-        bnc_LoggingFunction = NULL;
+        BNCLogDrainMessages_Internal();
+        BNCLogFlush_Internal();
+        BNCLogCloseFile_Internal();
+        BNCLogSetLoggingFunction_Internal(NULL);
         bnc_LogFlushFunction = NULL;
         result = BNCLogRecordWrapOpenURL_Internal(url, maxRecords, recordSize);
     });
@@ -334,93 +878,63 @@ void BNCLogByteWrapWrite(NSDate*_Nonnull timestamp, BNCLogLevel level, NSString
     // Truncate the file if the file size > max file size.
 
     if ((bnc_LogOffset + stringData.length) > bnc_LogOffsetMax) {
+        BNCLogWriteBatch_Internal();
         long n = ftruncate(bnc_LogDescriptor, bnc_LogOffset);
         if (n < 0) {
             int e = errno;
             BNCLogInternalError(@"Can't truncate log (%d): %s.", e, strerror(e));
         }
+        BNCLogIndexTruncate_Internal(bnc_LogOffset);
         lseek(bnc_LogDescriptor, 0, SEEK_SET);
         bnc_LogOffset = 0;
     }
 
-    long n = write(bnc_LogDescriptor, stringData.bytes, stringData.length);
-    if (n < 0) {
-        int e = errno;
-        BNCLogInternalError(@"Can't write log message (%d): %s.", e, strerror(e));
-    } else {
-        bnc_LogOffset += n;
-    }
+    NSTimeInterval recordTime = 0.0;
+    if (BNCLogTimestampFromBytes(stringData.bytes, stringData.length, &recordTime))
+        BNCLogIndexAddRecord_Internal(bnc_LogOffset, stringData.length, recordTime);
+    BNCLogWriteToDescriptor(bnc_LogDescriptor, stringData);
+    bnc_LogOffset += stringData.length;
 }
 
 void BNCLogByteWrapFlush() {
     if (bnc_LogDescriptor >= 0) {
         fsync(bnc_LogDescriptor);
+        BNCLogIndexWrite_Internal(bnc_LogOffset);
     }
 }
 
-NSString *BNCLogByteWrapReadNextRecord() {
-
-    char *buffer = NULL;
-    long bufferSize = 0;
-    off_t originalOffset = lseek(bnc_LogDescriptor, 0, SEEK_CUR);
-    if (originalOffset < 0) {
-        int e = errno;
-        BNCLogInternalError(@"Can't find offset in log file (%d): %s.", e, strerror(e));
-        goto error_exit;
-    }
-
-    do {
-
-        bufferSize += 1024;
-        if (buffer) free(buffer);
-        buffer = malloc(bufferSize);
-        if (!buffer) {
-            BNCLogInternalError(@"Can't allocate a buffer of %ld bytes.", bufferSize);
-            goto error_exit;
-        }
-
-        off_t newOffset = lseek(bnc_LogDescriptor, originalOffset, SEEK_SET);
-        if (newOffset < 0) {
-            int e = errno;
-            BNCLogInternalError(@"Can't seek in log file (%d): %s.", e, strerror(e));
-            goto error_exit;
-        }
-        ssize_t bytesRead = read(bnc_LogDescriptor, buffer, bufferSize);
-        if (bytesRead == 0) {
-            goto error_exit;
-        } else if (bytesRead < 0) {
-            int e = errno;
-            if (e != EOF) {
-                BNCLogInternalError(@"Can't read log message (%d): %s.", e, strerror(e));
+// Reads the log ahead in large blocks rather than a record at a time.
+typedef struct BNCLogReadBuffer {
+    char    bytes[64*1024];
+    off_t   offset;     // The file offset of bytes[0].
+    size_t  length;
+} BNCLogReadBuffer;
+
+// Reads the record at bnc_LogOffset, including its '\n', and advances bnc_LogOffset past it.
+// Returns NO at the end of the log or if the record is too long.
+static BOOL BNCLogByteWrapReadNextRecord(BNCLogReadBuffer *buffer, const char **record, size_t *length) {
+    for (int pass = 0; pass < 2; pass++) {
+        if (bnc_LogOffset >= buffer->offset && bnc_LogOffset < buffer->offset + (off_t) buffer->length) {
+            const char *start = buffer->bytes + (bnc_LogOffset - buffer->offset);
+            const char *end = memchr(start, '\n', buffer->bytes + buffer->length - start);
+            if (end) {
+                *record = start;
+                *length = end - start + 1;
+                bnc_LogOffset += *length;
+                return YES;
             }
-            goto error_exit;
         }
-
-        char* p = buffer;
-        intptr_t endByte = bytesRead;
-        while ( (p-buffer) < endByte && *p != '\n') {
-            p++;
-        }
-        if ((p-buffer) < endByte && *p == '\n') {
-            intptr_t offset = (p-buffer)+1;
-            NSString *result =
-                [[NSString alloc]
-                    initWithBytes:buffer length:offset encoding:NSUTF8StringEncoding];
-            bnc_LogOffset = originalOffset + offset;
-            newOffset = lseek(bnc_LogDescriptor, bnc_LogOffset, SEEK_SET);
-            if (newOffset < 0) {
-                int e = errno;
-                BNCLogInternalError(@"Can't seek in log file (%d): %s.", e, strerror(e));
-            }
-            free(buffer);
-            return result;
+        if (pass > 0) break;
+        ssize_t bytesRead = pread(bnc_LogDescriptor, buffer->bytes, sizeof(buffer->bytes), bnc_LogOffset);
+        if (bytesRead < 0) {
+            int e = errno;
+            BNCLogInternalError(@"Can't read log message (%d): %s.", e, strerror(e));
+            return NO;
         }
-
-    } while (bufferSize < 1024*20);
-
-error_exit:
-    if (buffer) free(buffer);
-    return nil;
+        buffer->offset = bnc_LogOffset;
+        buffer->length = bytesRead;
+    }
+    return NO;
 }
 
 BOOL BNCLogByteWrapOpenURL_Internal(NSURL *url, long maxBytes) {
@@ -437,7 +951,7 @@ BOOL BNCLogByteWrapOpenURL_Internal(NSURL *url, long maxBytes) {
         BNCLogInternalError(@"Can't open log file (%d): %s.", e, strerror(e));
         return NO;
     }
-    bnc_LoggingFunction = BNCLogByteWrapWrite;
+    BNCLogSetLoggingFunction_Internal(BNCLogByteWrapWrite);
     bnc_LogFlushFunction = BNCLogByteWrapFlush;
 
     // Truncate the file if the file size > max file size.
@@ -458,29 +972,47 @@ BOOL BNCLogByteWrapOpenURL_Internal(NSURL *url, long maxBytes) {
     bnc_LogOffset = 0;
     lseek(bnc_LogDescriptor, bnc_LogOffset, SEEK_SET);
 
+    // Use the index to find the write position if it's up to date --
+
+    off_t writeOffset = 0;
+    if (BNCLogIndexOpen_Internal(url, BNCLogIndexKindByteWrap, bnc_LogOffsetMax, 0, &writeOffset)) {
+        bnc_LogOffset = (writeOffset >= bnc_LogOffsetMax) ? 0 : writeOffset;
+        newOffset = lseek(bnc_LogDescriptor, bnc_LogOffset, SEEK_SET);
+        if (newOffset < 0) {
+            int e = errno;
+            BNCLogInternalError(@"Can't seek in log (%d): %s.", e, strerror(e));
+        }
+        return YES;
+    }
+
     // Read the records until the oldest record is found --
 
     BOOL logDidWrap = NO;
     off_t wrapOffset = 0;
 
     off_t lastOffset = 0;
-    NSDate *lastDate = [NSDate distantPast];
+    NSTimeInterval lastDate = -INFINITY;
 
-    NSString *record = BNCLogByteWrapReadNextRecord();
-    while (record) {
-        NSDate *date = nil;
-        if (record.length >= 27) {
-            NSString *dateString = dateString = [record substringWithRange:NSMakeRange(0, 27)];
-            date = [bnc_LogDateFormatter dateFromString:dateString];
-        }
-        if (!date || [date compare:lastDate] < 0) {
+    BNCLogReadBuffer *buffer = calloc(1, sizeof(BNCLogReadBuffer));
+    if (!buffer) {
+        BNCLogInternalError(@"Can't allocate a buffer of %ld bytes.", (long) sizeof(BNCLogReadBuffer));
+        return NO;
+    }
+    const char *record = NULL;
+    size_t recordLength = 0;
+    while (BNCLogByteWrapReadNextRecord(buffer, &record, &recordLength)) {
+        NSTimeInterval date = 0.0;
+        BOOL hasDate = BNCLogTimestampFromBytes(record, recordLength, &date);
+        if (!hasDate || date < lastDate) {
             wrapOffset = lastOffset;
             logDidWrap = YES;
         }
-        lastDate = date ?: [NSDate distantPast];
+        if (hasDate)
+            BNCLogIndexAddRecord_Internal(lastOffset, recordLength, date);
+        lastDate = hasDate ? date : -INFINITY;
         lastOffset = bnc_LogOffset;
-        record = BNCLogByteWrapReadNextRecord();
     }
+    free(buffer);
     if (logDidWrap) {
         bnc_LogOffset = wrapOffset;
     } else if (bnc_LogOffset >= bnc_LogOffsetMax)
@@ -496,33 +1028,627 @@ BOOL BNCLogByteWrapOpenURL_Internal(NSURL *url, long maxBytes) {
 void BNCLogSetOutputToURLByteWrap(NSURL *_Nullable URL, long maxBytes) {
     __block BOOL result = NO;
     dispatch_sync(bnc_LogQueue, ^{
-        if (bnc_LogFlushFunction)
-            bnc_LogFlushFunction();
-        if (bnc_LogDescriptor >= 0) {
-            close(bnc_LogDescriptor);
-            bnc_LogDescriptor = -1;
-        }
+        BNCLogDrainMessages_Internal();
+        BNCLogFlush_Internal();
+        BNCLogCloseFile_Internal();
         result = BNCLogByteWrapOpenURL_Internal(URL, maxBytes);
     });
 }
 
-#pragma mark - Log Message Severity
+#pragma mark - Binary Output File Functions
+
+// The binary log is a compact alternative to the text logs. Messages aren't formatted when they're
+// logged. Their format strings and arguments are packed instead, and the log is turned back into
+// text later by BNCLogBinaryDecoder.
+//
+// The log starts with kBNCLogBinaryMagic and is followed by records. Each record starts with its
+// type:
+//
+//  Session     The log was opened. Resets the message time and the string and site IDs.
+//  String      ID, byte count, UTF-8 bytes: a format string or a file name.
+//  Site        ID, file name string ID, line number: where messages are logged from.
+//  Message     Time, level, site ID, format string ID, argument count, arguments.
+//
+// Numbers are unsigned LEB128 varints. The message time is the zigzag encoded difference in
+// microseconds from the last message. Site zero means the message was formatted when it was
+// logged. Each argument is a type byte and a value:
+//
+//  'i'     A zigzag varint signed integer.
+//  'u'     A varint unsigned integer or pointer.
+//  'd'     An 8 byte little-endian double.
+//  's'     A byte count and UTF-8 bytes: a C string or an object's description.
+//  'n'     A NULL C string or nil object.
+
+#define kBNCLogBinaryMagic  "BNCLBIN1"
+
+typedef NS_ENUM(uint64_t, BNCLogBinaryRecordType) {
+    BNCLogBinaryRecordSession = 1,
+    BNCLogBinaryRecordString,
+    BNCLogBinaryRecordSite,
+    BNCLogBinaryRecordMessage,
+};
 
-static BNCLogLevel bnc_LogDisplayLevel = BNCLogLevelWarning;
+static inline void BNCLogAppendVarint(NSMutableData *data, uint64_t value) {
+    uint8_t bytes[10];
+    int count = 0;
+    do {
+        bytes[count++] = (value & 0x7f) | ((value > 0x7f) ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+    [data appendBytes:bytes length:count];
+}
 
-BNCLogLevel BNCLogDisplayLevel() {
-    __block BNCLogLevel level = BNCLogLevelAll;
+static inline BOOL BNCLogReadVarint(const uint8_t **bytes, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *bytes < end; shift += 7) {
+        uint8_t byte = *(*bytes)++;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static inline uint64_t BNCLogZigZag(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static inline int64_t BNCLogUnZigZag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static inline void BNCLogAppendType(NSMutableData *data, char type) {
+    [data appendBytes:&type length:1];
+}
+
+static void BNCLogAppendString(NSMutableData *data, const char *string) {
+    if (!string) {
+        BNCLogAppendType(data, 'n');
+        return;
+    }
+    size_t length = strlen(string);
+    BNCLogAppendType(data, 's');
+    BNCLogAppendVarint(data, length);
+    [data appendBytes:string length:length];
+}
+
+static void BNCLogAppendDouble(NSMutableData *data, double value) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = OSSwapHostToLittleInt64(bits);
+    BNCLogAppendType(data, 'd');
+    [data appendBytes:&bits length:sizeof(bits)];
+}
+
+// A conversion in a format string, like '%-8.*lld'.
+typedef struct BNCLogFormatSpec {
+    const char  *start;         // The '%'.
+    const char  *lengthStart;   // The length modifier, or the conversion if there isn't one.
+    const char  *end;           // After the conversion.
+    BOOL        widthIsArgument;
+    BOOL        precisionIsArgument;
+    char        length;         // 'H' for 'hh', 'q' for 'll' or 'q', or the modifier, or zero.
+    char        conversion;     // Zero if the conversion isn't understood.
+} BNCLogFormatSpec;
+
+// Finds the next conversion in `format`. Returns NO at the end of the format.
+static BOOL BNCLogNextFormatSpec(const char *format, BNCLogFormatSpec *spec) {
+    const char *p = strchr(format, '%');
+    if (!p) return NO;
+    memset(spec, 0, sizeof(*spec));
+    spec->start = p++;
+
+    // Positional arguments, like '%1$@', aren't packed:
+    const char *q = p;
+    while (*q >= '0' && *q <= '9') q++;
+    if (*q == '$') {
+        spec->lengthStart = spec->end = q + 1;
+        return YES;
+    }
+
+    while (*p && strchr("-+ #0'", *p)) p++;
+    if (*p == '*') {
+        spec->widthIsArgument = YES;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->precisionIsArgument = YES;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') p++;
+        }
+    }
+
+    spec->lengthStart = p;
+    if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l')) {
+        spec->length = (p[0] == 'h') ? 'H' : 'q';
+        p += 2;
+    } else if (*p && strchr("hlqLztj", *p)) {
+        spec->length = *p++;
+    }
+    if (!*p) {
+        spec->end = p;
+        return YES;
+    }
+    spec->conversion = *p++;
+    spec->end = p;
+    if (spec->conversion == 'D' || spec->conversion == 'U' || spec->conversion == 'O') {
+        spec->length = 'l';
+        spec->conversion = tolower(spec->conversion);
+    }
+    return YES;
+}
+
+// A message packed for the binary log on the thread that logged it.
+@interface BNCLogPackedMessage : NSObject {
+@public
+    NSString        *_format;
+    NSMutableData   *_arguments;
+    uint64_t        _argumentCount;
+    int32_t         _line;
+    char            _file[128];     // The file name without its directory.
+}
+@end
+
+@implementation BNCLogPackedMessage
+@end
+
+// Packs the arguments of `format`. Returns NO if a conversion can't be packed.
+static BOOL BNCLogPackArguments(BNCLogPackedMessage *packed, const char *format, va_list args) {
+    if (!format) return NO;
+    NSMutableData *data = packed->_arguments;
+    BNCLogFormatSpec spec;
+    while (BNCLogNextFormatSpec(format, &spec)) {
+        format = spec.end;
+        if (spec.conversion == '%') continue;
+        if (spec.widthIsArgument) {
+            BNCLogAppendType(data, 'i');
+            BNCLogAppendVarint(data, BNCLogZigZag(va_arg(args, int)));
+            packed->_argumentCount++;
+        }
+        if (spec.precisionIsArgument) {
+            BNCLogAppendType(data, 'i');
+            BNCLogAppendVarint(data, BNCLogZigZag(va_arg(args, int)));
+            packed->_argumentCount++;
+        }
+        switch (spec.conversion) {
+        case 'c':
+            if (spec.length) return NO;
+            BNCLogAppendType(data, 'i');
+            BNCLogAppendVarint(data, BNCLogZigZag(va_arg(args, int)));
+            break;
+        case 'd': case 'i': {
+            int64_t value = 0;
+            switch (spec.length) {
+            case 'l':   value = va_arg(args, long); break;
+            case 'q':   value = va_arg(args, long long); break;
+            case 'z':   value = va_arg(args, ssize_t); break;
+            case 't':   value = va_arg(args, ptrdiff_t); break;
+            case 'j':   value = va_arg(args, intmax_t); break;
+            case 'L':   return NO;
+            default:    value = va_arg(args, int); break;
+            }
+            BNCLogAppendType(data, 'i');
+            BNCLogAppendVarint(data, BNCLogZigZag(value));
+            break;
+        }
+        case 'o': case 'u': case 'x': case 'X': {
+            uint64_t value = 0;
+            switch (spec.length) {
+            case 'l':   value = va_arg(args, unsigned long); break;
+            case 'q':   value = va_arg(args, unsigned long long); break;
+            case 'z':   value = va_arg(args, size_t); break;
+            case 't':   value = va_arg(args, ptrdiff_t); break;
+            case 'j':   value = va_arg(args, uintmax_t); break;
+            case 'L':   return NO;
+            default:    value = va_arg(args, unsigned int); break;
+            }
+            BNCLogAppendType(data, 'u');
+            BNCLogAppendVarint(data, value);
+            break;
+        }
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (spec.length == 'L')
+                BNCLogAppendDouble(data, (double) va_arg(args, long double));
+            else
+                BNCLogAppendDouble(data, va_arg(args, double));
+            break;
+        case 'p':
+            BNCLogAppendType(data, 'u');
+            BNCLogAppendVarint(data, (uintptr_t) va_arg(args, void*));
+            break;
+        case 's':
+            if (spec.length) return NO;
+            BNCLogAppendString(data, va_arg(args, const char*));
+            break;
+        case '@': {
+            id object = va_arg(args, id);
+            BNCLogAppendString(data, object ? ([object description].UTF8String ?: "") : NULL);
+            break;
+        }
+        default:
+            return NO;
+        }
+        packed->_argumentCount++;
+    }
+    return YES;
+}
+
+static BNCLogPackedMessage *BNCLogPackMessage(
+        const char *file,
+        int32_t line,
+        NSString *format,
+        va_list args
+    ) {
+    BNCLogPackedMessage *packed = [BNCLogPackedMessage new];
+    const char *name = strrchr(file, '/');
+    strlcpy(packed->_file, name ? name + 1 : file, sizeof(packed->_file));
+    packed->_line = line;
+    packed->_format = format;
+    packed->_arguments = [NSMutableData dataWithCapacity:32];
+
+    va_list formatArgs;
+    va_copy(formatArgs, args);
+    if (!BNCLogPackArguments(packed, format.UTF8String, args)) {
+        // Save the formatted message instead:
+        NSString *message = [[NSString alloc] initWithFormat:format arguments:formatArgs];
+        packed->_format = @"%@";
+        packed->_arguments.length = 0;
+        packed->_argumentCount = 1;
+        BNCLogAppendString(packed->_arguments, message.UTF8String ?: "");
+    }
+    va_end(formatArgs);
+    return packed;
+}
+
+// Unpacks `count` arguments as NSNumbers, NSStrings, and NSNulls. Returns nil if they're cut short.
+static NSArray *BNCLogUnpackArguments(const uint8_t **bytes, const uint8_t *end, uint64_t count) {
+    NSMutableArray *arguments = [NSMutableArray arrayWithCapacity:MIN(count, 64)];
+    for (uint64_t i = 0; i < count; i++) {
+        if (*bytes >= end) return nil;
+        char type = *(*bytes)++;
+        uint64_t value = 0;
+        switch (type) {
+        case 'i':
+            if (!BNCLogReadVarint(bytes, end, &value)) return nil;
+            [arguments addObject:@(BNCLogUnZigZag(value))];
+            break;
+        case 'u':
+            if (!BNCLogReadVarint(bytes, end, &value)) return nil;
+            [arguments addObject:@(value)];
+            break;
+        case 'd': {
+            if (end - *bytes < (ptrdiff_t) sizeof(value)) return nil;
+            memcpy(&value, *bytes, sizeof(value));
+            *bytes += sizeof(value);
+            value = OSSwapLittleToHostInt64(value);
+            double number = 0.0;
+            memcpy(&number, &value, sizeof(number));
+            [arguments addObject:@(number)];
+            break;
+        }
+        case 's': {
+            if (!BNCLogReadVarint(bytes, end, &value) || value > (uint64_t) (end - *bytes)) return nil;
+            NSString *string =
+                [[NSString alloc] initWithBytes:*bytes length:value encoding:NSUTF8StringEncoding];
+            if (!string)
+                string = [[NSString alloc] initWithBytes:*bytes length:value encoding:NSISOLatin1StringEncoding];
+            *bytes += value;
+            [arguments addObject:string];
+            break;
+        }
+        case 'n':
+            [arguments addObject:[NSNull null]];
+            break;
+        default:
+            return nil;
+        }
+    }
+    return arguments;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+
+// Formats `format` with unpacked arguments the way NSString would have.
+static NSString *BNCLogFormatArguments(NSString *format, NSArray *arguments) {
+    const char *f = format.UTF8String;
+    if (!f) return format ?: @"";
+    NSMutableData *text = [NSMutableData dataWithCapacity:strlen(f) + 32];
+    NSUInteger index = 0;
+    BNCLogFormatSpec spec;
+    while (BNCLogNextFormatSpec(f, &spec)) {
+        [text appendBytes:f length:spec.start - f];
+        f = spec.end;
+        if (spec.conversion == '%') {
+            [text appendBytes:"%" length:1];
+            continue;
+        }
+
+        // Rebuild the conversion for asprintf with the width and precision arguments filled in:
+        char conversion[64];
+        size_t length = 0;
+        BOOL isValid = (spec.conversion != 0);
+        for (const char *p = spec.start; p < spec.lengthStart && length < sizeof(conversion) - 24; p++) {
+            if (*p != '*') {
+                conversion[length++] = *p;
+                continue;
+            }
+            id argument = (index < arguments.count) ? arguments[index++] : nil;
+            if (![argument isKindOfClass:[NSNumber class]]) {
+                isValid = NO;
+                break;
+            }
+            length += snprintf(conversion + length, 16, "%d", [argument intValue]);
+        }
+        BOOL isLong = (spec.length && spec.length != 'H' && spec.length != 'h');
+        if (isLong && strchr("diouxX", spec.conversion)) {
+            conversion[length++] = 'l';
+            conversion[length++] = 'l';
+        } else if (spec.length == 'H' || spec.length == 'h') {
+            memcpy(conversion + length, spec.lengthStart, spec.length == 'H' ? 2 : 1);
+            length += spec.length == 'H' ? 2 : 1;
+        }
+        conversion[length++] = spec.conversion;
+        conversion[length] = 0;
+
+        id argument = (isValid && index < arguments.count) ? arguments[index++] : nil;
+        BOOL isNumber = [argument isKindOfClass:[NSNumber class]];
+        BOOL isString = [argument isKindOfClass:[NSString class]];
+        BOOL isNull = [argument isKindOfClass:[NSNull class]];
+        char *formatted = NULL;
+        int count = -1;
+        switch (spec.conversion) {
+        case 'd': case 'i': case 'c':
+            if (!isNumber) break;
+            count = isLong
+                ? asprintf(&formatted, conversion, [argument longLongValue])
+                : asprintf(&formatted, conversion, [argument intValue]);
+            break;
+        case 'o': case 'u': case 'x': case 'X':
+            if (!isNumber) break;
+            count = isLong
+                ? asprintf(&formatted, conversion, [argument unsignedLongLongValue])
+                : asprintf(&formatted, conversion, [argument unsignedIntValue]);
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (isNumber) count = asprintf(&formatted, conversion, [argument doubleValue]);
+            break;
+        case 'p':
+            if (isNumber)
+                count = asprintf(&formatted, conversion, (void*) (uintptr_t) [argument unsignedLongLongValue]);
+            break;
+        case 's':
+            if (isString || isNull)
+                count = asprintf(&formatted, conversion, isString ? [argument UTF8String] : "(null)");
+            break;
+        case '@':
+            if (isString || isNull) {
+                NSData *data = [(isString ? argument : @"(null)") dataUsingEncoding:NSUTF8StringEncoding];
+                [text appendData:data];
+                continue;
+            }
+            break;
+        }
+        if (count >= 0 && formatted)
+            [text appendBytes:formatted length:count];
+        else
+            [text appendBytes:spec.start length:spec.end - spec.start];
+        if (formatted) free(formatted);
+    }
+    [text appendBytes:f length:strlen(f)];
+    return [[NSString alloc] initWithData:text encoding:NSUTF8StringEncoding]
+        ?: [[NSString alloc] initWithData:text encoding:NSISOLatin1StringEncoding];
+}
+
+#pragma clang diagnostic pop
+
+static NSString *BNCLogMessageString(NSString *file, int64_t line, BNCLogLevel level, NSString *message) {
+    level = MAX(MIN(level, BNCLogLevelMax-1), 0);
+    return [NSString stringWithFormat:@"[branch.io] %@(%lld) %@: %@",
+        file, line, bnc_LogLevelNames[level], message];
+}
+
+static NSString *BNCLogStringFromMessage(BNCLogLevel level, id message) {
+    if (![message isKindOfClass:[BNCLogPackedMessage class]]) return message;
+    BNCLogPackedMessage *packed = message;
+    const uint8_t *bytes = packed->_arguments.bytes;
+    NSArray *arguments =
+        BNCLogUnpackArguments(&bytes, bytes + packed->_arguments.length, packed->_argumentCount);
+    return BNCLogMessageString(
+        [NSString stringWithCString:packed->_file encoding:NSMacOSRomanStringEncoding],
+        packed->_line,
+        level,
+        BNCLogFormatArguments(packed->_format, arguments ?: @[])
+    );
+}
+
+// The binary log has its own file, so it can be open along with the text log files. Its records
+// are collected during a drain and written together at the end.
+#define kBNCLogBinaryBatchMax   (64*1024)
+
+static int bnc_LogBinaryDescriptor = -1;
+static NSMutableData *bnc_LogBinaryBatch = nil;
+
+// The strings and sites that have been written to the binary log:
+static NSMutableDictionary<NSString*, NSNumber*> *bnc_LogBinaryStrings = nil;
+static NSMutableDictionary<NSNumber*, NSNumber*> *bnc_LogBinarySites = nil;
+static int64_t bnc_LogBinaryLastTime = 0;
+
+static uint64_t BNCLogBinaryStringID(NSMutableData *record, NSString *string) {
+    NSNumber *identifier = bnc_LogBinaryStrings[string];
+    if (identifier) return identifier.unsignedLongLongValue;
+    identifier = @(bnc_LogBinaryStrings.count + 1);
+    bnc_LogBinaryStrings[string] = identifier;
+    const char *bytes = string.UTF8String ?: "";
+    size_t length = strlen(bytes);
+    BNCLogAppendVarint(record, BNCLogBinaryRecordString);
+    BNCLogAppendVarint(record, identifier.unsignedLongLongValue);
+    BNCLogAppendVarint(record, length);
+    [record appendBytes:bytes length:length];
+    return identifier.unsignedLongLongValue;
+}
+
+static void BNCLogWriteBinaryBatch_Internal() {
+    const char *bytes = bnc_LogBinaryBatch.bytes;
+    size_t length = bnc_LogBinaryBatch.length;
+    while (length > 0 && bnc_LogBinaryDescriptor >= 0) {
+        ssize_t n = write(bnc_LogBinaryDescriptor, bytes, length);
+        if (n < 0) {
+            int e = errno;
+            if (e == EINTR) continue;
+            BNCLogInternalError(@"Can't write binary log records (%d): %s.", e, strerror(e));
+            break;
+        }
+        bytes += n;
+        length -= n;
+    }
+    bnc_LogBinaryBatch.length = 0;
+}
+
+static void BNCLogBinaryFlush_Internal() {
+    BNCLogWriteBinaryBatch_Internal();
+    if (bnc_LogBinaryDescriptor >= 0)
+        fsync(bnc_LogBinaryDescriptor);
+}
+
+static void BNCLogBinaryClose_Internal() {
+    atomic_store(&bnc_LogBinaryIsEnabled, false);
+    BNCLogWriteBinaryBatch_Internal();
+    if (bnc_LogBinaryDescriptor >= 0) {
+        close(bnc_LogBinaryDescriptor);
+        bnc_LogBinaryDescriptor = -1;
+    }
+}
+
+static void BNCLogBinaryWrite_Internal(NSTimeInterval timestamp, BNCLogLevel level, id message) {
+    if (bnc_LogBinaryDescriptor < 0) return;
+    NSMutableData *record = [NSMutableData dataWithCapacity:64];
+    uint64_t site = 0, format = 0, argumentCount = 0;
+    NSData *arguments = nil;
+    if ([message isKindOfClass:[BNCLogPackedMessage class]]) {
+        BNCLogPackedMessage *packed = message;
+        NSString *fileName =
+            [NSString stringWithCString:packed->_file encoding:NSMacOSRomanStringEncoding] ?: @"";
+        uint64_t file = BNCLogBinaryStringID(record, fileName);
+        NSNumber *key = @((file << 32) | (uint32_t) packed->_line);
+        site = [bnc_LogBinarySites[key] unsignedLongLongValue];
+        if (!site) {
+            site = bnc_LogBinarySites.count + 1;
+            bnc_LogBinarySites[key] = @(site);
+            BNCLogAppendVarint(record, BNCLogBinaryRecordSite);
+            BNCLogAppendVarint(record, site);
+            BNCLogAppendVarint(record, file);
+            BNCLogAppendVarint(record, (uint32_t) packed->_line);
+        }
+        format = BNCLogBinaryStringID(record, packed->_format);
+        argumentCount = packed->_argumentCount;
+        arguments = packed->_arguments;
+    } else {
+        // A message that was formatted when it was logged:
+        NSMutableData *data = [NSMutableData new];
+        BNCLogAppendString(data, [message description].UTF8String ?: "");
+        format = BNCLogBinaryStringID(record, @"%@");
+        argumentCount = 1;
+        arguments = data;
+    }
+
+    int64_t time = llround(timestamp * 1000000.0);
+    BNCLogAppendVarint(record, BNCLogBinaryRecordMessage);
+    BNCLogAppendVarint(record, BNCLogZigZag(time - bnc_LogBinaryLastTime));
+    BNCLogAppendVarint(record, level);
+    BNCLogAppendVarint(record, site);
+    BNCLogAppendVarint(record, format);
+    BNCLogAppendVarint(record, argumentCount);
+    [record appendData:arguments];
+    bnc_LogBinaryLastTime = time;
+    if (!bnc_LogBinaryBatch) bnc_LogBinaryBatch = [[NSMutableData alloc] initWithCapacity:kBNCLogBinaryBatchMax];
+    [bnc_LogBinaryBatch appendData:record];
+    if (!bnc_LogIsDraining || bnc_LogBinaryBatch.length >= kBNCLogBinaryBatchMax)
+        BNCLogWriteBinaryBatch_Internal();
+}
+
+static BOOL BNCLogBinaryOpenURL_Internal(NSURL *url) {
+    if (url == nil) return NO;
+    bnc_LogBinaryDescriptor = open(
+        url.path.UTF8String,
+        O_RDWR|O_CREAT|O_APPEND,
+        S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP
+    );
+    if (bnc_LogBinaryDescriptor < 0) {
+        int e = errno;
+        BNCLogInternalError(@"Can't open log file '%@'.", url);
+        BNCLogInternalError(@"Can't open log file (%d): %s.", e, strerror(e));
+        return NO;
+    }
+
+    // Append to an existing binary log:
+    if (!bnc_LogBinaryBatch) bnc_LogBinaryBatch = [[NSMutableData alloc] initWithCapacity:kBNCLogBinaryBatchMax];
+    char magic[8];
+    ssize_t bytesRead = pread(bnc_LogBinaryDescriptor, magic, sizeof(magic), 0);
+    if (bytesRead == 0) {
+        [bnc_LogBinaryBatch appendBytes:kBNCLogBinaryMagic length:sizeof(magic)];
+    } else if (bytesRead != sizeof(magic) || memcmp(magic, kBNCLogBinaryMagic, sizeof(magic)) != 0) {
+        BNCLogInternalError(@"The log file '%@' isn't a binary log.", url);
+        BNCLogBinaryClose_Internal();
+        return NO;
+    }
+
+    bnc_LogBinaryStrings = [NSMutableDictionary new];
+    bnc_LogBinarySites = [NSMutableDictionary new];
+    bnc_LogBinaryLastTime = 0;
+    BNCLogAppendVarint(bnc_LogBinaryBatch, BNCLogBinaryRecordSession);
+    BNCLogWriteBinaryBatch_Internal();
+    atomic_store(&bnc_LogBinaryIsEnabled, true);
+    return YES;
+}
+
+void BNCLogSetOutputToURLBinary(NSURL *_Nullable URL) {
     dispatch_sync(bnc_LogQueue, ^{
-        level = bnc_LogDisplayLevel;
+        BNCLogDrainMessages_Internal();
+        BNCLogFlush_Internal();
+        BNCLogBinaryClose_Internal();
+        BNCLogBinaryOpenURL_Internal(URL);
     });
-    return level;
+}
+
+#pragma mark - Log Message Severity
+
+// The levels are read before every message, so they're atomic rather than on the bnc_LogQueue.
+static _Atomic(BNCLogLevel) bnc_LogDisplayLevel = BNCLogLevelWarning;
+static _Atomic(BNCLogLevel) bnc_LogOutputLevel = BNCLogLevelAll;
+
+BNCLogLevel BNCLogDisplayLevel() {
+    return atomic_load_explicit(&bnc_LogDisplayLevel, memory_order_relaxed);
 }
 
 void BNCLogSetDisplayLevel(BNCLogLevel level) {
     BNCLogInitializeClient_Internal();
-    dispatch_async(bnc_LogQueue, ^{
-        bnc_LogDisplayLevel = level;
-    });
+    atomic_store_explicit(&bnc_LogDisplayLevel, level, memory_order_relaxed);
+}
+
+BNCLogLevel BNCLogOutputLevel() {
+    return atomic_load_explicit(&bnc_LogOutputLevel, memory_order_relaxed);
+}
+
+void BNCLogSetOutputLevel(BNCLogLevel level) {
+    BNCLogInitializeClient_Internal();
+    atomic_store_explicit(&bnc_LogOutputLevel, level, memory_order_relaxed);
+}
+
+BOOL BNCLogLevelIsEnabled(BNCLogLevel level) {
+    BNCLogInitializeClient_Internal();
+    if (level >= atomic_load_explicit(&bnc_LogDisplayLevel, memory_order_relaxed)) return YES;
+    BOOL hasOutput =
+        atomic_load_explicit(&bnc_LogHasOutputFunction, memory_order_relaxed) ||
+        atomic_load_explicit(&bnc_LogBinaryIsEnabled, memory_order_relaxed);
+    return hasOutput && level >= atomic_load_explicit(&bnc_LogOutputLevel, memory_order_relaxed);
 }
 
 static NSString*const bnc_logLevelStrings[] = {
@@ -557,8 +1683,6 @@ BNCLogLevel BNCLogLevelFromString(NSString*string) {
 
 #pragma mark - Client Initialization Function
 
-static _Atomic(BNCLogClientInitializeFunctionPtr) bnc_LogClientInitializeFunctionPtr = (BNCLogClientInitializeFunctionPtr) 0;
-
 extern BNCLogClientInitializeFunctionPtr _Null_unspecified BNCLogSetClientInitializeFunction(
         BNCLogClientInitializeFunctionPtr _Nullable clientInitializationFunction
     ) {
@@ -597,20 +1721,21 @@ BNCLogOutputFunctionPtr _Nullable BNCLogOutputFunction() {
 
 void BNCLogCloseLogFile() {
     dispatch_sync(bnc_LogQueue, ^{
-        if (bnc_LogFlushFunction)
-            bnc_LogFlushFunction();
-        if (bnc_LogDescriptor >= 0) {
-            close(bnc_LogDescriptor);
-            bnc_LogDescriptor = -1;
-        }
+        BNCLogDrainMessages_Internal();
+        BNCLogFlush_Internal();
+        BNCLogCloseFile_Internal();
+        BNCLogBinaryClose_Internal();
         bnc_LogFlushFunction = NULL;
-        bnc_LoggingFunction = NULL;
+        BNCLogSetLoggingFunction_Internal(NULL);
     });
 }
 
 void BNCLogSetOutputFunction(BNCLogOutputFunctionPtr _Nullable logFunction) {
+    // Messages logged from now on are meant for the new function, so they're formatted for it:
+    if (logFunction) atomic_store_explicit(&bnc_LogHasOutputFunction, true, memory_order_relaxed);
     dispatch_async(bnc_LogQueue, ^{
-        bnc_LoggingFunction = logFunction;
+        BNCLogDrainMessages_Internal();
+        BNCLogSetLoggingFunction_Internal(logFunction);
     });
 }
 
@@ -624,6 +1749,7 @@ BNCLogFlushFunctionPtr BNCLogFlushFunction() {
 
 void BNCLogSetFlushFunction(BNCLogFlushFunctionPtr flushFunction) {
     dispatch_async(bnc_LogQueue, ^{
+        BNCLogDrainMessages_Internal();
         bnc_LogFlushFunction = flushFunction;
     });
 }
@@ -637,7 +1763,7 @@ void BNCLogWriteMessageFormat(
         NSString *_Nullable message,
         ...
     ) {
-    BNCLogInitializeClient_Internal();
+    if (!BNCLogLevelIsEnabled(logLevel)) return;
     if (!file) file = "";
     if (!message) message = @"<nil>";
     if (![message isKindOfClass:[NSString class]]) {
@@ -645,23 +1771,20 @@ void BNCLogWriteMessageFormat(
             (uint64_t) message, message.class, message.description];
     }
 
+    logLevel = MAX(MIN(logLevel, BNCLogLevelMax-1), 0);
+    if (atomic_load_explicit(&bnc_LogBinaryIsEnabled, memory_order_relaxed)) {
+        va_list args;
+        va_start(args, message);
+        BNCLogPackedMessage *packed = BNCLogPackMessage(file, lineNumber, message, args);
+        va_end(args);
+        BNCLogEnqueueMessage(logLevel, packed);
+        return;
+    }
+
     NSString* filename =
         [[NSString stringWithCString:file encoding:NSMacOSRomanStringEncoding]
             lastPathComponent];
-
-    NSString * const logLevels[BNCLogLevelMax] = {
-        @"DebugSDK",
-        @"Break",
-        @"Debug",
-        @"Warning",
-        @"Error",
-        @"Assert",
-        @"Log",
-        @"None",
-    };
-
-    logLevel = MAX(MIN(logLevel, BNCLogLevelMax-1), 0);
-    NSString *levelString = logLevels[logLevel];
+    NSString *levelString = bnc_LogLevelNames[logLevel];
 
     va_list args;
     va_start(args, message);
@@ -670,13 +1793,7 @@ void BNCLogWriteMessageFormat(
         @"[branch.io] %@(%d) %@: %@", filename, lineNumber, levelString, m];
     va_end(args);
 
-    dispatch_async(bnc_LogQueue, ^{
-        if (logLevel >= bnc_LogDisplayLevel) {
-            NSLog(@"%@", s); // Upgrade this to unified logging when we can.
-        }
-        if (bnc_LoggingFunction)
-            bnc_LoggingFunction([NSDate date], logLevel, s);
-    });
+    BNCLogEnqueueMessage(logLevel, s);
 }
 
 void BNCLogWriteMessage(
@@ -690,8 +1807,8 @@ void BNCLogWriteMessage(
 
 void BNCLogFlushMessages() {
     dispatch_sync(bnc_LogQueue, ^{
-        if (bnc_LogFlushFunction)
-            bnc_LogFlushFunction();
+        BNCLogDrainMessages_Internal();
+        BNCLogFlush_Internal();
     });
 }
 
@@ -701,6 +1818,9 @@ __attribute__((constructor)) void BNCLogInitialize(void) {
     static dispatch_once_t onceToken = 0;
     dispatch_once(&onceToken, ^ {
         bnc_LogQueue = dispatch_queue_create("io.branch.sdk.log", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(bnc_LogQueue, &bnc_LogQueue, &bnc_LogQueue, NULL);
+        BNCLogRingInitialize_Internal();
+        bnc_LogNewLineData = [NSData dataWithBytes:"\n   " length:sizeof('\n')];
 
         bnc_LogDateFormatter = [[NSDateFormatter alloc] init];
         bnc_LogDateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
@@ -710,3 +1830,385 @@ __attribute__((constructor)) void BNCLogInitialize(void) {
         bnc_LogIsInitialized = @(YES);
     });
 }
+
+#pragma mark - BNCLogRecord
+
+@interface BNCLogRecord ()
+@property (strong) NSDate *date;
+@property (assign) BNCLogLevel level;
+@property (strong) NSString *message;
+@property (strong) NSString *file;
+@property (assign) NSInteger line;
+@property (strong) NSString *format;
+@property (strong) NSArray *arguments;
+@end
+
+@implementation BNCLogRecord
+
+- (NSString*) description {
+    return [NSString stringWithFormat:@"<%@ %p %@ %ld %@>",
+        NSStringFromClass(self.class), (void*) self, self.date, (long) self.level, self.message];
+}
+
+@end
+
+#pragma mark - BNCLogFileReader
+
+static int BNCLogIndexEntryCompare(const void *a, const void *b) {
+    int64_t offsetA = ((const BNCLogIndexEntry*) a)->offset;
+    int64_t offsetB = ((const BNCLogIndexEntry*) b)->offset;
+    return (offsetA < offsetB) ? -1 : (offsetA > offsetB) ? 1 : 0;
+}
+
+// Positions in the reader are logical: zero is the oldest byte of the log. The log is mapped as it
+// is on disk, so a position is translated to its byte in _data around _oldestOffset.
+
+@interface BNCLogFileReader () {
+    NSData          *_data;         // The log as it is on disk.
+    size_t          _oldestOffset;  // The offset in _data of the oldest byte.
+    size_t          _position;
+    NSMutableData   *_index;        // The indexed records by their position.
+    NSMutableData   *_buffer;       // A record that wraps around the end of _data.
+}
+@property (strong) NSURL *URL;
+@end
+
+@implementation BNCLogFileReader
+
+- (instancetype) initWithURL:(NSURL*)URL error:(NSError*__autoreleasing*)error {
+    self = [super init];
+    if (!self) return self;
+    self.URL = URL;
+
+    struct stat status;
+    BOOL haveStatus = (stat(URL.path.UTF8String, &status) == 0);
+    NSData *data = [NSData dataWithContentsOfURL:URL options:NSDataReadingMappedIfSafe error:error];
+    if (!data) return nil;
+
+    const char *bytes = data.bytes;
+    size_t length = data.length;
+
+    // Read the index if it matches the log --
+
+    const BNCLogIndexEntry *entries = NULL;
+    int64_t entryCount = 0;
+    int64_t oldestOffset = -1;
+    NSString *indexPath = [URL.path stringByAppendingString:@".idx"];
+    NSData *indexData = [NSData dataWithContentsOfFile:indexPath options:0 error:nil];
+    if (haveStatus && indexData.length >= sizeof(BNCLogIndexHeader)) {
+        const BNCLogIndexHeader *header = indexData.bytes;
+        if (memcmp(header->magic, kBNCLogIndexMagic, sizeof(header->magic)) == 0 &&
+            (header->kind == BNCLogIndexKindRecordWrap || header->kind == BNCLogIndexKindByteWrap) &&
+            header->entryCount >= 0 &&
+            header->entryCount <=
+                (indexData.length - sizeof(BNCLogIndexHeader)) / sizeof(BNCLogIndexEntry) &&
+            indexData.length ==
+                sizeof(BNCLogIndexHeader) + header->entryCount * sizeof(BNCLogIndexEntry) &&
+            header->fileSize == (int64_t) length &&
+            header->fileSize == status.st_size &&
+            header->fileModified == BNCLogModifiedNanoseconds(&status) &&
+            header->writeOffset >= 0 &&
+            header->writeOffset <= header->fileSize) {
+            entries = (const BNCLogIndexEntry*) (header + 1);
+            entryCount = header->entryCount;
+            oldestOffset = (header->writeOffset < (int64_t) length) ? header->writeOffset : 0;
+        }
+    }
+
+    // Otherwise find where the log wrapped. That's the first record that's older than the one
+    // before it, or the partial record that's left before it --
+
+    if (oldestOffset < 0) {
+        oldestOffset = 0;
+        NSTimeInterval lastDate = -INFINITY;
+        size_t partialOffset = 0;
+        BOOL havePartial = NO;
+        for (size_t offset = 0; offset < length; ) {
+            const char *end = memchr(bytes + offset, '\n', length - offset);
+            size_t next = end ? end - bytes + 1 : length;
+            NSTimeInterval date = 0.0;
+            if (BNCLogTimestampFromBytes(bytes + offset, next - offset, &date)) {
+                if (date < lastDate) {
+                    oldestOffset = havePartial ? partialOffset : offset;
+                    break;
+                }
+                lastDate = date;
+                havePartial = NO;
+            } else if (!havePartial) {
+                partialOffset = offset;
+                havePartial = YES;
+            }
+            offset = next;
+        }
+    }
+
+    _data = data;
+    _oldestOffset = (size_t) oldestOffset;
+    _buffer = [NSMutableData new];
+    _index = [NSMutableData new];
+    for (int64_t i = 0; i < entryCount; i++) {
+        BNCLogIndexEntry entry = entries[i];
+        if (entry.offset < 0 || entry.offset >= (int64_t) length) continue;
+        entry.offset = (entry.offset >= oldestOffset)
+            ? entry.offset - oldestOffset
+            : entry.offset + ((int64_t) length - oldestOffset);
+        [_index appendBytes:&entry length:sizeof(entry)];
+    }
+    qsort(_index.mutableBytes, _index.length / sizeof(BNCLogIndexEntry), sizeof(BNCLogIndexEntry),
+        BNCLogIndexEntryCompare);
+    return self;
+}
+
+// Finds the record at or after `position`. A record is a line that starts with a timestamp and the
+// lines after it that don't. Lines before the first record are partial records and are skipped.
+// Returns the position after the line at `position`.
+- (size_t) lineEndFrom:(size_t)position {
+    const char *bytes = _data.bytes;
+    size_t length = _data.length;
+    size_t wrapPosition = length - _oldestOffset; // The position of the byte at offset zero.
+    if (position < wrapPosition) {
+        const char *lineEnd = memchr(bytes + _oldestOffset + position, '\n', wrapPosition - position);
+        if (lineEnd) return lineEnd - (bytes + _oldestOffset) + 1;
+        position = wrapPosition;
+    }
+    const char *lineEnd = memchr(bytes + position - wrapPosition, '\n', length - position);
+    return lineEnd ? lineEnd - bytes + wrapPosition + 1 : length;
+}
+
+// Returns the bytes from `start` up to `end`. They're copied only if they wrap around the end of
+// the log and are good until the next call.
+- (const char*) bytesFrom:(size_t)start end:(size_t)end {
+    const char *bytes = _data.bytes;
+    size_t wrapPosition = _data.length - _oldestOffset;
+    if (start >= wrapPosition) return bytes + start - wrapPosition;
+    if (end <= wrapPosition) return bytes + _oldestOffset + start;
+    _buffer.length = 0;
+    [_buffer appendBytes:bytes + _oldestOffset + start length:wrapPosition - start];
+    [_buffer appendBytes:bytes length:end - wrapPosition];
+    return _buffer.bytes;
+}
+
+- (BOOL) nextRecordFrom:(size_t)position start:(size_t*)start end:(size_t*)end date:(NSTimeInterval*)date {
+    size_t length = _data.length;
+    BOOL found = NO;
+    while (position < length) {
+        size_t next = [self lineEndFrom:position];
+        NSTimeInterval lineDate = 0.0;
+        BOOL hasDate =
+            BNCLogTimestampFromBytes([self bytesFrom:position end:next], next - position, &lineDate);
+        if (found && hasDate) break;
+        if (!found && hasDate) {
+            found = YES;
+            *start = position;
+            *date = lineDate;
+        }
+        position = next;
+    }
+    *end = position;
+    return found;
+}
+
+- (BNCLogRecord*) recordFrom:(size_t)start end:(size_t)end date:(NSTimeInterval)date {
+    const char *bytes = [self bytesFrom:start end:end];
+    size_t length = end - start;
+
+    // A record is '<timestamp> <level> <message>':
+    size_t offset = 27;
+    long level = 0;
+    if (offset < length && bytes[offset] == ' ') offset++;
+    while (offset < length && bytes[offset] >= '0' && bytes[offset] <= '9')
+        level = level * 10 + (bytes[offset++] - '0');
+    if (offset < length && bytes[offset] == ' ') offset++;
+
+    NSString *message =
+        [[NSString alloc] initWithBytes:bytes + offset length:length - offset encoding:NSUTF8StringEncoding];
+    if (!message) {
+        // The end of a record can be cut in the middle of a character.
+        message =
+            [[NSString alloc] initWithBytes:bytes + offset length:length - offset encoding:NSISOLatin1StringEncoding];
+    }
+
+    BNCLogRecord *record = [BNCLogRecord new];
+    record.date = [NSDate dateWithTimeIntervalSinceReferenceDate:date];
+    record.level = MIN(MAX(level, BNCLogLevelAll), BNCLogLevelMax);
+    record.message =
+        [message stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] ?: @"";
+    return record;
+}
+
+- (void) seekToStart {
+    _position = 0;
+}
+
+- (void) seekToDate:(NSDate*)date {
+    NSTimeInterval time = date.timeIntervalSinceReferenceDate;
+
+    // Start from the last indexed record before `date`:
+    const BNCLogIndexEntry *entries = _index.bytes;
+    NSInteger low = 0, high = _index.length / sizeof(BNCLogIndexEntry);
+    while (low < high) {
+        NSInteger middle = low + (high - low) / 2;
+        if (entries[middle].timestamp < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    _position = (low > 0) ? (size_t) entries[low-1].offset : 0;
+
+    size_t start = 0, end = 0;
+    NSTimeInterval recordTime = 0.0;
+    while ([self nextRecordFrom:_position start:&start end:&end date:&recordTime]) {
+        if (recordTime >= time) {
+            _position = start;
+            return;
+        }
+        _position = end;
+    }
+}
+
+- (NSArray<BNCLogRecord*>*) readRecords:(NSInteger)count {
+    NSMutableArray *records = [NSMutableArray new];
+    size_t start = 0, end = 0;
+    NSTimeInterval date = 0.0;
+    while ((NSInteger) records.count < count && [self nextRecordFrom:_position start:&start end:&end date:&date]) {
+        [records addObject:[self recordFrom:start end:end date:date]];
+        _position = end;
+    }
+    if ((NSInteger) records.count < count) _position = _data.length;
+    return records;
+}
+
+- (NSArray<BNCLogRecord*>*) recordsFromDate:(NSDate*)fromDate toDate:(NSDate*)toDate {
+    NSTimeInterval toTime = toDate.timeIntervalSinceReferenceDate;
+    NSMutableArray *records = [NSMutableArray new];
+    [self seekToDate:fromDate];
+    size_t start = 0, end = 0;
+    NSTimeInterval date = 0.0;
+    while ([self nextRecordFrom:_position start:&start end:&end date:&date] && date < toTime) {
+        [records addObject:[self recordFrom:start end:end date:date]];
+        _position = end;
+    }
+    return records;
+}
+
+@end
+
+#pragma mark - BNCLogBinaryDecoder
+
+@interface BNCLogBinaryDecoder () {
+    NSData          *_data;
+    size_t          _position;
+    int64_t         _time;
+    NSMutableDictionary<NSNumber*, NSString*> *_strings;
+    NSMutableDictionary<NSNumber*, NSArray*> *_sites; // The file name and line.
+}
+@end
+
+@implementation BNCLogBinaryDecoder
+
+- (instancetype) initWithData:(NSData*)data error:(NSError*__autoreleasing*)error {
+    self = [super init];
+    if (!self) return self;
+    if (data.length < sizeof(kBNCLogBinaryMagic)-1 ||
+        memcmp(data.bytes, kBNCLogBinaryMagic, sizeof(kBNCLogBinaryMagic)-1) != 0) {
+        if (error) *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError
+            userInfo:@{NSLocalizedDescriptionKey: @"The data isn't a binary log."}];
+        return nil;
+    }
+    _data = data;
+    _position = sizeof(kBNCLogBinaryMagic)-1;
+    _strings = [NSMutableDictionary new];
+    _sites = [NSMutableDictionary new];
+    return self;
+}
+
+- (instancetype) initWithURL:(NSURL*)URL error:(NSError*__autoreleasing*)error {
+    NSData *data = [NSData dataWithContentsOfURL:URL options:NSDataReadingMappedIfSafe error:error];
+    if (!data) return nil;
+    return [self initWithData:data error:error];
+}
+
+// Reads the next record. Returns NO at the end of the log or if the record is cut short.
+- (BOOL) readRecord:(BNCLogRecord*_Nullable*_Nonnull)record {
+    const uint8_t *bytes = (const uint8_t*) _data.bytes + _position;
+    const uint8_t *end = (const uint8_t*) _data.bytes + _data.length;
+    uint64_t type = 0;
+    *record = nil;
+    if (!BNCLogReadVarint(&bytes, end, &type)) return NO;
+    switch (type) {
+    case BNCLogBinaryRecordSession:
+        _time = 0;
+        [_strings removeAllObjects];
+        [_sites removeAllObjects];
+        break;
+
+    case BNCLogBinaryRecordString: {
+        uint64_t identifier = 0, length = 0;
+        if (!BNCLogReadVarint(&bytes, end, &identifier) ||
+            !BNCLogReadVarint(&bytes, end, &length) ||
+            length > (uint64_t) (end - bytes))
+            return NO;
+        _strings[@(identifier)] =
+            [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] ?:
+            [[NSString alloc] initWithBytes:bytes length:length encoding:NSISOLatin1StringEncoding];
+        bytes += length;
+        break;
+    }
+
+    case BNCLogBinaryRecordSite: {
+        uint64_t identifier = 0, file = 0, line = 0;
+        if (!BNCLogReadVarint(&bytes, end, &identifier) ||
+            !BNCLogReadVarint(&bytes, end, &file) ||
+            !BNCLogReadVarint(&bytes, end, &line))
+            return NO;
+        _sites[@(identifier)] = @[ _strings[@(file)] ?: @"", @(line) ];
+        break;
+    }
+
+    case BNCLogBinaryRecordMessage: {
+        uint64_t time = 0, level = 0, site = 0, format = 0, count = 0;
+        if (!BNCLogReadVarint(&bytes, end, &time) ||
+            !BNCLogReadVarint(&bytes, end, &level) ||
+            !BNCLogReadVarint(&bytes, end, &site) ||
+            !BNCLogReadVarint(&bytes, end, &format) ||
+            !BNCLogReadVarint(&bytes, end, &count))
+            return NO;
+        NSArray *arguments = BNCLogUnpackArguments(&bytes, end, count);
+        if (!arguments) return NO;
+        _time += BNCLogUnZigZag(time);
+
+        BNCLogRecord *message = [BNCLogRecord new];
+        message.date = [NSDate dateWithTimeIntervalSinceReferenceDate:_time / 1000000.0];
+        message.level = (BNCLogLevel) MIN(level, BNCLogLevelMax);
+        message.format = _strings[@(format)] ?: @"";
+        message.arguments = arguments;
+        NSString *text = BNCLogFormatArguments(message.format, arguments);
+        NSArray *location = (site) ? _sites[@(site)] : nil;
+        if (location) {
+            message.file = location[0];
+            message.line = [location[1] integerValue];
+            message.message = BNCLogMessageString(message.file, message.line, message.level, text);
+        } else {
+            message.message = text;
+        }
+        *record = message;
+        break;
+    }
+
+    default:
+        return NO;
+    }
+    _position = bytes - (const uint8_t*) _data.bytes;
+    return YES;
+}
+
+- (NSArray<BNCLogRecord*>*) readRecords:(NSInteger)count {
+    NSMutableArray *records = [NSMutableArray new];
+    BNCLogRecord *record = nil;
+    while ((NSInteger) records.count < count && [self readRecord:&record]) {
+        if (record) [records addObject:record];
+    }
+    return records;
+}
+
+@end
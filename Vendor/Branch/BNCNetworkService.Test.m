@@ -0,0 +1,215 @@
+/**
+ @file          BNCNetworkService.Test.m
+ @package       Branch-SDK
+ @brief         Tests for BNCNetworkService.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "BNCNetworkService.h"
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+@interface BNCNetworkServiceTest : BNCTestCase
+@end
+
+@implementation BNCNetworkServiceTest
+
+- (BNCNetworkService*) service {
+    BNCNetworkService *service = [BNCNetworkService new];
+    service.retryInterval = 0.05;
+    service.maximumRetryInterval = 0.2;
+    return service;
+}
+
+/// A URL for a socket that's listening but never answers.
+- (NSURL*) silentURLWithSocket:(int*)listenSocket {
+    *listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    XCTAssertEqual(bind(*listenSocket, (struct sockaddr*) &address, sizeof(address)), 0);
+    XCTAssertEqual(listen(*listenSocket, 16), 0);
+    socklen_t length = sizeof(address);
+    getsockname(*listenSocket, (struct sockaddr*) &address, &length);
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/", ntohs(address.sin_port)]];
+}
+
+- (BNCNetworkOperation*) operationWithService:(BNCNetworkService*)service method:(NSString*)method {
+    // Nothing listens on port 1, so the connection is refused:
+    NSURL *URL = [NSURL URLWithString:@"http://127.0.0.1:1/"];
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    BNCNetworkOperation *operation =
+        [service getOperationWithURL:URL completion:^(BNCNetworkOperation*operation) {
+            dispatch_semaphore_signal(semaphore);
+        }];
+    operation.request.HTTPMethod = method;
+    [operation start];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    return operation;
+}
+
+- (void) testRetry {
+    BNCNetworkService *service = [self service];
+    BNCNetworkOperation *operation = [self operationWithService:service method:@"GET"];
+    XCTAssertEqual(operation.retryCount, 2);
+    XCTAssertEqualObjects(operation.error.domain, NSURLErrorDomain);
+    XCTAssertEqual(operation.error.code, NSURLErrorCannotConnectToHost);
+
+    // A POST isn't retried:
+    operation = [self operationWithService:service method:@"POST"];
+    XCTAssertEqual(operation.retryCount, 0);
+    XCTAssertNotNil(operation.error);
+}
+
+- (void) testCircuitBreaker {
+    BNCNetworkService *service = [self service];
+    service.maximumRetryCount = 0;
+    service.circuitFailureThreshold = 3;
+    service.circuitOpenInterval = 1.0;
+
+    for (int i = 0; i < 3; i++) {
+        XCTAssertEqual([service circuitStateForHost:@"127.0.0.1"], BNCCircuitStateClosed);
+        [self operationWithService:service method:@"GET"];
+    }
+    XCTAssertEqual([service circuitStateForHost:@"127.0.0.1"], BNCCircuitStateOpen);
+    XCTAssertEqual([service circuitStateForHost:@"localhost"], BNCCircuitStateClosed);
+
+    // Requests fail right away while the circuit is open:
+    BNCNetworkOperation *operation = [self operationWithService:service method:@"GET"];
+    XCTAssertEqual(operation.error.code, NSURLErrorCannotConnectToHost);
+    XCTAssertTrue([operation.error.localizedDescription containsString:@"isn't responding"]);
+
+    // Later one request tests the host, and it opens again when the test fails:
+    [NSThread sleepForTimeInterval:1.1];
+    XCTAssertEqual([service circuitStateForHost:@"127.0.0.1"], BNCCircuitStateHalfOpen);
+    operation = [self operationWithService:service method:@"GET"];
+    XCTAssertFalse([operation.error.localizedDescription containsString:@"isn't responding"]);
+    XCTAssertEqual([service circuitStateForHost:@"127.0.0.1"], BNCCircuitStateOpen);
+
+    [service resetCircuits];
+    XCTAssertEqual([service circuitStateForHost:@"127.0.0.1"], BNCCircuitStateClosed);
+    XCTAssertEqualObjects(NSStringFromBNCCircuitState(BNCCircuitStateHalfOpen), @"HalfOpen");
+}
+
+- (void) testSlowHostDoesntDelayOtherHosts {
+    int listenSocket = 0;
+    NSURL *slowURL = [self silentURLWithSocket:&listenSocket];
+
+    BNCNetworkService *service = [self service];
+    service.maximumRetryCount = 0;
+    service.coalescesRequests = NO;
+    BNCNetworkHostConfiguration *configuration = [BNCNetworkHostConfiguration new];
+    configuration.maximumConcurrentRequests = 1;
+    configuration.timeoutInterval = 1.0;
+    [service setConfiguration:configuration forHost:@"127.0.0.1"];
+    XCTAssertEqual([service configurationForHost:@"127.0.0.1"].maximumConcurrentRequests, 1);
+    XCTAssertEqual([service configurationForHost:@"localhost"].maximumConcurrentRequests, 4);
+
+    // Fill the slow host. Its requests take turns:
+    NSDate *startDate = [NSDate date];
+    NSMutableArray<NSNumber*>*slowTimes = [NSMutableArray new];
+    XCTestExpectation *slowExpectation = [self expectationWithDescription:@"Slow"];
+    slowExpectation.expectedFulfillmentCount = 3;
+    for (int i = 0; i < 3; i++) {
+        BNCNetworkOperation *operation =
+            [service getOperationWithURL:slowURL completion:^(BNCNetworkOperation*operation) {
+                @synchronized(slowTimes) {
+                    [slowTimes addObject:@(- startDate.timeIntervalSinceNow)];
+                }
+                [slowExpectation fulfill];
+            }];
+        [operation start];
+    }
+
+    // Another host is answered right away:
+    XCTestExpectation *fastExpectation = [self expectationWithDescription:@"Fast"];
+    __block NSTimeInterval fastTime = 0.0;
+    BNCNetworkOperation *operation =
+        [service getOperationWithURL:[NSURL URLWithString:@"http://localhost:1/"]
+            completion:^(BNCNetworkOperation*operation) {
+                fastTime = - startDate.timeIntervalSinceNow;
+                [fastExpectation fulfill];
+            }];
+    [operation start];
+    [self waitForExpectations:@[ fastExpectation ] timeout:10.0];
+    XCTAssertLessThan(fastTime, 0.5);
+
+    [self waitForExpectations:@[ slowExpectation ] timeout:10.0];
+    close(listenSocket);
+    XCTAssertEqual(slowTimes.count, 3);
+    XCTAssertGreaterThan(slowTimes.lastObject.doubleValue, 2.5);
+}
+
+- (void) testCoalescing {
+    int listenSocket = 0;
+    NSURL *URL = [self silentURLWithSocket:&listenSocket];
+    BNCNetworkService *service = [self service];
+    service.maximumRetryCount = 0;
+    BNCNetworkHostConfiguration *configuration = [BNCNetworkHostConfiguration new];
+    configuration.timeoutInterval = 1.0;
+    service.defaultHostConfiguration = configuration;
+
+    // The same GET three times, a different token, and a POST:
+    NSMutableArray<BNCNetworkOperation*>*operations = [NSMutableArray new];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Coalescing"];
+    expectation.expectedFulfillmentCount = 5;
+    for (int i = 0; i < 5; i++) {
+        BNCNetworkOperation *operation =
+            [service getOperationWithURL:URL completion:^(BNCNetworkOperation*operation) {
+                [expectation fulfill];
+            }];
+        if (i == 3) [operation.request setValue:@"token other" forHTTPHeaderField:@"Authorization"];
+        if (i == 4) operation.request.HTTPMethod = @"POST";
+        [operations addObject:operation];
+        [operation start];
+    }
+    [self waitForExpectations:@[ expectation ] timeout:10.0];
+    close(listenSocket);
+
+    XCTAssertEqual(service.coalescedRequestCount, 2);
+    for (BNCNetworkOperation *operation in operations) {
+        XCTAssertEqual(operation.error.code, NSURLErrorTimedOut);
+    }
+}
+
+- (void) testConditionalRequestsAreCoalescedSeparately {
+    int listenSocket = 0;
+    NSURL *URL = [self silentURLWithSocket:&listenSocket];
+    BNCNetworkService *service = [self service];
+    service.maximumRetryCount = 0;
+    BNCNetworkHostConfiguration *configuration = [BNCNetworkHostConfiguration new];
+    configuration.timeoutInterval = 1.0;
+    service.defaultHostConfiguration = configuration;
+
+    // Two plain GETs, two with the same ETag, one with another ETag, and one with a date:
+    NSArray<NSDictionary*>*headers = @[
+        @{},
+        @{},
+        @{ @"If-None-Match": @"\"abc\"" },
+        @{ @"If-None-Match": @"\"abc\"" },
+        @{ @"If-None-Match": @"\"def\"" },
+        @{ @"If-Modified-Since": @"Thu, 01 Nov 2018 00:00:00 GMT" },
+    ];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Conditional"];
+    expectation.expectedFulfillmentCount = headers.count;
+    for (NSDictionary *requestHeaders in headers) {
+        BNCNetworkOperation *operation =
+            [service getOperationWithURL:URL completion:^(BNCNetworkOperation*operation) {
+                [expectation fulfill];
+            }];
+        for (NSString *field in requestHeaders)
+            [operation.request setValue:requestHeaders[field] forHTTPHeaderField:field];
+        [operation start];
+    }
+    [self waitForExpectations:@[ expectation ] timeout:10.0];
+    close(listenSocket);
+
+    XCTAssertEqual(service.coalescedRequestCount, 2);
+}
+
+@end
@@ -17,11 +17,13 @@ NS_ASSUME_NONNULL_BEGIN
 @interface BNCNetworkOperation : NSObject
 @property (readonly) NSURLSessionTaskState  sessionState;
 @property (readonly) NSMutableURLRequest*_Nullable request;
+@property (readonly) NSHTTPURLResponse*_Nullable response;
 @property (readonly) NSInteger              HTTPStatusCode;
 @property (readonly) NSError*_Nullable      error;
 @property (readonly) NSDate*_Nullable       dateStart;
 @property (readonly) NSDate*_Nullable       dateFinish;
 @property (readonly) id<NSObject>           responseData;
+@property (readonly) NSInteger              retryCount; // The number of times the request was retried.
 
 - (void) start;
 - (void) cancel;
@@ -31,6 +33,40 @@ NS_ASSUME_NONNULL_BEGIN
 - (void) setUser:(NSString*)user password:(NSString*)password;
 @end
 
+#pragma mark - BNCNetworkHostConfiguration
+
+/// The connection settings of one host. Each host has its own connections, so a slow host
+/// doesn't hold up requests to the others.
+@interface BNCNetworkHostConfiguration : NSObject <NSCopying>
+
+/// The most requests to the host at a time. Other requests wait their turn. Defaults to 4.
+@property (assign) NSInteger maximumConcurrentRequests;
+
+/// The request timeout. Defaults to 60 seconds.
+@property (assign) NSTimeInterval timeoutInterval;
+
+/// How long the connections to an idle host are kept open. Defaults to 60 seconds.
+@property (assign) NSTimeInterval keepAliveInterval;
+@end
+
+#pragma mark - BNCCircuitState
+
+/**
+ The state of a host's circuit breaker.
+
+ A host's circuit opens after several requests in a row fail with a transient error, like a
+ dropped connection or a 502. While the circuit is open, requests to the host fail right away.
+ After a while the circuit is half-open and one request is let through to test the host. If it
+ succeeds the circuit closes, otherwise it opens again.
+*/
+typedef NS_ENUM(NSInteger, BNCCircuitState) {
+    BNCCircuitStateClosed = 0,
+    BNCCircuitStateOpen,
+    BNCCircuitStateHalfOpen,
+};
+
+FOUNDATION_EXPORT NSString* NSStringFromBNCCircuitState(BNCCircuitState state);
+
 #pragma mark - BNCNetworkService
 
 @interface BNCNetworkService : NSObject
@@ -55,6 +91,79 @@ NS_ASSUME_NONNULL_BEGIN
 
 /// Allow self-signed certs from any host. Trumps `anySSLCertHosts`.
 @property (assign) BOOL allowAnySSLCert;
+
+///@name Coalescing
+
+/**
+ Identical GETs that are in flight at the same time share one request: same URL, same
+ Authorization, Accept, If-None-Match, and If-Modified-Since headers. Each operation still gets its own completion, and the
+ response JSON is decoded once for all of them. Defaults to YES.
+*/
+@property (assign) BOOL coalescesRequests;
+
+/// The number of operations that shared another operation's request.
+@property (readonly) NSInteger coalescedRequestCount;
+
+///@name Observing
+
+/**
+ Called with each operation that the service finishes, just before the operation's completion
+ block. It may be called from several queues at once. It's called once per operation, after any
+ retries, including operations that failed because their host's circuit was open. Operations
+ that joined another operation's request aren't passed since they didn't send their own request.
+*/
+@property (copy) void (^_Nullable finishedOperationObserver)(BNCNetworkOperation*operation);
+
+/**
+ Called after each attempt at an operation's request: each time the request is sent, including
+ retries, and each time it fails fast because its host's circuit is open. It's called before any
+ retry and before the operation finishes, and it may be called from several queues at once.
+
+ The operation holds the attempt's response and error. `duration` is the time from sending the
+ request until its response, without the time spent waiting for a connection or a retry. A request
+ that failed fast wasn't sent, so `wasSent` is NO and `duration` is zero.
+*/
+@property (copy) void (^_Nullable attemptObserver)
+    (BNCNetworkOperation*operation, NSTimeInterval duration, BOOL wasSent);
+
+///@name Hosts
+
+/// The connection settings for hosts that don't have their own.
+@property (copy, null_resettable) BNCNetworkHostConfiguration *defaultHostConfiguration;
+
+/// Sets the connection settings of a host. Set nil to use the default settings.
+- (void) setConfiguration:(BNCNetworkHostConfiguration*_Nullable)configuration forHost:(NSString*)host;
+
+/// The connection settings that are used for a host.
+- (BNCNetworkHostConfiguration*) configurationForHost:(NSString*)host;
+
+///@name Retries
+
+/**
+ The number of times an idempotent request (not a POST or PATCH) is retried after a transient
+ error. Retries wait exponentially longer each time, with some random jitter. Defaults to 2.
+*/
+@property (assign) NSInteger maximumRetryCount;
+
+/// The wait before the first retry. Defaults to 0.5 seconds.
+@property (assign) NSTimeInterval retryInterval;
+
+/// The longest wait between retries. Defaults to 8 seconds.
+@property (assign) NSTimeInterval maximumRetryInterval;
+
+///@name Circuit Breakers
+
+/// The number of transient failures in a row that opens a host's circuit. Defaults to 5.
+@property (assign) NSInteger circuitFailureThreshold;
+
+/// How long a circuit stays open before a request is let through. Defaults to 30 seconds.
+@property (assign) NSTimeInterval circuitOpenInterval;
+
+/// The state of the circuit breaker for a host name.
+- (BNCCircuitState) circuitStateForHost:(NSString*)host;
+
+/// Closes all circuits.
+- (void) resetCircuits;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -11,7 +11,34 @@
 #import "BNCNetworkService.h"
 #import "BNCLog.h"
 
-#pragma mark  BNCNetworkOperation
+#pragma mark BNCSharedResponse
+
+/// A response that's shared by coalesced operations. The JSON is decoded once for all of them.
+@interface BNCSharedResponse : NSObject
+@property (strong) NSData *data;
+@property (strong) id JSONObject;
+@property (strong) NSError *JSONError;
+@property (assign) BOOL isDecoded;
+@end
+
+@implementation BNCSharedResponse
+
+- (id) JSONObjectWithError:(NSError*__autoreleasing*)error {
+    @synchronized(self) {
+        if (!self.isDecoded) {
+            NSError *localError = nil;
+            self.JSONObject = [NSJSONSerialization JSONObjectWithData:self.data options:0 error:&localError];
+            self.JSONError = localError;
+            self.isDecoded = YES;
+        }
+        if (error) *error = self.JSONError;
+        return self.JSONObject;
+    }
+}
+
+@end
+
+#pragma mark - BNCNetworkOperation
 
 @interface BNCNetworkOperation ()
 @property BNCNetworkService     *networkService;
@@ -22,20 +49,110 @@
 @property id<NSObject>          responseData;
 @property NSDate                *dateStart;
 @property NSDate                *dateFinish;
+@property NSInteger             retryCount;
+@property NSString              *coalescingKey;     // Set while other operations can join this one.
+@property BNCSharedResponse     *sharedResponse;    // Set when the response is shared.
 @property (copy, nullable) void (^completionBlock)(BNCNetworkOperation*);
 @end
 
+#pragma mark - BNCNetworkHostConfiguration
+
+@implementation BNCNetworkHostConfiguration
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _maximumConcurrentRequests = 4;
+    _timeoutInterval = 60.0;
+    _keepAliveInterval = 60.0;
+    return self;
+}
+
+- (id) copyWithZone:(NSZone*)zone {
+    BNCNetworkHostConfiguration *copy = [[self.class allocWithZone:zone] init];
+    copy.maximumConcurrentRequests = self.maximumConcurrentRequests;
+    copy.timeoutInterval = self.timeoutInterval;
+    copy.keepAliveInterval = self.keepAliveInterval;
+    return copy;
+}
+
+- (BOOL) isEqual:(id)object {
+    if (![object isKindOfClass:BNCNetworkHostConfiguration.class]) return NO;
+    BNCNetworkHostConfiguration *other = object;
+    return
+        self.maximumConcurrentRequests == other.maximumConcurrentRequests &&
+        self.timeoutInterval == other.timeoutInterval &&
+        self.keepAliveInterval == other.keepAliveInterval;
+}
+
+- (NSUInteger) hash {
+    return (NSUInteger) self.maximumConcurrentRequests ^ (NSUInteger) self.timeoutInterval;
+}
+
+@end
+
+#pragma mark - BNCNetworkHostPool
+
+/// The session and request queue of one host.
+@interface BNCNetworkHostPool : NSObject
+@property (copy)   NSString *host;
+@property (copy)   BNCNetworkHostConfiguration *configuration;
+@property (strong) NSURLSession *session;       // Nil while the host is idle.
+@property (strong) NSOperationQueue *delegateQueue;
+@property (assign) NSInteger activeCount;
+@property (strong) NSMutableArray<BNCNetworkOperation*> *waitingOperations;
+@property (assign) NSInteger idleGeneration;    // Changes each time the host becomes busy.
+@end
+
+@implementation BNCNetworkHostPool
+@end
+
+#pragma mark - BNCCircuit
+
+NSString* NSStringFromBNCCircuitState(BNCCircuitState state) {
+    switch (state) {
+    case BNCCircuitStateClosed:     return @"Closed";
+    case BNCCircuitStateOpen:       return @"Open";
+    case BNCCircuitStateHalfOpen:   return @"HalfOpen";
+    }
+    return [NSString stringWithFormat:@"< Unknown circuit state %ld >", (long) state];
+}
+
+/// The circuit breaker of a host. Only hosts that have had failures have a circuit.
+@interface BNCCircuit : NSObject
+@property NSInteger         failureCount;   // Transient failures in a row.
+@property NSDate            *openUntilDate; // Nil while the circuit is closed.
+@property BOOL              isTesting;      // The half-open test request is in flight.
+@property (readonly) BNCCircuitState state;
+@end
+
+@implementation BNCCircuit
+
+- (BNCCircuitState) state {
+    if (!self.openUntilDate) return BNCCircuitStateClosed;
+    if ([self.openUntilDate timeIntervalSinceNow] > 0.0) return BNCCircuitStateOpen;
+    return BNCCircuitStateHalfOpen;
+}
+
+@end
+
 #pragma mark - BNCNetworkService
 
 @interface BNCNetworkService () <NSURLSessionDelegate> {
     NSMutableArray*_pinnedPublicKeys;
     NSMutableSet<NSString*>*_anySSLCertHosts;
+    NSMutableDictionary<NSString*, BNCCircuit*>*_circuits;
+    NSMutableDictionary<NSString*, NSMutableArray<BNCNetworkOperation*>*>*_coalescedOperations;
+    NSInteger _coalescedRequestCount;
+    NSMutableDictionary<NSString*, BNCNetworkHostPool*>*_pools;
+    NSMutableDictionary<NSString*, BNCNetworkHostConfiguration*>*_hostConfigurations;
+    BNCNetworkHostConfiguration *_defaultHostConfiguration;
 }
 
 - (void) startOperation:(BNCNetworkOperation*)operation;
 
 @property NSOperationQueue *serviceQueue;
-@property NSURLSession *session;
+@property NSURLCache *URLCache;
 @end
 
 #pragma mark - BNCNetworkOperation
@@ -63,8 +180,9 @@
     }
     NSError *error = nil;
     NSDictionary *dictionary =
-        [NSJSONSerialization JSONObjectWithData:(NSData*)self.responseData
-            options:0 error:&error];
+        (self.sharedResponse.data == self.responseData)
+        ? [self.sharedResponse JSONObjectWithError:&error]
+        : [NSJSONSerialization JSONObjectWithData:(NSData*)self.responseData options:0 error:&error];
     if (error) {
         self.error = error;
         return;
@@ -134,11 +252,7 @@
     }
     cacheURL = [cacheURL URLByAppendingPathComponent:@"io.branch.network.cache"];
 
-    NSURLSessionConfiguration *configuration =
-        [NSURLSessionConfiguration defaultSessionConfiguration];
-    configuration.timeoutIntervalForRequest = 60.0;
-    configuration.timeoutIntervalForResource = 60.0;
-    configuration.URLCache =
+    self.URLCache =
         [[NSURLCache alloc]
             initWithMemoryCapacity:20*1024*1024
             diskCapacity:200*1024*1024
@@ -149,11 +263,18 @@
     self.serviceQueue.maxConcurrentOperationCount = 3;
     self.serviceQueue.qualityOfService = NSQualityOfServiceUserInteractive;
 
-    self.session =
-        [NSURLSession sessionWithConfiguration:configuration
-            delegate:self
-            delegateQueue:self.serviceQueue];
-    self.session.sessionDescription = @"io.branch.network.session";
+    _pools = [NSMutableDictionary new];
+    _hostConfigurations = [NSMutableDictionary new];
+    _defaultHostConfiguration = [BNCNetworkHostConfiguration new];
+
+    self.maximumRetryCount = 2;
+    self.retryInterval = 0.5;
+    self.maximumRetryInterval = 8.0;
+    self.circuitFailureThreshold = 5;
+    self.circuitOpenInterval = 30.0;
+    _circuits = [NSMutableDictionary new];
+    _coalescedOperations = [NSMutableDictionary new];
+    self.coalescesRequests = YES;
 
     return self;
 }
@@ -225,27 +346,362 @@
 - (void) startOperation:(BNCNetworkOperation*)operation {
     operation.networkService = self;
     operation.dateStart = [NSDate date];
+    operation.retryCount = 0;
+    operation.sharedResponse = nil;
+
+    // Join an identical GET that's already in flight:
+    NSString *key = (self.coalescesRequests) ? [self.class coalescingKeyForRequest:operation.request] : nil;
+    if (key) {
+        @synchronized(self) {
+            NSMutableArray *operations = _coalescedOperations[key];
+            if (operations) {
+                [operations addObject:operation];
+                _coalescedRequestCount++;
+                BNCLogDebug(@"Network joined operation %@.", operation.request.URL);
+                return;
+            }
+            _coalescedOperations[key] = [NSMutableArray new];
+            operation.coalescingKey = key;
+        }
+    }
+    [self sendOperation:operation];
+}
+
+/// Only GETs with the same URL, credentials, and conditional headers are coalesced. Otherwise an
+/// unconditional GET could get a 304 it never asked for.
++ (NSString*) coalescingKeyForRequest:(NSURLRequest*)request {
+    NSString *method = request.HTTPMethod.uppercaseString ?: @"GET";
+    if (![method isEqualToString:@"GET"] || request.HTTPBody.length || !request.URL) return nil;
+    return [NSString stringWithFormat:@"%@\n%@\n%@\n%@\n%@",
+        request.URL.absoluteString,
+        [request valueForHTTPHeaderField:@"Authorization"] ?: @"",
+        [request valueForHTTPHeaderField:@"Accept"] ?: @"",
+        [request valueForHTTPHeaderField:@"If-None-Match"] ?: @"",
+        [request valueForHTTPHeaderField:@"If-Modified-Since"] ?: @""];
+}
+
+/// Calls the operation's completion block, and those of the operations that joined it.
+- (void) finishOperation:(BNCNetworkOperation*)operation {
+    NSArray<BNCNetworkOperation*>*joinedOperations = nil;
+    if (operation.coalescingKey) {
+        @synchronized(self) {
+            joinedOperations = _coalescedOperations[operation.coalescingKey];
+            [_coalescedOperations removeObjectForKey:operation.coalescingKey];
+        }
+        operation.coalescingKey = nil;
+    }
+    void (^observer)(BNCNetworkOperation*) = self.finishedOperationObserver;
+    if (observer) observer(operation);
+
+    BNCSharedResponse *sharedResponse = nil;
+    if (joinedOperations.count && [operation.responseData isKindOfClass:NSData.class]) {
+        sharedResponse = [BNCSharedResponse new];
+        sharedResponse.data = (NSData*) operation.responseData;
+        operation.sharedResponse = sharedResponse;
+    }
+    for (BNCNetworkOperation *joinedOperation in joinedOperations) {
+        joinedOperation.responseData = operation.responseData;
+        joinedOperation.response = operation.response;
+        joinedOperation.error = operation.error;
+        joinedOperation.retryCount = operation.retryCount;
+        joinedOperation.dateFinish = operation.dateFinish;
+        joinedOperation.sharedResponse = sharedResponse;
+        [self.serviceQueue addOperationWithBlock:^{
+            if (joinedOperation.completionBlock)
+                joinedOperation.completionBlock(joinedOperation);
+        }];
+    }
+    if (operation.completionBlock)
+        operation.completionBlock(operation);
+}
+
+- (void) observeAttemptOfOperation:(BNCNetworkOperation*)operation
+        duration:(NSTimeInterval)duration
+        wasSent:(BOOL)wasSent {
+    void (^observer)(BNCNetworkOperation*, NSTimeInterval, BOOL) = self.attemptObserver;
+    if (observer) observer(operation, duration, wasSent);
+}
+
+- (NSInteger) coalescedRequestCount {
+    @synchronized(self) {
+        return _coalescedRequestCount;
+    }
+}
+
+- (void) sendOperation:(BNCNetworkOperation*)operation {
+    NSString *host = operation.request.URL.host ?: @"";
+    if (![self shouldSendRequestToHost:host]) {
+        // Fail fast while the host is down:
+        operation.responseData = nil;
+        operation.response = nil;
+        operation.error =
+            [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotConnectToHost userInfo:@{
+                NSLocalizedDescriptionKey:
+                    [NSString stringWithFormat:@"The host '%@' isn't responding.", host],
+                NSURLErrorFailingURLErrorKey: operation.request.URL,
+            }];
+        operation.dateFinish = [NSDate date];
+        BNCLogDebug(@"Network circuit for '%@' is open. Failed operation %@.",
+            host, operation.request.URL.absoluteString);
+        [self.serviceQueue addOperationWithBlock:^{
+            [self observeAttemptOfOperation:operation duration:0.0 wasSent:NO];
+            [self finishOperation:operation];
+        }];
+        return;
+    }
+
+    [self enqueueOperation:operation inPool:[self poolForHost:host]];
+}
+
+- (void) sendTaskForOperation:(BNCNetworkOperation*)operation inPool:(BNCNetworkHostPool*)pool {
+    NSString *host = pool.host;
+    NSDate *sendDate = [NSDate date];
+    operation.request.timeoutInterval = pool.configuration.timeoutInterval;
     operation.sessionTask =
-        [self.session dataTaskWithRequest:operation.request
+        [pool.session dataTaskWithRequest:operation.request
             completionHandler:
             ^(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error) {
                 operation.responseData = data;
                 operation.response = (NSHTTPURLResponse*) response;
                 operation.error = error;
                 operation.dateFinish = [NSDate date];
+                [self dequeueOperationInPool:pool];
+                [self observeAttemptOfOperation:operation
+                    duration:[operation.dateFinish timeIntervalSinceDate:sendDate]
+                    wasSent:YES];
+
+                BOOL isTransientFailure = [self.class isTransientFailure:operation];
+                [self recordOperation:operation forHost:host failed:isTransientFailure];
+                if (isTransientFailure && [self shouldRetryOperation:operation]) {
+                    NSTimeInterval delay = [self retryDelayForOperation:operation];
+                    operation.retryCount++;
+                    BNCLogWarning(@"Network retry %ld of %ld for %@ in %1.1fs. Status %ld error %@.",
+                        (long) operation.retryCount, (long) self.maximumRetryCount,
+                        operation.request.URL.absoluteString, delay,
+                        (long) operation.HTTPStatusCode, operation.error);
+                    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                        dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+                        [self sendOperation:operation];
+                    });
+                    return;
+                }
+
                 BNCLogDebug(@"Network finish operation %@ %1.3fs. Status %ld error %@.\n%@.",
                     operation.request.URL.absoluteString,
                     [operation.dateFinish timeIntervalSinceDate:operation.dateStart],
                     (long)operation.HTTPStatusCode,
                     operation.error,
                     operation.stringFromResponseData);
-                if (operation.completionBlock)
-                    operation.completionBlock(operation);
+                [self finishOperation:operation];
             }];
     BNCLogDebug(@"Network start operation %@.", operation.request.URL);
     [operation.sessionTask resume];
 }
 
+#pragma mark - Hosts
+
+- (BNCNetworkHostConfiguration*) defaultHostConfiguration {
+    @synchronized(self) {
+        return [_defaultHostConfiguration copy];
+    }
+}
+
+- (void) setDefaultHostConfiguration:(BNCNetworkHostConfiguration*)configuration {
+    @synchronized(self) {
+        _defaultHostConfiguration = [configuration copy] ?: [BNCNetworkHostConfiguration new];
+    }
+}
+
+- (void) setConfiguration:(BNCNetworkHostConfiguration*)configuration forHost:(NSString*)host {
+    @synchronized(self) {
+        _hostConfigurations[host] = [configuration copy];
+    }
+}
+
+- (BNCNetworkHostConfiguration*) configurationForHost:(NSString*)host {
+    @synchronized(self) {
+        return [_hostConfigurations[host] ?: _defaultHostConfiguration copy];
+    }
+}
+
+/// Returns the host's pool. When the configuration changes a new pool takes over and the old one
+/// finishes the requests that it has.
+- (BNCNetworkHostPool*) poolForHost:(NSString*)host {
+    @synchronized(self) {
+        BNCNetworkHostConfiguration *configuration = _hostConfigurations[host] ?: _defaultHostConfiguration;
+        BNCNetworkHostPool *pool = _pools[host];
+        if ([pool.configuration isEqual:configuration]) return pool;
+
+        pool = [BNCNetworkHostPool new];
+        pool.host = host;
+        pool.configuration = configuration;
+        pool.waitingOperations = [NSMutableArray new];
+        pool.delegateQueue = [NSOperationQueue new];
+        pool.delegateQueue.name = [NSString stringWithFormat:@"io.branch.network.queue.%@", host];
+        pool.delegateQueue.maxConcurrentOperationCount = MAX(1, configuration.maximumConcurrentRequests);
+        pool.delegateQueue.qualityOfService = NSQualityOfServiceUserInteractive;
+        _pools[host] = pool;
+        return pool;
+    }
+}
+
+- (NSURLSession*) sessionForPool:(BNCNetworkHostPool*)pool {
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    configuration.timeoutIntervalForRequest = pool.configuration.timeoutInterval;
+    configuration.timeoutIntervalForResource = pool.configuration.timeoutInterval;
+    configuration.HTTPMaximumConnectionsPerHost = MAX(1, pool.configuration.maximumConcurrentRequests);
+    configuration.URLCache = self.URLCache;
+    NSURLSession *session =
+        [NSURLSession sessionWithConfiguration:configuration
+            delegate:self
+            delegateQueue:pool.delegateQueue];
+    session.sessionDescription = [NSString stringWithFormat:@"io.branch.network.session.%@", pool.host];
+    return session;
+}
+
+- (void) enqueueOperation:(BNCNetworkOperation*)operation inPool:(BNCNetworkHostPool*)pool {
+    @synchronized(pool) {
+        if (pool.activeCount >= MAX(1, pool.configuration.maximumConcurrentRequests)) {
+            [pool.waitingOperations addObject:operation];
+            return;
+        }
+        pool.activeCount++;
+        pool.idleGeneration++;
+        if (!pool.session) pool.session = [self sessionForPool:pool];
+    }
+    [self sendTaskForOperation:operation inPool:pool];
+}
+
+- (void) dequeueOperationInPool:(BNCNetworkHostPool*)pool {
+    BNCNetworkOperation *operation = nil;
+    @synchronized(pool) {
+        operation = pool.waitingOperations.firstObject;
+        if (operation) {
+            [pool.waitingOperations removeObjectAtIndex:0];
+        } else {
+            pool.activeCount--;
+        }
+        if (pool.activeCount == 0) [self closeIdlePool:pool generation:pool.idleGeneration];
+    }
+    if (operation) [self sendTaskForOperation:operation inPool:pool];
+}
+
+/// Closes the host's connections if it's still idle after the keep-alive interval.
+- (void) closeIdlePool:(BNCNetworkHostPool*)pool generation:(NSInteger)generation {
+    NSTimeInterval interval = pool.configuration.keepAliveInterval;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)),
+        dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        @synchronized(pool) {
+            if (pool.activeCount > 0 || pool.idleGeneration != generation) return;
+            [pool.session finishTasksAndInvalidate];
+            pool.session = nil;
+        }
+    });
+}
+
+#pragma mark - Retries
+
+/// Errors where the same request might work if it's tried again.
++ (BOOL) isTransientFailure:(BNCNetworkOperation*)operation {
+    NSError *error = operation.error;
+    if (error) {
+        if (![error.domain isEqualToString:NSURLErrorDomain]) return NO;
+        switch (error.code) {
+        case NSURLErrorTimedOut:
+        case NSURLErrorCannotFindHost:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorNetworkConnectionLost:
+        case NSURLErrorDNSLookupFailed:
+        case NSURLErrorNotConnectedToInternet:
+            return YES;
+        default:
+            return NO;
+        }
+    }
+    NSInteger status = operation.HTTPStatusCode;
+    return (status == 502 || status == 503 || status == 504);
+}
+
+- (BOOL) shouldRetryOperation:(BNCNetworkOperation*)operation {
+    if (operation.retryCount >= self.maximumRetryCount) return NO;
+    // A POST or PATCH that failed might have been applied anyway:
+    NSString *method = operation.request.HTTPMethod.uppercaseString ?: @"GET";
+    return !([method isEqualToString:@"POST"] || [method isEqualToString:@"PATCH"]);
+}
+
+- (NSTimeInterval) retryDelayForOperation:(BNCNetworkOperation*)operation {
+    // Exponential backoff with half the wait random so that clients don't retry in lockstep:
+    NSTimeInterval delay = self.retryInterval * pow(2.0, operation.retryCount);
+    delay = MIN(delay, self.maximumRetryInterval);
+    delay = delay / 2.0 + (delay / 2.0) * ((double) arc4random_uniform(1001) / 1000.0);
+
+    // Wait at least as long as the server asks, up to the maximum:
+    NSString *retryAfter = operation.response.allHeaderFields[@"Retry-After"];
+    if ([retryAfter isKindOfClass:NSString.class] && retryAfter.doubleValue > delay)
+        delay = MIN(retryAfter.doubleValue, self.maximumRetryInterval);
+    return delay;
+}
+
+#pragma mark - Circuit Breakers
+
+- (BOOL) shouldSendRequestToHost:(NSString*)host {
+    @synchronized(self) {
+        BNCCircuit *circuit = _circuits[host];
+        switch (circuit.state) {
+        case BNCCircuitStateClosed:
+            return YES;
+        case BNCCircuitStateOpen:
+            return NO;
+        case BNCCircuitStateHalfOpen:
+            // Let one request through to test the host:
+            if (circuit.isTesting) return NO;
+            circuit.isTesting = YES;
+            return YES;
+        }
+    }
+    return YES;
+}
+
+- (void) recordOperation:(BNCNetworkOperation*)operation forHost:(NSString*)host failed:(BOOL)failed {
+    @synchronized(self) {
+        BNCCircuit *circuit = _circuits[host];
+        if ([operation.error.domain isEqualToString:NSURLErrorDomain] &&
+            operation.error.code == NSURLErrorCancelled) {
+            circuit.isTesting = NO;
+            return;
+        }
+        if (!failed) {
+            if (circuit.openUntilDate) BNCLog(@"Network circuit for '%@' is closed.", host);
+            [_circuits removeObjectForKey:host];
+            return;
+        }
+        if (!circuit) {
+            circuit = [BNCCircuit new];
+            _circuits[host] = circuit;
+        }
+        circuit.failureCount++;
+        if (circuit.isTesting || circuit.failureCount >= self.circuitFailureThreshold) {
+            circuit.isTesting = NO;
+            circuit.openUntilDate = [NSDate dateWithTimeIntervalSinceNow:self.circuitOpenInterval];
+            BNCLogWarning(@"Network circuit for '%@' is open for %1.0fs after %ld failures.",
+                host, self.circuitOpenInterval, (long) circuit.failureCount);
+        }
+    }
+}
+
+- (BNCCircuitState) circuitStateForHost:(NSString*)host {
+    @synchronized(self) {
+        BNCCircuit *circuit = _circuits[host];
+        return (circuit) ? circuit.state : BNCCircuitStateClosed;
+    }
+}
+
+- (void) resetCircuits {
+    @synchronized(self) {
+        [_circuits removeAllObjects];
+    }
+}
+
 #pragma mark - Gorey Details
 
 - (NSError*) pinSessionToPublicSecKeyRefs:(NSArray/**<SecKeyRef>*/*)publicKeys {
@@ -0,0 +1,94 @@
+/**
+ @file          XGBotCache.Test.m
+ @package       xcode-github
+ @brief         Tests for XGBotCache.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGBotCache.h"
+#import "XGXcodeBot.h"
+
+@interface XGXcodeBot (Test)
+- (NSDictionary<NSString*, NSString*>*) cacheFields;
+- (instancetype) initWithServerName:(NSString*)serverName cacheFields:(NSDictionary<NSString*, NSString*>*)fields;
+@end
+
+@interface XGBotCacheTest : BNCTestCase
+@end
+
+@implementation XGBotCacheTest
+
+- (NSURL*) cacheFileURL {
+    NSString *name = [NSString stringWithFormat:@"XGBotCacheTest-%@.plist", [NSUUID UUID].UUIDString];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+}
+
+- (void) testCacheSurvivesRestart {
+    NSURL *fileURL = [self cacheFileURL];
+    XGXcodeBot *bot = [[XGXcodeBot alloc] initWithServerName:@"localhost" dictionary:@{
+        @"_id":                 @"bot-1",
+        @"_rev":                @"3-abc",
+        @"name":                @"xcode-github PR#1 Title",
+        @"templateBotName":     @"Template",
+        @"pullRequestNumber":   @"1",
+        @"pullRequestTitle":    @"Title",
+        @"configuration": @{ @"sourceControlBlueprint": @{
+            @"DVTSourceControlWorkspaceBlueprintRemoteRepositoriesKey": @[ @{
+                @"DVTSourceControlWorkspaceBlueprintRemoteRepositoryURLKey": @"git@github.com:owner/repo.git",
+            }],
+            @"DVTSourceControlWorkspaceBlueprintLocationsKey": @{
+                @"ABCDEF": @{ @"DVTSourceControlBranchIdentifierKey": @"branch-1" },
+            },
+        }},
+    }];
+    NSDictionary *template = @{ @"name": @"Template", @"configuration": @{ @"triggers": @[ [NSNull null] ] } };
+
+    XGBotCache *cache = [[XGBotCache alloc] initWithFileURL:fileURL];
+    [cache setFields:bot.cacheFields forBotID:@"bot-1" server:@"localhost" revision:@"3-abc"];
+    [cache setTemplate:template forBotID:@"bot-1" server:@"localhost" revision:@"3-abc"];
+    [cache setFields:@{ @"name": @"Other" } forBotID:@"bot-2" server:@"localhost" revision:@"1-abc"];
+    [cache setFields:@{ @"name": @"Other" } forBotID:@"bot-2" server:@"otherhost" revision:@"1-abc"];
+    XCTAssertEqualObjects([cache templateForBotID:@"bot-1" server:@"localhost" revision:@"3-abc"], template);
+    [cache flush];
+
+    // A new cache reads the saved one:
+    cache = [[XGBotCache alloc] initWithFileURL:fileURL];
+    NSDictionary *fields = [cache fieldsForBotID:@"bot-1" server:@"localhost" revision:@"3-abc"];
+    XCTAssertNotNil(fields);
+    XGXcodeBot *cachedBot = [[XGXcodeBot alloc] initWithServerName:@"localhost" cacheFields:fields];
+    XCTAssertEqualObjects(cachedBot.name, bot.name);
+    XCTAssertEqualObjects(cachedBot.botID, bot.botID);
+    XCTAssertEqualObjects(cachedBot.revision, @"3-abc");
+    XCTAssertEqualObjects(cachedBot.repoOwner, @"owner");
+    XCTAssertEqualObjects(cachedBot.repoName, @"repo");
+    XCTAssertEqualObjects(cachedBot.branch, @"branch-1");
+    XCTAssertEqualObjects(cachedBot.sourceControlRepository, bot.sourceControlRepository);
+    XCTAssertEqualObjects(cachedBot.sourceControlWorkspaceBlueprintLocationsID, @"ABCDEF");
+    XCTAssertEqualObjects(cachedBot.templateBotName, @"Template");
+    XCTAssertEqualObjects(cachedBot.pullRequestNumber, @"1");
+    XCTAssertEqualObjects(cachedBot.pullRequestTitle, @"Title");
+    XCTAssertEqualObjects([cache templateForBotID:@"bot-1" server:@"localhost" revision:@"3-abc"], template);
+
+    // A new revision replaces the old one:
+    XCTAssertNil([cache fieldsForBotID:@"bot-1" server:@"localhost" revision:@"4-def"]);
+    [cache setFields:@{ @"name": @"New" } forBotID:@"bot-1" server:@"localhost" revision:@"4-def"];
+    XCTAssertEqualObjects([cache fieldsForBotID:@"bot-1" server:@"localhost" revision:@"4-def"], @{ @"name": @"New" });
+    XCTAssertNil([cache fieldsForBotID:@"bot-1" server:@"localhost" revision:@"3-abc"]);
+    XCTAssertNil([cache templateForBotID:@"bot-1" server:@"localhost" revision:@"4-def"]);
+
+    // Deleted bots are forgotten, but only for their server:
+    [cache removeBotsForServer:@"localhost" exceptBotIDs:[NSSet setWithObject:@"bot-1"]];
+    XCTAssertNil([cache fieldsForBotID:@"bot-2" server:@"localhost" revision:@"1-abc"]);
+    XCTAssertNotNil([cache fieldsForBotID:@"bot-2" server:@"otherhost" revision:@"1-abc"]);
+    XCTAssertNotNil([cache fieldsForBotID:@"bot-1" server:@"localhost" revision:@"4-def"]);
+
+    [cache clear];
+    XCTAssertNil([cache fieldsForBotID:@"bot-1" server:@"localhost" revision:@"4-def"]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:fileURL.path]);
+}
+
+@end
@@ -0,0 +1,68 @@
+/**
+ @file          XGBotCache.h
+ @package       xcode-github
+ @brief         A cache of parsed Xcode bot configurations, kept by bot revision.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The bot cache keeps what was parsed from each bot, keyed by the server, the bot ID, and the
+ bot's `_rev`. The server changes a bot's `_rev` whenever the bot changes, so a bot whose revision
+ hasn't changed doesn't need to be parsed again.
+
+ Two things are kept for a bot: the fields that make up an `XGXcodeBot`, and the bot's
+ configuration prepared as a template for duplicating the bot.
+
+ The cache is kept in memory and saved to a binary property list a short time after it changes.
+ Unsaved changes are saved when the process exits too.
+*/
+@interface XGBotCache : NSObject
+
++ (XGBotCache*) sharedCache;
+
+/// Makes a cache that's saved to `fileURL`, or a cache that's only in memory if it's nil.
+- (instancetype) initWithFileURL:(NSURL*_Nullable)fileURL NS_DESIGNATED_INITIALIZER;
+- (instancetype) init NS_UNAVAILABLE;
+
+@property (strong, readonly) NSURL*_Nullable fileURL;
+
+/// The bot fields that were saved for the revision, or nil if they weren't saved.
+- (NSDictionary<NSString*, NSString*>*_Nullable) fieldsForBotID:(NSString*)botID
+                                                         server:(NSString*)server
+                                                       revision:(NSString*)revision;
+
+/// Saves the bot's fields. The fields must be property list values.
+- (void) setFields:(NSDictionary<NSString*, NSString*>*)fields
+          forBotID:(NSString*)botID
+            server:(NSString*)server
+          revision:(NSString*)revision;
+
+/// The template configuration that was saved for the revision, or nil if it wasn't saved.
+- (NSDictionary*_Nullable) templateForBotID:(NSString*)botID
+                                     server:(NSString*)server
+                                   revision:(NSString*)revision;
+
+/// Saves the template configuration of a bot. The template must be a JSON object.
+- (void) setTemplate:(NSDictionary*)template
+            forBotID:(NSString*)botID
+              server:(NSString*)server
+            revision:(NSString*)revision;
+
+/// Forgets the server's bots that aren't in `botIDs`, like bots that were deleted.
+- (void) removeBotsForServer:(NSString*)server exceptBotIDs:(NSSet<NSString*>*)botIDs;
+
+/// Clears the cache.
+- (void) clear;
+
+/// Saves any unsaved changes now.
+- (void) flush;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,268 @@
+/**
+ @file          XGBotCache.m
+ @package       xcode-github
+ @brief         A cache of parsed Xcode bot configurations, kept by bot revision.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGBotCache.h"
+#import "XGUtility.h"
+#import "BNCLog.h"
+
+/// Changes are written to the cache file at most this often.
+static NSTimeInterval const kFlushDelaySeconds = 2.0;
+
+#pragma mark XGBotCacheEntry
+
+/// What's kept for one bot. Only the latest revision of a bot is kept.
+@interface XGBotCacheEntry : NSObject
+@property (strong) NSString *server;
+@property (strong) NSString *revision;
+@property (strong) NSDictionary<NSString*, NSString*>*_Nullable fields;
+/// The template as it's saved, in compact JSON. It's decoded the first time it's used.
+@property (strong) NSData*_Nullable templateData;
+@property (strong) NSDictionary*_Nullable template;
+@end
+
+@implementation XGBotCacheEntry
+
++ (instancetype) entryWithPropertyList:(NSDictionary*)plist {
+    if (![plist isKindOfClass:NSDictionary.class] ||
+        ![plist[@"server"] isKindOfClass:NSString.class] ||
+        ![plist[@"revision"] isKindOfClass:NSString.class])
+        return nil;
+    XGBotCacheEntry *entry = [XGBotCacheEntry new];
+    entry.server = plist[@"server"];
+    entry.revision = plist[@"revision"];
+    if ([plist[@"fields"] isKindOfClass:NSDictionary.class])
+        entry.fields = plist[@"fields"];
+    if ([plist[@"template"] isKindOfClass:NSData.class])
+        entry.templateData = plist[@"template"];
+    return entry;
+}
+
+- (NSDictionary*) propertyList {
+    NSMutableDictionary *plist = [NSMutableDictionary new];
+    plist[@"server"] = self.server;
+    plist[@"revision"] = self.revision;
+    plist[@"fields"] = self.fields;
+    plist[@"template"] = self.templateData;
+    return plist;
+}
+
+@end
+
+#pragma mark - XGBotCache
+
+@interface XGBotCache () {
+    dispatch_queue_t _queue;
+    NSMutableDictionary<NSString*, XGBotCacheEntry*>*_entries;
+    XGDeferredFlush *_deferredFlush;
+}
+@end
+
+@implementation XGBotCache
+
++ (XGBotCache*) sharedCache {
+    static dispatch_once_t onceToken = 0;
+    static XGBotCache*_sharedCache = nil;
+    dispatch_once(&onceToken, ^ {
+        NSError *error = nil;
+        NSURL *cacheURL =
+            [[NSFileManager defaultManager]
+                URLForDirectory:NSCachesDirectory
+                inDomain:NSUserDomainMask
+                appropriateForURL:nil
+                create:YES
+                error:&error];
+        if (error) {
+            BNCLogError(@"Error locating cache directory. Bots won't be cached between runs. %@.", error);
+            cacheURL = nil;
+        } else {
+            cacheURL = [cacheURL URLByAppendingPathComponent:@"io.branch.xcode-github"];
+            [[NSFileManager defaultManager]
+                createDirectoryAtURL:cacheURL withIntermediateDirectories:YES attributes:nil error:nil];
+            cacheURL = [cacheURL URLByAppendingPathComponent:@"bots.plist"];
+        }
+        _sharedCache = [[XGBotCache alloc] initWithFileURL:cacheURL];
+    });
+    return _sharedCache;
+}
+
+- (instancetype) initWithFileURL:(NSURL*)fileURL {
+    self = [super init];
+    if (!self) return self;
+    _fileURL = fileURL;
+    _queue = dispatch_queue_create("io.branch.xcode-github.bot-cache", DISPATCH_QUEUE_CONCURRENT);
+    _entries = [NSMutableDictionary new];
+    if (_fileURL) {
+        __weak __typeof(self) weakSelf = self;
+        _deferredFlush = [[XGDeferredFlush alloc] initWithDelay:kFlushDelaySeconds storeQueue:_queue save:^{
+            [weakSelf save];
+        }];
+    }
+
+    NSData *data = (_fileURL) ? [NSData dataWithContentsOfURL:_fileURL] : nil;
+    if (data) {
+        NSError *error = nil;
+        NSDictionary *plist =
+            [NSPropertyListSerialization propertyListWithData:data
+                options:NSPropertyListImmutable format:NULL error:&error];
+        if (![plist isKindOfClass:NSDictionary.class]) {
+            BNCLogError(@"Can't read the bot cache at '%@': %@.", _fileURL.path, error);
+            plist = nil;
+        }
+        for (NSString *key in plist.keyEnumerator) {
+            XGBotCacheEntry *entry = [XGBotCacheEntry entryWithPropertyList:plist[key]];
+            if (entry) _entries[key] = entry;
+        }
+        BNCLogDebug(@"Loaded %ld cached bots.", (long) _entries.count);
+    }
+    return self;
+}
+
++ (NSString*) keyForBotID:(NSString*)botID server:(NSString*)server {
+    return [NSString stringWithFormat:@"%@ %@", server, botID];
+}
+
+/// Returns the entry for the revision, or nil. Called on the queue.
+- (XGBotCacheEntry*) entryForKey:(NSString*)key revision:(NSString*)revision {
+    XGBotCacheEntry *entry = _entries[key];
+    return [entry.revision isEqualToString:revision] ? entry : nil;
+}
+
+/// Returns the entry for the revision, replacing an entry for an older revision. Called as a barrier.
+- (XGBotCacheEntry*) newEntryForKey:(NSString*)key server:(NSString*)server revision:(NSString*)revision {
+    XGBotCacheEntry *entry = [self entryForKey:key revision:revision];
+    if (!entry) {
+        entry = [XGBotCacheEntry new];
+        entry.server = server;
+        entry.revision = revision;
+        _entries[key] = entry;
+    }
+    return entry;
+}
+
+#pragma mark - Fields and Templates
+
+- (NSDictionary<NSString*, NSString*>*) fieldsForBotID:(NSString*)botID
+        server:(NSString*)server
+        revision:(NSString*)revision {
+    NSString *key = [self.class keyForBotID:botID server:server];
+    __block NSDictionary *fields = nil;
+    dispatch_sync(_queue, ^{
+        fields = [self entryForKey:key revision:revision].fields;
+    });
+    return fields;
+}
+
+- (void) setFields:(NSDictionary<NSString*, NSString*>*)fields
+        forBotID:(NSString*)botID
+        server:(NSString*)server
+        revision:(NSString*)revision {
+    NSString *key = [self.class keyForBotID:botID server:server];
+    fields = [fields copy];
+    dispatch_barrier_async(_queue, ^{
+        XGBotCacheEntry *entry = [self newEntryForKey:key server:server revision:revision];
+        if ([entry.fields isEqualToDictionary:fields]) return;
+        entry.fields = fields;
+        [self setNeedsFlush];
+    });
+}
+
+- (NSDictionary*) templateForBotID:(NSString*)botID
+        server:(NSString*)server
+        revision:(NSString*)revision {
+    NSString *key = [self.class keyForBotID:botID server:server];
+    __block XGBotCacheEntry *entry = nil;
+    __block NSDictionary *template = nil;
+    dispatch_sync(_queue, ^{
+        entry = [self entryForKey:key revision:revision];
+        template = entry.template;
+    });
+    if (template || !entry.templateData) return template;
+
+    // Decode a saved template once:
+    template = [NSJSONSerialization JSONObjectWithData:entry.templateData options:0 error:nil];
+    if (![template isKindOfClass:NSDictionary.class]) return nil;
+    dispatch_barrier_async(_queue, ^{
+        if (!entry.template) entry.template = template;
+    });
+    return template;
+}
+
+- (void) setTemplate:(NSDictionary*)template
+        forBotID:(NSString*)botID
+        server:(NSString*)server
+        revision:(NSString*)revision {
+    NSError *error = nil;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:template options:0 error:&error];
+    if (!data) {
+        BNCLogError(@"Can't cache the template for bot '%@': %@.", botID, error);
+        return;
+    }
+    NSString *key = [self.class keyForBotID:botID server:server];
+    dispatch_barrier_async(_queue, ^{
+        XGBotCacheEntry *entry = [self newEntryForKey:key server:server revision:revision];
+        entry.template = template;
+        entry.templateData = data;
+        [self setNeedsFlush];
+    });
+}
+
+- (void) removeBotsForServer:(NSString*)server exceptBotIDs:(NSSet<NSString*>*)botIDs {
+    NSMutableSet *keys = [NSMutableSet new];
+    for (NSString *botID in botIDs) [keys addObject:[self.class keyForBotID:botID server:server]];
+    dispatch_barrier_async(_queue, ^{
+        NSMutableArray *removed = [NSMutableArray new];
+        [self->_entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, XGBotCacheEntry *entry, BOOL *stop) {
+            if ([entry.server isEqualToString:server] && ![keys containsObject:key])
+                [removed addObject:key];
+        }];
+        if (removed.count == 0) return;
+        [self->_entries removeObjectsForKeys:removed];
+        [self setNeedsFlush];
+    });
+}
+
+#pragma mark - Persistence
+
+- (void) setNeedsFlush {
+    [_deferredFlush setNeedsFlush];
+}
+
+- (void) flush {
+    [_deferredFlush flush];
+}
+
+- (void) save {
+    NSMutableDictionary *plist = [NSMutableDictionary new];
+    dispatch_sync(_queue, ^{
+        [self->_entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, XGBotCacheEntry *entry, BOOL *stop) {
+            plist[key] = entry.propertyList;
+        }];
+    });
+
+    NSError *error = nil;
+    NSData *data =
+        [NSPropertyListSerialization dataWithPropertyList:plist
+            format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+    if (!data || ![data writeToURL:_fileURL options:NSDataWritingAtomic error:&error]) {
+        BNCLogError(@"Can't save the bot cache to '%@': %@.", _fileURL.path, error);
+        return;
+    }
+    BNCLogDebug(@"Saved %ld cached bots.", (long) plist.count);
+}
+
+- (void) clear {
+    dispatch_barrier_sync(_queue, ^{
+        [self->_entries removeAllObjects];
+    });
+    [_deferredFlush cancel];
+    if (_fileURL) [[NSFileManager defaultManager] removeItemAtURL:_fileURL error:nil];
+}
+
+@end
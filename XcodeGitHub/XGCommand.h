@@ -10,6 +10,7 @@
 
 #import <Foundation/Foundation.h>
 #import "XGCommandOptions.h"
+#import "XGCycleSnapshot.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -21,6 +22,16 @@ NS_ASSUME_NONNULL_BEGIN
 */
 FOUNDATION_EXPORT NSError*_Nullable XGUpdateXcodeBotsWithGitHub(XGCommandOptions* options);
 
+/**
+ Like `XGUpdateXcodeBotsWithGitHub`, but gets the bots, statuses, and PRs from a cycle snapshot so
+ that several updates and the status display in the same refresh cycle share them.
+
+ @param  options The options for the new bot.
+ @param  cycle   The snapshot for the current refresh cycle.
+ @return Returns an error if one occurs else nil.
+*/
+FOUNDATION_EXPORT NSError*_Nullable XGUpdateXcodeBotsWithGitHubInCycle(XGCommandOptions* options, XGCycleSnapshot* cycle);
+
 /**
  Writes the current Xcode server status to the output device.
 
@@ -29,4 +40,13 @@ FOUNDATION_EXPORT NSError*_Nullable XGUpdateXcodeBotsWithGitHub(XGCommandOptions
 */
 FOUNDATION_EXPORT NSError*_Nullable XGShowXcodeBotStatus(XGCommandOptions* options);
 
+/**
+ Listens for GitHub webhooks on `options.listenPort` and updates the bot of each PR as its events
+ arrive. A full update runs at the start and then every 15 minutes or so as a safety net.
+
+ @param  options The command options. `webhookSecret` must be set.
+ @return Only returns if the listener can't start.
+*/
+FOUNDATION_EXPORT NSError*_Nullable XGListenForGitHubWebhooks(XGCommandOptions* options);
+
 NS_ASSUME_NONNULL_END
@@ -11,160 +11,17 @@
 #import "XGCommand.h"
 #import "XGXcodeBot.h"
 #import "XGGitHubPullRequest.h"
-#import "XGSettings.h"
+#import "XGReconcile.h"
+#import "XGCycleSnapshot.h"
+#import "XGWebhook.h"
+#import "XGGitHubScheduler.h"
+#import "XGNetworkMetrics.h"
 #import "BNCLog.h"
 #import "BNCNetworkService.h"
 #include <sysexits.h>
 
 #pragma mark Bot Functions
 
-NSError*_Nullable XGCreateBotWithOptions(
-        XGCommandOptions*_Nonnull options,
-        XGGitHubPullRequest*_Nonnull pr,
-        XGXcodeBot*_Nonnull templateBot,
-        NSString*_Nonnull newBotName
-    ) {
-    if (options.dryRun) {
-        BNCLog(@"Would create bot '%@'.", newBotName);
-        return nil;
-    }
-    NSError *error = nil;
-    BNCLogDebug(@"Creating bot '%@'...", newBotName);
-    [pr setStatus:XGPullRequestStatusPending
-        message:@"Creating Xcode bot..."
-        statusURL:nil];
-    [templateBot duplicateBotWithNewName:newBotName
-        branchName:pr.branch
-        gitHubPullRequestNumber:pr.number
-        gitHubPullRequestTitle:pr.title
-        error:&error];
-    if (error) {
-        BNCLogError(@"Can't create Xcode bot: %@.", error);
-    }
-    return error;
-}
-
-NSError*_Nullable XGDeleteBotWithOptions(
-        XGCommandOptions*_Nonnull options,
-        XGXcodeBot*_Nonnull bot
-    ) {
-    NSError*error = nil;
-    if (options.dryRun) {
-        BNCLog(@"Would delete bot '%@'.", bot.name);
-        return error;
-    }
-    BNCLogDebug(@"Deleting old bot '%@'...", bot.name);
-    error = [bot deleteBot];
-    if (error) {
-        BNCLogError(
-            @"Can't remove old bot named '%@' from server: %@.", bot.name, error
-        );
-        return error;
-    }
-    [[XGSettings sharedSettings]
-        deleteGitHubStatusForRepoOwner:bot.repoOwner
-        repoName:bot.repoName
-        branch:bot.branch];
-    return error;
-}
-
-NSError*_Nullable XGUpdatePRStatusOnGitHub(
-        XGCommandOptions*_Nonnull options,
-        XGGitHubPullRequest*_Nonnull pr,
-        XGXcodeBotStatus*_Nonnull botStatus
-    ) {
-    NSError*error = nil;
-    XGPullRequestStatus status = XGPullRequestStatusError;
-
-    /*
-    XGXcodeBotStatus:
-
-    XGPullRequestStatusError,
-    XGPullRequestStatusFailure,
-    XGPullRequestStatusPending,
-    XGPullRequestStatusSuccess,
-    */
-
-    NSSet<NSString*>*failureResults = [NSSet setWithArray:@[
-        @"build-errors",
-        @"test-failures",
-        @"build-failed",
-        @"canceled",
-    ]];
-    NSSet<NSString*>*successResults = [NSSet setWithArray:@[
-        @"succeeded",
-        @"warnings",
-        @"analyzer-warnings",
-    ]];
-
-    if ([botStatus.currentStep isEqualToString:@"completed"]) {
-        if (botStatus.result == nil) {
-        } else
-        if ([successResults containsObject:botStatus.result]) {
-            status = XGPullRequestStatusSuccess;
-        } else
-        if ([failureResults containsObject:botStatus.result]) {
-            status = XGPullRequestStatusFailure;
-        } else {
-            status = XGPullRequestStatusError;
-        }
-    } else {
-        status = XGPullRequestStatusPending;
-    }
-
-    NSString*message = botStatus.summaryString;
-    NSString*statusHash = [NSString stringWithFormat:@"%@:%@",
-        NSStringFromXGPullRequestStatus(status), message];
-
-    NSString*lastStatusHash =
-        [[XGSettings sharedSettings]
-            gitHubStatusForRepoOwner:pr.repoOwner
-            repoName:pr.repoName
-            branch:pr.branch];
-
-    if (lastStatusHash == nil) {
-        // Get the most recent status from GitHub:
-        XGGitHubPullRequestStatus *status = [[pr statusesWithError:nil] firstObject];
-        if (status) {
-            lastStatusHash = [NSString stringWithFormat:@"%@:%@",
-                NSStringFromXGPullRequestStatus(status.status), status.message];
-            [[XGSettings sharedSettings]
-                setGitHubStatus:lastStatusHash
-                forRepoOwner:pr.repoOwner
-                repoName:pr.repoName
-                branch:pr.branch];
-        }
-    }
-
-    if ([lastStatusHash isEqualToString:statusHash])
-        return nil;
-
-    if (options.dryRun) {
-        BNCLog(@"Would update PR#%@ with status %@: %@.",
-            pr.number, NSStringFromXGPullRequestStatus(status), message);
-        return nil;
-    }
-
-    error = [pr setStatus:status
-        message:message
-        statusURL:nil];
-    if (error) return error;
-
-    // Add a completion message to the PR:
-    if ([botStatus.currentStep isEqualToString:@"completed"]) {
-        error = [pr addComment:[botStatus.formattedDetailString renderMarkDown]];
-        if (error) return error;
-    }
-
-    [[XGSettings sharedSettings]
-        setGitHubStatus:statusHash
-        forRepoOwner:pr.repoOwner
-        repoName:pr.repoName
-        branch:pr.branch];
-
-    return nil;
-}
-
 NSError* XGShowXcodeBotStatus(XGCommandOptions* options) {
     // Update the bots and display the results:
 
@@ -189,9 +46,15 @@ NSError* XGShowXcodeBotStatus(XGCommandOptions* options) {
         BNCLog(@"Xcode bot status: No Xcode bots.");
     } else {
         BNCLog(@"Xcode bot status:");
+        NSDictionary<NSString*, XGXcodeBotStatus*> *statuses =
+            [XGXcodeBot botStatusesForServer:xcodeServer bots:bots.allValues jobs:options.jobs error:&error];
+        if (error) {
+            BNCLogError(@"Can't retrieve Xcode bot statuses from '%@': %@.", xcodeServer.server, error);
+            return error;
+        }
         for (XGXcodeBot *bot in bots.objectEnumerator) {
-            XGXcodeBotStatus *status = [bot status];
-            BNCLog(@"%@", status);
+            XGXcodeBotStatus *status = statuses[bot.name];
+            if (status) BNCLog(@"%@", status);
         }
     }
     return nil;
@@ -200,6 +63,13 @@ NSError* XGShowXcodeBotStatus(XGCommandOptions* options) {
 #pragma mark - Main Function
 
 NSError*_Nullable XGUpdateXcodeBotsWithGitHub(XGCommandOptions*_Nonnull options) {
+    NSError *error = XGUpdateXcodeBotsWithGitHubInCycle(options, [XGCycleSnapshot new]);
+    if (options.metricsFile.length)
+        [[XGNetworkMetrics shared] writeToFile:options.metricsFile];
+    return error;
+}
+
+NSError*_Nullable XGUpdateXcodeBotsWithGitHubInCycle(XGCommandOptions*_Nonnull options, XGCycleSnapshot*_Nonnull cycle) {
     NSError *error = nil;
     int returnCode = EXIT_FAILURE;
     {
@@ -213,7 +83,7 @@ NSError*_Nullable XGUpdateXcodeBotsWithGitHub(XGCommandOptions*_Nonnull options)
 
         BNCLogDebug(@"Getting Xcode bots on '%@'...", options.xcodeServerName);
         NSDictionary<NSString*, XGXcodeBot*> *bots =
-            [XGXcodeBot botsForServer:xcodeServer error:&error];
+            [cycle botsForServer:xcodeServer error:&error];
         if (error) {
             BNCLogError(@"Can't retrieve Xcode bot information from %@: %@.",
                 options.xcodeServerName, error);
@@ -237,7 +107,7 @@ NSError*_Nullable XGUpdateXcodeBotsWithGitHub(XGCommandOptions*_Nonnull options)
         BNCLogDebug(@"Getting pull requests for '%@'...", templateBot.sourceControlRepository);
 
         NSDictionary<NSString*, XGGitHubPullRequest*> *pullRequests =
-            [XGGitHubPullRequest pullsRequestsForRepository:templateBot.sourceControlRepository
+            [cycle pullRequestsForRepository:templateBot.sourceControlRepository
                 authToken:options.githubAuthToken
                 error:&error];
         if (error) {
@@ -247,31 +117,47 @@ NSError*_Nullable XGUpdateXcodeBotsWithGitHub(XGCommandOptions*_Nonnull options)
             goto exit;
         }
 
-        // Check for open pull requests with state 'open':
+        // Gather the status of the bots for open pull requests before deciding anything. Without
+        // statuses the plan still creates and deletes bots, but doesn't update any PR status:
+        NSError *statusError = nil;
+        NSDictionary<NSString*, XGXcodeBotStatus*> *serverStatuses =
+            [cycle botStatusesForServer:xcodeServer jobs:options.jobs error:&statusError];
+        if (statusError) {
+            BNCLogError(@"Can't retrieve Xcode bot statuses from %@: %@. Not updating PR statuses.",
+                options.xcodeServerName, statusError);
+            serverStatuses = nil;
+        }
+        NSMutableDictionary<NSString*, XGXcodeBotStatus*> *botStatuses = [NSMutableDictionary new];
         for (XGGitHubPullRequest *pr in pullRequests.objectEnumerator) {
-            NSString *newBotName = [XGXcodeBot botNameFromPRNumber:pr.number title:pr.title];
-            XGXcodeBot *bot = bots[newBotName];
-            if ([pr.state isEqualToString:@"open"]) {
-                if (bot) {
-                    error = XGUpdatePRStatusOnGitHub(options, pr, bot.status);
-                } else {
-                    error = XGCreateBotWithOptions(options, pr, templateBot, newBotName);
-                }
-                if (error) {
-                    returnCode = EX_NOPERM;
-                    goto exit;
-                }
-            }
+            NSString *botName = [XGXcodeBot botNameFromPRNumber:pr.number title:pr.title];
+            if (bots[botName] && [pr.state isEqualToString:@"open"])
+                botStatuses[botName] = serverStatuses[botName];
         }
 
-        // Check for bots with no PR and delete it:
-        for (XGXcodeBot *bot in bots.objectEnumerator) {
-            NSString *number = bot.pullRequestNumber;
-            if (number && !pullRequests[number]) {
-                error = XGDeleteBotWithOptions(options, bot);
-                if (error) { returnCode = EX_NOPERM; goto exit; }
+        // Plan the changes and apply them:
+        XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+        snapshot.templateBot = templateBot;
+        snapshot.bots = bots;
+        snapshot.botStatuses = botStatuses;
+        snapshot.pullRequests = pullRequests;
+
+        XGReconciler *reconciler =
+            [XGReconciler reconcilerForServer:xcodeServer.server templateBotName:templateBot.name];
+        XGReconcilePlan *plan = [reconciler planWithSnapshot:snapshot];
+        error = [reconciler applyPlan:plan options:options];
+
+        // The display shouldn't show bots that were just added or removed from this cycle:
+        for (XGReconcileAction *action in plan.actions) {
+            if (!options.dryRun &&
+               (action.type == XGReconcileActionCreateBot || action.type == XGReconcileActionDeleteBot)) {
+                [cycle invalidateServer:xcodeServer];
+                break;
             }
         }
+        if (error) {
+            returnCode = EX_NOPERM;
+            goto exit;
+        }
 
         error = nil;
         returnCode = EXIT_SUCCESS;
@@ -289,3 +175,276 @@ exit:
     }
     return error;
 }
+
+#pragma mark - Webhooks
+
+/**
+ Brings the bot of a single PR up to date, like `XGUpdateXcodeBotsWithGitHub` does for every PR.
+
+ @param options     The command options.
+ @param pr          The PR. If it isn't open its bot is deleted.
+ @param repository  The repository the PR belongs to, like 'owner/repo'.
+ @param pending     Set to YES if the PR's bot has an integration that isn't done yet.
+ @return Returns an error if one occurs else nil.
+*/
+static NSError*_Nullable XGUpdateXcodeBotForPullRequest(
+        XGCommandOptions*_Nonnull options,
+        XGGitHubPullRequest*_Nonnull pr,
+        NSString*_Nullable repository,
+        BOOL*_Nonnull pending
+    ) {
+    NSError *error = nil;
+    *pending = NO;
+    {
+        XGServer*xcodeServer = [[XGServer alloc] init];
+        xcodeServer.server = options.xcodeServerName;
+        xcodeServer.user = options.xcodeServerUser;
+        xcodeServer.password = options.xcodeServerPassword;
+
+        NSDictionary<NSString*, XGXcodeBot*> *bots =
+            [XGXcodeBot botsForServer:xcodeServer error:&error];
+        if (error) {
+            BNCLogError(@"Can't retrieve Xcode bot information from %@: %@.",
+                options.xcodeServerName, error);
+            goto exit;
+        }
+        XGXcodeBot *templateBot = bots[options.templateBotName];
+        if (!templateBot) {
+            BNCLogError(@"Can't find Xcode template bot named '%@'.", options.templateBotName);
+            error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileNoSuchFileError userInfo:nil];
+            goto exit;
+        }
+        NSString *templateRepository = [NSString stringWithFormat:@"github.com:%@.git", repository];
+        if (![templateBot.sourceControlRepository isEqualToString:templateRepository]) {
+            BNCLogDebug(@"Ignoring PR#%@ from '%@'.", pr.number, repository);
+            goto exit;
+        }
+
+        // Only this PR's bots are part of the snapshot, so no other bot is touched:
+        BOOL isOpen = [pr.state isEqualToString:@"open"];
+        NSMutableDictionary<NSString*, XGXcodeBot*> *prBots = [NSMutableDictionary new];
+        for (XGXcodeBot *bot in bots.objectEnumerator) {
+            if ([bot.pullRequestNumber isEqualToString:pr.number]) prBots[bot.name] = bot;
+        }
+        NSDictionary<NSString*, XGXcodeBotStatus*> *botStatuses = @{};
+        if (isOpen && prBots.count) {
+            NSError *statusError = nil;
+            botStatuses =
+                [XGXcodeBot botStatusesForServer:xcodeServer
+                    bots:prBots.allValues
+                    jobs:options.jobs
+                    error:&statusError];
+            if (statusError) {
+                BNCLogError(@"Can't retrieve the status of PR#%@'s bot: %@.", pr.number, statusError);
+                botStatuses = @{};
+            }
+        }
+
+        XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+        snapshot.templateBot = templateBot;
+        snapshot.bots = prBots;
+        snapshot.botStatuses = botStatuses;
+        snapshot.pullRequests = (isOpen) ? @{ pr.number: pr } : @{};
+        snapshot.isPartial = YES;
+
+        XGReconciler *reconciler =
+            [XGReconciler reconcilerForServer:xcodeServer.server templateBotName:templateBot.name];
+        XGReconcilePlan *plan = [reconciler planWithSnapshot:snapshot];
+        error = [reconciler applyPlan:plan options:options];
+        if (error) goto exit;
+
+        if (isOpen) {
+            NSString *botName = [XGXcodeBot botNameFromPRNumber:pr.number title:pr.title];
+            XGXcodeBotStatus *status = botStatuses[botName];
+            *pending = (status == nil || ![status.currentStep isEqualToString:@"completed"]);
+        }
+    }
+
+exit:
+    return error;
+}
+
+/// Pending PRs are rechecked after 1, 2, 4, 8, and 16 minutes. After that the sweep picks them up.
+static NSTimeInterval const kXGRecheckInterval = 60.0;
+static NSInteger const kXGRecheckLimit = 5;
+
+/// Turns webhook events into PR updates. The updates and the full sweeps run one at a time.
+@interface XGWebhookUpdater : NSObject
+- (instancetype) initWithOptions:(XGCommandOptions*)options;
+- (void) handleEvent:(XGWebhookEvent*)event;
+- (void) startSweeps;
+@end
+
+@implementation XGWebhookUpdater {
+    XGCommandOptions *_options;
+    dispatch_queue_t _queue;
+    dispatch_source_t _sweepTimer;
+    NSMutableDictionary<NSString*, XGGitHubPullRequest*>*_queuedPullRequests;   // Keyed by PR number.
+    NSMutableDictionary<NSString*, XGGitHubPullRequest*>*_latestPullRequests;   // Keyed by PR number.
+    NSMutableDictionary<NSString*, NSString*>*_repositories;                    // Keyed by PR number.
+    NSMutableDictionary<NSString*, NSNumber*>*_recheckCounts;                   // Keyed by PR number.
+}
+
+- (instancetype) initWithOptions:(XGCommandOptions*)options {
+    self = [super init];
+    if (!self) return self;
+    _options = options;
+    _queue = dispatch_queue_create("io.branch.xcode-github.update", DISPATCH_QUEUE_SERIAL);
+    _queuedPullRequests = [NSMutableDictionary new];
+    _latestPullRequests = [NSMutableDictionary new];
+    _repositories = [NSMutableDictionary new];
+    _recheckCounts = [NSMutableDictionary new];
+    return self;
+}
+
+- (void) handleEvent:(XGWebhookEvent*)event {
+    switch (event.type) {
+    case XGWebhookEventTypePullRequest:
+        event.pullRequest.authToken = _options.githubAuthToken;
+        [self queuePullRequest:event.pullRequest repository:event.repository];
+        break;
+    case XGWebhookEventTypePush:
+        if (event.branch.length && event.repository.length)
+            dispatch_async(_queue, ^{ [self queuePullRequestsForPush:event]; });
+        break;
+    default:
+        break;
+    }
+}
+
+- (void) queuePullRequest:(XGGitHubPullRequest*)pr repository:(NSString*)repository {
+    @synchronized(self) {
+        // A newer event for the same PR replaces one that's still waiting:
+        _queuedPullRequests[pr.number] = pr;
+        _latestPullRequests[pr.number] = pr;
+        if (repository) _repositories[pr.number] = repository;
+        // The PR changed, so it gets a fresh round of rechecks:
+        [_recheckCounts removeObjectForKey:pr.number];
+    }
+    dispatch_async(_queue, ^{ [self updateQueuedPullRequests]; });
+}
+
+- (void) queuePullRequestsForPush:(XGWebhookEvent*)event {
+    // A push to a PR's branch changes its head, so update the PRs on that branch:
+    NSError *error = nil;
+    NSString *repository = [NSString stringWithFormat:@"github.com:%@.git", event.repository];
+    NSDictionary<NSString*, XGGitHubPullRequest*> *pullRequests =
+        [XGGitHubPullRequest pullsRequestsForRepository:repository
+            authToken:_options.githubAuthToken
+            error:&error];
+    if (error) {
+        BNCLogError(@"Can't retrieve pull requests from '%@': %@.", repository, error);
+        return;
+    }
+    for (XGGitHubPullRequest *pr in pullRequests.objectEnumerator) {
+        if ([pr.branch isEqualToString:event.branch])
+            [self queuePullRequest:pr repository:event.repository];
+    }
+}
+
+- (void) updateQueuedPullRequests {
+    NSDictionary<NSString*, XGGitHubPullRequest*>*pullRequests = nil;
+    NSDictionary<NSString*, NSString*>*repositories = nil;
+    @synchronized(self) {
+        pullRequests = [_queuedPullRequests copy];
+        repositories = [_repositories copy];
+        [_queuedPullRequests removeAllObjects];
+    }
+    for (XGGitHubPullRequest *pr in pullRequests.objectEnumerator) {
+        BOOL pending = NO;
+        BNCLogDebug(@"Updating PR#%@ from a webhook.", pr.number);
+        NSError *error =
+            XGUpdateXcodeBotForPullRequest(_options, pr, repositories[pr.number], &pending);
+        if (error) continue;
+        if (pending) {
+            // Webhooks don't tell us when an integration finishes, so check back on this PR,
+            // backing off each time:
+            NSInteger recheckCount = 0;
+            @synchronized(self) {
+                recheckCount = self->_recheckCounts[pr.number].integerValue;
+                if (recheckCount < kXGRecheckLimit)
+                    self->_recheckCounts[pr.number] = @(recheckCount + 1);
+            }
+            if (recheckCount >= kXGRecheckLimit) {
+                BNCLogDebug(@"PR#%@ is still pending. Leaving it for the next full update.", pr.number);
+                continue;
+            }
+            NSTimeInterval delay = kXGRecheckInterval * (double)(1 << recheckCount);
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), _queue, ^{
+                [self recheckPullRequestNumber:pr.number];
+            });
+        } else {
+            @synchronized(self) {
+                [self->_recheckCounts removeObjectForKey:pr.number];
+                if (![pr.state isEqualToString:@"open"]) {
+                    [self->_latestPullRequests removeObjectForKey:pr.number];
+                    [self->_repositories removeObjectForKey:pr.number];
+                }
+            }
+        }
+    }
+}
+
+- (void) recheckPullRequestNumber:(NSString*)number {
+    XGGitHubPullRequest *pr = nil;
+    @synchronized(self) {
+        if (_queuedPullRequests[number]) return;
+        pr = _latestPullRequests[number];
+        if (pr) _queuedPullRequests[number] = pr;
+    }
+    if (pr) [self updateQueuedPullRequests];
+}
+
+- (void) startSweeps {
+    // A full update now and then catches anything the webhooks missed:
+    dispatch_sync(_queue, ^{ [self sweep]; });
+    NSTimeInterval interval = [[XGGitHubScheduler shared] recommendedPollIntervalWithMinimum:15.0*60.0];
+    _sweepTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+    dispatch_source_set_timer(_sweepTimer,
+        dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)),
+        (uint64_t)(interval * NSEC_PER_SEC),
+        (uint64_t)(10.0 * NSEC_PER_SEC));
+    __weak __typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(_sweepTimer, ^{ [weakSelf sweep]; });
+    dispatch_resume(_sweepTimer);
+}
+
+- (void) sweep {
+    BNCLogDebug(@"Starting a full update.");
+    XGUpdateXcodeBotsWithGitHub(_options);
+}
+
+@end
+
+NSError*_Nullable XGListenForGitHubWebhooks(XGCommandOptions*_Nonnull options) {
+    if (options.webhookSecret.length == 0) {
+        BNCLogError(@"A webhook secret is needed to listen for webhooks.");
+        return [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:@{
+            @"return_code": @(EX_USAGE)
+        }];
+    }
+
+    // Allow self-signed certs from the xcode server:
+    [BNCNetworkService shared].allowAnySSLCert = YES;
+
+    XGWebhookUpdater *updater = [[XGWebhookUpdater alloc] initWithOptions:options];
+    XGWebhookListener *listener =
+        [[XGWebhookListener alloc] initWithSecret:options.webhookSecret handler:^(XGWebhookEvent*event) {
+            [updater handleEvent:event];
+        }];
+    NSError *error =
+        [listener startWithPort:(uint16_t) options.listenPort localOnly:!options.listenOnAllHosts];
+    if (error) {
+        return [NSError errorWithDomain:error.domain code:error.code userInfo:@{
+            @"return_code": @(EX_UNAVAILABLE)
+        }];
+    }
+    BNCLog(@"Listening for GitHub webhooks on port %d.", (int) listener.port);
+    [updater startSweeps];
+
+    // The listener and updater do the rest:
+    dispatch_semaphore_t forever = dispatch_semaphore_create(0);
+    dispatch_semaphore_wait(forever, DISPATCH_TIME_FOREVER);
+    [listener stop];
+    return nil;
+}
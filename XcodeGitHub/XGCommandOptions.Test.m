@@ -0,0 +1,70 @@
+/**
+ @file          XGCommandOptions.Test.m
+ @package       xcode-github
+ @brief         Tests for XGCommandOptions.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGCommandOptions.h"
+#include <getopt.h>
+
+@interface XGCommandOptionsTest : BNCTestCase
+@end
+
+@implementation XGCommandOptionsTest
+
+- (XGCommandOptions*) optionsWithArguments:(NSArray<NSString*>*)arguments {
+    // getopt_long keeps its place in globals, so start it over for each parse:
+    optind = 1;
+    optreset = 1;
+    NSMutableArray<NSString*> *strings = [NSMutableArray arrayWithObject:@"xcode-github"];
+    [strings addObjectsFromArray:arguments];
+    char **argv = calloc(strings.count + 1, sizeof(char*));
+    for (NSUInteger i = 0; i < strings.count; i++)
+        argv[i] = strdup(strings[i].UTF8String);
+    XGCommandOptions *options = [[XGCommandOptions alloc] initWithArgc:(int)strings.count argv:argv];
+    for (NSUInteger i = 0; i < strings.count; i++)
+        free(argv[i]);
+    free(argv);
+    return options;
+}
+
+- (void) testJobs {
+    XGCommandOptions *options = [self optionsWithArguments:@[ @"-s" ]];
+    XCTAssertFalse(options.badOptionsError);
+    XCTAssertEqual(options.jobs, 4);
+
+    options = [self optionsWithArguments:@[ @"-s", @"-j", @"8" ]];
+    XCTAssertFalse(options.badOptionsError);
+    XCTAssertEqual(options.jobs, 8);
+
+    options = [self optionsWithArguments:@[ @"-s", @"--jobs", @"1" ]];
+    XCTAssertFalse(options.badOptionsError);
+    XCTAssertEqual(options.jobs, 1);
+
+    options = [self optionsWithArguments:@[ @"-s", @"--jobs", @"0" ]];
+    XCTAssertTrue(options.badOptionsError);
+
+    options = [self optionsWithArguments:@[ @"-s", @"-j", @"many" ]];
+    XCTAssertTrue(options.badOptionsError);
+}
+
+- (void) testBinaryLog {
+    XGCommandOptions *options = [self optionsWithArguments:@[ @"-s" ]];
+    XCTAssertFalse(options.badOptionsError);
+    XCTAssertNil(options.binaryLogFile);
+
+    options = [self optionsWithArguments:@[ @"-s", @"-b", @"/tmp/xcode-github.log" ]];
+    XCTAssertFalse(options.badOptionsError);
+    XCTAssertEqualObjects(options.binaryLogFile, @"/tmp/xcode-github.log");
+
+    options = [self optionsWithArguments:@[ @"-s", @"--binary-log", @"xcode-github.log" ]];
+    XCTAssertFalse(options.badOptionsError);
+    XCTAssertEqualObjects(options.binaryLogFile, @"xcode-github.log");
+}
+
+@end
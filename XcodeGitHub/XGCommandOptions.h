@@ -9,6 +9,7 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "BNCNetworkService.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -18,16 +19,30 @@ NS_ASSUME_NONNULL_BEGIN
 @property (copy)   NSString*_Nullable xcodeServerPassword;  // Optional
 @property (copy)   NSString*_Nullable templateBotName;
 @property (copy)   NSString*_Nullable githubAuthToken;
+@property (copy)   NSString*_Nullable webhookSecret;        // The GitHub webhook secret
+@property (assign) int  listenPort;                         // Listen for webhooks if not zero
+@property (assign) BOOL listenOnAllHosts;                   // Accept webhooks from other hosts
 @property (assign) int  verbosity;
+@property (assign) int  jobs;                               // Concurrent status requests
+@property (assign) int  connectionsPerHost;                 // Concurrent requests to each host
+@property (assign) NSTimeInterval requestTimeout;           // Network request timeout in seconds
+@property (copy)   NSString*_Nullable metricsFile;          // Write network metrics here each update
+@property (assign) int  metricsPort;                        // Serve network metrics if not zero
+@property (copy)   NSString*_Nullable binaryLogFile;        // Also write a binary log here
 @property (assign) BOOL dryRun;
+@property (assign) BOOL useGraphQL;                         // Use the GitHub GraphQL API for PRs
 @property (assign) BOOL showStatusOnly;
 @property (assign) BOOL showVersion;
 @property (assign) BOOL showHelp;
 @property (assign) BOOL badOptionsError;
 @property (assign) BOOL repeatForever;
 
+- (instancetype _Nonnull) init;
 - (instancetype _Nonnull) initWithArgc:(int)argc argv:(char*const _Nullable[_Nullable])argv;
 + (NSString*) helpString;
+
+/// The network connection settings for each host.
+- (BNCNetworkHostConfiguration*) hostConfiguration;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -13,21 +13,40 @@
 
 @implementation XGCommandOptions
 
-- (instancetype _Nonnull) initWithArgc:(int)argc argv:(char*const _Nullable[_Nullable])argv {
+- (instancetype _Nonnull) init {
     self = [super init];
     if (!self) return self;
+    self.jobs = 4;
+    self.connectionsPerHost = 4;
+    self.requestTimeout = 60.0;
+    return self;
+}
+
+- (instancetype _Nonnull) initWithArgc:(int)argc argv:(char*const _Nullable[_Nullable])argv {
+    self = [self init];
+    if (!self) return self;
 
     static struct option long_options[] = {
+        {"binary-log",  required_argument,  NULL, 'b'},
+        {"connections", required_argument,  NULL, 'c'},
         {"dryrun",      no_argument,        NULL, 'd'},
         {"github",      required_argument,  NULL, 'g'},
+        {"graphql",     no_argument,        NULL, 'q'},
         {"help",        no_argument,        NULL, 'h'},
+        {"jobs",        required_argument,  NULL, 'j'},
+        {"listen",      required_argument,  NULL, 'l'},
+        {"listen-all",  no_argument,        NULL, 'L'},
+        {"metrics-file", required_argument, NULL, 'm'},
+        {"metrics-port", required_argument, NULL, 'M'},
         {"password",    required_argument,  NULL, 'p'},
         {"repeat",      no_argument,        NULL, 'r'},
         {"status",      no_argument,        NULL, 's'},
         {"template",    required_argument,  NULL, 't'},
+        {"timeout",     required_argument,  NULL, 'T'},
         {"user",        required_argument,  NULL, 'u'},
         {"verbose",     no_argument,        NULL, 'v'},
         {"version",     no_argument,        NULL, 'V'},
+        {"webhook-secret", required_argument, NULL, 'w'},
         {"xcodeserver", required_argument,  NULL, 'x'},
         {0, 0, 0, 0}
     };
@@ -40,19 +59,44 @@
     int c = 0;
     do {
         int option_index = 0;
-        c = getopt_long(argc, argv, "dg:hst:vVx:", long_options, &option_index);
+        c = getopt_long(argc, argv, "b:c:dg:hj:l:Lm:M:qst:T:vVw:x:", long_options, &option_index);
         switch (c) {
         case -1:    break;
+        case 'b':   self.binaryLogFile = [self.class stringFromParameter]; break;
+        case 'c':
+            self.connectionsPerHost = [[self.class stringFromParameter] intValue];
+            if (self.connectionsPerHost < 1) self.badOptionsError = YES;
+            break;
         case 'd':   self.dryRun = YES; break;
         case 'g':   self.githubAuthToken = [self.class stringFromParameter]; break;
         case 'h':   self.showHelp = YES; break;
+        case 'j':
+            self.jobs = [[self.class stringFromParameter] intValue];
+            if (self.jobs < 1) self.badOptionsError = YES;
+            break;
+        case 'q':   self.useGraphQL = YES; break;
+        case 'l':
+            self.listenPort = [[self.class stringFromParameter] intValue];
+            if (self.listenPort < 1 || self.listenPort > 65535) self.badOptionsError = YES;
+            break;
+        case 'L':   self.listenOnAllHosts = YES; break;
+        case 'm':   self.metricsFile = [self.class stringFromParameter]; break;
+        case 'M':
+            self.metricsPort = [[self.class stringFromParameter] intValue];
+            if (self.metricsPort < 1 || self.metricsPort > 65535) self.badOptionsError = YES;
+            break;
         case 'p':   self.xcodeServerPassword = [self.class stringFromParameter]; break;
         case 'r':   self.repeatForever = YES; break;
         case 's':   self.showStatusOnly = YES; break;
         case 't':   self.templateBotName = [self.class stringFromParameter]; break;
+        case 'T':
+            self.requestTimeout = [[self.class stringFromParameter] doubleValue];
+            if (self.requestTimeout <= 0.0) self.badOptionsError = YES;
+            break;
         case 'u':   self.xcodeServerUser = [self.class stringFromParameter]; break;
         case 'v':   self.verbosity++; break;
         case 'V':   self.showVersion = YES; break;
+        case 'w':   self.webhookSecret = [self.class stringFromParameter]; break;
         case 'x':   self.xcodeServerName = [self.class stringFromParameter]; break;
         default:    self.badOptionsError = YES; break;
         }
@@ -69,9 +113,21 @@
     NSString *kHelpString =
         @"xcode-github - Creates an Xcode test bots for new GitHub PRs.\n"
          "\n"
-         "usage: xcode-github [-dhsVv] -g <github-auth-token>\n"
+         "usage: xcode-github [-dhqsVv] [-c <connections>] [-j <jobs>] [-T <seconds>]\n"
+         "                 -g <github-auth-token>\n"
          "                 -t <bot-template> -x <xcode-server-domain-name>\n"
+         "                 [-l <port> [-L] -w <webhook-secret>]\n"
+         "                 [-m <metrics-file>] [-M <metrics-port>] [-b <log-file>]\n"
+         "\n"
          "\n"
+         "  -b, --binary-log <log-file>\n"
+         "      Also write every log message, debug messages included, to <log-file> in\n"
+         "      a compact binary format. An existing log is appended to. Read it with\n"
+         "      xcode-github-log.\n"
+         "\n"
+         "  -c, --connections <connections>\n"
+         "      The number of requests to each host at the same time. A slow host\n"
+         "      doesn't hold up requests to the others. Defaults to 4.\n"
          "\n"
          "  -d, --dryrun\n"
          "      Dry run. Print what would be done.\n"
@@ -83,6 +139,33 @@
          "  -h, --help\n"
          "      Print this help information.\n"
          "\n"
+         "  -j, --jobs <jobs>\n"
+         "      The number of Xcode bot statuses to fetch at the same time. Defaults to 4.\n"
+         "\n"
+         "  -l, --listen <port>\n"
+         "      Listen on <port> of localhost for GitHub 'pull_request' and 'push' webhooks\n"
+         "      and update the bot of each PR as its events arrive. A full update still runs\n"
+         "      every 15 minutes. Needs --webhook-secret. Forward the webhooks to the port\n"
+         "      with a reverse proxy, like nginx.\n"
+         "\n"
+         "  -L, --listen-all\n"
+         "      Accept webhooks from other hosts too, not just localhost. The listener isn't\n"
+         "      hardened for the open internet, so only use this on a trusted network.\n"
+         "\n"
+         "  -m, --metrics-file <metrics-file>\n"
+         "      Write the network metrics to <metrics-file> after each update: request\n"
+         "      counts, status codes, bytes, and latency percentiles for each host and\n"
+         "      endpoint. The file is JSON if its name ends in '.json' and Prometheus\n"
+         "      text otherwise.\n"
+         "\n"
+         "  -M, --metrics-port <metrics-port>\n"
+         "      Serve the network metrics on <metrics-port> of localhost while running.\n"
+         "      '/metrics' is Prometheus text and '/metrics.json' is JSON.\n"
+         "\n"
+         "  -q, --graphql\n"
+         "      Use the GitHub GraphQL API to get the open PRs and their statuses in one\n"
+         "      paged query.\n"
+         "\n"
          "  -p, --password <password>\n"
          "      Password for the Xcode server.\n"
          "\n"
@@ -96,6 +179,9 @@
          "      An existing bot on the xcode server that is used as a template\n"
          "      for the new GitHub PR bots.\n"
          "\n"
+         "  -T, --timeout <seconds>\n"
+         "      The network request timeout. Defaults to 60 seconds.\n"
+         "\n"
          "  -u, --user <user>\n"
          "      User for the Xcode server.\n"
          "\n"
@@ -105,6 +191,9 @@
          "  -v, --verbose\n"
          "      Verbose. Extra 'v' increases the verbosity.\n"
          "\n"
+         "  -w, --webhook-secret <webhook-secret>\n"
+         "      The secret that signs the GitHub webhooks.\n"
+         "\n"
          "  -x, --xcodeserver <xcode-server-domain-name>\n"
          "      The network name of the xcode server.\n"
          "\n"
@@ -112,4 +201,11 @@
     return kHelpString;
 }
 
+- (BNCNetworkHostConfiguration*) hostConfiguration {
+    BNCNetworkHostConfiguration *configuration = [BNCNetworkHostConfiguration new];
+    configuration.maximumConcurrentRequests = self.connectionsPerHost;
+    configuration.timeoutInterval = self.requestTimeout;
+    return configuration;
+}
+
 @end
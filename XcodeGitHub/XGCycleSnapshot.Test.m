@@ -0,0 +1,77 @@
+/**
+ @file          XGCycleSnapshot.Test.m
+ @package       xcode-github
+ @brief         Tests for XGCycleSnapshot.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGCycleSnapshot.h"
+#import "XGHTTPServer.h"
+
+@interface XGCycleSnapshotTest : BNCTestCase
+@end
+
+@implementation XGCycleSnapshotTest
+
+- (void) testPullRequestsAreFetchedOncePerCycle {
+    __block NSInteger requestCount = 0;
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        @synchronized(self) {
+            requestCount++;
+        }
+        // Slow enough that the readers below overlap:
+        [NSThread sleepForTimeInterval:0.5];
+        NSDictionary *page = @{ @"data": @{ @"repository": @{ @"pullRequests": @{
+            @"pageInfo": @{ @"hasNextPage": @NO },
+            @"nodes": @[ @{
+                @"number": @1, @"title": @"Title", @"state": @"OPEN",
+                @"headRefName": @"branch", @"headRefOid": @"sha",
+                @"headRepository": @{ @"nameWithOwner": @"owner/repo" },
+            }],
+        }}}};
+        return [XGHTTPResponse responseWithStatusCode:200 JSONObject:page];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    XGGitHubPullRequest.graphQLURL =
+        [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/graphql", server.port]];
+
+    // Several readers at once share one request:
+    XGCycleSnapshot *cycle = [XGCycleSnapshot new];
+    NSMutableArray *results = [NSMutableArray new];
+    dispatch_apply(4, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t i) {
+        NSError *error = nil;
+        NSDictionary *prs = [cycle pullRequestsForRepository:@"github.com:owner/repo.git"
+            authToken:@"token" error:&error];
+        @synchronized(results) {
+            if (prs && !error) [results addObject:prs];
+        }
+    });
+    XCTAssertEqual(results.count, 4);
+    XCTAssertEqual(requestCount, 1);
+    XCTAssertEqualObjects([results[0][@"1"] title], @"Title");
+
+    // A different token or a new cycle fetches again:
+    [cycle pullRequestsForRepository:@"github.com:owner/repo.git" authToken:@"other" error:nil];
+    XCTAssertEqual(requestCount, 2);
+    cycle = [XGCycleSnapshot new];
+    [cycle pullRequestsForRepository:@"github.com:owner/repo.git" authToken:@"token" error:nil];
+    XCTAssertEqual(requestCount, 3);
+
+    // Errors are remembered for the cycle too:
+    [server stop];
+    NSError *error = nil;
+    [cycle pullRequestsForRepository:@"github.com:owner/other.git" authToken:@"token" error:&error];
+    XCTAssertNotNil(error);
+    error = nil;
+    [cycle pullRequestsForRepository:@"github.com:owner/other.git" authToken:@"token" error:&error];
+    XCTAssertNotNil(error);
+    XCTAssertEqual(requestCount, 3);
+
+    XGGitHubPullRequest.graphQLURL = nil;
+}
+
+@end
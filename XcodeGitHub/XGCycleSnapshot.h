@@ -0,0 +1,45 @@
+/**
+ @file          XGCycleSnapshot.h
+ @package       xcode-github
+ @brief         The Xcode bots, bot statuses, and GitHub PRs fetched during one refresh cycle.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+#import "XGXcodeBot.h"
+#import "XGGitHubPullRequest.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A cycle snapshot fetches each resource at most once, no matter how many sync tasks or views ask
+ for it during a refresh cycle. Errors are remembered too, so an unreachable server is only tried
+ once per cycle.
+
+ Make a new snapshot for each refresh cycle. The snapshot is safe to use from several threads.
+ If two threads ask for the same resource at once, one fetches it and the other waits for it.
+*/
+@interface XGCycleSnapshot : NSObject
+
+/// The bots on the server, keyed by bot name.
+- (NSDictionary<NSString*, XGXcodeBot*>*_Nullable) botsForServer:(XGServer*)server
+                                                           error:(NSError*_Nullable __autoreleasing *_Nullable)error;
+
+/// The latest status of every bot on the server, keyed by bot name.
+- (NSDictionary<NSString*, XGXcodeBotStatus*>*_Nullable) botStatusesForServer:(XGServer*)server
+                                                                          jobs:(NSInteger)jobs
+                                                                         error:(NSError*_Nullable __autoreleasing *_Nullable)error;
+
+/// The open PRs of a repository, keyed by PR number.
+- (NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable) pullRequestsForRepository:(NSString*)repository
+                                                                            authToken:(NSString*)authToken
+                                                                                error:(NSError*_Nullable __autoreleasing *_Nullable)error;
+
+/// Forgets the bots and statuses of a server after its bots were added or removed.
+- (void) invalidateServer:(XGServer*)server;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,107 @@
+/**
+ @file          XGCycleSnapshot.m
+ @package       xcode-github
+ @brief         The Xcode bots, bot statuses, and GitHub PRs fetched during one refresh cycle.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGCycleSnapshot.h"
+#import "BNCLog.h"
+
+#pragma mark XGCycleEntry
+
+/// A resource that's fetched once. Fetching holds the entry's lock so other readers wait for it.
+@interface XGCycleEntry : NSObject
+@property (assign) BOOL isLoaded;
+@property (strong) id _Nullable result;
+@property (strong) NSError*_Nullable error;
+@end
+
+@implementation XGCycleEntry
+@end
+
+#pragma mark - XGCycleSnapshot
+
+@implementation XGCycleSnapshot {
+    NSMutableDictionary<NSString*, XGCycleEntry*>*_entries;
+}
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _entries = [NSMutableDictionary new];
+    return self;
+}
+
+- (id _Nullable) resultForKey:(NSString*)key
+        error:(NSError*_Nullable __autoreleasing *_Nullable)error
+        loader:(id _Nullable (^_Nonnull)(NSError*_Nullable __autoreleasing *_Nonnull error))loader {
+    XGCycleEntry *entry = nil;
+    @synchronized(self) {
+        entry = _entries[key];
+        if (!entry) {
+            entry = [XGCycleEntry new];
+            _entries[key] = entry;
+        }
+    }
+    @synchronized(entry) {
+        if (!entry.isLoaded) {
+            NSError *loadError = nil;
+            entry.result = loader(&loadError);
+            entry.error = loadError;
+            entry.isLoaded = YES;
+        } else {
+            BNCLogDebug(@"Using '%@' from this cycle.", key);
+        }
+        if (error) *error = entry.error;
+        return entry.result;
+    }
+}
+
++ (NSString*) keyForServer:(XGServer*)server {
+    return [NSString stringWithFormat:@"%@@%@", server.user ?: @"", server.server];
+}
+
+- (NSDictionary<NSString*, XGXcodeBot*>*) botsForServer:(XGServer*)server
+                                                  error:(NSError*__autoreleasing*)error {
+    NSString *key = [@"bots " stringByAppendingString:[self.class keyForServer:server]];
+    return [self resultForKey:key error:error loader:^id(NSError*__autoreleasing*loadError) {
+        return [XGXcodeBot botsForServer:server error:loadError];
+    }];
+}
+
+- (NSDictionary<NSString*, XGXcodeBotStatus*>*) botStatusesForServer:(XGServer*)server
+                                                                 jobs:(NSInteger)jobs
+                                                                error:(NSError*__autoreleasing*)error {
+    NSString *key = [@"statuses " stringByAppendingString:[self.class keyForServer:server]];
+    return [self resultForKey:key error:error loader:^id(NSError*__autoreleasing*loadError) {
+        NSDictionary<NSString*, XGXcodeBot*>*bots = [self botsForServer:server error:loadError];
+        if (!bots) return nil;
+        return [XGXcodeBot botStatusesForServer:server bots:bots.allValues jobs:jobs error:loadError];
+    }];
+}
+
+- (NSDictionary<NSString*, XGGitHubPullRequest*>*) pullRequestsForRepository:(NSString*)repository
+                                                                    authToken:(NSString*)authToken
+                                                                        error:(NSError*__autoreleasing*)error {
+    // What's visible depends on who's asking, so the token is part of the key. Only its hash is
+    // used so that the key can be logged:
+    NSString *key =
+        [NSString stringWithFormat:@"pulls %@ %lx", repository, (unsigned long) authToken.hash];
+    return [self resultForKey:key error:error loader:^id(NSError*__autoreleasing*loadError) {
+        return [XGGitHubPullRequest pullsRequestsForRepository:repository authToken:authToken error:loadError];
+    }];
+}
+
+- (void) invalidateServer:(XGServer*)server {
+    NSString *serverKey = [self.class keyForServer:server];
+    @synchronized(self) {
+        [_entries removeObjectForKey:[@"bots " stringByAppendingString:serverKey]];
+        [_entries removeObjectForKey:[@"statuses " stringByAppendingString:serverKey]];
+    }
+}
+
+@end
@@ -0,0 +1,296 @@
+/**
+ @file          XGGitHubPullRequest.Test.m
+ @package       xcode-github
+ @brief         Tests for XGGitHubPullRequest.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGGitHubPullRequest.h"
+#import "XGHTTPServer.h"
+
+@interface XGGitHubPullRequestTest : BNCTestCase
+@end
+
+@implementation XGGitHubPullRequestTest
+
+- (NSDictionary*) nodeWithNumber:(NSInteger)number statusContexts:(NSArray*)contexts {
+    return @{
+        @"number":          @(number),
+        @"title":           [NSString stringWithFormat:@"Title %ld", (long) number],
+        @"body":            @"Body",
+        @"state":           @"OPEN",
+        @"url":             [NSString stringWithFormat:@"https://github.com/owner/repo/pull/%ld", (long) number],
+        @"headRefName":     [NSString stringWithFormat:@"branch-%ld", (long) number],
+        @"headRefOid":      [NSString stringWithFormat:@"sha-%ld", (long) number],
+        @"headRepository":  @{ @"nameWithOwner": @"owner/repo" },
+        @"commits": @{ @"nodes": @[
+            @{ @"commit": @{ @"status": (contexts) ? @{ @"contexts": contexts } : [NSNull null] } }
+        ]},
+    };
+}
+
+- (void) testGraphQLPullRequests {
+    NSDictionary *page1 = @{ @"data": @{ @"repository": @{ @"pullRequests": @{
+        @"pageInfo": @{ @"hasNextPage": @YES, @"endCursor": @"cursor-1" },
+        @"nodes": @[
+            [self nodeWithNumber:1 statusContexts:@[
+                @{ @"context": @"other-ci", @"state": @"FAILURE",
+                   @"description": @"Old", @"createdAt": @"2018-10-01T10:00:00Z" },
+                @{ @"context": @"continuous-integration/xcode-github", @"state": @"SUCCESS",
+                   @"description": @"Succeeded", @"createdAt": @"2018-10-01T12:00:00Z" },
+            ]],
+        ],
+    }}}};
+    NSDictionary *page2 = @{ @"data": @{ @"repository": @{ @"pullRequests": @{
+        @"pageInfo": @{ @"hasNextPage": @NO, @"endCursor": @"cursor-2" },
+        @"nodes": @[ [self nodeWithNumber:2 statusContexts:nil] ],
+    }}}};
+
+    NSMutableArray<NSDictionary*>*requests = [NSMutableArray new];
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        NSDictionary *query = [NSJSONSerialization JSONObjectWithData:request.body options:0 error:nil];
+        @synchronized(requests) {
+            if (query) [requests addObject:query];
+        }
+        if (![request.method isEqualToString:@"POST"] ||
+            ![request.headers[@"authorization"] isEqualToString:@"bearer token"])
+            return [XGHTTPResponse responseWithStatusCode:401 JSONObject:@{ @"message": @"Bad credentials" }];
+        id cursor = query[@"variables"][@"cursor"];
+        NSDictionary *page = ([cursor isEqual:@"cursor-1"]) ? page2 : page1;
+        return [XGHTTPResponse responseWithStatusCode:200 JSONObject:page];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    XGGitHubPullRequest.graphQLURL =
+        [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/graphql", server.port]];
+
+    NSError *error = nil;
+    NSDictionary<NSString*, XGGitHubPullRequest*>*prs =
+        [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/repo.git"
+            authToken:@"token"
+            error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(prs.count, 2);
+    XCTAssertEqual(requests.count, 2);
+    XCTAssertEqualObjects(requests[0][@"variables"][@"owner"], @"owner");
+    XCTAssertEqualObjects(requests[0][@"variables"][@"name"], @"repo");
+    XCTAssertEqualObjects(requests[1][@"variables"][@"cursor"], @"cursor-1");
+
+    // The PRs look just like REST PRs:
+    XGGitHubPullRequest *pr = prs[@"1"];
+    XCTAssertEqualObjects(pr.number, @"1");
+    XCTAssertEqualObjects(pr.title, @"Title 1");
+    XCTAssertEqualObjects(pr.state, @"open");
+    XCTAssertEqualObjects(pr.branch, @"branch-1");
+    XCTAssertEqualObjects(pr.sha, @"sha-1");
+    XCTAssertEqualObjects(pr.repoOwner, @"owner");
+    XCTAssertEqualObjects(pr.repoName, @"repo");
+
+    // And the statuses came along without another request:
+    NSArray<XGGitHubPullRequestStatus*>*statuses = [pr statusesWithError:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(statuses.count, 2);
+    XCTAssertEqual(statuses.firstObject.status, XGPullRequestStatusSuccess);
+    XCTAssertEqualObjects(statuses.firstObject.message, @"Succeeded");
+    XCTAssertEqual([prs[@"2"] statusesWithError:&error].count, 0);
+    XCTAssertNil(error);
+    XCTAssertEqual(requests.count, 2);
+
+    // A GraphQL error fails the list:
+    prs = [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/repo.git"
+        authToken:@"wrong"
+        error:&error];
+    XCTAssertNil(prs);
+    XCTAssertEqualObjects(error.localizedDescription, @"Bad credentials");
+
+    XGGitHubPullRequest.graphQLURL = nil;
+    [server stop];
+}
+
+- (void) testCompletionIsCalledOnTheQueue {
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        NSDictionary *page = @{ @"data": @{ @"repository": @{ @"pullRequests": @{
+            @"pageInfo": @{ @"hasNextPage": @NO },
+            @"nodes": @[ [self nodeWithNumber:1 statusContexts:@[]] ],
+        }}}};
+        return [XGHTTPResponse responseWithStatusCode:200 JSONObject:page];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    XGGitHubPullRequest.graphQLURL =
+        [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/graphql", server.port]];
+
+    static char kQueueKey = 0;
+    dispatch_queue_t queue = dispatch_queue_create("io.branch.xcode-github.test", DISPATCH_QUEUE_SERIAL);
+    dispatch_queue_set_specific(queue, &kQueueKey, &kQueueKey, NULL);
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    __block BOOL isOnQueue = NO;
+    __block NSDictionary<NSString*, XGGitHubPullRequest*>*prs = nil;
+    [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/repo.git"
+        authToken:@"token"
+        queue:queue
+        completion:^(NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable pullRequests, NSError*_Nullable error) {
+            isOnQueue = (dispatch_get_specific(&kQueueKey) == &kQueueKey);
+            prs = pullRequests;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertTrue(isOnQueue);
+    XCTAssertEqual(prs.count, 1);
+
+    // Errors are reported on the queue too:
+    isOnQueue = NO;
+    __block NSError *listError = nil;
+    [XGGitHubPullRequest pullsRequestsForRepository:@"gitlab.com:owner/repo.git"
+        authToken:@"token"
+        queue:queue
+        completion:^(NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable pullRequests, NSError*_Nullable error) {
+            isOnQueue = (dispatch_get_specific(&kQueueKey) == &kQueueKey);
+            listError = error;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertTrue(isOnQueue);
+    XCTAssertNotNil(listError);
+
+    XGGitHubPullRequest.graphQLURL = nil;
+    [server stop];
+}
+
+- (NSDictionary*) pullWithNumber:(NSInteger)number {
+    return @{
+        @"number":  @(number),
+        @"title":   [NSString stringWithFormat:@"Title %ld", (long) number],
+        @"state":   @"open",
+        @"head":    @{
+            @"ref":     [NSString stringWithFormat:@"branch-%ld", (long) number],
+            @"sha":     [NSString stringWithFormat:@"sha-%ld", (long) number],
+            @"repo":    @{ @"full_name": @"owner/repo" },
+        },
+    };
+}
+
+- (void) testConditionalPullRequestListing {
+    NSMutableArray<NSString*>*conditions = [NSMutableArray new];
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        NSString *condition = request.headers[@"if-none-match"];
+        @synchronized(conditions) {
+            [conditions addObject:condition ?: @""];
+        }
+        if ([condition isEqualToString:@"\"etag-1\""])
+            return [XGHTTPResponse responseWithStatusCode:304];
+        XGHTTPResponse *response =
+            [XGHTTPResponse responseWithStatusCode:200
+                JSONObject:@[ [self pullWithNumber:1], [self pullWithNumber:2] ]];
+        response.headers = @{ @"ETag": @"\"etag-1\"" };
+        return response;
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    XGGitHubPullRequest.APIURL =
+        [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d", server.port]];
+
+    // A token of its own so that responses cached by other tests aren't used:
+    NSString *token = [NSUUID UUID].UUIDString;
+    NSError *error = nil;
+    NSDictionary<NSString*, XGGitHubPullRequest*>*prs =
+        [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/repo.git"
+            authToken:token
+            error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(prs.count, 2);
+
+    // The second listing sends the ETag, gets a 304, and returns the cached PRs:
+    prs = [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/repo.git"
+        authToken:token
+        error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(prs.count, 2);
+    XCTAssertEqualObjects(prs[@"2"].title, @"Title 2");
+    XCTAssertEqualObjects(prs[@"2"].sha, @"sha-2");
+    @synchronized(conditions) {
+        XCTAssertEqualObjects(conditions, (@[ @"", @"\"etag-1\"" ]));
+    }
+
+    XGGitHubPullRequest.APIURL = nil;
+    [server stop];
+}
+
+- (void) testPagesAreReadInOrder {
+    NSMutableArray<NSString*>*paths = [NSMutableArray new];
+    __block uint16_t port = 0;
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        @synchronized(paths) {
+            [paths addObject:request.path];
+        }
+        NSURLComponents *components = [NSURLComponents componentsWithString:request.path];
+        NSInteger page = 1;
+        for (NSURLQueryItem *item in components.queryItems)
+            if ([item.name isEqualToString:@"page"]) page = item.value.integerValue;
+        XGHTTPResponse *response =
+            [XGHTTPResponse responseWithStatusCode:200
+                JSONObject:@[ [self pullWithNumber:page * 10], [self pullWithNumber:page * 10 + 1] ]];
+        if (page < 3) {
+            NSString *base = [NSString stringWithFormat:@"http://127.0.0.1:%d/repos/owner/repo/pulls", port];
+            response.headers = @{ @"Link": [NSString stringWithFormat:
+                @"<%@?page=%ld>; rel=\"next\", <%@?page=3>; rel=\"last\"", base, (long) page + 1, base] };
+        }
+        return response;
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    port = server.port;
+    XGGitHubPullRequest.APIURL =
+        [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d", server.port]];
+
+    NSError *error = nil;
+    NSDictionary<NSString*, XGGitHubPullRequest*>*prs =
+        [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/repo.git"
+            authToken:[NSUUID UUID].UUIDString
+            error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqualObjects([NSSet setWithArray:prs.allKeys],
+        ([NSSet setWithArray:@[ @"10", @"11", @"20", @"21", @"30", @"31" ]]));
+
+    // Each page is read after the one before it, following its 'next' link:
+    @synchronized(paths) {
+        XCTAssertEqual(paths.count, 3);
+        XCTAssertTrue([paths[0] hasPrefix:@"/repos/owner/repo/pulls?state=open"]);
+        XCTAssertEqualObjects(paths[1], @"/repos/owner/repo/pulls?page=2");
+        XCTAssertEqualObjects(paths[2], @"/repos/owner/repo/pulls?page=3");
+    }
+
+    XGGitHubPullRequest.APIURL = nil;
+    [server stop];
+}
+
+- (void) testLinksFromLinkHeader {
+    NSURL *next = [NSURL URLWithString:@"https://api.github.com/repos/o/r/pulls?per_page=100&page=2"];
+    NSURL *last = [NSURL URLWithString:@"https://api.github.com/repos/o/r/pulls?per_page=100&page=5"];
+
+    // A header like GitHub's:
+    NSDictionary *links = XGLinksFromLinkHeader(
+        @"<https://api.github.com/repos/o/r/pulls?per_page=100&page=2>; rel=\"next\", "
+         "<https://api.github.com/repos/o/r/pulls?per_page=100&page=5>; rel=\"last\"");
+    XCTAssertEqualObjects(links, (@{ @"next": next, @"last": last }));
+
+    // Extra whitespace, other parameters, an unquoted 'rel', and more than one relation:
+    links = XGLinksFromLinkHeader(
+        @"  < https://api.github.com/repos/o/r/pulls?per_page=100&page=2 > ;  title=\"Next\" ; REL = next ,"
+         "<https://api.github.com/repos/o/r/pulls?per_page=100&page=5>;type=\"text/json\";rel=\"last end\"  ");
+    XCTAssertEqualObjects(links, (@{ @"next": next, @"last": last, @"end": last }));
+
+    // A link without a 'rel' is skipped:
+    links = XGLinksFromLinkHeader(
+        @"<https://api.github.com/repos/o/r/pulls?per_page=100&page=2>; title=\"next\", "
+         "<https://api.github.com/repos/o/r/pulls?per_page=100&page=5>; rel=\"last\"");
+    XCTAssertEqualObjects(links, (@{ @"last": last }));
+
+    // Nothing to parse:
+    XCTAssertEqualObjects(XGLinksFromLinkHeader(nil), @{});
+    XCTAssertEqualObjects(XGLinksFromLinkHeader(@""), @{});
+    XCTAssertEqualObjects(XGLinksFromLinkHeader(@"rel=\"next\""), @{});
+    XCTAssertEqualObjects(XGLinksFromLinkHeader((NSString*)@[]), @{});
+}
+
+@end
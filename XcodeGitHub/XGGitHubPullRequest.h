@@ -21,6 +21,13 @@ typedef NS_ENUM(NSInteger, XGPullRequestStatus) {
 
 FOUNDATION_EXPORT NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status);
 
+/**
+ Parses an HTTP 'Link' header like
+ `<https://api.github.com/...&page=2>; rel="next", <https://api.github.com/...&page=5>; rel="last"`
+ into a dictionary of URLs keyed by their 'rel' values. Links without a 'rel' are skipped.
+*/
+FOUNDATION_EXPORT NSDictionary<NSString*, NSURL*>*_Nonnull XGLinksFromLinkHeader(NSString*_Nullable header);
+
 #pragma mark - XGGitHubPullRequestStatus
 
 @interface XGGitHubPullRequestStatus : NSObject
@@ -41,28 +48,66 @@ FOUNDATION_EXPORT NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullReques
 @property (strong, readonly) NSString*_Nullable title;
 @property (strong, readonly) NSString*_Nullable body;
 @property (strong, readonly) NSString*_Nullable state;
-@property (strong, readonly) NSDictionary*_Nullable dictionary;
 @property (strong, readonly) NSString*_Nullable sha;
 @property (strong, readonly) NSString*_Nullable githubPRURL;
+@property (strong) NSString*_Nullable authToken;    // The GitHub token used for status updates.
 
 + (instancetype _Nonnull) new NS_UNAVAILABLE;
 - (instancetype _Nonnull) init NS_UNAVAILABLE;
 
 - (instancetype _Nonnull) initWithDictionary:(NSDictionary*_Nullable)dictionary NS_DESIGNATED_INITIALIZER;
 
+/*
+ The network methods come in two flavors: a blocking method that returns its result, and a
+ non-blocking method that calls a completion block with the result.
+
+ The completion block is called asynchronously on `queue`. If `queue` is nil the completion block
+ is called on the network service's queue, so it should be short and must not block.
+*/
+
 - (NSArray<XGGitHubPullRequestStatus*>*_Nullable) statusesWithError:(NSError*_Nullable __autoreleasing *_Nullable)error;
 
+- (void) statusesWithQueue:(dispatch_queue_t _Nullable)queue
+                completion:(void (^_Nonnull)(NSArray<XGGitHubPullRequestStatus*>*_Nullable statuses, NSError*_Nullable error))completion;
+
 - (NSError*_Nullable) setStatus:(XGPullRequestStatus)status
                         message:(NSString*)message
                       statusURL:(NSURL*_Nullable)statusURL;
 
+- (void) setStatus:(XGPullRequestStatus)status
+           message:(NSString*)message
+         statusURL:(NSURL*_Nullable)statusURL
+             queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nullable)(NSError*_Nullable error))completion;
+
 - (NSError*_Nullable) addComment:(NSString*)comment;
 
+- (void) addComment:(NSString*)comment
+              queue:(dispatch_queue_t _Nullable)queue
+         completion:(void (^_Nullable)(NSError*_Nullable error))completion;
+
+/// The GitHub REST API, `https://api.github.com` by default. Setting it to nil restores the default.
+@property (class, strong, null_resettable) NSURL*APIURL;
+
+/**
+ The GitHub GraphQL endpoint, usually `https://api.github.com/graphql`. The default is nil.
+
+ When it's set, the open PRs of a repository are fetched with a paged GraphQL query that also
+ returns the latest commit statuses of each PR, so `statusesWithError:` doesn't need a request of
+ its own. The PRs are the same either way.
+*/
+@property (class, strong) NSURL*_Nullable graphQLURL;
+
 + (NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable)
     pullsRequestsForRepository:(NSString*_Nonnull)sourceControlRepository
     authToken:(NSString*_Nonnull)authToken
     error:(NSError*_Nullable __autoreleasing *_Nullable)error;
 
++ (void) pullsRequestsForRepository:(NSString*_Nonnull)sourceControlRepository
+                          authToken:(NSString*_Nonnull)authToken
+                              queue:(dispatch_queue_t _Nullable)queue
+                         completion:(void (^_Nonnull)(NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable pullRequests, NSError*_Nullable error))completion;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -11,7 +11,7 @@
 #import "XGGitHubPullRequest.h"
 #import "XGUtility.h"
 #import "BNCLog.h"
-#import "BNCNetworkService.h"
+#import "XGGitHubScheduler.h"
 
 NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
     NSArray<NSString*>*statusStrings = @[
@@ -28,42 +28,137 @@ NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
 #pragma mark - XGGitHubPullRequestStatus
 
 @interface XGGitHubPullRequestStatus ()
-@property (strong) NSDictionary*dictionary;
+- (instancetype) initWithDictionary:(NSDictionary*)dictionary;
 @end
 
 @implementation XGGitHubPullRequestStatus
 
-- (instancetype) initWithDictionary:(NSDictionary*)dictionary_ {
+- (instancetype) initWithDictionary:(NSDictionary*)dictionary {
     self = [super init];
     if (!self) return self;
-    self.dictionary = dictionary_;
-    return self;
-}
 
-- (XGPullRequestStatus) status {
     NSDictionary*d = @{
         @"error":   @(XGPullRequestStatusError),
         @"failure": @(XGPullRequestStatusFailure),
         @"pending": @(XGPullRequestStatusPending),
         @"success": @(XGPullRequestStatusSuccess)
     };
-    NSString*status = self.dictionary[@"state"];
-    if (status) {
-        NSNumber*n = d[status];
-        if (n != nil) return n.integerValue;
+    NSString*status = dictionary[@"state"];
+    NSNumber*n = (status) ? d[status] : nil;
+    _status = (n != nil) ? n.integerValue : XGPullRequestStatusError;
+    _message = dictionary[@"description"];
+
+    NSString*s = dictionary[@"updated_at"];
+    if (s) _updateDate = [[NSDateFormatter dateFormatter8601] dateFromString:s];
+    return self;
+}
+
+@end
+
+#pragma mark - XGLinksFromLinkHeader
+
+NSDictionary<NSString*, NSURL*>*_Nonnull XGLinksFromLinkHeader(NSString*_Nullable header) {
+    NSMutableDictionary<NSString*, NSURL*>*links = [NSMutableDictionary new];
+    if (![header isKindOfClass:NSString.class]) return links;
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    for (NSString *link in [header componentsSeparatedByString:@","]) {
+        // '<URL>' followed by ';'-separated parameters, one of which is 'rel':
+        NSRange start = [link rangeOfString:@"<"];
+        NSRange end = [link rangeOfString:@">"];
+        if (start.location == NSNotFound || end.location == NSNotFound || end.location < start.location)
+            continue;
+        NSString *URLString =
+            [link substringWithRange:NSMakeRange(start.location+1, end.location - start.location - 1)];
+        NSURL *URL = [NSURL URLWithString:[URLString stringByTrimmingCharactersInSet:whitespace]];
+        if (!URL) continue;
+
+        NSArray<NSString*>*parameters = [[link substringFromIndex:end.location+1] componentsSeparatedByString:@";"];
+        for (NSString *parameter in parameters) {
+            NSRange equals = [parameter rangeOfString:@"="];
+            if (equals.location == NSNotFound) continue;
+            NSString *name = [[parameter substringToIndex:equals.location] stringByTrimmingCharactersInSet:whitespace];
+            if ([name caseInsensitiveCompare:@"rel"] != NSOrderedSame) continue;
+            NSString *value = [[parameter substringFromIndex:equals.location+1] stringByTrimmingCharactersInSet:whitespace];
+            value = [value stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\""]];
+            // A link can have more than one relation, like rel="next last":
+            for (NSString *rel in [value componentsSeparatedByCharactersInSet:whitespace])
+                if (rel.length) links[rel] = URL;
+        }
     }
-    return XGPullRequestStatusError;
+    return links;
 }
 
-- (NSString*_Nullable) message {
-    return self.dictionary[@"description"];
+#pragma mark - XGGitHubResponseCache
+
+/// The validators and parsed result of a GitHub response, used to make conditional requests.
+@interface XGGitHubResponseCacheEntry : NSObject
+@property (strong) NSString*_Nullable eTag;
+@property (strong) NSString*_Nullable lastModified;
+@property (strong) id _Nullable result;
+@property (strong) NSDictionary<NSString*, NSURL*>*_Nullable links;
+@end
+
+@implementation XGGitHubResponseCacheEntry
+@end
+
+@interface XGGitHubResponseCache : NSObject
++ (XGGitHubResponseCache*) shared;
+- (XGGitHubResponseCacheEntry*_Nullable) entryForURL:(NSURL*)URL authToken:(NSString*_Nullable)authToken;
+- (void) setResult:(id)result
+             links:(NSDictionary<NSString*, NSURL*>*_Nullable)links
+      forOperation:(BNCNetworkOperation*)operation
+         authToken:(NSString*_Nullable)authToken;
+@end
+
+@implementation XGGitHubResponseCache {
+    NSMutableDictionary<NSString*, XGGitHubResponseCacheEntry*>*_entries;
+}
+
++ (XGGitHubResponseCache*) shared {
+    static XGGitHubResponseCache* sharedInstance = nil;
+    static dispatch_once_t onceToken = 0;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[self alloc] init];
+    });
+    return sharedInstance;
 }
 
-- (NSDate*_Nullable) updateDate {
-    NSString*s = self.dictionary[@"updated_at"];
-    if (!s) return nil;
-    NSDateFormatter *dateFormatter = [NSDateFormatter dateFormatter8601];
-    return [dateFormatter dateFromString:s];
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _entries = [NSMutableDictionary new];
+    return self;
+}
+
+- (NSString*) keyForURL:(NSURL*)URL authToken:(NSString*_Nullable)authToken {
+    // Responses depend on who is asking, so the token is part of the key:
+    return [NSString stringWithFormat:@"%@ %@", URL.absoluteString, authToken ?: @""];
+}
+
+- (XGGitHubResponseCacheEntry*_Nullable) entryForURL:(NSURL*)URL authToken:(NSString*_Nullable)authToken {
+    NSString *key = [self keyForURL:URL authToken:authToken];
+    @synchronized(self) {
+        return _entries[key];
+    }
+}
+
+- (void) setResult:(id)result
+             links:(NSDictionary<NSString*, NSURL*>*_Nullable)links
+      forOperation:(BNCNetworkOperation*)operation
+         authToken:(NSString*_Nullable)authToken {
+    NSString *key = [self keyForURL:operation.request.URL authToken:authToken];
+    NSDictionary *headers = operation.response.allHeaderFields;
+    XGGitHubResponseCacheEntry *entry = [XGGitHubResponseCacheEntry new];
+    entry.eTag = headers[@"ETag"];
+    entry.lastModified = headers[@"Last-Modified"];
+    entry.result = result;
+    entry.links = links;
+    @synchronized(self) {
+        if (entry.eTag.length || entry.lastModified.length)
+            _entries[key] = entry;
+        else
+            [_entries removeObjectForKey:key];
+    }
 }
 
 @end
@@ -71,11 +166,47 @@ NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
 #pragma mark - XGGitHubPullRequest
 
 @interface XGGitHubPullRequest ()
-@property (strong) NSString*_Nullable authToken;
+/// The latest statuses, newest first, if they came along with the PR. Nil if they're unknown.
+@property (strong) NSArray<XGGitHubPullRequestStatus*>*_Nullable knownStatuses;
 @end
 
 @implementation XGGitHubPullRequest
 
+static NSURL*_Nullable XGGitHubGraphQLURL = nil;
+static NSURL*_Nullable XGGitHubAPIURL = nil;
+
++ (NSURL*_Nonnull) APIURL {
+    @synchronized(self) {
+        if (!XGGitHubAPIURL) XGGitHubAPIURL = [NSURL URLWithString:@"https://api.github.com"];
+        return XGGitHubAPIURL;
+    }
+}
+
++ (void) setAPIURL:(NSURL*_Nullable)APIURL {
+    @synchronized(self) {
+        XGGitHubAPIURL = APIURL;
+    }
+}
+
+/// Returns the API URL as a string without a trailing slash, for building request URLs.
++ (NSString*) APIURLString {
+    NSString *string = self.APIURL.absoluteString;
+    if ([string hasSuffix:@"/"]) string = [string substringToIndex:string.length-1];
+    return string;
+}
+
++ (NSURL*_Nullable) graphQLURL {
+    @synchronized(self) {
+        return XGGitHubGraphQLURL;
+    }
+}
+
++ (void) setGraphQLURL:(NSURL*_Nullable)graphQLURL {
+    @synchronized(self) {
+        XGGitHubGraphQLURL = graphQLURL;
+    }
+}
+
 - (instancetype) init {
     return [self initWithDictionary:nil];
 }
@@ -84,23 +215,23 @@ NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
     self = [super init];
     if (!self) return self;
 
-    _dictionary = dictionary;
-    _title = _dictionary[@"title"];
-    _body = _dictionary[@"body"];
-    _branch = _dictionary[@"head"][@"ref"];
-    _number = _dictionary[@"number"];
+    // Only the fields that are used are kept, not the whole pull request dictionary:
+    _title = dictionary[@"title"];
+    _body = dictionary[@"body"];
+    _branch = dictionary[@"head"][@"ref"];
+    _number = dictionary[@"number"];
     if (![_number isKindOfClass:NSString.class]) _number = _number.description;
-    _state = _dictionary[@"state"];
+    _state = dictionary[@"state"];
 
-    NSString* fullname = _dictionary[@"head"][@"repo"][@"full_name"];
+    NSString* fullname = dictionary[@"head"][@"repo"][@"full_name"];
     NSRange range = [fullname rangeOfString:@"/"];
     if (range.location != NSNotFound) {
         _repoOwner = [fullname substringToIndex:range.location];
         NSInteger index = range.location + range.length;
         if (index < fullname.length) _repoName = [fullname substringFromIndex:index];
     }
-    _sha = _dictionary[@"head"][@"sha"];
-    _githubPRURL = _dictionary[@"url"];
+    _sha = dictionary[@"head"][@"sha"];
+    _githubPRURL = dictionary[@"url"];
     return self;
 }
 
@@ -108,10 +239,28 @@ NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
     pullsRequestsForRepository:(NSString*_Nonnull)sourceControlRepository
     authToken:(NSString*_Nonnull)authToken
     error:(NSError*_Nullable __autoreleasing *_Nullable)error {
+    __block NSDictionary<NSString*, XGGitHubPullRequest*>* prs = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self pullsRequestsForRepository:sourceControlRepository
+        authToken:authToken
+        queue:nil
+        completion:^(NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable prs_, NSError*_Nullable error_) {
+            prs = prs_;
+            localError = error_;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    if (error) *error = localError;
+    return prs;
+}
 
-    NSError *localError = nil;
-    NSMutableDictionary<NSString*, XGGitHubPullRequest*>* prs = nil;
++ (void) pullsRequestsForRepository:(NSString*_Nonnull)sourceControlRepository
+        authToken:(NSString*_Nonnull)authToken
+        queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nonnull)(NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable pullRequests, NSError*_Nullable error))completion {
 
+    NSError *localError = nil;
     {
         NSString *repo = nil;
         NSRange range = [sourceControlRepository rangeOfString:@":"];
@@ -131,10 +280,20 @@ NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
             goto exit;
         }
 
+        NSURL *graphQLURL = self.graphQLURL;
+        if (graphQLURL) {
+            [self graphQLPullRequestsForRepository:repo
+                URL:graphQLURL
+                authToken:authToken
+                queue:queue
+                completion:completion];
+            return;
+        }
+
         NSString *serverURLString =
             [NSString stringWithFormat:
-                @"https://api.github.com/repos/%@/pulls?state=open&sort=created&direction=desc",
-                    repo];
+                @"%@/repos/%@/pulls?state=open&sort=created&direction=desc&per_page=100",
+                    self.APIURLString, repo];
 
         NSURL *serverURL = [NSURL URLWithString:serverURLString];
         if (!serverURL) {
@@ -146,20 +305,104 @@ NSString*_Nonnull NSStringFromXGPullRequestStatus(XGPullRequestStatus status) {
             goto exit;
         }
 
-        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
-        BNCNetworkOperation *operation =
-            [[BNCNetworkService shared]
-                getOperationWithURL:serverURL completion:^(BNCNetworkOperation *operation) {
-                dispatch_semaphore_signal(semaphore);
+        // Follow the 'next' links of the 'Link' header one page at a time. Pages are offsets into
+        // the list, so fetching later pages before the earlier ones are read could skip a PR when
+        // another PR opens or closes during the listing. Any page that fails fails the whole list,
+        // since a missing PR would delete its bot.
+        NSMutableDictionary<NSString*, XGGitHubPullRequest*>*allPullRequests = [NSMutableDictionary new];
+        [self pullRequestPagesFollowingURL:serverURL
+            authToken:authToken
+            pullRequests:allPullRequests
+            pageCount:1
+            completion:^(NSInteger pageCount, NSError*_Nullable error) {
+                NSDictionary *result = (error) ? nil : allPullRequests;
+                BNCLogDebug(@"Found %ld open pull requests in %ld pages for '%@'.",
+                    (long) result.count, (long) pageCount, repo);
+                XGDispatchOnQueue(queue, ^{ completion(result, error); });
             }];
-        [operation.request addValue:@"application/vnd.github.v3+json" forHTTPHeaderField:@"Accept"];
-        if (authToken.length > 0) {
-            NSString *token = [NSString stringWithFormat:@"token %@", authToken];
-            [operation.request addValue:token forHTTPHeaderField:@"Authorization"];
+        return;
+    }
+
+exit:
+    XGDispatchOnQueue(queue, ^{ completion(nil, localError); });
+}
+
++ (void) pullRequestPagesFollowingURL:(NSURL*)URL
+        authToken:(NSString*)authToken
+        pullRequests:(NSMutableDictionary<NSString*, XGGitHubPullRequest*>*)allPullRequests
+        pageCount:(NSInteger)pageCount
+        completion:(void (^_Nonnull)(NSInteger pageCount, NSError*_Nullable error))completion {
+    [self pullRequestPageWithURL:URL authToken:authToken
+        completion:^(NSDictionary*_Nullable pullRequests, NSDictionary*_Nullable links, NSError*_Nullable error) {
+        if (error) {
+            completion(pageCount, error);
+            return;
         }
-        [operation start];
-        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+        [allPullRequests addEntriesFromDictionary:pullRequests];
+        NSURL *nextURL = links[@"next"];
+        if (nextURL)
+            [self pullRequestPagesFollowingURL:nextURL
+                authToken:authToken
+                pullRequests:allPullRequests
+                pageCount:pageCount + 1
+                completion:completion];
+        else
+            completion(pageCount, nil);
+    }];
+}
+
+/// Gets one page of pull requests. The completion block is called on the network queue.
++ (void) pullRequestPageWithURL:(NSURL*)URL
+        authToken:(NSString*)authToken
+        completion:(void (^_Nonnull)(
+            NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable pullRequests,
+            NSDictionary<NSString*, NSURL*>*_Nullable links,
+            NSError*_Nullable error))completion {
+
+    // Make a conditional request if we've seen this page before. GitHub doesn't count a
+    // '304 Not Modified' response against the rate limit:
+    XGGitHubResponseCacheEntry *cacheEntry =
+        [[XGGitHubResponseCache shared] entryForURL:URL authToken:authToken];
+
+    BNCNetworkOperation *operation =
+        [[XGGitHubScheduler shared]
+            getOperationWithURL:URL completion:^(BNCNetworkOperation *operation) {
+            if (cacheEntry && !operation.error && operation.HTTPStatusCode == 304) {
+                BNCLogDebug(@"Pull requests at '%@' haven't changed.", URL);
+                completion(cacheEntry.result, cacheEntry.links, nil);
+                return;
+            }
+            NSError *error = nil;
+            NSDictionary *prs = [self pullRequestsFromOperation:operation authToken:authToken error:&error];
+            NSDictionary *links = XGLinksFromLinkHeader(operation.response.allHeaderFields[@"Link"]);
+            if (prs) {
+                [[XGGitHubResponseCache shared]
+                    setResult:[prs copy] links:links forOperation:operation authToken:authToken];
+            }
+            completion(prs, links, error);
+        }];
+    [operation.request addValue:@"application/vnd.github.v3+json" forHTTPHeaderField:@"Accept"];
+    if (authToken.length > 0) {
+        NSString *token = [NSString stringWithFormat:@"token %@", authToken];
+        [operation.request addValue:token forHTTPHeaderField:@"Authorization"];
+    }
+    if (cacheEntry.eTag.length)
+        [operation.request setValue:cacheEntry.eTag forHTTPHeaderField:@"If-None-Match"];
+    else
+    if (cacheEntry.lastModified.length)
+        [operation.request setValue:cacheEntry.lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    [[XGGitHubScheduler shared] startOperation:operation];
+}
+
++ (NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable)
+    pullRequestsFromOperation:(BNCNetworkOperation*)operation
+    authToken:(NSString*)authToken
+    error:(NSError*_Nullable __autoreleasing *_Nullable)error {
+
+    NSError *localError = nil;
+    NSMutableDictionary<NSString*, XGGitHubPullRequest*>* prs = nil;
 
+    {
         if (operation.error) {
             NSString *message = operation.stringFromResponseData;
             if (message.length) BNCLogError(@"From GitHub: %@.", message);
@@ -212,6 +455,223 @@ exit:
     return prs;
 }
 
+#pragma mark - GraphQL
+
+static NSString*const kXGPullRequestsQuery =
+    @"query($owner: String!, $name: String!, $cursor: String) {\n"
+     "  repository(owner: $owner, name: $name) {\n"
+     "    pullRequests(states: OPEN, first: 100, after: $cursor,\n"
+     "        orderBy: {field: CREATED_AT, direction: DESC}) {\n"
+     "      pageInfo { hasNextPage endCursor }\n"
+     "      nodes {\n"
+     "        number title body state url headRefName headRefOid\n"
+     "        headRepository { nameWithOwner }\n"
+     "        commits(last: 1) {\n"
+     "          nodes { commit { status { contexts { context state description createdAt } } } }\n"
+     "        }\n"
+     "      }\n"
+     "    }\n"
+     "  }\n"
+     "}\n";
+
++ (void) graphQLPullRequestsForRepository:(NSString*)repo
+        URL:(NSURL*)URL
+        authToken:(NSString*)authToken
+        queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nonnull)(NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable pullRequests, NSError*_Nullable error))completion {
+    NSMutableDictionary<NSString*, XGGitHubPullRequest*>*allPullRequests = [NSMutableDictionary new];
+    [self graphQLPullRequestPagesForRepository:repo
+        URL:URL
+        authToken:authToken
+        cursor:nil
+        pullRequests:allPullRequests
+        completion:^(NSError*_Nullable error) {
+            NSDictionary *result = (error) ? nil : allPullRequests;
+            BNCLogDebug(@"Found %ld open pull requests for '%@' with GraphQL.", (long) result.count, repo);
+            XGDispatchOnQueue(queue, ^{ completion(result, error); });
+        }];
+}
+
+/// Gets the pages of pull requests one at a time, following the page cursors.
++ (void) graphQLPullRequestPagesForRepository:(NSString*)repo
+        URL:(NSURL*)URL
+        authToken:(NSString*)authToken
+        cursor:(NSString*_Nullable)cursor
+        pullRequests:(NSMutableDictionary<NSString*, XGGitHubPullRequest*>*)allPullRequests
+        completion:(void (^_Nonnull)(NSError*_Nullable error))completion {
+    NSRange slash = [repo rangeOfString:@"/"];
+    NSMutableDictionary *variables = [NSMutableDictionary new];
+    variables[@"owner"] = (slash.location == NSNotFound) ? repo : [repo substringToIndex:slash.location];
+    variables[@"name"] = (slash.location == NSNotFound) ? @"" : [repo substringFromIndex:slash.location+1];
+    variables[@"cursor"] = cursor ?: [NSNull null];
+    NSDictionary *query = @{
+        @"query":       kXGPullRequestsQuery,
+        @"variables":   variables,
+    };
+
+    BNCNetworkOperation *operation =
+        [[XGGitHubScheduler shared]
+            postOperationWithURL:URL
+            JSONData:query
+            completion:^(BNCNetworkOperation *operation) {
+            NSError *error = nil;
+            NSString *nextCursor = nil;
+            NSDictionary *prs =
+                [self graphQLPullRequestsFromOperation:operation
+                    authToken:authToken
+                    nextCursor:&nextCursor
+                    error:&error];
+            if (error) {
+                completion(error);
+                return;
+            }
+            [allPullRequests addEntriesFromDictionary:prs];
+            if (nextCursor)
+                [self graphQLPullRequestPagesForRepository:repo
+                    URL:URL
+                    authToken:authToken
+                    cursor:nextCursor
+                    pullRequests:allPullRequests
+                    completion:completion];
+            else
+                completion(nil);
+        }];
+    if (authToken.length > 0) {
+        NSString *token = [NSString stringWithFormat:@"bearer %@", authToken];
+        [operation.request addValue:token forHTTPHeaderField:@"Authorization"];
+    }
+    // A query is a read even though it's a POST:
+    [[XGGitHubScheduler shared] startOperation:operation priority:XGGitHubRequestPriorityRead];
+}
+
++ (NSDictionary<NSString*, XGGitHubPullRequest*>*_Nullable)
+    graphQLPullRequestsFromOperation:(BNCNetworkOperation*)operation
+    authToken:(NSString*)authToken
+    nextCursor:(NSString*_Nullable __autoreleasing *_Nonnull)nextCursor
+    error:(NSError*_Nullable __autoreleasing *_Nullable)error {
+
+    NSError *localError = nil;
+    NSMutableDictionary<NSString*, XGGitHubPullRequest*>* prs = nil;
+    *nextCursor = nil;
+
+    {
+        if (operation.error) {
+            NSString *message = operation.stringFromResponseData;
+            if (message.length) BNCLogError(@"From GitHub: %@.", message);
+            localError = operation.error;
+            goto exit;
+        }
+        [operation deserializeJSONResponseData];
+        if (operation.error) {
+            NSString *message = operation.stringFromResponseData;
+            if (message.length) BNCLogError(@"From GitHub: %@.", message);
+            localError = operation.error;
+            goto exit;
+        }
+        NSDictionary *response = (id) operation.responseData;
+        if (![response isKindOfClass:NSDictionary.class]) response = nil;
+
+        // GraphQL errors usually come back with a 200 status and an 'errors' array:
+        NSArray *errors = response[@"errors"];
+        if (operation.HTTPStatusCode != 200 || [errors isKindOfClass:NSArray.class]) {
+            NSString *message = nil;
+            if ([errors isKindOfClass:NSArray.class] && [errors.firstObject isKindOfClass:NSDictionary.class])
+                message = errors.firstObject[@"message"];
+            if (!message) message = response[@"message"];
+            if (!message)
+                message = [NSString stringWithFormat:@"GitHub response code %ld.", operation.HTTPStatusCode];
+            BNCLogError(@"From GitHub: %@.", message);
+            localError = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorUnknown userInfo:@{
+                NSLocalizedDescriptionKey: message
+            }];
+            goto exit;
+        }
+
+        NSDictionary *pullRequests = response[@"data"][@"repository"][@"pullRequests"];
+        NSArray *nodes = pullRequests[@"nodes"];
+        if (![nodes isKindOfClass:NSArray.class]) {
+            localError =
+                [NSError errorWithDomain:NSNetServicesErrorDomain
+                    code:NSURLErrorBadServerResponse
+                    userInfo:@{ NSLocalizedDescriptionKey: @"Expected an array of pull requests." }];
+            goto exit;
+        }
+
+        prs = [NSMutableDictionary new];
+        for (NSDictionary *node in nodes) {
+            if (![node isKindOfClass:NSDictionary.class]) continue;
+            XGGitHubPullRequest *pr =
+                [[XGGitHubPullRequest alloc] initWithDictionary:[self dictionaryFromGraphQLNode:node]];
+            if (pr && pr.number) {
+                pr.authToken = authToken;
+                pr.knownStatuses = [self statusesFromGraphQLNode:node];
+                prs[pr.number] = pr;
+            }
+        }
+
+        NSDictionary *pageInfo = pullRequests[@"pageInfo"];
+        NSString *endCursor = pageInfo[@"endCursor"];
+        if ([pageInfo[@"hasNextPage"] boolValue] && [endCursor isKindOfClass:NSString.class])
+            *nextCursor = endCursor;
+    }
+
+exit:
+    if (error) *error = localError;
+    return prs;
+}
+
+/// Returns a dictionary in the same shape as a REST v3 pull request.
++ (NSDictionary*) dictionaryFromGraphQLNode:(NSDictionary*)node {
+    NSMutableDictionary *head = [NSMutableDictionary new];
+    head[@"ref"] = node[@"headRefName"];
+    head[@"sha"] = node[@"headRefOid"];
+    NSString *fullName = node[@"headRepository"][@"nameWithOwner"];
+    if ([fullName isKindOfClass:NSString.class]) head[@"repo"] = @{ @"full_name": fullName };
+
+    NSMutableDictionary *dictionary = [NSMutableDictionary new];
+    dictionary[@"number"] = node[@"number"];
+    dictionary[@"title"] = node[@"title"];
+    dictionary[@"body"] = node[@"body"];
+    NSString *state = node[@"state"];
+    if ([state isKindOfClass:NSString.class]) dictionary[@"state"] = state.lowercaseString;
+    dictionary[@"url"] = node[@"url"];
+    dictionary[@"head"] = head;
+    return dictionary;
+}
+
+/// Returns the statuses of the PR's head commit, newest first, in the same shape as REST v3 statuses.
++ (NSArray<XGGitHubPullRequestStatus*>*) statusesFromGraphQLNode:(NSDictionary*)node {
+    NSArray *commits = node[@"commits"][@"nodes"];
+    NSDictionary *status = nil;
+    if ([commits isKindOfClass:NSArray.class] && [commits.lastObject isKindOfClass:NSDictionary.class])
+        status = commits.lastObject[@"commit"][@"status"];
+    NSArray *contexts = ([status isKindOfClass:NSDictionary.class]) ? status[@"contexts"] : nil;
+    if (![contexts isKindOfClass:NSArray.class]) return @[];
+
+    NSMutableArray<NSDictionary*>*dictionaries = [NSMutableArray new];
+    for (NSDictionary *context in contexts) {
+        if (![context isKindOfClass:NSDictionary.class]) continue;
+        NSMutableDictionary *d = [NSMutableDictionary new];
+        NSString *state = context[@"state"];
+        if ([state isKindOfClass:NSString.class]) d[@"state"] = state.lowercaseString;
+        d[@"context"] = context[@"context"];
+        d[@"description"] = context[@"description"];
+        d[@"updated_at"] = context[@"createdAt"];
+        [dictionaries addObject:d];
+    }
+    // ISO 8601 dates sort as strings:
+    [dictionaries sortUsingComparator:^NSComparisonResult(NSDictionary *d1, NSDictionary *d2) {
+        NSString *date1 = [d1[@"updated_at"] isKindOfClass:NSString.class] ? d1[@"updated_at"] : @"";
+        NSString *date2 = [d2[@"updated_at"] isKindOfClass:NSString.class] ? d2[@"updated_at"] : @"";
+        return [date2 compare:date1];
+    }];
+
+    NSMutableArray<XGGitHubPullRequestStatus*>*statuses = [NSMutableArray new];
+    for (NSDictionary *d in dictionaries)
+        [statuses addObject:[[XGGitHubPullRequestStatus alloc] initWithDictionary:d]];
+    return statuses;
+}
+
 + (NSString*) stringFromStatus:(XGPullRequestStatus)status {
     status = MAX(XGPullRequestStatusError, MIN(XGPullRequestStatusSuccess, status));
     NSArray*a =  @[
@@ -224,39 +684,65 @@ exit:
 }
 
 - (NSArray<XGGitHubPullRequestStatus*>*_Nullable) statusesWithError:
-        (NSError*_Nullable __autoreleasing *_Nullable)error_ {
-    NSError*error = nil;
-    NSMutableArray<XGGitHubPullRequestStatus*>*results = nil;
+        (NSError*_Nullable __autoreleasing *_Nullable)error {
+    __block NSArray<XGGitHubPullRequestStatus*>*statuses = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self statusesWithQueue:nil
+        completion:^(NSArray<XGGitHubPullRequestStatus*>*_Nullable statuses_, NSError*_Nullable error_) {
+            statuses = statuses_;
+            localError = error_;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    if (error) *error = localError;
+    return statuses;
+}
+
+- (void) statusesWithQueue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nonnull)(NSArray<XGGitHubPullRequestStatus*>*_Nullable statuses, NSError*_Nullable error))completion {
+    NSArray<XGGitHubPullRequestStatus*>*knownStatuses = self.knownStatuses;
+    if (knownStatuses) {
+        XGDispatchOnQueue(queue, ^{ completion(knownStatuses, nil); });
+        return;
+    }
 
-    {
     NSString* string = [NSString stringWithFormat:
-        @"https://api.github.com/repos/%@/%@/commits/%@/statuses",
-            self.repoOwner, self.repoName, self.sha];
+        @"%@/repos/%@/%@/commits/%@/statuses",
+            self.class.APIURLString, self.repoOwner, self.repoName, self.sha];
     NSURL *URL = [NSURL URLWithString:string];
     if (!URL) {
-        error =
+        NSError *error =
             [NSError errorWithDomain:NSNetServicesErrorDomain code:NSURLErrorBadURL userInfo:@{
                 NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Bad URL '%@'.", URL]
             }];
         BNCLogError(@"Bad URL '%@'.", URL);
-        goto exit;
+        XGDispatchOnQueue(queue, ^{ completion(nil, error); });
+        return;
     }
 
-    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
     BNCNetworkOperation *operation =
-        [[BNCNetworkService shared]
+        [[XGGitHubScheduler shared]
             getOperationWithURL:URL
             completion:^(BNCNetworkOperation *operation) {
-            dispatch_semaphore_signal(semaphore);
+            NSError *error = nil;
+            NSArray *statuses = [self statusesFromOperation:operation error:&error];
+            XGDispatchOnQueue(queue, ^{ completion(statuses, error); });
         }];
     [operation.request addValue:@"application/vnd.github.v3+json" forHTTPHeaderField:@"Accept"];
     if (self.authToken.length > 0) {
         NSString *token = [NSString stringWithFormat:@"token %@", self.authToken];
         [operation.request addValue:token forHTTPHeaderField:@"Authorization"];
     }
-    [operation start];
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    [[XGGitHubScheduler shared] startOperation:operation];
+}
+
+- (NSArray<XGGitHubPullRequestStatus*>*_Nullable) statusesFromOperation:(BNCNetworkOperation*)operation
+        error:(NSError*_Nullable __autoreleasing *_Nullable)error_ {
+    NSError*error = nil;
+    NSMutableArray<XGGitHubPullRequestStatus*>*results = nil;
 
+    {
     if (operation.error) {
         NSString *message = operation.stringFromResponseData;
         if (message.length) BNCLogError(@"From GitHub: %@.", message);
@@ -302,18 +788,34 @@ exit:
 - (NSError*_Nullable) setStatus:(XGPullRequestStatus)status
                         message:(NSString*)message
                       statusURL:(NSURL*)statusURL {
-    NSError *error = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self setStatus:status message:message statusURL:statusURL queue:nil
+        completion:^(NSError*_Nullable error) {
+            localError = error;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return localError;
+}
+
+- (void) setStatus:(XGPullRequestStatus)status
+           message:(NSString*)message
+         statusURL:(NSURL*_Nullable)statusURL
+             queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nullable)(NSError*_Nullable error))completion {
     NSString* string = [NSString stringWithFormat:
-        @"https://api.github.com/repos/%@/%@/statuses/%@",
-            self.repoOwner, self.repoName, self.sha];
+        @"%@/repos/%@/%@/statuses/%@",
+            self.class.APIURLString, self.repoOwner, self.repoName, self.sha];
     NSURL *URL = [NSURL URLWithString:string];
     if (!URL) {
-        error =
+        NSError *error =
             [NSError errorWithDomain:NSNetServicesErrorDomain code:NSURLErrorBadURL userInfo:@{
                 NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Bad URL '%@'.", URL]
             }];
         BNCLogError(@"Bad URL '%@'.", URL);
-        return error;
+        if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
+        return;
     }
 
     NSMutableDictionary *dictionary = [NSMutableDictionary new];
@@ -322,80 +824,75 @@ exit:
     if (statusURL) dictionary[@"target_url"] = statusURL;
     if (message.length) dictionary[@"description"] = message;
 
-    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
     BNCNetworkOperation *operation =
-        [[BNCNetworkService shared]
+        [[XGGitHubScheduler shared]
             postOperationWithURL:URL
             JSONData:dictionary
             completion:^(BNCNetworkOperation *operation) {
-            dispatch_semaphore_signal(semaphore);
+            NSError *error = [self.class errorFromPostOperation:operation];
+            if (error && !operation.error) {
+                BNCLogError(@"Can't access GitHub status. Is write access enabled and the token set?");
+            }
+            if (!error) self.knownStatuses = nil;
+            if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
         }];
     [operation.request addValue:@"application/vnd.github.v3+json" forHTTPHeaderField:@"Accept"];
     if (self.authToken.length > 0) {
         NSString *token = [NSString stringWithFormat:@"token %@", self.authToken];
         [operation.request addValue:token forHTTPHeaderField:@"Authorization"];
     }
-    [operation start];
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
-
-    if (operation.error) {
-        NSString *message = operation.stringFromResponseData;
-        if (message.length) BNCLogError(@"From GitHub: %@.", message);
-        return operation.error;
-    }
-    [operation deserializeJSONResponseData];
-    if (operation.error) {
-        NSString *message = operation.stringFromResponseData;
-        if (message.length) BNCLogError(@"From GitHub: %@.", message);
-        return operation.error;
-    }
-    if (operation.HTTPStatusCode != 201) {
-        error = [NSError errorWithDomain:NSNetServicesErrorDomain
-            code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
-                [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
-        BNCLogError(
-            @"Can't access GitHub status. Is write access enabled and the token set?\nResponse was: %@.",
-            [operation stringFromResponseData]
-        );
-        return error;
-    }
-    return error;
+    [[XGGitHubScheduler shared] startOperation:operation];
 }
 
 - (NSError*_Nullable) addComment:(NSString*)comment {
-    NSError *error = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self addComment:comment queue:nil completion:^(NSError*_Nullable error) {
+        localError = error;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return localError;
+}
+
+- (void) addComment:(NSString*)comment
+              queue:(dispatch_queue_t _Nullable)queue
+         completion:(void (^_Nullable)(NSError*_Nullable error))completion {
     NSString* string = [NSString stringWithFormat:
-        @"https://api.github.com/repos/%@/%@/commits/%@/comments",
-            self.repoOwner, self.repoName, self.sha];
+        @"%@/repos/%@/%@/commits/%@/comments",
+            self.class.APIURLString, self.repoOwner, self.repoName, self.sha];
     NSURL *URL = [NSURL URLWithString:string];
     if (!URL) {
-        error =
+        NSError *error =
             [NSError errorWithDomain:NSNetServicesErrorDomain code:NSURLErrorBadURL userInfo:@{
                 NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Bad URL '%@'.", URL]
             }];
         BNCLogError(@"Bad URL '%@'.", URL);
-        return error;
+        if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
+        return;
     }
 
     NSMutableDictionary *dictionary = [NSMutableDictionary new];
     dictionary[@"body"] = comment;
 
-    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
     BNCNetworkOperation *operation =
-        [[BNCNetworkService shared]
+        [[XGGitHubScheduler shared]
             postOperationWithURL:URL
             JSONData:dictionary
             completion:^(BNCNetworkOperation *operation) {
-            dispatch_semaphore_signal(semaphore);
+            NSError *error = [self.class errorFromPostOperation:operation];
+            if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
         }];
     [operation.request addValue:@"application/vnd.github.v3.raw+json" forHTTPHeaderField:@"Accept"];
     if (self.authToken.length > 0) {
         NSString *token = [NSString stringWithFormat:@"token %@", self.authToken];
         [operation.request addValue:token forHTTPHeaderField:@"Authorization"];
     }
-    [operation start];
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    [[XGGitHubScheduler shared] startOperation:operation];
+}
 
+/// Returns the error, if any, from a GitHub POST operation that is expected to create a resource.
++ (NSError*_Nullable) errorFromPostOperation:(BNCNetworkOperation*)operation {
     if (operation.error) {
         NSString *message = operation.stringFromResponseData;
         if (message.length) BNCLogError(@"From GitHub: %@.", message);
@@ -408,14 +905,13 @@ exit:
         return operation.error;
     }
     if (operation.HTTPStatusCode != 201) {
-        error = [NSError errorWithDomain:NSNetServicesErrorDomain
+        NSError *error = [NSError errorWithDomain:NSNetServicesErrorDomain
             code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
                 [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
         BNCLogError(@"Response was: %@.", [operation stringFromResponseData]);
         return error;
     }
-
-    return error;
+    return nil;
 }
 
 @end
@@ -0,0 +1,216 @@
+/**
+ @file          XGGitHubScheduler.Test.m
+ @package       xcode-github
+ @brief         Tests for XGGitHubScheduler.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGGitHubScheduler.h"
+#import "XGHTTPServer.h"
+
+@interface XGGitHubSchedulerTest : BNCTestCase
+@end
+
+@implementation XGGitHubSchedulerTest
+
+- (NSURL*) URLWithServer:(XGHTTPServer*)server path:(NSString*)path {
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d%@", server.port, path]];
+}
+
+- (void) testConcurrentRequestsAreCapped {
+    __block NSInteger inFlightCount = 0;
+    __block NSInteger maximumInFlightCount = 0;
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        @synchronized(self) {
+            inFlightCount++;
+            maximumInFlightCount = MAX(maximumInFlightCount, inFlightCount);
+        }
+        [NSThread sleepForTimeInterval:0.2];
+        @synchronized(self) {
+            inFlightCount--;
+        }
+        return [XGHTTPResponse responseWithStatusCode:200 JSONObject:@{}];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+
+    XGGitHubScheduler *scheduler = [XGGitHubScheduler new];
+    scheduler.maximumConcurrentRequests = 2;
+    dispatch_group_t group = dispatch_group_create();
+    for (int i = 0; i < 6; i++) {
+        // Different paths so that the network service doesn't coalesce them:
+        NSURL *URL = [self URLWithServer:server path:[NSString stringWithFormat:@"/read/%d", i]];
+        dispatch_group_enter(group);
+        BNCNetworkOperation *operation =
+            [scheduler getOperationWithURL:URL completion:^(BNCNetworkOperation*operation) {
+                dispatch_group_leave(group);
+            }];
+        [scheduler startOperation:operation];
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(maximumInFlightCount, 2);
+    [server stop];
+}
+
+- (void) testReadsWaitForTheRateLimitReset {
+    NSTimeInterval resetTime = ceil([NSDate date].timeIntervalSince1970) + 2.0;
+    NSMutableDictionary<NSString*, NSDate*>*requestDates = [NSMutableDictionary new];
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        @synchronized(requestDates) {
+            requestDates[request.path] = [NSDate date];
+        }
+        XGHTTPResponse *response = [XGHTTPResponse responseWithStatusCode:200 JSONObject:@{}];
+        if ([request.path isEqualToString:@"/first"]) {
+            // Fewer requests left than the scheduler reserves for writes:
+            response.headers = @{
+                @"X-RateLimit-Limit":       @"5000",
+                @"X-RateLimit-Remaining":   @"10",
+                @"X-RateLimit-Reset":       [NSString stringWithFormat:@"%.0f", resetTime],
+            };
+        }
+        return response;
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+
+    XGGitHubScheduler *scheduler = [XGGitHubScheduler new];
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    BNCNetworkOperation *operation =
+        [scheduler getOperationWithURL:[self URLWithServer:server path:@"/first"]
+            completion:^(BNCNetworkOperation*operation) {
+                dispatch_semaphore_signal(semaphore);
+            }];
+    [scheduler startOperation:operation];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(scheduler.rateLimitRemaining, 10);
+    XCTAssertEqual(scheduler.rateLimit, 5000);
+    XCTAssertEqualWithAccuracy(scheduler.rateLimitResetDate.timeIntervalSince1970, resetTime, 0.001);
+
+    // The read waits for the reset, but the write can still spend the reserved budget:
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_enter(group);
+    operation =
+        [scheduler getOperationWithURL:[self URLWithServer:server path:@"/read"]
+            completion:^(BNCNetworkOperation*operation) {
+                dispatch_group_leave(group);
+            }];
+    [scheduler startOperation:operation];
+    dispatch_group_enter(group);
+    operation =
+        [scheduler postOperationWithURL:[self URLWithServer:server path:@"/write"]
+            JSONData:@{ @"state": @"success" }
+            completion:^(BNCNetworkOperation*operation) {
+                dispatch_group_leave(group);
+            }];
+    [scheduler startOperation:operation];
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+
+    @synchronized(requestDates) {
+        XCTAssertLessThan(requestDates[@"/write"].timeIntervalSince1970, resetTime);
+        XCTAssertGreaterThanOrEqual(requestDates[@"/read"].timeIntervalSince1970, resetTime - 0.1);
+    }
+    [server stop];
+}
+
+- (void) testGraphQLBudgetIsSeparate {
+    NSTimeInterval resetTime = ceil([NSDate date].timeIntervalSince1970) + 30.0;
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        XGHTTPResponse *response = [XGHTTPResponse responseWithStatusCode:200 JSONObject:@{}];
+        if ([request.path isEqualToString:@"/graphql"]) {
+            // The GraphQL budget is almost spent:
+            response.headers = @{
+                @"X-RateLimit-Limit":       @"5000",
+                @"X-RateLimit-Remaining":   @"1",
+                @"X-RateLimit-Reset":       [NSString stringWithFormat:@"%.0f", resetTime],
+                @"X-RateLimit-Resource":    @"graphql",
+            };
+        } else {
+            response.headers = @{
+                @"X-RateLimit-Limit":       @"5000",
+                @"X-RateLimit-Remaining":   @"4000",
+                @"X-RateLimit-Reset":       [NSString stringWithFormat:@"%.0f", resetTime],
+                @"X-RateLimit-Resource":    @"core",
+            };
+        }
+        return response;
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+
+    XGGitHubScheduler *scheduler = [XGGitHubScheduler new];
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    BNCNetworkOperation *operation =
+        [scheduler getOperationWithURL:[self URLWithServer:server path:@"/first"]
+            completion:^(BNCNetworkOperation*operation) {
+                dispatch_semaphore_signal(semaphore);
+            }];
+    [scheduler startOperation:operation];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(scheduler.rateLimitRemaining, 4000);
+
+    operation =
+        [scheduler getOperationWithURL:[self URLWithServer:server path:@"/graphql"]
+            completion:^(BNCNetworkOperation*operation) {
+                dispatch_semaphore_signal(semaphore);
+            }];
+    [scheduler startOperation:operation];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+
+    // The GraphQL response doesn't change the REST budget, so REST reads don't wait for the reset:
+    XCTAssertEqual(scheduler.rateLimitRemaining, 4000);
+    operation =
+        [scheduler getOperationWithURL:[self URLWithServer:server path:@"/read"]
+            completion:^(BNCNetworkOperation*operation) {
+                dispatch_semaphore_signal(semaphore);
+            }];
+    [scheduler startOperation:operation];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    [server stop];
+}
+
+- (void) testSecondaryRateLimitBacksOff {
+    __block NSInteger requestCount = 0;
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        NSInteger count = 0;
+        @synchronized(self) {
+            count = ++requestCount;
+        }
+        if (count == 1) {
+            XGHTTPResponse *response =
+                [XGHTTPResponse responseWithStatusCode:403 JSONObject:@{
+                    @"message": @"You have exceeded a secondary rate limit."
+                }];
+            response.headers = @{ @"Retry-After": @"1" };
+            return response;
+        }
+        return [XGHTTPResponse responseWithStatusCode:201 JSONObject:@{}];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+
+    // The limited write is retried once the `Retry-After` time has passed, and only the
+    // final response is passed on:
+    XGGitHubScheduler *scheduler = [XGGitHubScheduler new];
+    __block NSInteger completionCount = 0;
+    __block NSInteger statusCode = 0;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    NSDate *startDate = [NSDate date];
+    BNCNetworkOperation *operation =
+        [scheduler postOperationWithURL:[self URLWithServer:server path:@"/statuses"]
+            JSONData:@{ @"state": @"pending" }
+            completion:^(BNCNetworkOperation*operation) {
+                completionCount++;
+                statusCode = operation.HTTPStatusCode;
+                dispatch_semaphore_signal(semaphore);
+            }];
+    [scheduler startOperation:operation];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+
+    XCTAssertEqual(completionCount, 1);
+    XCTAssertEqual(statusCode, 201);
+    XCTAssertEqual(requestCount, 2);
+    XCTAssertGreaterThanOrEqual([[NSDate date] timeIntervalSinceDate:startDate], 0.9);
+    [server stop];
+}
+
+@end
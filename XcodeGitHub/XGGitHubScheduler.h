@@ -0,0 +1,72 @@
+/**
+ @file          XGGitHubScheduler.h
+ @package       xcode-github
+ @brief         Schedules GitHub requests to fit within the GitHub rate limits.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+#import "BNCNetworkService.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, XGGitHubRequestPriority) {
+    XGGitHubRequestPriorityRead = 0,    // Reads. These wait when the budget runs low.
+    XGGitHubRequestPriorityWrite,       // Content-creating writes. These go first, one at a time, paced.
+};
+
+/**
+ The GitHub scheduler runs GitHub requests so that they fit within the GitHub rate limits.
+
+ It reads the `X-RateLimit-Remaining`, `X-RateLimit-Reset`, and `Retry-After` headers from each
+ response. GitHub keeps a separate budget for each `X-RateLimit-Resource`, like `core` for the REST
+ API and `graphql` for GraphQL queries, and so does the scheduler. Writes, like setting a PR status or adding a comment, run before reads. Writes run one
+ at a time with a pause between them to avoid GitHub's secondary rate limits. When the remaining
+ budget runs low, reads wait until the rate limit resets. A request that hits the rate limit is
+ retried once after the limit resets.
+*/
+@interface XGGitHubScheduler : NSObject
+
++ (XGGitHubScheduler*) shared;
+
+/// Creates a GitHub operation that is started with `startOperation:`.
+- (BNCNetworkOperation*) getOperationWithURL:(NSURL*)URL
+                                  completion:(void (^)(BNCNetworkOperation*operation))completion;
+
+/// Creates a GitHub operation that is started with `startOperation:`.
+- (BNCNetworkOperation*) postOperationWithURL:(NSURL*)URL
+                                     JSONData:(id)dictionaryOrArray
+                                   completion:(void (^)(BNCNetworkOperation*operation))completion;
+
+/// Starts the operation when the rate limits allow. POSTs are writes and other methods are reads.
+- (void) startOperation:(BNCNetworkOperation*)operation;
+- (void) startOperation:(BNCNetworkOperation*)operation priority:(XGGitHubRequestPriority)priority;
+
+/**
+ Returns how long to wait between polling cycles so that the current rate of GitHub requests lasts
+ until the rate limit resets.
+
+ @param minimumInterval The shortest interval to return.
+ @return The recommended polling interval in seconds.
+*/
+- (NSTimeInterval) recommendedPollIntervalWithMinimum:(NSTimeInterval)minimumInterval;
+
+/// The number of REST (`core`) requests left in the current rate limit window, or -1 if unknown.
+@property (assign, readonly) NSInteger rateLimitRemaining;
+/// The REST (`core`) request limit for a rate limit window, or -1 if unknown.
+@property (assign, readonly) NSInteger rateLimit;
+/// The time that the current REST (`core`) rate limit window resets.
+@property (strong, readonly) NSDate*_Nullable rateLimitResetDate;
+
+/// The number of requests that can run at the same time. The default is 4.
+@property (assign) NSInteger maximumConcurrentRequests;
+/// The shortest time between content-creating writes. The default is one second.
+@property (assign) NSTimeInterval writeInterval;
+/// Reads wait for the rate limit to reset when fewer than this many requests remain. The default is 50.
+@property (assign) NSInteger reservedWriteBudget;
+@end
+
+NS_ASSUME_NONNULL_END
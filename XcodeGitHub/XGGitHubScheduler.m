@@ -0,0 +1,328 @@
+/**
+ @file          XGGitHubScheduler.m
+ @package       xcode-github
+ @brief         Schedules GitHub requests to fit within the GitHub rate limits.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGGitHubScheduler.h"
+#import "XGUtility.h"
+#import "BNCLog.h"
+
+#pragma mark XGGitHubScheduledRequest
+
+@interface XGGitHubScheduledRequest : NSObject
+@property (strong) BNCNetworkOperation*operation;
+@property (assign) XGGitHubRequestPriority priority;
+@property (assign) NSInteger retryCount;
+@property (strong) NSString*resource;       // The rate limit resource that the request counts against.
+@end
+
+@implementation XGGitHubScheduledRequest
+@end
+
+#pragma mark - XGGitHubRateLimitBudget
+
+/// The rate limit of one GitHub resource, like 'core' for the REST API or 'graphql'.
+@interface XGGitHubRateLimitBudget : NSObject
+@property (assign) NSInteger remaining;     // -1 if unknown.
+@property (assign) NSInteger limit;         // -1 if unknown.
+@property (strong) NSDate*_Nullable resetDate;
+@property (assign) NSInteger inFlightCount;
+@property (strong) NSDate*_Nullable windowStartDate;
+@property (assign) NSInteger windowRequestCount;
+@end
+
+@implementation XGGitHubRateLimitBudget
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _remaining = -1;
+    _limit = -1;
+    return self;
+}
+
+@end
+
+#pragma mark - XGGitHubScheduler
+
+@interface XGGitHubScheduler () {
+    // All state is guarded by _queue:
+    dispatch_queue_t _queue;
+    NSMutableArray<XGGitHubScheduledRequest*>*_writes;
+    NSMutableArray<XGGitHubScheduledRequest*>*_reads;
+    NSMapTable<BNCNetworkOperation*, XGGitHubScheduledRequest*>*_running;
+    NSInteger _inFlightCount;
+    BOOL _writeInFlight;
+    NSDate*_lastWriteDate;
+    NSDate*_pausedUntilDate;
+    NSDate*_pumpDate;
+    NSMutableDictionary<NSString*, XGGitHubRateLimitBudget*>*_budgets; // Keyed by resource.
+}
+@property (assign) NSInteger rateLimitRemaining;
+@property (assign) NSInteger rateLimit;
+@property (strong) NSDate*_Nullable rateLimitResetDate;
+@end
+
+@implementation XGGitHubScheduler
+
++ (XGGitHubScheduler*) shared {
+    static XGGitHubScheduler* sharedInstance = nil;
+    static dispatch_once_t onceToken = 0;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[self alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _queue = dispatch_queue_create("io.branch.xcode-github.scheduler", DISPATCH_QUEUE_SERIAL);
+    _writes = [NSMutableArray new];
+    _reads = [NSMutableArray new];
+    _running = [NSMapTable strongToStrongObjectsMapTable];
+    _budgets = [NSMutableDictionary new];
+    _rateLimitRemaining = -1;
+    _rateLimit = -1;
+    _maximumConcurrentRequests = 4;
+    _writeInterval = 1.0;
+    _reservedWriteBudget = 50;
+    return self;
+}
+
+#pragma mark - Operations
+
+- (BNCNetworkOperation*) getOperationWithURL:(NSURL*)URL
+                                  completion:(void (^)(BNCNetworkOperation*operation))completion {
+    return [[BNCNetworkService shared]
+        getOperationWithURL:URL
+        completion:[self completionBlockWithCompletion:completion]];
+}
+
+- (BNCNetworkOperation*) postOperationWithURL:(NSURL*)URL
+                                     JSONData:(id)dictionaryOrArray
+                                   completion:(void (^)(BNCNetworkOperation*operation))completion {
+    return [[BNCNetworkService shared]
+        postOperationWithURL:URL
+        JSONData:dictionaryOrArray
+        completion:[self completionBlockWithCompletion:completion]];
+}
+
+- (void (^)(BNCNetworkOperation*)) completionBlockWithCompletion:(void (^)(BNCNetworkOperation*))completion {
+    return ^ (BNCNetworkOperation*operation) {
+        __block BOOL willRetry = NO;
+        dispatch_sync(self->_queue, ^{
+            willRetry = [self finishOperation:operation];
+        });
+        if (!willRetry && completion) completion(operation);
+    };
+}
+
+- (void) startOperation:(BNCNetworkOperation*)operation {
+    XGGitHubRequestPriority priority =
+        ([operation.request.HTTPMethod isEqualToString:@"POST"])
+        ? XGGitHubRequestPriorityWrite
+        : XGGitHubRequestPriorityRead;
+    [self startOperation:operation priority:priority];
+}
+
+- (void) startOperation:(BNCNetworkOperation*)operation priority:(XGGitHubRequestPriority)priority {
+    XGGitHubScheduledRequest *request = [XGGitHubScheduledRequest new];
+    request.operation = operation;
+    request.priority = priority;
+    request.resource = [self.class resourceForURL:operation.request.URL];
+    dispatch_async(_queue, ^{
+        if (priority == XGGitHubRequestPriorityWrite)
+            [self->_writes addObject:request];
+        else
+            [self->_reads addObject:request];
+        [self pump];
+    });
+}
+
+#pragma mark - Scheduling
+
+/// GitHub counts GraphQL queries against their own 'graphql' budget and other requests against 'core'.
++ (NSString*) resourceForURL:(NSURL*)URL {
+    return ([URL.path hasSuffix:@"/graphql"]) ? @"graphql" : @"core";
+}
+
+- (XGGitHubRateLimitBudget*) budgetForResource:(NSString*)resource {
+    XGGitHubRateLimitBudget *budget = _budgets[resource];
+    if (!budget) {
+        budget = [XGGitHubRateLimitBudget new];
+        _budgets[resource] = budget;
+    }
+    return budget;
+}
+
+- (NSDate*_Nullable) budgetWaitDateForRequest:(XGGitHubScheduledRequest*)request now:(NSDate*)now {
+    if (_pausedUntilDate && [_pausedUntilDate compare:now] == NSOrderedDescending)
+        return _pausedUntilDate;
+    XGGitHubRateLimitBudget *budget = [self budgetForResource:request.resource];
+    if (budget.remaining < 0 || !budget.resetDate || [budget.resetDate compare:now] != NSOrderedDescending)
+        return nil;
+    NSInteger reserve = (request.priority == XGGitHubRequestPriorityWrite) ? 0 : self.reservedWriteBudget;
+    return (budget.remaining - budget.inFlightCount <= reserve) ? budget.resetDate : nil;
+}
+
+- (void) pump {
+    NSDate *now = [NSDate date];
+    NSDate *wakeDate = nil;
+    while (_inFlightCount < MAX(1, self.maximumConcurrentRequests)) {
+        XGGitHubScheduledRequest *request = nil;
+        NSDate *waitDate = nil;
+
+        // Writes first, one at a time and paced:
+        if (_writes.count && !_writeInFlight) {
+            XGGitHubScheduledRequest *write = _writes.firstObject;
+            NSDate *pacedDate = [_lastWriteDate dateByAddingTimeInterval:self.writeInterval];
+            waitDate = [self budgetWaitDateForRequest:write now:now];
+            if (!waitDate && pacedDate && [pacedDate compare:now] == NSOrderedDescending)
+                waitDate = pacedDate;
+            if (waitDate) {
+                wakeDate = (wakeDate) ? [wakeDate earlierDate:waitDate] : waitDate;
+            } else {
+                request = write;
+                [_writes removeObjectAtIndex:0];
+                _writeInFlight = YES;
+                _lastWriteDate = now;
+            }
+        }
+
+        if (!request && _reads.count) {
+            XGGitHubScheduledRequest *read = _reads.firstObject;
+            waitDate = [self budgetWaitDateForRequest:read now:now];
+            if (waitDate) {
+                wakeDate = (wakeDate) ? [wakeDate earlierDate:waitDate] : waitDate;
+            } else {
+                request = read;
+                [_reads removeObjectAtIndex:0];
+            }
+        }
+
+        if (!request) break;
+        XGGitHubRateLimitBudget *budget = [self budgetForResource:request.resource];
+        _inFlightCount++;
+        budget.inFlightCount++;
+        budget.windowRequestCount++;
+        [_running setObject:request forKey:request.operation];
+        [request.operation start];
+    }
+
+    if (wakeDate) [self pumpAtDate:wakeDate];
+}
+
+- (void) pumpAtDate:(NSDate*)date {
+    // Only keep the earliest wake up:
+    if (_pumpDate && [_pumpDate compare:date] != NSOrderedDescending) return;
+    _pumpDate = date;
+    BNCLogDebug(@"GitHub requests are waiting until %@.", date);
+    NSTimeInterval delay = MAX(0.0, date.timeIntervalSinceNow);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), _queue, ^{
+        self->_pumpDate = nil;
+        [self pump];
+    });
+}
+
+/// Updates the budget from the response. Returns YES if the request is retried.
+- (BOOL) finishOperation:(BNCNetworkOperation*)operation {
+    XGGitHubScheduledRequest *request = [_running objectForKey:operation];
+    if (!request) return NO; // Started outside the scheduler.
+    [_running removeObjectForKey:operation];
+    _inFlightCount--;
+    [self budgetForResource:request.resource].inFlightCount--;
+    if (request.priority == XGGitHubRequestPriorityWrite) _writeInFlight = NO;
+
+    NSDictionary *headers = operation.response.allHeaderFields;
+    NSString *remaining = headers[@"X-RateLimit-Remaining"];
+    NSString *limit = headers[@"X-RateLimit-Limit"];
+    NSString *reset = headers[@"X-RateLimit-Reset"];
+    NSString *resource = headers[@"X-RateLimit-Resource"];
+    NSString *retryAfter = headers[@"Retry-After"];
+
+    // Each resource has its own budget, so a GraphQL response doesn't change the REST budget:
+    if (resource.length == 0) resource = request.resource;
+    XGGitHubRateLimitBudget *budget = [self budgetForResource:resource];
+    if (reset) {
+        NSDate *resetDate = [NSDate dateWithTimeIntervalSince1970:reset.doubleValue];
+        if (!budget.resetDate || fabs([resetDate timeIntervalSinceDate:budget.resetDate]) > 1.0) {
+            // A new rate limit window:
+            budget.windowStartDate = operation.dateStart ?: [NSDate date];
+            budget.windowRequestCount = 1;
+        }
+        budget.resetDate = resetDate;
+    }
+    if (limit) budget.limit = limit.integerValue;
+    if (remaining) {
+        budget.remaining = remaining.integerValue;
+        BNCLogDebug(@"GitHub '%@' rate limit: %ld of %ld requests remaining, resets in %@.",
+            resource,
+            (long) budget.remaining,
+            (long) budget.limit,
+            XGDurationStringFromTimeInterval(budget.resetDate.timeIntervalSinceNow));
+    }
+    if ([resource isEqualToString:@"core"]) {
+        self.rateLimitRemaining = budget.remaining;
+        self.rateLimit = budget.limit;
+        self.rateLimitResetDate = budget.resetDate;
+    }
+
+    // A secondary rate limit pauses every request. An exhausted budget only holds up the requests
+    // of its resource until it resets:
+    BOOL isRateLimited =
+        (operation.HTTPStatusCode == 403 || operation.HTTPStatusCode == 429) &&
+        (retryAfter != nil || (remaining && remaining.integerValue == 0));
+    if (isRateLimited && retryAfter) {
+        NSDate *pauseDate = [NSDate dateWithTimeIntervalSinceNow:retryAfter.doubleValue];
+        if (!_pausedUntilDate || [pauseDate compare:_pausedUntilDate] == NSOrderedDescending)
+            _pausedUntilDate = pauseDate;
+        BNCLogWarning(@"GitHub secondary rate limit reached. Waiting until %@.", _pausedUntilDate);
+    } else if (isRateLimited) {
+        BNCLogWarning(@"GitHub '%@' rate limit reached. Waiting until %@.", resource, budget.resetDate);
+    }
+
+    BOOL willRetry = NO;
+    if (isRateLimited && request.retryCount == 0) {
+        request.retryCount++;
+        if (request.priority == XGGitHubRequestPriorityWrite)
+            [_writes insertObject:request atIndex:0];
+        else
+            [_reads insertObject:request atIndex:0];
+        willRetry = YES;
+    }
+    dispatch_async(_queue, ^{ [self pump]; });
+    return willRetry;
+}
+
+- (NSTimeInterval) recommendedPollIntervalWithMinimum:(NSTimeInterval)minimumInterval {
+    __block NSTimeInterval interval = minimumInterval;
+    dispatch_sync(_queue, ^{
+        NSDate *now = [NSDate date];
+        if (self->_pausedUntilDate)
+            interval = MAX(interval, [self->_pausedUntilDate timeIntervalSinceDate:now]);
+
+        // The interval has to suit the busiest budget:
+        for (XGGitHubRateLimitBudget *budget in self->_budgets.objectEnumerator) {
+            NSTimeInterval untilReset = [budget.resetDate timeIntervalSinceDate:now];
+            NSTimeInterval elapsed = [now timeIntervalSinceDate:budget.windowStartDate];
+            if (budget.remaining < 0 || untilReset <= 0.0 || elapsed <= 0.0 || !budget.windowStartDate)
+                continue;
+
+            // If requests keep coming at the current rate, will the budget last until the reset?
+            double rate = (double) budget.windowRequestCount / MAX(elapsed, minimumInterval);
+            double projected = rate * untilReset;
+            double available = MAX(1.0, (double) (budget.remaining - self.reservedWriteBudget));
+            if (projected > available)
+                interval = MAX(interval, MIN(minimumInterval * projected / available, untilReset));
+        }
+    });
+    return interval;
+}
+
+@end
@@ -0,0 +1,84 @@
+/**
+ @file          XGHTTPServer.h
+ @package       xcode-github
+ @brief         A small HTTP server for local endpoints and test stand-ins.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+#pragma mark XGHTTPRequest
+
+@interface XGHTTPRequest : NSObject
+@property (strong, readonly) NSString*method;
+@property (strong, readonly) NSString*path;                         // Includes the query string.
+@property (strong, readonly) NSDictionary<NSString*, NSString*>*headers; // Keys are lowercase.
+@property (strong, readonly) NSData*body;
+@end
+
+#pragma mark - XGHTTPResponse
+
+@interface XGHTTPResponse : NSObject
+@property (assign) NSInteger statusCode;
+@property (strong) NSDictionary<NSString*, NSString*>*_Nullable headers;
+@property (strong) NSData*_Nullable body;
+
++ (instancetype) responseWithStatusCode:(NSInteger)statusCode;
++ (instancetype) responseWithStatusCode:(NSInteger)statusCode JSONObject:(id _Nullable)object;
+@end
+
+#pragma mark - XGHTTPServer
+
+typedef XGHTTPResponse*_Nonnull (^XGHTTPRequestHandler)(XGHTTPRequest*request);
+typedef XGHTTPResponse*_Nullable (^XGHTTPHeaderHandler)(XGHTTPRequest*request);
+
+/**
+ A small HTTP/1.1 server. Each connection handles a single request and is then closed. The
+ handler is called on a background queue and may be called for several requests at once.
+
+ It's meant for low volume local traffic, like webhooks and test stand-ins, not for the open
+ internet. A server that other hosts can reach should sit behind a reverse proxy that terminates
+ TLS and limits clients.
+*/
+@interface XGHTTPServer : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
++ (instancetype) new NS_UNAVAILABLE;
+- (instancetype) initWithHandler:(XGHTTPRequestHandler)handler NS_DESIGNATED_INITIALIZER;
+
+/**
+ Starts listening for connections.
+
+ @param port        The TCP port. Zero picks any free port.
+ @param localOnly   If YES only connections from this host are accepted.
+ @return Returns an error if the server can't listen on the port.
+*/
+- (NSError*_Nullable) startWithPort:(uint16_t)port localOnly:(BOOL)localOnly;
+- (void) stop;
+
+/// The port the server is listening on, or zero if it isn't running.
+@property (assign, readonly) uint16_t port;
+
+/// The largest request body that is accepted. Larger requests are refused with a 413. The default is 10 MB.
+@property (assign) NSUInteger maximumBodyLength;
+
+/// The most connections that are handled at once. Others are refused with a 503. The default is 16.
+@property (assign) NSInteger maximumConnectionCount;
+
+/// The longest time that reading a request may take. The default is 10 seconds.
+@property (assign) NSTimeInterval requestTimeout;
+
+/**
+ Called with each request after its headers are read but before its body is read. The request
+ has no body yet. If the handler returns a response the request is refused with it and the body
+ isn't read.
+*/
+@property (copy) XGHTTPHeaderHandler _Nullable headerHandler;
+@end
+
+NS_ASSUME_NONNULL_END
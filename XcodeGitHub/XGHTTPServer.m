@@ -0,0 +1,299 @@
+/**
+ @file          XGHTTPServer.m
+ @package       xcode-github
+ @brief         A small HTTP server for local endpoints and test stand-ins.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGHTTPServer.h"
+#import "BNCLog.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#pragma mark XGHTTPRequest
+
+@interface XGHTTPRequest ()
+@property (strong) NSString*method;
+@property (strong) NSString*path;
+@property (strong) NSDictionary<NSString*, NSString*>*headers;
+@property (strong) NSData*body;
+@end
+
+@implementation XGHTTPRequest
+
+- (NSString*) description {
+    return [NSString stringWithFormat:@"<%@ %p %@ %@>",
+        NSStringFromClass(self.class), (void*) self, self.method, self.path];
+}
+
+@end
+
+#pragma mark - XGHTTPResponse
+
+@implementation XGHTTPResponse
+
++ (instancetype) responseWithStatusCode:(NSInteger)statusCode {
+    XGHTTPResponse *response = [[self alloc] init];
+    response.statusCode = statusCode;
+    return response;
+}
+
++ (instancetype) responseWithStatusCode:(NSInteger)statusCode JSONObject:(id)object {
+    XGHTTPResponse *response = [self responseWithStatusCode:statusCode];
+    if (object) {
+        NSError *error = nil;
+        response.body = [NSJSONSerialization dataWithJSONObject:object options:0 error:&error];
+        if (error) BNCLogError(@"Can't convert to JSON: %@.", error);
+    }
+    response.headers = @{ @"Content-Type": @"application/json" };
+    return response;
+}
+
+@end
+
+#pragma mark - XGHTTPServer
+
+@interface XGHTTPServer () {
+    XGHTTPRequestHandler _handler;
+    dispatch_queue_t _queue;
+    dispatch_source_t _listenSource;
+    NSInteger _connectionCount;
+}
+@property (assign) uint16_t port;
+@end
+
+@implementation XGHTTPServer
+
+- (instancetype) initWithHandler:(XGHTTPRequestHandler)handler {
+    self = [super init];
+    if (!self) return self;
+    _handler = [handler copy];
+    _queue = dispatch_queue_create("io.branch.xcode-github.http-server", DISPATCH_QUEUE_SERIAL);
+    _maximumBodyLength = 10*1024*1024;
+    _maximumConnectionCount = 16;
+    _requestTimeout = 10.0;
+    return self;
+}
+
+- (void) dealloc {
+    [self stop];
+}
+
+- (NSError*) startWithPort:(uint16_t)port localOnly:(BOOL)localOnly {
+    NSError *error = nil;
+    int listenSocket = -1;
+
+    {
+        if (self.port) {
+            error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EALREADY userInfo:nil];
+            goto exit;
+        }
+
+        listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenSocket < 0) {
+            error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            goto exit;
+        }
+        int yes = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        setsockopt(listenSocket, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+
+        struct sockaddr_in address = {0};
+        address.sin_len = sizeof(address);
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl((localOnly) ? INADDR_LOOPBACK : INADDR_ANY);
+        if (bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+            listen(listenSocket, 16) != 0) {
+            error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            goto exit;
+        }
+
+        socklen_t length = sizeof(address);
+        if (getsockname(listenSocket, (struct sockaddr*) &address, &length) != 0) {
+            error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            goto exit;
+        }
+
+        dispatch_source_t listenSource =
+            dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listenSocket, 0, _queue);
+        __weak __typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(listenSource, ^{
+            int connection = accept(listenSocket, NULL, NULL);
+            if (connection < 0) return;
+            __strong __typeof(weakSelf) strongSelf = weakSelf;
+            if (!strongSelf) {
+                close(connection);
+                return;
+            }
+            // Each connection holds a thread while it's read, so slow clients can only hold a few:
+            @synchronized(strongSelf) {
+                if (strongSelf->_connectionCount >= MAX(1, strongSelf.maximumConnectionCount)) {
+                    BNCLogWarning(@"Too many HTTP connections. Refusing a connection.");
+                    [strongSelf writeResponse:[XGHTTPResponse responseWithStatusCode:503] toConnection:connection];
+                    close(connection);
+                    return;
+                }
+                strongSelf->_connectionCount++;
+            }
+            dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+                [strongSelf handleConnection:connection];
+                @synchronized(strongSelf) {
+                    strongSelf->_connectionCount--;
+                }
+            });
+        });
+        dispatch_source_set_cancel_handler(listenSource, ^{
+            close(listenSocket);
+        });
+        @synchronized(self) {
+            _listenSource = listenSource;
+            self.port = ntohs(address.sin_port);
+        }
+        dispatch_resume(listenSource);
+        BNCLogDebug(@"HTTP server listening on port %d.", (int) self.port);
+    }
+
+exit:
+    if (error) {
+        BNCLogError(@"Can't start the HTTP server on port %d: %@.", (int) port, error);
+        if (listenSocket >= 0) close(listenSocket);
+    }
+    return error;
+}
+
+- (void) stop {
+    @synchronized(self) {
+        if (_listenSource) dispatch_source_cancel(_listenSource);
+        _listenSource = nil;
+        self.port = 0;
+    }
+}
+
+#pragma mark - Connections
+
+- (void) handleConnection:(int)connection {
+    int yes = 1;
+    setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+
+    XGHTTPResponse *response = nil;
+    XGHTTPRequest *request = [self readRequestFromConnection:connection response:&response];
+    if (request) {
+        response = _handler(request);
+        BNCLogDebug(@"HTTP %@ %@: %ld.", request.method, request.path, (long) response.statusCode);
+    } else
+    if (!response) {
+        response = [XGHTTPResponse responseWithStatusCode:400];
+    }
+    [self writeResponse:response toConnection:connection];
+    close(connection);
+}
+
+/// Returns the request, or nil and maybe a refusal in `response` if the request can't be read.
+- (XGHTTPRequest*) readRequestFromConnection:(int)connection
+                                    response:(XGHTTPResponse*__autoreleasing*)response {
+    NSMutableData *data = [NSMutableData new];
+    NSData *headerEnd = [@"\r\n\r\n" dataUsingEncoding:NSUTF8StringEncoding];
+    NSRange headerRange = NSMakeRange(NSNotFound, 0);
+    XGHTTPRequest *request = nil;
+    NSUInteger contentLength = 0;
+    char buffer[16*1024];
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:self.requestTimeout];
+
+    while (YES) {
+        if (headerRange.location == NSNotFound) {
+            headerRange = [data rangeOfData:headerEnd options:0 range:NSMakeRange(0, data.length)];
+            if (headerRange.location != NSNotFound) {
+                NSData *headerData = [data subdataWithRange:NSMakeRange(0, headerRange.location)];
+                request = [self.class requestWithHeaderData:headerData];
+                if (!request) return nil;
+                contentLength = (NSUInteger) MAX(0, [request.headers[@"content-length"] integerValue]);
+                if (contentLength > self.maximumBodyLength) {
+                    *response = [XGHTTPResponse responseWithStatusCode:413];
+                    return nil;
+                }
+                XGHTTPHeaderHandler headerHandler = self.headerHandler;
+                if (headerHandler) {
+                    *response = headerHandler(request);
+                    if (*response) return nil;
+                }
+            } else
+            if (data.length > 64*1024) {
+                return nil;
+            }
+        }
+        if (request && data.length >= NSMaxRange(headerRange) + contentLength) break;
+
+        // A client that trickles its request in doesn't get to keep the connection:
+        NSTimeInterval remaining = deadline.timeIntervalSinceNow;
+        if (remaining <= 0.0) {
+            *response = [XGHTTPResponse responseWithStatusCode:408];
+            return nil;
+        }
+        struct timeval timeout = {
+            .tv_sec = (time_t) remaining,
+            .tv_usec = (suseconds_t) ((remaining - floor(remaining)) * 1000000.0)
+        };
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ssize_t bytesRead = read(connection, buffer, sizeof(buffer));
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            *response = [XGHTTPResponse responseWithStatusCode:408];
+        if (bytesRead <= 0) return nil;
+        [data appendBytes:buffer length:bytesRead];
+    }
+
+    request.body = [data subdataWithRange:NSMakeRange(NSMaxRange(headerRange), contentLength)];
+    return request;
+}
+
++ (XGHTTPRequest*) requestWithHeaderData:(NSData*)headerData {
+    NSString *string = [[NSString alloc] initWithData:headerData encoding:NSUTF8StringEncoding];
+    NSArray<NSString*>*lines = [string componentsSeparatedByString:@"\r\n"];
+    NSArray<NSString*>*requestLine = [lines.firstObject componentsSeparatedByString:@" "];
+    if (requestLine.count != 3) return nil;
+
+    NSMutableDictionary *headers = [NSMutableDictionary new];
+    for (NSInteger i = 1; i < lines.count; i++) {
+        NSRange colon = [lines[i] rangeOfString:@":"];
+        if (colon.location == NSNotFound) continue;
+        NSString *name = [[lines[i] substringToIndex:colon.location] lowercaseString];
+        NSString *value = [[lines[i] substringFromIndex:colon.location + 1]
+            stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        headers[name] = value;
+    }
+
+    XGHTTPRequest *request = [XGHTTPRequest new];
+    request.method = requestLine[0];
+    request.path = requestLine[1];
+    request.headers = headers;
+    return request;
+}
+
+- (void) writeResponse:(XGHTTPResponse*)response toConnection:(int)connection {
+    NSString *reason = [NSHTTPURLResponse localizedStringForStatusCode:response.statusCode];
+    NSMutableString *header =
+        [NSMutableString stringWithFormat:@"HTTP/1.1 %ld %@\r\n", (long) response.statusCode, reason];
+    for (NSString *name in response.headers) {
+        [header appendFormat:@"%@: %@\r\n", name, response.headers[name]];
+    }
+    [header appendFormat:@"Content-Length: %ld\r\n", (long) response.body.length];
+    [header appendString:@"Connection: close\r\n\r\n"];
+
+    NSMutableData *data = [[header dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    if (response.body) [data appendData:response.body];
+
+    const uint8_t *bytes = data.bytes;
+    NSUInteger written = 0;
+    while (written < data.length) {
+        ssize_t count = write(connection, bytes + written, data.length - written);
+        if (count <= 0) break;
+        written += count;
+    }
+}
+
+@end
@@ -0,0 +1,177 @@
+/**
+ @file          XGJSONScanner.Test.m
+ @package       xcode-github
+ @brief         Tests for XGJSONScanner.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGJSONScanner.h"
+#import "XGXcodeBot.h"
+
+@interface XGXcodeBot (Test)
+- (instancetype) initWithServerName:(NSString*)serverName
+                            scanner:(XGJSONScanner*)scanner
+                              range:(NSRange)range
+                              error:(NSError*__autoreleasing _Nullable*_Nullable)error;
+@end
+
+@interface XGJSONScannerTest : BNCTestCase
+@end
+
+@implementation XGJSONScannerTest
+
+/// A bot with a full configuration, like the ones returned by /api/bots.
++ (NSDictionary*) botWithIndex:(NSInteger)index {
+    NSMutableArray *triggers = [NSMutableArray new];
+    for (NSInteger i = 0; i < 20; i++) {
+        [triggers addObject:@{
+            @"name": [NSString stringWithFormat:@"Trigger %ld", (long) i],
+            @"type": @1,
+            @"phase": @2,
+            @"scriptBody": [@"" stringByPaddingToLength:2000 withString:@"echo \"[ok]\" {}\n" startingAtIndex:0],
+        }];
+    }
+    return @{
+        @"_id": [NSString stringWithFormat:@"bot-%ld", (long) index],
+        @"_rev": @"12-abc",
+        @"name": [NSString stringWithFormat:@"xcode-github PR#%ld Title \"%ld\"", (long) index, (long) index],
+        @"templateBotName": @"Template Bot",
+        @"pullRequestNumber": [NSString stringWithFormat:@"%ld", (long) index],
+        @"pullRequestTitle": [NSString stringWithFormat:@"Title \"%ld\"", (long) index],
+        @"integration_counter": @(index),
+        @"configuration": @{
+            @"schemeName": @"Scheme",
+            @"scheduleType": @2,
+            @"triggers": triggers,
+            @"sourceControlBlueprint": @{
+                @"DVTSourceControlWorkspaceBlueprintRemoteRepositoriesKey": @[ @{
+                    @"DVTSourceControlWorkspaceBlueprintRemoteRepositoryURLKey":
+                        @"git@github.com:owner/repo.git",
+                }],
+                @"DVTSourceControlWorkspaceBlueprintLocationsKey": @{
+                    @"ABCDEF": @{
+                        @"DVTSourceControlBranchIdentifierKey":
+                            [NSString stringWithFormat:@"branch-%ld", (long) index],
+                    },
+                },
+            },
+        },
+    };
+}
+
++ (NSData*) responseWithBotCount:(NSInteger)count {
+    NSMutableArray *results = [NSMutableArray new];
+    for (NSInteger i = 0; i < count; i++) [results addObject:[self botWithIndex:i]];
+    return [NSJSONSerialization
+        dataWithJSONObject:@{ @"count": @(count), @"results": results }
+        options:NSJSONWritingPrettyPrinted
+        error:nil];
+}
+
++ (NSDictionary<NSString*, XGXcodeBot*>*) scannedBotsWithData:(NSData*)data {
+    XGJSONScanner *scanner = [[XGJSONScanner alloc] initWithData:data];
+    NSMutableDictionary *bots = [NSMutableDictionary new];
+    for (NSValue *range in [scanner rangesOfElementsOfArrayForKey:@"results" error:nil]) {
+        XGXcodeBot *bot = [[XGXcodeBot alloc] initWithServerName:@"localhost"
+            scanner:scanner range:range.rangeValue error:nil];
+        if (bot.name) bots[bot.name] = bot;
+    }
+    return bots;
+}
+
++ (NSDictionary<NSString*, XGXcodeBot*>*) decodedBotsWithData:(NSData*)data {
+    NSDictionary *response = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    NSMutableDictionary *bots = [NSMutableDictionary new];
+    for (NSDictionary *d in response[@"results"]) {
+        XGXcodeBot *bot = [[XGXcodeBot alloc] initWithServerName:@"localhost" dictionary:d];
+        if (bot.name) bots[bot.name] = bot;
+    }
+    return bots;
+}
+
+- (void) testScanner {
+    NSData *data = [@" { \"a\" : [1, \"]}\\\"\" , {\"b\": {\"c\": true, \"d\": [null]}}, -2.5e3 ] ,"
+        "\"k\\u0065y\": {\"x\": {\"y\": \"z\"}, \"w\": 1} } " dataUsingEncoding:NSUTF8StringEncoding];
+    XGJSONScanner *scanner = [[XGJSONScanner alloc] initWithData:data];
+
+    NSError *error = nil;
+    NSArray<NSValue*> *ranges = [scanner rangesOfElementsOfArrayForKey:@"a" error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(ranges.count, 4);
+    XCTAssertEqualObjects([scanner objectAtRange:ranges[0].rangeValue error:nil], @1);
+    XCTAssertEqualObjects([scanner objectAtRange:ranges[1].rangeValue error:nil], @"]}\"");
+    XCTAssertEqualObjects([scanner objectAtRange:ranges[3].rangeValue error:nil], @(-2500));
+
+    NSDictionary *values =
+        [scanner valuesForKeyPaths:@[ @"b.c", @"b.e" ] inObjectAtRange:ranges[2].rangeValue error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqualObjects(values, @{ @"b.c": @YES });
+
+    // Escaped keys:
+    ranges = [scanner rangesOfElementsOfArrayForKey:@"key" error:&error];
+    XCTAssertNil(ranges);
+    XCTAssertNotNil(error);
+    values = [scanner valuesForKeyPaths:@[ @"key.x.y", @"key.w" ]
+        inObjectAtRange:NSMakeRange(0, data.length) error:&error];
+    XCTAssertEqualObjects(values, (@{ @"key.x.y": @"z", @"key.w": @1 }));
+
+    // Malformed JSON:
+    for (NSString *string in @[ @"", @"[]", @"{\"a\": [1, 2", @"{\"a\": [1 2]}", @"{\"a\" 1}", @"{\"a\": \"1}" ]) {
+        scanner = [[XGJSONScanner alloc] initWithData:[string dataUsingEncoding:NSUTF8StringEncoding]];
+        error = nil;
+        XCTAssertNil([scanner rangesOfElementsOfArrayForKey:@"a" error:&error], @"%@", string);
+        XCTAssertNotNil(error, @"%@", string);
+    }
+    scanner = [[XGJSONScanner alloc] initWithData:[@"{\"a\": []}" dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertEqualObjects([scanner rangesOfElementsOfArrayForKey:@"a" error:nil], @[]);
+}
+
+- (void) testScannedBotsMatchDecodedBots {
+    NSData *data = [self.class responseWithBotCount:5];
+    NSDictionary<NSString*, XGXcodeBot*> *scanned = [self.class scannedBotsWithData:data];
+    NSDictionary<NSString*, XGXcodeBot*> *decoded = [self.class decodedBotsWithData:data];
+    XCTAssertEqual(scanned.count, 5);
+    XCTAssertEqualObjects([NSSet setWithArray:scanned.allKeys], [NSSet setWithArray:decoded.allKeys]);
+
+    for (NSString *name in decoded) {
+        XGXcodeBot *a = scanned[name], *b = decoded[name];
+        XCTAssertEqualObjects(a.botID, b.botID);
+        XCTAssertEqualObjects(a.serverName, b.serverName);
+        XCTAssertEqualObjects(a.repoOwner, @"owner");
+        XCTAssertEqualObjects(a.repoOwner, b.repoOwner);
+        XCTAssertEqualObjects(a.repoName, b.repoName);
+        XCTAssertEqualObjects(a.branch, b.branch);
+        XCTAssertEqualObjects(a.sourceControlRepository, b.sourceControlRepository);
+        XCTAssertEqualObjects(a.sourceControlWorkspaceBlueprintLocationsID, b.sourceControlWorkspaceBlueprintLocationsID);
+        XCTAssertEqualObjects(a.templateBotName, b.templateBotName);
+        XCTAssertEqualObjects(a.pullRequestNumber, b.pullRequestNumber);
+        XCTAssertEqualObjects(a.pullRequestTitle, b.pullRequestTitle);
+    }
+}
+
+- (void) testScanPerformance {
+    NSData *data = [self.class responseWithBotCount:300];
+    [self measureBlock:^{
+        @autoreleasepool {
+            NSDictionary *bots = [self.class scannedBotsWithData:data];
+            XCTAssertEqual(bots.count, 300);
+        }
+    }];
+}
+
+- (void) testDecodePerformance {
+    // For comparison with testScanPerformance:
+    NSData *data = [self.class responseWithBotCount:300];
+    [self measureBlock:^{
+        @autoreleasepool {
+            NSDictionary *bots = [self.class decodedBotsWithData:data];
+            XCTAssertEqual(bots.count, 300);
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,58 @@
+/**
+ @file          XGJSONScanner.h
+ @package       xcode-github
+ @brief         Decodes selected values from a JSON document without decoding the whole document.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A JSON scanner walks the raw bytes of a UTF-8 JSON document and only creates objects for the
+ values that are asked for. Everything else is skipped over, so a large response that's mostly
+ unused costs a pass over its bytes instead of a full object tree.
+
+ Skipped values are only checked for balanced brackets and strings, not fully validated. The
+ values that are returned are decoded with `NSJSONSerialization` and are fully validated.
+*/
+@interface XGJSONScanner : NSObject
+
+- (instancetype) initWithData:(NSData*)data NS_DESIGNATED_INITIALIZER;
+- (instancetype) init NS_UNAVAILABLE;
+
+@property (strong, readonly) NSData *data;
+
+/**
+ Returns the byte range of each element of the array that is the value of `key` in the
+ document's top level object.
+
+ @param key     The key of the array in the top level object.
+ @param error   If not nil, on exit, any error encountered is returned here.
+ @return An array of `NSValue` ranges, or nil if the document isn't an object with that array.
+*/
+- (NSArray<NSValue*>*_Nullable) rangesOfElementsOfArrayForKey:(NSString*)key
+                                                        error:(NSError*_Nullable __autoreleasing *_Nullable)error;
+
+/**
+ Decodes the values at `keyPaths` in the object at `range`, skipping everything else. Scanning
+ stops as soon as every key path has been found.
+
+ @param keyPaths    Dot separated key paths, such as `configuration.sourceControlBlueprint`.
+ @param range       The byte range of a JSON object in the document.
+ @param error       If not nil, on exit, any error encountered is returned here.
+ @return The decoded values keyed by key path. Key paths that aren't found are left out.
+*/
+- (NSDictionary<NSString*, id>*_Nullable) valuesForKeyPaths:(NSArray<NSString*>*)keyPaths
+                                               inObjectAtRange:(NSRange)range
+                                                         error:(NSError*_Nullable __autoreleasing *_Nullable)error;
+
+/// Decodes the whole value at `range`.
+- (id _Nullable) objectAtRange:(NSRange)range error:(NSError*_Nullable __autoreleasing *_Nullable)error;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,270 @@
+/**
+ @file          XGJSONScanner.m
+ @package       xcode-github
+ @brief         Decodes selected values from a JSON document without decoding the whole document.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGJSONScanner.h"
+
+#pragma mark Scanning
+
+// Each function takes the index of the first byte to scan and returns the index just past what was
+// scanned, or NSNotFound if the bytes aren't well formed.
+
+static inline NSUInteger XGSkipWhitespace(const uint8_t *bytes, NSUInteger i, NSUInteger end) {
+    while (i < end && (bytes[i] == ' ' || bytes[i] == '\n' || bytes[i] == '\r' || bytes[i] == '\t'))
+        i++;
+    return i;
+}
+
+static NSUInteger XGSkipString(const uint8_t *bytes, NSUInteger i, NSUInteger end) {
+    if (i >= end || bytes[i] != '"') return NSNotFound;
+    for (i++; i < end; i++) {
+        if (bytes[i] == '\\')
+            i++;
+        else
+        if (bytes[i] == '"')
+            return i + 1;
+    }
+    return NSNotFound;
+}
+
+static NSUInteger XGSkipValue(const uint8_t *bytes, NSUInteger i, NSUInteger end) {
+    if (i >= end) return NSNotFound;
+    switch (bytes[i]) {
+    case '"':
+        return XGSkipString(bytes, i, end);
+
+    case '{':
+    case '[': {
+        NSInteger depth = 0;
+        while (i < end) {
+            uint8_t c = bytes[i];
+            if (c == '"') {
+                i = XGSkipString(bytes, i, end);
+                if (i == NSNotFound) return NSNotFound;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else
+            if (c == '}' || c == ']') {
+                if (--depth == 0) return i + 1;
+            }
+            i++;
+        }
+        return NSNotFound;
+    }
+
+    default: {
+        // A number, true, false, or null:
+        NSUInteger start = i;
+        while (i < end) {
+            uint8_t c = bytes[i];
+            if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t')
+                break;
+            i++;
+        }
+        return (i > start) ? i : NSNotFound;
+    }
+    }
+}
+
+/// Calls `member` with the key and value range of each member of the object at `i`.
+static NSUInteger XGScanObject(
+        const uint8_t *bytes,
+        NSUInteger i,
+        NSUInteger end,
+        void (^member)(NSRange key, NSRange value, BOOL *stop)
+    ) {
+    i = XGSkipWhitespace(bytes, i, end);
+    if (i >= end || bytes[i] != '{') return NSNotFound;
+    i = XGSkipWhitespace(bytes, i + 1, end);
+    if (i < end && bytes[i] == '}') return i + 1;
+
+    while (i < end) {
+        NSUInteger keyStart = i;
+        i = XGSkipString(bytes, i, end);
+        if (i == NSNotFound) return NSNotFound;
+        NSRange key = NSMakeRange(keyStart, i - keyStart);
+
+        i = XGSkipWhitespace(bytes, i, end);
+        if (i >= end || bytes[i] != ':') return NSNotFound;
+        i = XGSkipWhitespace(bytes, i + 1, end);
+
+        NSUInteger valueStart = i;
+        i = XGSkipValue(bytes, i, end);
+        if (i == NSNotFound) return NSNotFound;
+
+        BOOL stop = NO;
+        member(key, NSMakeRange(valueStart, i - valueStart), &stop);
+        if (stop) return i;
+
+        i = XGSkipWhitespace(bytes, i, end);
+        if (i >= end) break;
+        if (bytes[i] == '}') return i + 1;
+        if (bytes[i] != ',') break;
+        i = XGSkipWhitespace(bytes, i + 1, end);
+    }
+    return NSNotFound;
+}
+
+#pragma mark - XGJSONScanner
+
+@implementation XGJSONScanner
+
+- (instancetype) initWithData:(NSData*)data {
+    self = [super init];
+    if (!self) return self;
+    _data = data;
+    return self;
+}
+
+- (instancetype) init {
+    return [self initWithData:[NSData new]];
+}
+
+- (NSError*) errorAtIndex:(NSUInteger)i {
+    NSString *message =
+        (i == NSNotFound)
+        ? @"The JSON data is malformed."
+        : [NSString stringWithFormat:@"The JSON data is malformed at byte %lu.", (unsigned long) i];
+    return [NSError errorWithDomain:NSCocoaErrorDomain
+        code:NSPropertyListReadCorruptError
+        userInfo:@{ NSLocalizedDescriptionKey: message }];
+}
+
+- (NSString*) keyAtRange:(NSRange)range {
+    // Keys are short and rarely escaped, so only escaped keys go through the full decoder:
+    const uint8_t *bytes = self.data.bytes;
+    if (memchr(bytes + range.location, '\\', range.length) == NULL) {
+        return [[NSString alloc]
+            initWithBytes:bytes + range.location + 1
+            length:range.length - 2
+            encoding:NSUTF8StringEncoding];
+    }
+    id key = [self objectAtRange:range error:nil];
+    return [key isKindOfClass:NSString.class] ? key : nil;
+}
+
+- (id _Nullable) objectAtRange:(NSRange)range error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    return [NSJSONSerialization
+        JSONObjectWithData:[self.data subdataWithRange:range]
+        options:NSJSONReadingFragmentsAllowed
+        error:error];
+}
+
+- (NSArray<NSValue*>*_Nullable) rangesOfElementsOfArrayForKey:(NSString*)arrayKey
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    NSError *localError = nil;
+    NSMutableArray<NSValue*> *ranges = nil;
+    const uint8_t *bytes = self.data.bytes;
+    NSUInteger end = self.data.length;
+
+    {
+        __block NSRange arrayRange = NSMakeRange(NSNotFound, 0);
+        NSUInteger i = XGScanObject(bytes, 0, end, ^(NSRange key, NSRange value, BOOL *stop) {
+            if ([[self keyAtRange:key] isEqualToString:arrayKey]) {
+                arrayRange = value;
+                *stop = YES;
+            }
+        });
+        if (i == NSNotFound) {
+            localError = [self errorAtIndex:NSNotFound];
+            goto exit;
+        }
+        if (arrayRange.location == NSNotFound || bytes[arrayRange.location] != '[') {
+            localError =
+                [NSError errorWithDomain:NSCocoaErrorDomain
+                    code:NSPropertyListReadCorruptError
+                    userInfo:@{ NSLocalizedDescriptionKey:
+                        [NSString stringWithFormat:@"Expected an array for '%@'.", arrayKey]
+                    }];
+            goto exit;
+        }
+
+        ranges = [NSMutableArray new];
+        end = NSMaxRange(arrayRange);
+        i = XGSkipWhitespace(bytes, arrayRange.location + 1, end);
+        if (i < end && bytes[i] == ']') goto exit;
+        while (i < end) {
+            NSUInteger start = i;
+            i = XGSkipValue(bytes, i, end);
+            if (i == NSNotFound) {
+                localError = [self errorAtIndex:start];
+                ranges = nil;
+                goto exit;
+            }
+            [ranges addObject:[NSValue valueWithRange:NSMakeRange(start, i - start)]];
+            i = XGSkipWhitespace(bytes, i, end);
+            if (i < end && bytes[i] == ']') break;
+            if (i >= end || bytes[i] != ',') {
+                localError = [self errorAtIndex:i];
+                ranges = nil;
+                goto exit;
+            }
+            i = XGSkipWhitespace(bytes, i + 1, end);
+        }
+    }
+
+exit:
+    if (error) *error = localError;
+    return ranges;
+}
+
+- (BOOL) addValuesForKeyPaths:(NSArray<NSArray<NSString*>*>*)keyPaths
+        prefix:(NSString*)prefix
+        inObjectAtRange:(NSRange)range
+        values:(NSMutableDictionary*)values
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    NSMutableSet<NSString*> *keys = [NSMutableSet new];
+    for (NSArray<NSString*> *path in keyPaths) [keys addObject:path.firstObject];
+
+    __block NSError *localError = nil;
+    NSUInteger i = XGScanObject(self.data.bytes, range.location, NSMaxRange(range),
+        ^(NSRange keyRange, NSRange valueRange, BOOL *stop) {
+        NSString *key = [self keyAtRange:keyRange];
+        if (![keys containsObject:key]) return;
+
+        NSString *fullKey = prefix.length ? [NSString stringWithFormat:@"%@.%@", prefix, key] : key;
+        NSMutableArray<NSArray<NSString*>*> *subpaths = [NSMutableArray new];
+        for (NSArray<NSString*> *path in keyPaths) {
+            if (![path.firstObject isEqualToString:key]) continue;
+            if (path.count == 1) {
+                id value = [self objectAtRange:valueRange error:&localError];
+                if (localError) { *stop = YES; return; }
+                values[fullKey] = value;
+            } else {
+                [subpaths addObject:[path subarrayWithRange:NSMakeRange(1, path.count - 1)]];
+            }
+        }
+        if (subpaths.count && ((const uint8_t*)self.data.bytes)[valueRange.location] == '{') {
+            if (![self addValuesForKeyPaths:subpaths prefix:fullKey inObjectAtRange:valueRange
+                    values:values error:&localError])
+                *stop = YES;
+        }
+        // The rest of the object doesn't need to be scanned once every key is found:
+        [keys removeObject:key];
+        if (keys.count == 0) *stop = YES;
+    });
+    if (!localError && i == NSNotFound) localError = [self errorAtIndex:range.location];
+    if (error) *error = localError;
+    return (localError == nil);
+}
+
+- (NSDictionary<NSString*, id>*_Nullable) valuesForKeyPaths:(NSArray<NSString*>*)keyPaths
+        inObjectAtRange:(NSRange)range
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    NSMutableArray<NSArray<NSString*>*> *paths = [NSMutableArray new];
+    for (NSString *keyPath in keyPaths) [paths addObject:[keyPath componentsSeparatedByString:@"."]];
+    NSMutableDictionary *values = [NSMutableDictionary new];
+    if (![self addValuesForKeyPaths:paths prefix:@"" inObjectAtRange:range values:values error:error])
+        return nil;
+    return values;
+}
+
+@end
@@ -0,0 +1,198 @@
+/**
+ @file          XGNetworkMetrics.Test.m
+ @package       xcode-github
+ @brief         Tests for XGNetworkMetrics.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGNetworkMetrics.h"
+#import "XGHTTPServer.h"
+
+@interface XGNetworkMetricsTest : BNCTestCase
+@end
+
+@implementation XGNetworkMetricsTest
+
+- (NSString*) endpointForString:(NSString*)string {
+    return [XGNetworkMetrics endpointForURL:[NSURL URLWithString:string]];
+}
+
+- (void) testEndpoints {
+    XCTAssertEqualObjects([self endpointForString:@"https://xcode.local:20343/api/bots"], @"bots");
+    XCTAssertEqualObjects([self endpointForString:@"https://xcode.local:20343/api/bots/abc123"], @"bots");
+    XCTAssertEqualObjects([self endpointForString:@"https://xcode.local:20343/api/bots/abc123/integrations"], @"integrations");
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/repos/owner/repo/pulls?state=open"], @"pulls");
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/repos/owner/repo/statuses/a1b2c3"], @"statuses");
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/repos/owner/repo/commits/a1b2c3/status"], @"statuses");
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/repos/owner/repo/issues/12/comments"], @"comments");
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/graphql"], @"graphql");
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/rate_limit"], @"other");
+
+    // A repo named like an endpoint isn't taken for one:
+    XCTAssertEqualObjects([self endpointForString:@"https://api.github.com/repos/bots/pulls"], @"other");
+}
+
+- (void) testCountsAndQuantiles {
+    XGNetworkMetrics *metrics = [XGNetworkMetrics new];
+    NSURL *URL = [NSURL URLWithString:@"https://api.github.com/repos/owner/repo/pulls"];
+    for (int i = 0; i < 90; i++)
+        [metrics recordRequestWithURL:URL statusCode:200 bytesSent:0 bytesReceived:100 duration:0.02];
+    for (int i = 0; i < 10; i++)
+        [metrics recordRequestWithURL:URL statusCode:502 bytesSent:10 bytesReceived:0 duration:2.0];
+    [metrics recordRequestWithURL:[NSURL URLWithString:@"https://api.github.com/graphql"]
+        statusCode:0 bytesSent:50 bytesReceived:0 duration:0.5];
+
+    XCTAssertEqual([metrics requestCountForHost:@"api.github.com" endpoint:@"pulls"], 100);
+    XCTAssertEqual([metrics requestCountForHost:@"api.github.com" endpoint:@"graphql"], 1);
+    XCTAssertEqual([metrics requestCountForHost:@"api.github.com" endpoint:@"bots"], 0);
+
+    // The quantiles are interpolated within their bucket and never exceed the slowest request:
+    double p50 = [metrics latencyQuantile:0.50 forHost:@"api.github.com" endpoint:@"pulls"];
+    XCTAssertTrue(p50 > 0.01 && p50 <= 0.025);
+    XCTAssertEqualWithAccuracy([metrics latencyQuantile:0.95 forHost:@"api.github.com" endpoint:@"pulls"], 1.5, 0.001);
+    XCTAssertEqualWithAccuracy([metrics latencyQuantile:0.99 forHost:@"api.github.com" endpoint:@"pulls"], 1.9, 0.001);
+    XCTAssertEqualWithAccuracy([metrics latencyQuantile:1.00 forHost:@"api.github.com" endpoint:@"pulls"], 2.0, 0.001);
+    XCTAssertEqual([metrics latencyQuantile:0.50 forHost:@"api.github.com" endpoint:@"bots"], 0.0);
+
+    NSString *text = metrics.prometheusText;
+    XCTAssertTrue([text containsString:
+        @"xcode_github_requests_total{host=\"api.github.com\",endpoint=\"pulls\",status=\"200\"} 90\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_requests_total{host=\"api.github.com\",endpoint=\"pulls\",status=\"502\"} 10\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_requests_total{host=\"api.github.com\",endpoint=\"graphql\",status=\"error\"} 1\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_response_bytes_received_total{host=\"api.github.com\",endpoint=\"pulls\"} 9000\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_request_duration_seconds_bucket{host=\"api.github.com\",endpoint=\"pulls\",le=\"0.025\"} 90\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_request_duration_seconds_bucket{host=\"api.github.com\",endpoint=\"pulls\",le=\"+Inf\"} 100\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_request_duration_seconds_count{host=\"api.github.com\",endpoint=\"pulls\"} 100\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_request_latency_seconds{host=\"api.github.com\",endpoint=\"pulls\",quantile=\"0.95\"} 1.500000\n"]);
+
+    NSDictionary *JSON = metrics.JSONObject;
+    XCTAssertTrue([NSJSONSerialization isValidJSONObject:JSON]);
+    NSArray *series = JSON[@"series"];
+    XCTAssertEqual(series.count, 2);
+    XCTAssertEqualObjects(series[1][@"endpoint"], @"pulls");
+    XCTAssertEqualObjects(series[1][@"requests"], @100);
+    XCTAssertEqualObjects(series[1][@"statuses"], (@{ @"200": @90, @"502": @10 }));
+    XCTAssertEqualObjects(series[1][@"bytesSent"], @100);
+    XCTAssertEqualWithAccuracy([series[1][@"latency"][@"p99"] doubleValue], 1.9, 0.001);
+
+    [metrics reset];
+    XCTAssertEqual([metrics requestCountForHost:@"api.github.com" endpoint:@"pulls"], 0);
+}
+
+- (void) testWriteToFile {
+    XGNetworkMetrics *metrics = [XGNetworkMetrics new];
+    [metrics recordRequestWithURL:[NSURL URLWithString:@"https://xcode.local:20343/api/bots"]
+        statusCode:200 bytesSent:0 bytesReceived:1000 duration:0.3];
+
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:
+        [NSString stringWithFormat:@"XGNetworkMetricsTest-%@", [NSUUID UUID].UUIDString]];
+    NSString *JSONPath = [path stringByAppendingPathExtension:@"json"];
+    NSString *textPath = [path stringByAppendingPathExtension:@"prom"];
+    XCTAssertNil([metrics writeToFile:JSONPath]);
+    XCTAssertNil([metrics writeToFile:textPath]);
+
+    NSDictionary *JSON = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:JSONPath] options:0 error:nil];
+    XCTAssertEqualObjects(JSON[@"series"][0][@"host"], @"xcode.local");
+    XCTAssertEqualObjects(JSON[@"series"][0][@"endpoint"], @"bots");
+    NSString *text = [NSString stringWithContentsOfFile:textPath encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertEqualObjects(text, metrics.prometheusText);
+
+    [[NSFileManager defaultManager] removeItemAtPath:JSONPath error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:textPath error:nil];
+}
+
+- (void) testServerAndObserver {
+    XGNetworkMetrics *metrics = [XGNetworkMetrics new];
+    XCTAssertNil([metrics startServerWithPort:0]);
+    XCTAssertTrue(metrics.serverPort > 0);
+
+    // The metrics count their own requests:
+    BNCNetworkService *service = [BNCNetworkService new];
+    [metrics observeNetworkService:service];
+    NSURL *URL = [NSURL URLWithString:
+        [NSString stringWithFormat:@"http://127.0.0.1:%d/metrics", metrics.serverPort]];
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    BNCNetworkOperation *operation =
+        [service getOperationWithURL:URL completion:^(BNCNetworkOperation*operation) {
+            dispatch_semaphore_signal(semaphore);
+        }];
+    [operation start];
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(operation.HTTPStatusCode, 200);
+    XCTAssertTrue([operation.stringFromResponseData containsString:@"# TYPE xcode_github_requests_total counter"]);
+    XCTAssertEqual([metrics requestCountForHost:@"127.0.0.1" endpoint:@"other"], 1);
+
+    [metrics stopServer];
+    XCTAssertEqual(metrics.serverPort, 0);
+}
+
+- (void) testEachAttemptIsRecorded {
+    NSMutableArray<NSNumber*> *statusCodes = [NSMutableArray arrayWithArray:@[ @503, @200, @503 ]];
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        NSInteger statusCode = 200;
+        @synchronized(statusCodes) {
+            if (statusCodes.count) {
+                statusCode = statusCodes.firstObject.integerValue;
+                [statusCodes removeObjectAtIndex:0];
+            }
+        }
+        return [XGHTTPResponse responseWithStatusCode:statusCode];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    NSURL *URL = [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/", server.port]];
+
+    XGNetworkMetrics *metrics = [XGNetworkMetrics new];
+    BNCNetworkService *service = [BNCNetworkService new];
+    service.maximumRetryCount = 1;
+    service.retryInterval = 0.01;
+    [metrics observeNetworkService:service];
+
+    BNCNetworkOperation* (^get)(void) = ^ BNCNetworkOperation* {
+        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+        BNCNetworkOperation *operation =
+            [service getOperationWithURL:URL completion:^(BNCNetworkOperation*operation) {
+                dispatch_semaphore_signal(semaphore);
+            }];
+        [operation start];
+        XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+        return operation;
+    };
+
+    // The retried request counts once for each try, with that try's status:
+    BNCNetworkOperation *operation = get();
+    XCTAssertEqual(operation.HTTPStatusCode, 200);
+    XCTAssertEqual(operation.retryCount, 1);
+    XCTAssertEqual([metrics requestCountForHost:@"127.0.0.1" endpoint:@"other"], 2);
+
+    // Now a 503 opens the circuit, so the retry fails fast and isn't counted as sent:
+    service.circuitFailureThreshold = 1;
+    operation = get();
+    XCTAssertEqual(operation.HTTPStatusCode, 0);
+    XCTAssertEqual([service circuitStateForHost:@"127.0.0.1"], BNCCircuitStateOpen);
+    XCTAssertEqual([metrics requestCountForHost:@"127.0.0.1" endpoint:@"other"], 3);
+
+    NSString *text = metrics.prometheusText;
+    XCTAssertTrue([text containsString:
+        @"xcode_github_requests_total{host=\"127.0.0.1\",endpoint=\"other\",status=\"503\"} 2\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_requests_total{host=\"127.0.0.1\",endpoint=\"other\",status=\"200\"} 1\n"]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_circuit_open_requests_total{host=\"127.0.0.1\",endpoint=\"other\"} 1\n"]);
+    XCTAssertFalse([text containsString:@"status=\"circuit_open\""]);
+    XCTAssertTrue([text containsString:
+        @"xcode_github_request_duration_seconds_count{host=\"127.0.0.1\",endpoint=\"other\"} 3\n"]);
+    [server stop];
+}
+
+@end
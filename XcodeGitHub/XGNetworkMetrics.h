@@ -0,0 +1,107 @@
+/**
+ @file          XGNetworkMetrics.h
+ @package       xcode-github
+ @brief         Request counts and latencies for each host and endpoint.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+#import "BNCNetworkService.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Network metrics count the requests to each host and endpoint family: how many, their status
+ codes, the bytes sent and received, and a histogram of their latency with estimated p50, p95,
+ and p99.
+
+ Each request that's sent is counted on its own, so an operation that's retried counts once for
+ each try, with that try's status and latency. Requests that fail fast while a host's circuit is
+ open are counted separately, as `xcode_github_circuit_open_requests_total`. They never reach the
+ network, so they aren't in the request count, the status counts, or the latency histogram.
+
+ The endpoint families are `bots`, `integrations`, `pulls`, `statuses`, `comments`, and
+ `graphql`. Other requests are counted as `other`.
+
+ The metrics can be exported as Prometheus text or JSON, written to a file, or served from a local
+ port. The metrics are safe to use from several threads.
+*/
+@interface XGNetworkMetrics : NSObject
+
+/// The metrics of the shared network service.
++ (XGNetworkMetrics*) shared;
+
+/// Records every request that the network service sends or fails fast.
+- (void) observeNetworkService:(BNCNetworkService*)service;
+
+/**
+ Records one attempt at an operation's request, as passed to the network service's
+ `attemptObserver`.
+
+ @param operation   The operation, holding the attempt's response.
+ @param duration    The time the request took on the network, in seconds.
+ @param wasSent     NO if the request failed fast because its host's circuit was open.
+*/
+- (void) recordAttemptOfOperation:(BNCNetworkOperation*)operation
+                         duration:(NSTimeInterval)duration
+                          wasSent:(BOOL)wasSent;
+
+/**
+ Records a request.
+
+ @param URL             The request URL.
+ @param statusCode      The HTTP status code, or zero if there was no response.
+ @param bytesSent       The size of the request body.
+ @param bytesReceived   The size of the response body.
+ @param duration        The time from the start of the request until its response, in seconds.
+*/
+- (void) recordRequestWithURL:(NSURL*)URL
+                   statusCode:(NSInteger)statusCode
+                    bytesSent:(int64_t)bytesSent
+                bytesReceived:(int64_t)bytesReceived
+                     duration:(NSTimeInterval)duration;
+
+/// Records a request that failed fast because its host's circuit was open.
+- (void) recordCircuitOpenRequestWithURL:(NSURL*)URL;
+
+/// The endpoint family of a URL, like `bots` or `pulls`.
++ (NSString*) endpointForURL:(NSURL*)URL;
+
+/// The estimated latency quantile, like 0.95, of a host's endpoint. Returns zero if there's none.
+- (NSTimeInterval) latencyQuantile:(double)quantile forHost:(NSString*)host endpoint:(NSString*)endpoint;
+
+/// The number of requests sent to a host's endpoint.
+- (NSInteger) requestCountForHost:(NSString*)host endpoint:(NSString*)endpoint;
+
+/// The metrics in the Prometheus text exposition format.
+- (NSString*) prometheusText;
+
+/// The metrics as a JSON object.
+- (NSDictionary*) JSONObject;
+
+/**
+ Writes the metrics to a file atomically. The file is JSON if its extension is `.json` and
+ Prometheus text otherwise.
+*/
+- (NSError*_Nullable) writeToFile:(NSString*)path;
+
+/**
+ Serves the metrics over HTTP. `/metrics` is Prometheus text and `/metrics.json` is JSON.
+
+ @param port    The TCP port. Zero picks any free port.
+ @return Returns an error if the server can't listen on the port.
+*/
+- (NSError*_Nullable) startServerWithPort:(uint16_t)port;
+- (void) stopServer;
+
+/// The port the metrics are served on, or zero if they aren't being served.
+@property (assign, readonly) uint16_t serverPort;
+
+/// Clears the metrics.
+- (void) reset;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,407 @@
+/**
+ @file          XGNetworkMetrics.m
+ @package       xcode-github
+ @brief         Request counts and latencies for each host and endpoint.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGNetworkMetrics.h"
+#import "XGHTTPServer.h"
+#import "BNCLog.h"
+
+/// The upper bounds of the latency histogram buckets in seconds. The last bucket is unbounded.
+static double const kLatencyBuckets[] = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0, INFINITY
+};
+#define kLatencyBucketCount ((NSInteger) (sizeof(kLatencyBuckets) / sizeof(kLatencyBuckets[0])))
+
+#pragma mark XGNetworkSeries
+
+/// The metrics of one host and endpoint.
+@interface XGNetworkSeries : NSObject {
+    @public
+    int64_t _bucketCounts[kLatencyBucketCount];
+}
+@property (strong) NSString *host;
+@property (strong) NSString *endpoint;
+@property (assign) int64_t requestCount;
+@property (assign) int64_t circuitOpenCount;
+@property (strong) NSMutableDictionary<NSString*, NSNumber*> *statusCounts;
+@property (assign) int64_t bytesSent;
+@property (assign) int64_t bytesReceived;
+@property (assign) double latencySum;
+@property (assign) double latencyMaximum;
+@end
+
+@implementation XGNetworkSeries
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _statusCounts = [NSMutableDictionary new];
+    return self;
+}
+
+- (void) addDuration:(NSTimeInterval)duration {
+    duration = MAX(0.0, duration);
+    self.latencySum += duration;
+    self.latencyMaximum = MAX(self.latencyMaximum, duration);
+    for (NSInteger i = 0; i < kLatencyBucketCount; i++) {
+        if (duration <= kLatencyBuckets[i]) {
+            _bucketCounts[i]++;
+            break;
+        }
+    }
+}
+
+/// Estimates a quantile by interpolating within the histogram bucket that it falls in.
+- (double) quantile:(double)quantile {
+    if (self.requestCount <= 0) return 0.0;
+    double rank = MIN(MAX(quantile, 0.0), 1.0) * (double) self.requestCount;
+    int64_t count = 0;
+    for (NSInteger i = 0; i < kLatencyBucketCount; i++) {
+        if (_bucketCounts[i] == 0 || (double) (count + _bucketCounts[i]) < rank) {
+            count += _bucketCounts[i];
+            continue;
+        }
+        double lower = (i == 0) ? 0.0 : kLatencyBuckets[i-1];
+        double upper = MIN(kLatencyBuckets[i], self.latencyMaximum);
+        if (upper <= lower) return upper;
+        double fraction = (rank - (double) count) / (double) _bucketCounts[i];
+        return lower + (upper - lower) * fraction;
+    }
+    return self.latencyMaximum;
+}
+
+@end
+
+#pragma mark - XGNetworkMetrics
+
+@interface XGNetworkMetrics () {
+    NSMutableDictionary<NSString*, XGNetworkSeries*> *_series;
+    XGHTTPServer *_server;
+}
+@end
+
+@implementation XGNetworkMetrics
+
++ (XGNetworkMetrics*) shared {
+    static dispatch_once_t onceToken = 0;
+    static XGNetworkMetrics *sharedMetrics = nil;
+    dispatch_once(&onceToken, ^{
+        sharedMetrics = [[XGNetworkMetrics alloc] init];
+        [sharedMetrics observeNetworkService:[BNCNetworkService shared]];
+    });
+    return sharedMetrics;
+}
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _series = [NSMutableDictionary new];
+    return self;
+}
+
+- (void) observeNetworkService:(BNCNetworkService*)service {
+    __weak __typeof(self) weakSelf = self;
+    service.attemptObserver = ^ (BNCNetworkOperation *operation, NSTimeInterval duration, BOOL wasSent) {
+        [weakSelf recordAttemptOfOperation:operation duration:duration wasSent:wasSent];
+    };
+}
+
+#pragma mark - Recording
+
++ (NSString*) endpointForURL:(NSURL*)URL {
+    static NSDictionary<NSString*, NSString*> *endpoints = nil;
+    static dispatch_once_t onceToken = 0;
+    dispatch_once(&onceToken, ^{
+        endpoints = @{
+            @"bots":           @"bots",
+            @"integrations":   @"integrations",
+            @"pulls":          @"pulls",
+            @"statuses":       @"statuses",
+            @"status":         @"statuses",
+            @"comments":       @"comments",
+            @"graphql":        @"graphql",
+        };
+    });
+    // Skip the GitHub owner and repo names, then use the last part of the path that names an
+    // endpoint: '/api/bots/<id>/integrations' is 'integrations', '/api/bots/<id>' is 'bots'.
+    NSArray<NSString*> *parts = URL.path.pathComponents;
+    NSInteger first = (parts.count > 1 && [parts[1] isEqualToString:@"repos"]) ? 4 : 1;
+    for (NSInteger i = (NSInteger) parts.count - 1; i >= first; i--) {
+        NSString *endpoint = endpoints[parts[i]];
+        if (endpoint) return endpoint;
+    }
+    return @"other";
+}
+
+- (void) recordAttemptOfOperation:(BNCNetworkOperation*)operation
+        duration:(NSTimeInterval)duration
+        wasSent:(BOOL)wasSent {
+    NSURL *URL = operation.request.URL;
+    if (!URL) return;
+    if (!wasSent) {
+        [self recordCircuitOpenRequestWithURL:URL];
+        return;
+    }
+    int64_t bytesReceived =
+        [operation.responseData isKindOfClass:NSData.class]
+        ? (int64_t) [(NSData*) operation.responseData length]
+        : 0;
+    [self recordRequestWithURL:URL
+        statusCode:(operation.response) ? operation.HTTPStatusCode : 0
+        bytesSent:(int64_t) operation.request.HTTPBody.length
+        bytesReceived:bytesReceived
+        duration:duration];
+}
+
+- (void) recordRequestWithURL:(NSURL*)URL
+        statusCode:(NSInteger)statusCode
+        bytesSent:(int64_t)bytesSent
+        bytesReceived:(int64_t)bytesReceived
+        duration:(NSTimeInterval)duration {
+    NSString *status = (statusCode > 0) ? [NSString stringWithFormat:@"%ld", (long) statusCode] : @"error";
+    @synchronized(self) {
+        XGNetworkSeries *series = [self recordingSeriesForURL:URL];
+        series.statusCounts[status] = @(series.statusCounts[status].longLongValue + 1);
+        series.requestCount++;
+        series.bytesSent += bytesSent;
+        series.bytesReceived += bytesReceived;
+        [series addDuration:duration];
+    }
+}
+
+- (void) recordCircuitOpenRequestWithURL:(NSURL*)URL {
+    @synchronized(self) {
+        [self recordingSeriesForURL:URL].circuitOpenCount++;
+    }
+}
+
+/// Returns the series of the URL, adding it if it's new. Called while synchronized.
+- (XGNetworkSeries*) recordingSeriesForURL:(NSURL*)URL {
+    NSString *host = URL.host ?: @"";
+    NSString *endpoint = [self.class endpointForURL:URL];
+    NSString *key = [NSString stringWithFormat:@"%@ %@", host, endpoint];
+    XGNetworkSeries *series = _series[key];
+    if (!series) {
+        series = [XGNetworkSeries new];
+        series.host = host;
+        series.endpoint = endpoint;
+        _series[key] = series;
+    }
+    return series;
+}
+
+- (void) reset {
+    @synchronized(self) {
+        [_series removeAllObjects];
+    }
+}
+
+- (XGNetworkSeries*) seriesForHost:(NSString*)host endpoint:(NSString*)endpoint {
+    return _series[[NSString stringWithFormat:@"%@ %@", host, endpoint]];
+}
+
+- (NSTimeInterval) latencyQuantile:(double)quantile forHost:(NSString*)host endpoint:(NSString*)endpoint {
+    @synchronized(self) {
+        return [[self seriesForHost:host endpoint:endpoint] quantile:quantile];
+    }
+}
+
+- (NSInteger) requestCountForHost:(NSString*)host endpoint:(NSString*)endpoint {
+    @synchronized(self) {
+        return (NSInteger) [self seriesForHost:host endpoint:endpoint].requestCount;
+    }
+}
+
+#pragma mark - Export
+
+/// The series sorted by host and endpoint so that the output is stable. Called while synchronized.
+- (NSArray<XGNetworkSeries*>*) sortedSeries {
+    return [_series.allValues sortedArrayUsingComparator:^NSComparisonResult(XGNetworkSeries *a, XGNetworkSeries *b) {
+        NSComparisonResult result = [a.host compare:b.host];
+        return (result != NSOrderedSame) ? result : [a.endpoint compare:b.endpoint];
+    }];
+}
+
++ (NSString*) labelValue:(NSString*)string {
+    return [[[string
+        stringByReplacingOccurrencesOfString:@"\\" withString:@"\\\\"]
+        stringByReplacingOccurrencesOfString:@"\"" withString:@"\\\""]
+        stringByReplacingOccurrencesOfString:@"\n" withString:@"\\n"];
+}
+
+- (NSString*) prometheusText {
+    NSMutableString *requests = [NSMutableString new];
+    NSMutableString *circuitOpen = [NSMutableString new];
+    NSMutableString *sent = [NSMutableString new];
+    NSMutableString *received = [NSMutableString new];
+    NSMutableString *histogram = [NSMutableString new];
+    NSMutableString *quantiles = [NSMutableString new];
+
+    @synchronized(self) {
+        for (XGNetworkSeries *series in self.sortedSeries) {
+            NSString *labels = [NSString stringWithFormat:@"host=\"%@\",endpoint=\"%@\"",
+                [self.class labelValue:series.host], [self.class labelValue:series.endpoint]];
+            NSArray *statuses = [series.statusCounts.allKeys sortedArrayUsingSelector:@selector(compare:)];
+            for (NSString *status in statuses) {
+                [requests appendFormat:@"xcode_github_requests_total{%@,status=\"%@\"} %lld\n",
+                    labels, status, series.statusCounts[status].longLongValue];
+            }
+            [circuitOpen appendFormat:@"xcode_github_circuit_open_requests_total{%@} %lld\n",
+                labels, series.circuitOpenCount];
+            [sent appendFormat:@"xcode_github_request_bytes_sent_total{%@} %lld\n", labels, series.bytesSent];
+            [received appendFormat:@"xcode_github_response_bytes_received_total{%@} %lld\n",
+                labels, series.bytesReceived];
+
+            int64_t count = 0;
+            for (NSInteger i = 0; i < kLatencyBucketCount; i++) {
+                count += series->_bucketCounts[i];
+                NSString *bound = isinf(kLatencyBuckets[i])
+                    ? @"+Inf" : [NSString stringWithFormat:@"%g", kLatencyBuckets[i]];
+                [histogram appendFormat:@"xcode_github_request_duration_seconds_bucket{%@,le=\"%@\"} %lld\n",
+                    labels, bound, count];
+            }
+            [histogram appendFormat:@"xcode_github_request_duration_seconds_sum{%@} %.6f\n",
+                labels, series.latencySum];
+            [histogram appendFormat:@"xcode_github_request_duration_seconds_count{%@} %lld\n",
+                labels, series.requestCount];
+
+            for (NSNumber *quantile in @[ @0.5, @0.95, @0.99 ]) {
+                [quantiles appendFormat:@"xcode_github_request_latency_seconds{%@,quantile=\"%@\"} %.6f\n",
+                    labels, quantile, [series quantile:quantile.doubleValue]];
+            }
+        }
+    }
+
+    NSMutableString *text = [NSMutableString new];
+    [text appendString:
+        @"# HELP xcode_github_requests_total Network requests sent by host, endpoint, and HTTP status.\n"
+         "# TYPE xcode_github_requests_total counter\n"];
+    [text appendString:requests];
+    [text appendString:
+        @"# HELP xcode_github_circuit_open_requests_total Requests that failed fast because the "
+         "host's circuit was open.\n"
+         "# TYPE xcode_github_circuit_open_requests_total counter\n"];
+    [text appendString:circuitOpen];
+    [text appendString:
+        @"# HELP xcode_github_request_bytes_sent_total Request body bytes sent.\n"
+         "# TYPE xcode_github_request_bytes_sent_total counter\n"];
+    [text appendString:sent];
+    [text appendString:
+        @"# HELP xcode_github_response_bytes_received_total Response body bytes received.\n"
+         "# TYPE xcode_github_response_bytes_received_total counter\n"];
+    [text appendString:received];
+    [text appendString:
+        @"# HELP xcode_github_request_duration_seconds Network request latency.\n"
+         "# TYPE xcode_github_request_duration_seconds histogram\n"];
+    [text appendString:histogram];
+    [text appendString:
+        @"# HELP xcode_github_request_latency_seconds Latency quantiles estimated from the histogram.\n"
+         "# TYPE xcode_github_request_latency_seconds gauge\n"];
+    [text appendString:quantiles];
+    return text;
+}
+
+- (NSDictionary*) JSONObject {
+    NSMutableArray *array = [NSMutableArray new];
+    @synchronized(self) {
+        for (XGNetworkSeries *series in self.sortedSeries) {
+            NSMutableArray *buckets = [NSMutableArray new];
+            for (NSInteger i = 0; i < kLatencyBucketCount; i++) {
+                [buckets addObject:@{
+                    @"le":      isinf(kLatencyBuckets[i]) ? @"+Inf" : @(kLatencyBuckets[i]),
+                    @"count":   @(series->_bucketCounts[i]),
+                }];
+            }
+            [array addObject:@{
+                @"host":            series.host,
+                @"endpoint":        series.endpoint,
+                @"requests":        @(series.requestCount),
+                @"statuses":        [series.statusCounts copy],
+                @"circuitOpen":     @(series.circuitOpenCount),
+                @"bytesSent":       @(series.bytesSent),
+                @"bytesReceived":   @(series.bytesReceived),
+                @"latency": @{
+                    @"p50":     @([series quantile:0.50]),
+                    @"p95":     @([series quantile:0.95]),
+                    @"p99":     @([series quantile:0.99]),
+                    @"max":     @(series.latencyMaximum),
+                    @"sum":     @(series.latencySum),
+                    @"buckets": buckets,
+                },
+            }];
+        }
+    }
+    NSString *date = [NSISO8601DateFormatter stringFromDate:[NSDate date]
+        timeZone:[NSTimeZone timeZoneWithAbbreviation:@"UTC"]
+        formatOptions:NSISO8601DateFormatWithInternetDateTime];
+    return @{ @"date": date, @"series": array };
+}
+
+- (NSError*) writeToFile:(NSString*)path {
+    NSError *error = nil;
+    NSData *data = nil;
+    if ([path.pathExtension.lowercaseString isEqualToString:@"json"]) {
+        data = [NSJSONSerialization dataWithJSONObject:self.JSONObject
+            options:NSJSONWritingPrettyPrinted error:&error];
+    } else {
+        data = [self.prometheusText dataUsingEncoding:NSUTF8StringEncoding];
+    }
+    if (data) [data writeToFile:path options:NSDataWritingAtomic error:&error];
+    if (error) BNCLogError(@"Can't write the network metrics to '%@': %@.", path, error);
+    return error;
+}
+
+#pragma mark - Server
+
+- (NSError*) startServerWithPort:(uint16_t)port {
+    [self stopServer];
+    __weak __typeof(self) weakSelf = self;
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        __strong __typeof(weakSelf) strongSelf = weakSelf;
+        if (!strongSelf) return [XGHTTPResponse responseWithStatusCode:503];
+        if (![request.method isEqualToString:@"GET"]) return [XGHTTPResponse responseWithStatusCode:405];
+        NSString *path = [request.path componentsSeparatedByString:@"?"].firstObject;
+        if ([path isEqualToString:@"/metrics.json"])
+            return [XGHTTPResponse responseWithStatusCode:200 JSONObject:strongSelf.JSONObject];
+        if ([path isEqualToString:@"/metrics"]) {
+            XGHTTPResponse *response = [XGHTTPResponse responseWithStatusCode:200];
+            response.headers = @{ @"Content-Type": @"text/plain; version=0.0.4; charset=utf-8" };
+            response.body = [strongSelf.prometheusText dataUsingEncoding:NSUTF8StringEncoding];
+            return response;
+        }
+        return [XGHTTPResponse responseWithStatusCode:404];
+    }];
+    NSError *error = [server startWithPort:port localOnly:YES];
+    if (error) {
+        BNCLogError(@"Can't serve the network metrics on port %d: %@.", port, error);
+        return error;
+    }
+    @synchronized(self) {
+        _server = server;
+    }
+    BNCLogDebug(@"Serving network metrics on port %d.", server.port);
+    return nil;
+}
+
+- (void) stopServer {
+    XGHTTPServer *server = nil;
+    @synchronized(self) {
+        server = _server;
+        _server = nil;
+    }
+    [server stop];
+}
+
+- (uint16_t) serverPort {
+    @synchronized(self) {
+        return _server.port;
+    }
+}
+
+@end
@@ -0,0 +1,327 @@
+/**
+ @file          XGReconcile.Test.m
+ @package       xcode-github
+ @brief         Tests for XGReconcile.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGReconcile.h"
+#import "XGSettings.h"
+#import "XGHTTPServer.h"
+
+@interface XGReconcileTest : BNCTestCase
+@end
+
+@implementation XGReconcileTest
+
+- (XGGitHubPullRequest*) pullRequestWithNumber:(NSInteger)number sha:(NSString*)sha {
+    NSDictionary *d = @{
+        @"number":  @(number),
+        @"title":   [NSString stringWithFormat:@"Title %ld", (long) number],
+        @"state":   @"open",
+        @"head": @{
+            @"ref": [NSString stringWithFormat:@"branch-%ld", (long) number],
+            @"sha": sha,
+            @"repo": @{ @"full_name": @"owner/reconcile-test" },
+        },
+    };
+    return [[XGGitHubPullRequest alloc] initWithDictionary:d];
+}
+
+- (XGXcodeBot*) botForPullRequest:(XGGitHubPullRequest*_Nullable)pr number:(NSString*)number {
+    NSString *name = (pr)
+        ? [XGXcodeBot botNameFromPRNumber:pr.number title:pr.title]
+        : [NSString stringWithFormat:@"xcode-github PR#%@ Closed", number];
+    NSDictionary *d = @{
+        @"name":                name,
+        @"_id":                 [NSString stringWithFormat:@"bot-%@", number],
+        @"pullRequestNumber":   number,
+        @"templateBotName":     @"Template",
+    };
+    return [[XGXcodeBot alloc] initWithServerName:@"localhost" dictionary:d];
+}
+
+- (XGXcodeBotStatus*) statusForBot:(XGXcodeBot*)bot integration:(NSInteger)number result:(NSString*)result {
+    NSDictionary *d = @{
+        @"_id":         [NSString stringWithFormat:@"integration-%ld", (long) number],
+        @"number":      @(number),
+        @"currentStep": @"completed",
+        @"result":      result,
+        @"bot":         @{ @"_id": bot.botID, @"name": bot.name },
+    };
+    return [[XGXcodeBotStatus alloc] initWithServerName:@"localhost" dictionary:d];
+}
+
+- (void) testPlan {
+    [[XGSettings sharedSettings] clear];
+    XGGitHubPullRequest *pr1 = [self pullRequestWithNumber:1 sha:@"aaa"];
+    XGGitHubPullRequest *pr2 = [self pullRequestWithNumber:2 sha:@"bbb"];
+    XGXcodeBot *template = [[XGXcodeBot alloc] initWithServerName:@"localhost" dictionary:@{
+        @"name": @"Template", @"_id": @"template"
+    }];
+    XGXcodeBot *bot1 = [self botForPullRequest:pr1 number:@"1"];
+    XGXcodeBot *bot3 = [self botForPullRequest:nil number:@"3"];
+
+    XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+    snapshot.templateBot = template;
+    snapshot.bots = @{ template.name: template, bot1.name: bot1, bot3.name: bot3 };
+    snapshot.botStatuses = @{ bot1.name: [self statusForBot:bot1 integration:4 result:@"succeeded"] };
+    snapshot.pullRequests = @{ pr1.number: pr1, pr2.number: pr2 };
+
+    XGReconciler *reconciler = [XGReconciler new];
+    XGReconcilePlan *plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 4);
+    XCTAssertEqual(plan.actions[0].type, XGReconcileActionUpdateStatus);
+    XCTAssertEqual(plan.actions[0].status, XGPullRequestStatusSuccess);
+    XCTAssertTrue(plan.actions[0].needsRemoteCheck);
+    XCTAssertEqual(plan.actions[1].type, XGReconcileActionAddComment);
+    XCTAssertEqual(plan.actions[1].statusAction, plan.actions[0]);
+    XCTAssertEqual(plan.actions[2].type, XGReconcileActionCreateBot);
+    XCTAssertEqualObjects(plan.actions[2].pullRequest.number, @"2");
+    XCTAssertEqual(plan.actions[3].type, XGReconcileActionDeleteBot);
+    XCTAssertEqualObjects(plan.actions[3].bot.botID, @"bot-3");
+    XCTAssertEqual(plan.unchangedCount, 0);
+    XCTAssertNotNil(plan.fingerprints[@"1"]);
+    XCTAssertTrue([plan.description containsString:@"Create bot"]);
+
+    // A cached status on GitHub means no remote check:
+    [[XGSettings sharedSettings]
+        setGitHubStatus:@"XGPullRequestStatusPending:Building"
+        forRepoOwner:@"owner" repoName:@"reconcile-test" branch:@"branch-1"];
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions[0].type, XGReconcileActionUpdateStatus);
+    XCTAssertFalse(plan.actions[0].needsRemoteCheck);
+    [[XGSettings sharedSettings] clear];
+}
+
+- (void) testMissingStatusesAreNotPosted {
+    [[XGSettings sharedSettings] clear];
+    XGGitHubPullRequest *pr1 = [self pullRequestWithNumber:1 sha:@"aaa"];
+    XGGitHubPullRequest *pr2 = [self pullRequestWithNumber:2 sha:@"bbb"];
+    XGXcodeBot *template = [[XGXcodeBot alloc] initWithServerName:@"localhost" dictionary:@{
+        @"name": @"Template", @"_id": @"template"
+    }];
+    XGXcodeBot *bot1 = [self botForPullRequest:pr1 number:@"1"];
+
+    // The statuses couldn't be fetched. PR 2 still gets its bot, but PR 1 isn't marked pending:
+    XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+    snapshot.templateBot = template;
+    snapshot.bots = @{ template.name: template, bot1.name: bot1 };
+    snapshot.botStatuses = @{};
+    snapshot.pullRequests = @{ pr1.number: pr1, pr2.number: pr2 };
+
+    XGReconcilePlan *plan = [[XGReconciler new] planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 1);
+    XCTAssertEqual(plan.actions[0].type, XGReconcileActionCreateBot);
+    XCTAssertEqualObjects(plan.actions[0].pullRequest.number, @"2");
+    XCTAssertNil(plan.fingerprints[@"1"]);
+}
+
+- (void) testUnchangedPullRequestsAreSkipped {
+    [[XGSettings sharedSettings] clear];
+    XGGitHubPullRequest *pr1 = [self pullRequestWithNumber:1 sha:@"aaa"];
+    XGXcodeBot *bot1 = [self botForPullRequest:pr1 number:@"1"];
+
+    XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+    snapshot.bots = @{ bot1.name: bot1 };
+    snapshot.botStatuses = @{ bot1.name: [self statusForBot:bot1 integration:4 result:@"succeeded"] };
+    snapshot.pullRequests = @{ pr1.number: pr1 };
+
+    // A dry run doesn't remember the fingerprints:
+    XGReconciler *reconciler = [XGReconciler new];
+    XGCommandOptions *options = [XGCommandOptions new];
+    options.dryRun = YES;
+    XGReconcilePlan *plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 2);
+    XCTAssertNil([reconciler applyPlan:plan options:options]);
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 2);
+
+    // An empty plan is applied without any network requests:
+    [[XGSettings sharedSettings]
+        setGitHubStatus:@"XGPullRequestStatusSuccess:Succeeded"
+        forRepoOwner:@"owner" repoName:@"reconcile-test" branch:@"branch-1"];
+    options.dryRun = NO;
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 0);
+    XCTAssertNil([reconciler applyPlan:plan options:options]);
+
+    // Now the same snapshot is skipped even when the cached status is gone:
+    [[XGSettings sharedSettings] clear];
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 0);
+    XCTAssertEqual(plan.unchangedCount, 1);
+
+    // A new commit on the PR changes the fingerprint:
+    XGGitHubPullRequest *pr1b = [self pullRequestWithNumber:1 sha:@"ccc"];
+    snapshot.pullRequests = @{ pr1b.number: pr1b };
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 2);
+    XCTAssertEqual(plan.unchangedCount, 0);
+
+    // And so does a new integration:
+    snapshot.pullRequests = @{ pr1.number: pr1 };
+    snapshot.botStatuses = @{ bot1.name: [self statusForBot:bot1 integration:5 result:@"test-failures"] };
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 2);
+    XCTAssertEqual(plan.actions[0].status, XGPullRequestStatusFailure);
+    XCTAssertEqual(plan.unchangedCount, 0);
+
+    // After a reset every PR is checked again:
+    snapshot.botStatuses = @{ bot1.name: [self statusForBot:bot1 integration:4 result:@"succeeded"] };
+    XCTAssertEqual([reconciler planWithSnapshot:snapshot].unchangedCount, 1);
+    [reconciler reset];
+    XCTAssertEqual([reconciler planWithSnapshot:snapshot].unchangedCount, 0);
+}
+
+- (void) testPartialSnapshot {
+    [[XGSettings sharedSettings] clear];
+    XGGitHubPullRequest *pr1 = [self pullRequestWithNumber:1 sha:@"aaa"];
+    XGGitHubPullRequest *pr2 = [self pullRequestWithNumber:2 sha:@"bbb"];
+    XGXcodeBot *bot1 = [self botForPullRequest:pr1 number:@"1"];
+    XGXcodeBot *bot2 = [self botForPullRequest:pr2 number:@"2"];
+    [[XGSettings sharedSettings]
+        setGitHubStatus:@"XGPullRequestStatusSuccess:Succeeded"
+        forRepoOwner:@"owner" repoName:@"reconcile-test" branch:@"branch-1"];
+    [[XGSettings sharedSettings]
+        setGitHubStatus:@"XGPullRequestStatusSuccess:Succeeded"
+        forRepoOwner:@"owner" repoName:@"reconcile-test" branch:@"branch-2"];
+
+    XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+    snapshot.bots = @{ bot1.name: bot1, bot2.name: bot2 };
+    snapshot.botStatuses = @{
+        bot1.name: [self statusForBot:bot1 integration:4 result:@"succeeded"],
+        bot2.name: [self statusForBot:bot2 integration:7 result:@"succeeded"],
+    };
+    snapshot.pullRequests = @{ pr1.number: pr1, pr2.number: pr2 };
+    XGReconciler *reconciler = [XGReconciler new];
+    XGCommandOptions *options = [XGCommandOptions new];
+    XCTAssertNil([reconciler applyPlan:[reconciler planWithSnapshot:snapshot] options:options]);
+
+    // A webhook for PR 2 only sees PR 2's bot, so PR 1's bot isn't deleted:
+    XGReconcileSnapshot *partial = [XGReconcileSnapshot new];
+    partial.isPartial = YES;
+    partial.bots = @{ bot2.name: bot2 };
+    partial.botStatuses = @{ bot2.name: snapshot.botStatuses[bot2.name] };
+    partial.pullRequests = @{ pr2.number: pr2 };
+    XGReconcilePlan *plan = [reconciler planWithSnapshot:partial];
+    XCTAssertEqual(plan.actions.count, 0);
+    XCTAssertEqual(plan.unchangedCount, 1);
+    XCTAssertNil([reconciler applyPlan:plan options:options]);
+
+    // And PR 1 is still remembered:
+    [[XGSettings sharedSettings] clear];
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 0);
+    XCTAssertEqual(plan.unchangedCount, 2);
+}
+
+- (void) testUncachedStatusesAreFetchedBeforeApplying {
+    [[XGSettings sharedSettings] clear];
+
+    // GitHub already has the statuses of both PRs:
+    NSMutableArray *nodes = [NSMutableArray new];
+    for (NSInteger number = 1; number <= 2; number++) {
+        [nodes addObject:@{
+            @"number": @(number), @"title": [NSString stringWithFormat:@"Title %ld", (long) number],
+            @"state": @"OPEN",
+            @"headRefName": [NSString stringWithFormat:@"branch-%ld", (long) number],
+            @"headRefOid": [NSString stringWithFormat:@"sha-%ld", (long) number],
+            @"headRepository": @{ @"nameWithOwner": @"owner/reconcile-test" },
+            @"commits": @{ @"nodes": @[ @{ @"commit": @{ @"status": @{ @"contexts": @[ @{
+                @"state": @"SUCCESS", @"context": @"xcode-github", @"description": @"Succeeded",
+                @"createdAt": @"2018-10-01T12:00:00Z",
+            }]}}}]},
+        }];
+    }
+    XGHTTPServer *server = [[XGHTTPServer alloc] initWithHandler:^XGHTTPResponse*(XGHTTPRequest*request) {
+        NSDictionary *page = @{ @"data": @{ @"repository": @{ @"pullRequests": @{
+            @"pageInfo": @{ @"hasNextPage": @NO },
+            @"nodes": nodes,
+        }}}};
+        return [XGHTTPResponse responseWithStatusCode:200 JSONObject:page];
+    }];
+    XCTAssertNil([server startWithPort:0 localOnly:YES]);
+    XGGitHubPullRequest.graphQLURL =
+        [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/graphql", server.port]];
+    NSError *error = nil;
+    NSDictionary<NSString*, XGGitHubPullRequest*>*pullRequests =
+        [XGGitHubPullRequest pullsRequestsForRepository:@"github.com:owner/reconcile-test.git"
+            authToken:@"token" error:&error];
+    XGGitHubPullRequest.graphQLURL = nil;
+    [server stop];
+    XCTAssertNil(error);
+    XCTAssertEqual(pullRequests.count, 2);
+
+    XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+    NSMutableDictionary *bots = [NSMutableDictionary new];
+    NSMutableDictionary *botStatuses = [NSMutableDictionary new];
+    for (XGGitHubPullRequest *pr in pullRequests.objectEnumerator) {
+        XGXcodeBot *bot = [self botForPullRequest:pr number:pr.number];
+        bots[bot.name] = bot;
+        botStatuses[bot.name] = [self statusForBot:bot integration:1 result:@"succeeded"];
+    }
+    snapshot.bots = bots;
+    snapshot.botStatuses = botStatuses;
+    snapshot.pullRequests = pullRequests;
+
+    // Both statuses need checking, and are already up to date, so nothing is sent to GitHub:
+    XGReconciler *reconciler = [XGReconciler new];
+    XGReconcilePlan *plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 4);
+    XCTAssertTrue(plan.actions[0].needsRemoteCheck);
+    XCTAssertNil([reconciler applyPlan:plan options:[XGCommandOptions new]]);
+    for (NSInteger number = 1; number <= 2; number++) {
+        NSString *status =
+            [[XGSettings sharedSettings]
+                gitHubStatusForRepoOwner:@"owner"
+                repoName:@"reconcile-test"
+                branch:[NSString stringWithFormat:@"branch-%ld", (long) number]];
+        XCTAssertEqualObjects(status, @"XGPullRequestStatusSuccess:Succeeded");
+    }
+    [[XGSettings sharedSettings] clear];
+}
+
+- (void) testFailedChangesDontStopThePlan {
+    [[XGSettings sharedSettings] clear];
+    XGGitHubPullRequest *pr1 = [self pullRequestWithNumber:1 sha:@"aaa"];
+    XGXcodeBot *bot1 = [self botForPullRequest:pr1 number:@"1"];
+    [[XGSettings sharedSettings]
+        setGitHubStatus:@"XGPullRequestStatusSuccess:Succeeded"
+        forRepoOwner:@"owner" repoName:@"reconcile-test" branch:@"branch-1"];
+
+    // Bots on a server with a bad name can't be deleted:
+    NSMutableDictionary *bots = [NSMutableDictionary dictionaryWithObject:bot1 forKey:bot1.name];
+    for (NSString *number in @[ @"3", @"4" ]) {
+        XGXcodeBot *bot = [[XGXcodeBot alloc] initWithServerName:@"bad server" dictionary:@{
+            @"name": [NSString stringWithFormat:@"xcode-github PR#%@ Closed", number],
+            @"_id": [NSString stringWithFormat:@"bot-%@", number],
+            @"pullRequestNumber": number,
+            @"templateBotName": @"Template",
+        }];
+        bots[bot.name] = bot;
+    }
+    XGReconcileSnapshot *snapshot = [XGReconcileSnapshot new];
+    snapshot.bots = bots;
+    snapshot.botStatuses = @{ bot1.name: [self statusForBot:bot1 integration:4 result:@"succeeded"] };
+    snapshot.pullRequests = @{ pr1.number: pr1 };
+
+    XGReconciler *reconciler = [XGReconciler new];
+    XGReconcilePlan *plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 2);
+    XCTAssertNotNil([reconciler applyPlan:plan options:[XGCommandOptions new]]);
+
+    // Both deletes were tried again, and PR 1 is still remembered:
+    [[XGSettings sharedSettings] clear];
+    plan = [reconciler planWithSnapshot:snapshot];
+    XCTAssertEqual(plan.actions.count, 2);
+    XCTAssertEqual(plan.actions[0].type, XGReconcileActionDeleteBot);
+    XCTAssertEqual(plan.actions[1].type, XGReconcileActionDeleteBot);
+    XCTAssertEqual(plan.unchangedCount, 1);
+}
+
+@end
@@ -0,0 +1,110 @@
+/**
+ @file          XGReconcile.h
+ @package       xcode-github
+ @brief         Plans and applies the changes that keep Xcode bots in step with GitHub PRs.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+#import "XGCommandOptions.h"
+#import "XGGitHubPullRequest.h"
+#import "XGXcodeBot.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Returns the GitHub status that reflects an Xcode bot status.
+FOUNDATION_EXPORT XGPullRequestStatus XGPullRequestStatusFromBotStatus(XGXcodeBotStatus* botStatus);
+
+#pragma mark XGReconcileSnapshot
+
+/// The state of an Xcode server and the GitHub PRs of a template bot at one point in time.
+@interface XGReconcileSnapshot : NSObject
+@property (strong) XGXcodeBot*_Nullable templateBot;
+@property (strong) NSDictionary<NSString*, XGXcodeBot*>*bots;                 // Keyed by bot name.
+/// Keyed by bot name. A PR whose bot has no status here, or one with an error, keeps its GitHub status.
+@property (strong) NSDictionary<NSString*, XGXcodeBotStatus*>*botStatuses;
+@property (strong) NSDictionary<NSString*, XGGitHubPullRequest*>*pullRequests;// Keyed by PR number.
+
+/// The snapshot only has some PRs and their bots, like after a webhook event. The reconciler
+/// remembers the fingerprints of the other PRs rather than forgetting them.
+@property (assign) BOOL isPartial;
+@end
+
+#pragma mark - XGReconcileAction
+
+typedef NS_ENUM(NSInteger, XGReconcileActionType) {
+    XGReconcileActionCreateBot = 0,
+    XGReconcileActionDeleteBot,
+    XGReconcileActionUpdateStatus,
+    XGReconcileActionAddComment,
+};
+
+/// A single change to an Xcode server or GitHub.
+@interface XGReconcileAction : NSObject
+@property (assign) XGReconcileActionType type;
+@property (strong) NSString*_Nullable botName;
+@property (strong) XGXcodeBot*_Nullable bot;
+@property (strong) XGGitHubPullRequest*_Nullable pullRequest;
+@property (strong) XGXcodeBotStatus*_Nullable botStatus;
+@property (assign) XGPullRequestStatus status;
+@property (strong) NSString*_Nullable message;
+@property (strong) NSString*_Nullable statusHash;
+
+/// The status on GitHub isn't cached locally, so it has to be checked before it is updated.
+@property (assign) BOOL needsRemoteCheck;
+
+/// For a comment, the status update that the comment belongs to. The comment is skipped if the
+/// status update is skipped.
+@property (weak) XGReconcileAction*_Nullable statusAction;
+
+/// For a status update, a comment follows and will record the status when it's done.
+@property (assign) BOOL hasComment;
+@end
+
+#pragma mark - XGReconcilePlan
+
+/// The list of actions that bring an Xcode server up to date with GitHub.
+@interface XGReconcilePlan : NSObject
+@property (strong, readonly) NSArray<XGReconcileAction*>*actions;
+
+/// The number of PRs that were skipped because nothing changed since the last cycle.
+@property (assign, readonly) NSInteger unchangedCount;
+
+/// The fingerprints of the PRs that are up to date once the plan is done.
+@property (strong, readonly) NSDictionary<NSString*, NSString*>*fingerprints;
+@end
+
+#pragma mark - XGReconciler
+
+/**
+ The reconciler compares a snapshot with the desired state and makes a plan of the changes needed.
+
+ The reconciler remembers a fingerprint of each PR that it brought up to date: the PR head, the
+ bot's integration, and its result. If a PR has the same fingerprint in the next snapshot it is
+ skipped without any network requests.
+*/
+@interface XGReconciler : NSObject
+
+/// A shared reconciler for a server and template bot, so that fingerprints last between cycles.
++ (XGReconciler*) reconcilerForServer:(NSString*)serverName templateBotName:(NSString*)templateBotName;
+
+- (XGReconcilePlan*) planWithSnapshot:(XGReconcileSnapshot*)snapshot;
+
+/**
+ Applies the plan. Up to `options.jobs` changes are applied at a time, and a change that fails
+ doesn't stop the others. A status update and its comment are applied in order.
+
+ @param plan    The plan to apply.
+ @param options The command options. If `dryRun` is set, the plan is logged but not applied.
+ @return Returns the first error in plan order, or nil on success.
+*/
+- (NSError*_Nullable) applyPlan:(XGReconcilePlan*)plan options:(XGCommandOptions*)options;
+
+/// Forgets the remembered fingerprints so that the next plan checks every PR.
+- (void) reset;
+@end
+
+NS_ASSUME_NONNULL_END
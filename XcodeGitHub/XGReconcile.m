@@ -0,0 +1,571 @@
+/**
+ @file          XGReconcile.m
+ @package       xcode-github
+ @brief         Plans and applies the changes that keep Xcode bots in step with GitHub PRs.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGReconcile.h"
+#import "XGSettings.h"
+#import "XGUtility.h"
+#import "BNCLog.h"
+
+XGPullRequestStatus XGPullRequestStatusFromBotStatus(XGXcodeBotStatus* botStatus) {
+    NSSet<NSString*>*failureResults = [NSSet setWithArray:@[
+        @"build-errors",
+        @"test-failures",
+        @"build-failed",
+        @"canceled",
+    ]];
+    NSSet<NSString*>*successResults = [NSSet setWithArray:@[
+        @"succeeded",
+        @"warnings",
+        @"analyzer-warnings",
+    ]];
+
+    XGPullRequestStatus status = XGPullRequestStatusError;
+    if ([botStatus.currentStep isEqualToString:@"completed"]) {
+        if (botStatus.result == nil) {
+        } else
+        if ([successResults containsObject:botStatus.result]) {
+            status = XGPullRequestStatusSuccess;
+        } else
+        if ([failureResults containsObject:botStatus.result]) {
+            status = XGPullRequestStatusFailure;
+        } else {
+            status = XGPullRequestStatusError;
+        }
+    } else {
+        status = XGPullRequestStatusPending;
+    }
+    return status;
+}
+
+static NSString*_Nonnull XGStatusHash(XGPullRequestStatus status, NSString*_Nullable message) {
+    return [NSString stringWithFormat:@"%@:%@", NSStringFromXGPullRequestStatus(status), message];
+}
+
+#pragma mark XGReconcileSnapshot
+
+@implementation XGReconcileSnapshot
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _bots = @{};
+    _botStatuses = @{};
+    _pullRequests = @{};
+    return self;
+}
+
+@end
+
+#pragma mark - XGReconcileAction
+
+@interface XGReconcileAction ()
+/// The status on GitHub was fetched before the plan was applied and it is already up to date.
+@property (assign) BOOL remoteStatusIsCurrent;
+@end
+
+@implementation XGReconcileAction
+
+- (NSString*) description {
+    switch (self.type) {
+    case XGReconcileActionCreateBot:
+        return [NSString stringWithFormat:@"Create bot '%@' for PR#%@.",
+            self.botName, self.pullRequest.number];
+    case XGReconcileActionDeleteBot:
+        return [NSString stringWithFormat:@"Delete bot '%@'.", self.botName];
+    case XGReconcileActionUpdateStatus:
+        return [NSString stringWithFormat:@"Update PR#%@ with status %@: %@%@.",
+            self.pullRequest.number,
+            NSStringFromXGPullRequestStatus(self.status),
+            self.message,
+            self.needsRemoteCheck ? @" (if changed on GitHub)" : @""];
+    case XGReconcileActionAddComment:
+        return [NSString stringWithFormat:@"Comment on PR#%@ with the result of integration %@.",
+            self.pullRequest.number, self.botStatus.integrationNumber];
+    }
+    return [super description];
+}
+
+@end
+
+#pragma mark - XGReconcilePlan
+
+@interface XGReconcilePlan ()
+@property (strong) NSArray<XGReconcileAction*>*actions;
+@property (assign) NSInteger unchangedCount;
+@property (strong) NSDictionary<NSString*, NSString*>*fingerprints;
+@property (strong) NSSet<NSString*>*_Nullable partialPullRequestNumbers; // Nil for a full snapshot.
+@end
+
+@implementation XGReconcilePlan
+
+- (NSString*) description {
+    NSMutableString *string = [NSMutableString stringWithFormat:@"<%@ %p %ld actions, %ld unchanged>",
+        NSStringFromClass(self.class),
+        (void*)self,
+        (long) self.actions.count,
+        (long) self.unchangedCount];
+    for (XGReconcileAction *action in self.actions)
+        [string appendFormat:@"\n    %@", action];
+    return string;
+}
+
+@end
+
+#pragma mark - XGReconciler
+
+@interface XGReconciler ()
+@property (strong) NSDictionary<NSString*, NSString*>*fingerprints;
+@end
+
+@implementation XGReconciler
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _fingerprints = @{};
+    return self;
+}
+
++ (XGReconciler*) reconcilerForServer:(NSString*)serverName templateBotName:(NSString*)templateBotName {
+    static NSMutableDictionary<NSString*, XGReconciler*>*reconcilers = nil;
+    static dispatch_once_t onceToken = 0;
+    dispatch_once(&onceToken, ^ {
+        reconcilers = [NSMutableDictionary new];
+    });
+    NSString *key = [NSString stringWithFormat:@"%@/%@", serverName, templateBotName];
+    @synchronized(reconcilers) {
+        XGReconciler *reconciler = reconcilers[key];
+        if (!reconciler) {
+            reconciler = [XGReconciler new];
+            reconcilers[key] = reconciler;
+        }
+        return reconciler;
+    }
+}
+
+- (void) reset {
+    @synchronized(self) {
+        self.fingerprints = @{};
+    }
+}
+
++ (NSString*_Nullable) fingerprintForPullRequest:(XGGitHubPullRequest*)pr
+        botStatus:(XGXcodeBotStatus*_Nullable)botStatus {
+    if (!pr.sha || !botStatus || botStatus.error) return nil;
+    return [NSString stringWithFormat:@"%@|%@|%@|%@|%@",
+        pr.sha,
+        botStatus.integrationID,
+        botStatus.integrationNumber,
+        botStatus.currentStep,
+        botStatus.result];
+}
+
+- (XGReconcilePlan*) planWithSnapshot:(XGReconcileSnapshot*)snapshot {
+    NSDictionary<NSString*, NSString*>*knownFingerprints = nil;
+    @synchronized(self) {
+        knownFingerprints = self.fingerprints;
+    }
+    NSMutableArray<XGReconcileAction*>*actions = [NSMutableArray new];
+    NSMutableDictionary<NSString*, NSString*>*fingerprints = [NSMutableDictionary new];
+    NSInteger unchangedCount = 0;
+
+    // Work through the PRs in a stable order so that plans are easy to read:
+    NSArray<XGGitHubPullRequest*>*pullRequests =
+        [snapshot.pullRequests.allValues sortedArrayUsingComparator:
+            ^ NSComparisonResult(XGGitHubPullRequest*pr1, XGGitHubPullRequest*pr2) {
+                return [pr1.number compare:pr2.number options:NSNumericSearch];
+            }];
+
+    // Check for open pull requests with state 'open':
+    for (XGGitHubPullRequest *pr in pullRequests) {
+        if (![pr.state isEqualToString:@"open"]) continue;
+        NSString *botName = [XGXcodeBot botNameFromPRNumber:pr.number title:pr.title];
+        XGXcodeBot *bot = snapshot.bots[botName];
+        if (!bot) {
+            if (!snapshot.templateBot) continue;
+            XGReconcileAction *action = [XGReconcileAction new];
+            action.type = XGReconcileActionCreateBot;
+            action.botName = botName;
+            action.bot = snapshot.templateBot;
+            action.pullRequest = pr;
+            [actions addObject:action];
+            continue;
+        }
+
+        // A PR's status is only ever set from a status that was actually fetched:
+        XGXcodeBotStatus *botStatus = snapshot.botStatuses[botName];
+        if (!botStatus || botStatus.error) {
+            BNCLogDebug(@"No status for bot '%@' (%@). Not updating PR#%@.",
+                botName, botStatus.error, pr.number);
+            continue;
+        }
+        NSString *fingerprint = [self.class fingerprintForPullRequest:pr botStatus:botStatus];
+        if (fingerprint) {
+            fingerprints[pr.number] = fingerprint;
+            if ([knownFingerprints[pr.number] isEqualToString:fingerprint]) {
+                unchangedCount++;
+                continue;
+            }
+        }
+
+        XGPullRequestStatus status = XGPullRequestStatusFromBotStatus(botStatus);
+        NSString *message = botStatus.summaryString;
+        NSString *statusHash = XGStatusHash(status, message);
+        NSString *lastStatusHash =
+            [[XGSettings sharedSettings]
+                gitHubStatusForRepoOwner:pr.repoOwner
+                repoName:pr.repoName
+                branch:pr.branch];
+        if ([lastStatusHash isEqualToString:statusHash]) continue;
+
+        XGReconcileAction *statusAction = [XGReconcileAction new];
+        statusAction.type = XGReconcileActionUpdateStatus;
+        statusAction.botName = botName;
+        statusAction.bot = bot;
+        statusAction.pullRequest = pr;
+        statusAction.botStatus = botStatus;
+        statusAction.status = status;
+        statusAction.message = message;
+        statusAction.statusHash = statusHash;
+        statusAction.needsRemoteCheck = (lastStatusHash == nil);
+        [actions addObject:statusAction];
+
+        // Add a completion message to the PR:
+        if ([botStatus.currentStep isEqualToString:@"completed"]) {
+            XGReconcileAction *commentAction = [XGReconcileAction new];
+            commentAction.type = XGReconcileActionAddComment;
+            commentAction.botName = botName;
+            commentAction.bot = bot;
+            commentAction.pullRequest = pr;
+            commentAction.botStatus = botStatus;
+            commentAction.statusHash = statusHash;
+            commentAction.statusAction = statusAction;
+            statusAction.hasComment = YES;
+            [actions addObject:commentAction];
+        }
+    }
+
+    // Check for bots with no PR and delete them:
+    NSArray<NSString*>*botNames = [snapshot.bots.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString *botName in botNames) {
+        XGXcodeBot *bot = snapshot.bots[botName];
+        NSString *number = bot.pullRequestNumber;
+        if (number && !snapshot.pullRequests[number]) {
+            XGReconcileAction *action = [XGReconcileAction new];
+            action.type = XGReconcileActionDeleteBot;
+            action.botName = botName;
+            action.bot = bot;
+            [actions addObject:action];
+        }
+    }
+
+    XGReconcilePlan *plan = [XGReconcilePlan new];
+    plan.actions = actions;
+    plan.unchangedCount = unchangedCount;
+    plan.fingerprints = fingerprints;
+    if (snapshot.isPartial) {
+        NSMutableSet<NSString*>*numbers = [NSMutableSet setWithArray:snapshot.pullRequests.allKeys];
+        for (XGXcodeBot *bot in snapshot.bots.objectEnumerator)
+            if (bot.pullRequestNumber) [numbers addObject:bot.pullRequestNumber];
+        plan.partialPullRequestNumbers = numbers;
+    }
+    return plan;
+}
+
+#pragma mark - Applying Plans
+
+- (NSError*_Nullable) applyPlan:(XGReconcilePlan*)plan options:(XGCommandOptions*)options {
+    if (options.dryRun) {
+        BNCLog(@"Dry run. Would apply %@", plan);
+        return nil;
+    }
+    BNCLogDebug(@"Applying %@", plan);
+    [self hydrateStatusesForPlan:plan];
+
+    // A comment is applied after its status update, so they're kept together:
+    NSMutableArray<NSMutableArray<XGReconcileAction*>*>*items = [NSMutableArray new];
+    NSMapTable<XGReconcileAction*, NSMutableArray*>*itemsByStatusAction = [NSMapTable strongToStrongObjectsMapTable];
+    for (XGReconcileAction *action in plan.actions) {
+        NSMutableArray *item = (action.statusAction) ? [itemsByStatusAction objectForKey:action.statusAction] : nil;
+        if (item) {
+            [item addObject:action];
+            continue;
+        }
+        item = [NSMutableArray arrayWithObject:action];
+        [items addObject:item];
+        if (action.type == XGReconcileActionUpdateStatus)
+            [itemsByStatusAction setObject:item forKey:action];
+    }
+
+    // Apply the items `jobs` at a time. A failed item doesn't stop the others:
+    NSDate *startDate = [NSDate date];
+    NSMutableArray *errors = [NSMutableArray new];
+    NSMutableSet<NSString*>*failedNumbers = [NSMutableSet new];
+    __block NSTimeInterval totalLatency = 0.0;
+    __block NSTimeInterval longestLatency = 0.0;
+    for (NSUInteger i = 0; i < items.count; i++) [errors addObject:[NSNull null]];
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    NSArray<NSNumber*>*indexes = [self.class indexesForCount:items.count];
+    XGAsyncForEach(indexes, options.jobs, ^ (NSNumber *index, dispatch_block_t done) {
+        NSDate *itemDate = [NSDate date];
+        NSArray<XGReconcileAction*>*item = items[index.integerValue];
+        [self applyActions:item completion:^ (NSError*_Nullable error) {
+            NSTimeInterval latency = - itemDate.timeIntervalSinceNow;
+            @synchronized(errors) {
+                totalLatency += latency;
+                longestLatency = MAX(longestLatency, latency);
+                if (error) {
+                    errors[index.integerValue] = error;
+                    XGReconcileAction *action = item.firstObject;
+                    NSString *number = action.pullRequest.number ?: action.bot.pullRequestNumber;
+                    if (number) [failedNumbers addObject:number];
+                }
+            }
+            if (error) BNCLogError(@"Failed: %@ Error: %@.", item.firstObject, error);
+            done();
+        }];
+    }, ^ {
+        dispatch_semaphore_signal(semaphore);
+    });
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+
+    NSError *error = nil;
+    NSInteger errorCount = 0;
+    for (id e in errors) {
+        if (e == [NSNull null]) continue;
+        if (!error) error = e;
+        errorCount++;
+    }
+    if (items.count > 0) {
+        NSTimeInterval elapsed = - startDate.timeIntervalSinceNow;
+        BNCLogDebug(@"Applied %ld changes, %ld failed, in %@ (%1.1f per second). Average latency %@, longest %@.",
+            (long) items.count, (long) errorCount,
+            XGDurationStringFromTimeInterval(elapsed),
+            (elapsed > 0.0) ? (double) items.count / elapsed : 0.0,
+            XGDurationStringFromTimeInterval(totalLatency / items.count),
+            XGDurationStringFromTimeInterval(longestLatency));
+    }
+
+    // Only remember the PRs that are up to date:
+    NSMutableDictionary *planFingerprints = [plan.fingerprints mutableCopy];
+    [planFingerprints removeObjectsForKeys:failedNumbers.allObjects];
+    @synchronized(self) {
+        if (plan.partialPullRequestNumbers) {
+            NSMutableDictionary *fingerprints = [self.fingerprints mutableCopy];
+            [fingerprints removeObjectsForKeys:plan.partialPullRequestNumbers.allObjects];
+            [fingerprints addEntriesFromDictionary:planFingerprints];
+            self.fingerprints = fingerprints;
+        } else {
+            self.fingerprints = planFingerprints;
+        }
+    }
+    return error;
+}
+
++ (NSArray<NSNumber*>*) indexesForCount:(NSUInteger)count {
+    NSMutableArray *indexes = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) [indexes addObject:@(i)];
+    return indexes;
+}
+
+/// Applies the actions in order. Stops at the first error, or when a status update is skipped.
+- (void) applyActions:(NSArray<XGReconcileAction*>*)actions
+        completion:(void (^_Nonnull)(NSError*_Nullable error))completion {
+    if (actions.count == 0) {
+        completion(nil);
+        return;
+    }
+    XGReconcileAction *action = actions.firstObject;
+    NSArray *remainingActions = [actions subarrayWithRange:NSMakeRange(1, actions.count-1)];
+    void (^next)(NSError*_Nullable error, BOOL skipped) = ^ (NSError*_Nullable error, BOOL skipped) {
+        if (error || skipped)
+            completion(error);
+        else
+            [self applyActions:remainingActions completion:completion];
+    };
+    switch (action.type) {
+    case XGReconcileActionCreateBot:
+        [self createBot:action completion:^ (NSError*_Nullable error) { next(error, NO); }];
+        break;
+    case XGReconcileActionDeleteBot:
+        [self deleteBot:action completion:^ (NSError*_Nullable error) { next(error, NO); }];
+        break;
+    case XGReconcileActionUpdateStatus:
+        [self updateStatus:action completion:next];
+        break;
+    case XGReconcileActionAddComment:
+        [self addComment:action completion:^ (NSError*_Nullable error) { next(error, NO); }];
+        break;
+    }
+}
+
+/**
+ Fetches the GitHub status of every PR that has no cached status, several at a time, so that the
+ status updates don't each wait on a request first. This is mostly after a restart or after the
+ cached statuses expire. A PR whose fetch fails is checked again when its status is updated.
+*/
+- (void) hydrateStatusesForPlan:(XGReconcilePlan*)plan {
+    NSMutableArray<XGReconcileAction*>*actions = [NSMutableArray new];
+    for (XGReconcileAction *action in plan.actions) {
+        if (action.type == XGReconcileActionUpdateStatus && action.needsRemoteCheck)
+            [actions addObject:action];
+    }
+    if (actions.count < 2) return;
+
+    NSDate *startDate = [NSDate date];
+    __block NSInteger fetchedCount = 0;
+    __block NSInteger currentCount = 0;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    XGAsyncForEach(actions, 8, ^ (XGReconcileAction *action, dispatch_block_t done) {
+        XGGitHubPullRequest *pr = action.pullRequest;
+        [pr statusesWithQueue:nil
+            completion:^(NSArray<XGGitHubPullRequestStatus*>*_Nullable statuses, NSError*_Nullable error) {
+            if (!error) {
+                @synchronized(actions) {
+                    fetchedCount++;
+                }
+                action.needsRemoteCheck = NO;
+                XGGitHubPullRequestStatus *status = statuses.firstObject;
+                if (status) {
+                    NSString *lastStatusHash = XGStatusHash(status.status, status.message);
+                    [[XGSettings sharedSettings]
+                        setGitHubStatus:lastStatusHash
+                        forRepoOwner:pr.repoOwner
+                        repoName:pr.repoName
+                        branch:pr.branch];
+                    action.remoteStatusIsCurrent = [lastStatusHash isEqualToString:action.statusHash];
+                    if (action.remoteStatusIsCurrent) {
+                        @synchronized(actions) {
+                            currentCount++;
+                        }
+                    }
+                }
+            }
+            done();
+        }];
+    }, ^ {
+        dispatch_semaphore_signal(semaphore);
+    });
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    BNCLogDebug(@"Fetched %ld of %ld uncached PR statuses in %@. %ld were already current and aren't posted.",
+        (long) fetchedCount, (long) actions.count,
+        XGDurationStringFromTimeInterval(- startDate.timeIntervalSinceNow), (long) currentCount);
+}
+
+- (void) createBot:(XGReconcileAction*)action completion:(void (^_Nonnull)(NSError*_Nullable error))completion {
+    // The pending status and the new bot don't depend on each other, so they're sent together:
+    XGGitHubPullRequest *pr = action.pullRequest;
+    BNCLogDebug(@"Creating bot '%@'...", action.botName);
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_enter(group);
+    [pr setStatus:XGPullRequestStatusPending
+        message:@"Creating Xcode bot..."
+        statusURL:nil
+        queue:nil
+        completion:^ (NSError*_Nullable error) {
+            dispatch_group_leave(group);
+        }];
+    __block NSError *botError = nil;
+    dispatch_group_enter(group);
+    [action.bot duplicateBotWithNewName:action.botName
+        branchName:pr.branch
+        gitHubPullRequestNumber:pr.number
+        gitHubPullRequestTitle:pr.title
+        queue:nil
+        completion:^ (XGXcodeBot*_Nullable bot, NSError*_Nullable error) {
+            botError = error;
+            dispatch_group_leave(group);
+        }];
+    dispatch_group_notify(group, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        completion(botError);
+    });
+}
+
+- (void) deleteBot:(XGReconcileAction*)action completion:(void (^_Nonnull)(NSError*_Nullable error))completion {
+    XGXcodeBot *bot = action.bot;
+    BNCLogDebug(@"Deleting old bot '%@'...", bot.name);
+    [bot deleteBotWithQueue:nil completion:^ (NSError*_Nullable error) {
+        if (!error) {
+            [[XGSettings sharedSettings]
+                deleteGitHubStatusForRepoOwner:bot.repoOwner
+                repoName:bot.repoName
+                branch:bot.branch];
+        }
+        completion(error);
+    }];
+}
+
+- (void) updateStatus:(XGReconcileAction*)action
+        completion:(void (^_Nonnull)(NSError*_Nullable error, BOOL skipped))completion {
+    if (action.remoteStatusIsCurrent) {
+        completion(nil, YES);
+        return;
+    }
+    if (!action.needsRemoteCheck) {
+        [self sendStatus:action completion:completion];
+        return;
+    }
+    // Get the most recent status from GitHub:
+    XGGitHubPullRequest *pr = action.pullRequest;
+    [pr statusesWithQueue:nil
+        completion:^ (NSArray<XGGitHubPullRequestStatus*>*_Nullable statuses, NSError*_Nullable error) {
+        XGGitHubPullRequestStatus *status = statuses.firstObject;
+        if (status) {
+            NSString *lastStatusHash = XGStatusHash(status.status, status.message);
+            [[XGSettings sharedSettings]
+                setGitHubStatus:lastStatusHash
+                forRepoOwner:pr.repoOwner
+                repoName:pr.repoName
+                branch:pr.branch];
+            if ([lastStatusHash isEqualToString:action.statusHash]) {
+                completion(nil, YES);
+                return;
+            }
+        }
+        [self sendStatus:action completion:completion];
+    }];
+}
+
+- (void) sendStatus:(XGReconcileAction*)action
+        completion:(void (^_Nonnull)(NSError*_Nullable error, BOOL skipped))completion {
+    XGGitHubPullRequest *pr = action.pullRequest;
+    [pr setStatus:action.status
+        message:action.message
+        statusURL:nil
+        queue:nil
+        completion:^ (NSError*_Nullable error) {
+            if (!error && !action.hasComment) {
+                [[XGSettings sharedSettings]
+                    setGitHubStatus:action.statusHash
+                    forRepoOwner:pr.repoOwner
+                    repoName:pr.repoName
+                    branch:pr.branch];
+            }
+            completion(error, NO);
+        }];
+}
+
+- (void) addComment:(XGReconcileAction*)action completion:(void (^_Nonnull)(NSError*_Nullable error))completion {
+    XGGitHubPullRequest *pr = action.pullRequest;
+    [pr addComment:[action.botStatus.formattedDetailString renderMarkDown]
+        queue:nil
+        completion:^ (NSError*_Nullable error) {
+            if (!error) {
+                [[XGSettings sharedSettings]
+                    setGitHubStatus:action.statusHash
+                    forRepoOwner:pr.repoOwner
+                    repoName:pr.repoName
+                    branch:pr.branch];
+            }
+            completion(error);
+        }];
+}
+
+@end
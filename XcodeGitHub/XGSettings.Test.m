@@ -49,4 +49,25 @@
     XCTAssertNil(test);
 }
 
+- (void) testPersistence {
+    XGSettings*settings = [XGSettings new];
+    [settings clear];
+    [settings setGitHubStatus:@"Status1" forRepoOwner:@"owner" repoName:@"name1" branch:@"pr1"];
+    [settings setGitHubStatus:@"Status2" forRepoOwner:@"owner" repoName:@"name2" branch:@"pr2"];
+    [settings deleteGitHubStatusForRepoOwner:@"owner" repoName:@"name2" branch:@"pr2"];
+
+    [settings flush];
+    NSDictionary*saved = [[NSUserDefaults standardUserDefaults] dictionaryForKey:@"githubStatus"];
+    XCTAssertEqualObjects(saved[@"owner-name1-pr1"][@"status"], @"Status1");
+    XCTAssertNil(saved[@"owner-name2-pr2"]);
+
+    // A new store loads what was saved:
+    XGSettings*loaded = [XGSettings new];
+    NSString*test = [loaded gitHubStatusForRepoOwner:@"owner" repoName:@"name1" branch:@"pr1"];
+    XCTAssertEqualObjects(test, @"Status1");
+    test = [loaded gitHubStatusForRepoOwner:@"owner" repoName:@"name2" branch:@"pr2"];
+    XCTAssertNil(test);
+    [loaded clear];
+}
+
 @end
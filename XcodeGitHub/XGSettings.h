@@ -12,6 +12,10 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ The GitHub statuses that xcode-github has set, kept in memory and saved to the user defaults a
+ short time after they change. The settings are saved when the process exits too.
+*/
 @interface XGSettings : NSObject
 
 + (XGSettings*) sharedSettings;
@@ -32,6 +36,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// Clears all settings.
 - (void) clear;
 
+/// Saves any unsaved changes now.
+- (void) flush;
+
 /// Time in seconds to expire old entries. Defaults 7 days.
 @property (assign) NSTimeInterval dataExpirationSeconds;
 @end
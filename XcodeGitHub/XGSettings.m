@@ -9,46 +9,30 @@
 */
 
 #import "XGSettings.h"
+#import "XGUtility.h"
+#import "BNCLog.h"
 
-@interface NSMutableDictionary (XG)
-+ (instancetype _Nonnull) mutableDeepCopy:(NSDictionary*)dictionary;
-@end
-
-@implementation NSMutableDictionary (XG)
-
-+ (instancetype _Nonnull) mutableDeepCopy:(NSDictionary*)dictionary {
-    NSError*error = nil;
-    NSMutableDictionary*result = nil;
-    if (!dictionary) goto exit;
-
-    {
-    NSData*data =
-        [NSPropertyListSerialization dataWithPropertyList:dictionary
-            format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
-    if (!data || error) goto exit;
+static NSString*const kGitHubStatusKey = @"githubStatus";
 
-    result =
-        [NSPropertyListSerialization propertyListWithData:data
-            options:NSPropertyListMutableContainersAndLeaves format:NULL error:&error];
-    }
-    
-exit:
-    if (error) NSLog(@"Error creating mutable dictionary: %@.", error);
-    if (!result) result = [NSMutableDictionary new];
-    return result;
-}
+/// Entries are grouped by the minute they were written so that expired ones can be dropped a
+/// whole bucket at a time, without looking at every entry.
+static NSTimeInterval const kExpirationBucketSeconds = 60.0;
 
-@end
+/// Changes are written to the user defaults at most this often.
+static NSTimeInterval const kFlushDelaySeconds = 2.0;
 
-#pragma mark - XGSettings
+#pragma mark XGSettings
 
 @interface XGSettings () {
     NSTimeInterval _dataExpirationSeconds;
+    dispatch_queue_t _queue;
+    NSMutableDictionary<NSString*, NSDictionary*>*_statuses;
+    NSMutableDictionary<NSNumber*, NSMutableSet<NSString*>*>*_buckets;
+    long _oldestBucket;
+    XGDeferredFlush *_deferredFlush;
 }
 @end
 
-static NSString*const kGitHubStatusKey = @"githubStatus";
-
 @implementation XGSettings
 
 + (XGSettings*_Nonnull) sharedSettings {
@@ -63,40 +47,121 @@ static NSString*const kGitHubStatusKey = @"githubStatus";
 - (instancetype) init {
     self = [super init];
     if (!self) return self;
-    self.dataExpirationSeconds = 60.0*60.0*24.0*7.0;
+    _queue = dispatch_queue_create("io.branch.xcode-github.settings", DISPATCH_QUEUE_CONCURRENT);
+    _dataExpirationSeconds = - 60.0*60.0*24.0*7.0;
+    _statuses = [NSMutableDictionary new];
+    _buckets = [NSMutableDictionary new];
+    _oldestBucket = LONG_MAX;
+    __weak __typeof(self) weakSelf = self;
+    _deferredFlush = [[XGDeferredFlush alloc] initWithDelay:kFlushDelaySeconds storeQueue:_queue save:^{
+        [weakSelf save];
+    }];
+
+    NSDictionary*dictionary = [[NSUserDefaults standardUserDefaults] dictionaryForKey:kGitHubStatusKey];
+    for (NSString*key in dictionary.keyEnumerator) {
+        NSDictionary*entry = dictionary[key];
+        if ([entry isKindOfClass:NSDictionary.class] &&
+            [entry[@"date"] isKindOfClass:NSDate.class] &&
+            [entry[@"status"] isKindOfClass:NSString.class])
+            [self indexEntry:entry forKey:key];
+    }
+    [self expireOldData];
     return self;
 }
 
 - (NSTimeInterval) dataExpirationSeconds {
-    @synchronized(self) {
-        return _dataExpirationSeconds;
-    }
+    __block NSTimeInterval seconds = 0.0;
+    dispatch_sync(_queue, ^{ seconds = self->_dataExpirationSeconds; });
+    return seconds;
 }
 
 - (void) setDataExpirationSeconds:(NSTimeInterval)dataExpirationSeconds_ {
-    @synchronized(self) {
-        _dataExpirationSeconds = - fabs(dataExpirationSeconds_);
+    dispatch_barrier_sync(_queue, ^{
+        self->_dataExpirationSeconds = - fabs(dataExpirationSeconds_);
+    });
+}
+
+#pragma mark - Index
+
+// The index methods below are called on the queue as a barrier.
+
++ (long) bucketForDate:(NSDate*)date {
+    return (long) floor(date.timeIntervalSinceReferenceDate / kExpirationBucketSeconds);
+}
+
+- (void) indexEntry:(NSDictionary*)entry forKey:(NSString*)key {
+    [self removeEntryForKey:key];
+    _statuses[key] = entry;
+    long bucket = [self.class bucketForDate:entry[@"date"]];
+    NSMutableSet*keys = _buckets[@(bucket)];
+    if (!keys) {
+        keys = [NSMutableSet new];
+        _buckets[@(bucket)] = keys;
     }
+    [keys addObject:key];
+    _oldestBucket = MIN(_oldestBucket, bucket);
+}
+
+- (void) removeEntryForKey:(NSString*)key {
+    NSDictionary*entry = _statuses[key];
+    if (!entry) return;
+    [_statuses removeObjectForKey:key];
+    NSNumber*bucket = @([self.class bucketForDate:entry[@"date"]]);
+    NSMutableSet*keys = _buckets[bucket];
+    [keys removeObject:key];
+    if (keys.count == 0) [_buckets removeObjectForKey:bucket];
 }
 
 - (void) expireOldData {
-    @synchronized(self) {
-        NSMutableArray*deletions = [NSMutableArray new];
-        NSMutableDictionary*dictionary =
-            [NSMutableDictionary mutableDeepCopy:
-                [[NSUserDefaults standardUserDefaults] objectForKey:kGitHubStatusKey]];
-        NSTimeInterval age = self.dataExpirationSeconds;
-        for (NSString*key in dictionary.keyEnumerator) {
-            NSDate*date = dictionary[key][@"date"];
-            if (!date || [date timeIntervalSinceNow] < age) {
-                [deletions addObject:key];
-            }
+    // Drop the buckets that are entirely older than the expiration date. Entries in the bucket
+    // that straddles the date are checked when they're read:
+    NSDate*expirationDate = [NSDate dateWithTimeIntervalSinceNow:_dataExpirationSeconds];
+    long lastExpiredBucket = [self.class bucketForDate:expirationDate] - 1;
+    if (_oldestBucket > lastExpiredBucket) return;
+
+    if (lastExpiredBucket - _oldestBucket > (long) _buckets.count) {
+        // A long jump (like after the expiration was shortened) is quicker by looking at the buckets:
+        for (NSNumber*bucket in _buckets.allKeys) {
+            if (bucket.longValue <= lastExpiredBucket) [self expireBucket:bucket];
         }
-        [dictionary removeObjectsForKeys:deletions];
-        [[NSUserDefaults standardUserDefaults] setObject:dictionary forKey:kGitHubStatusKey];
+    } else {
+        for (long bucket = _oldestBucket; bucket <= lastExpiredBucket; bucket++)
+            [self expireBucket:@(bucket)];
     }
+    _oldestBucket = LONG_MAX;
+    for (NSNumber*bucket in _buckets.keyEnumerator)
+        _oldestBucket = MIN(_oldestBucket, bucket.longValue);
+}
+
+- (void) expireBucket:(NSNumber*)bucket {
+    NSMutableSet*keys = _buckets[bucket];
+    if (!keys) return;
+    [_statuses removeObjectsForKeys:keys.allObjects];
+    [_buckets removeObjectForKey:bucket];
+    [self setNeedsFlush];
+}
+
+#pragma mark - Persistence
+
+- (void) setNeedsFlush {
+    [_deferredFlush setNeedsFlush];
+}
+
+- (void) flush {
+    [_deferredFlush flush];
+}
+
+- (void) save {
+    __block NSDictionary*dictionary = nil;
+    dispatch_sync(_queue, ^{
+        dictionary = [self->_statuses copy];
+    });
+    BNCLogDebug(@"Saving %ld GitHub statuses.", (long) dictionary.count);
+    [[NSUserDefaults standardUserDefaults] setObject:dictionary forKey:kGitHubStatusKey];
 }
 
+#pragma mark - Statuses
+
 - (NSString*) keyForRepoOwner:(NSString*)repoOwner
         repoName:(NSString*)repoName
         branch:(NSString*)branch {
@@ -107,46 +172,52 @@ static NSString*const kGitHubStatusKey = @"githubStatus";
         forRepoOwner:(NSString*)repoOwner
         repoName:(NSString*)repoName
         branch:(NSString*)branch {
-    @synchronized(self) {
+    if (!status) return;
+    NSString*key = [self keyForRepoOwner:repoOwner repoName:repoName branch:branch];
+    NSDictionary*entry = @{
+        @"date":    [NSDate date],
+        @"status":  status
+    };
+    dispatch_barrier_async(_queue, ^{
         [self expireOldData];
-        if (!status) return;
-        NSMutableDictionary*dictionary =
-            [NSMutableDictionary mutableDeepCopy:
-                [[NSUserDefaults standardUserDefaults]
-                    dictionaryForKey:kGitHubStatusKey]];
-        dictionary[[self keyForRepoOwner:repoOwner repoName:repoName branch:branch]] = @{
-            @"date":    [NSDate date],
-            @"status":  status
-        };
-        [[NSUserDefaults standardUserDefaults] setObject:dictionary forKey:kGitHubStatusKey];
-    }
+        [self indexEntry:entry forKey:key];
+        [self setNeedsFlush];
+    });
 }
 
 - (NSString*_Nullable) gitHubStatusForRepoOwner:(NSString*)repoOwner
         repoName:(NSString*)repoName
         branch:(NSString*)branch {
-    @synchronized(self) {
-        [self expireOldData];
-        NSDictionary*dictionary = [[NSUserDefaults standardUserDefaults] dictionaryForKey:kGitHubStatusKey];
-        return dictionary[[self keyForRepoOwner:repoOwner repoName:repoName branch:branch]][@"status"];
-    }
+    NSString*key = [self keyForRepoOwner:repoOwner repoName:repoName branch:branch];
+    __block NSDictionary*entry = nil;
+    __block NSTimeInterval age = 0.0;
+    dispatch_sync(_queue, ^{
+        entry = self->_statuses[key];
+        age = self->_dataExpirationSeconds;
+    });
+    if ([entry[@"date"] timeIntervalSinceNow] < age) return nil;
+    return entry[@"status"];
 }
 
 - (void) deleteGitHubStatusForRepoOwner:(NSString*)repoOwner
         repoName:(NSString*)repoName
         branch:(NSString*)branch {
-    @synchronized(self) {
+    NSString*key = [self keyForRepoOwner:repoOwner repoName:repoName branch:branch];
+    dispatch_barrier_async(_queue, ^{
         [self expireOldData];
-        NSMutableDictionary*dictionary =
-            [NSMutableDictionary mutableDeepCopy:
-                [[NSUserDefaults standardUserDefaults]
-                    dictionaryForKey:kGitHubStatusKey]];
-        dictionary[[self keyForRepoOwner:repoOwner repoName:repoName branch:branch]] = nil;
-        [[NSUserDefaults standardUserDefaults] setObject:dictionary forKey:kGitHubStatusKey];
-    }
+        if (!self->_statuses[key]) return;
+        [self removeEntryForKey:key];
+        [self setNeedsFlush];
+    });
 }
 
 - (void) clear {
+    dispatch_barrier_sync(_queue, ^{
+        [self->_statuses removeAllObjects];
+        [self->_buckets removeAllObjects];
+        self->_oldestBucket = LONG_MAX;
+    });
+    [_deferredFlush cancel];
     [[NSUserDefaults standardUserDefaults] removeObjectForKey:kGitHubStatusKey];
 }
 
@@ -0,0 +1,149 @@
+/**
+ @file          XGUtility.Test.m
+ @package       xcode-github
+ @brief         Tests for XGUtility.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGUtility.h"
+
+@interface XGUtilityTest : BNCTestCase
+@end
+
+@implementation XGUtilityTest
+
+- (void) testDispatchOnQueue {
+    // Without a queue the block runs right away:
+    __block BOOL didRun = NO;
+    XGDispatchOnQueue(nil, ^{ didRun = YES; });
+    XCTAssertTrue(didRun);
+
+    // Otherwise it runs later on the queue:
+    static char kQueueKey = 0;
+    dispatch_queue_t queue = dispatch_queue_create("io.branch.xcode-github.test", DISPATCH_QUEUE_SERIAL);
+    dispatch_queue_set_specific(queue, &kQueueKey, &kQueueKey, NULL);
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    __block BOOL isOnQueue = NO;
+    XGDispatchOnQueue(queue, ^{
+        isOnQueue = (dispatch_get_specific(&kQueueKey) == &kQueueKey);
+        dispatch_semaphore_signal(semaphore);
+    });
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertTrue(isOnQueue);
+}
+
+- (void) testAsyncForEachLimit {
+    NSMutableArray *items = [NSMutableArray new];
+    for (NSInteger i = 0; i < 20; i++) [items addObject:@(i)];
+
+    NSMutableSet *doneItems = [NSMutableSet new];
+    __block NSInteger inProgressCount = 0;
+    __block NSInteger maximumInProgressCount = 0;
+    __block NSInteger completionCount = 0;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    XGAsyncForEach(items, 3, ^ (id item, dispatch_block_t done) {
+        @synchronized(self) {
+            inProgressCount++;
+            maximumInProgressCount = MAX(maximumInProgressCount, inProgressCount);
+        }
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.01 * NSEC_PER_SEC)),
+            dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            @synchronized(self) {
+                inProgressCount--;
+                [doneItems addObject:item];
+            }
+            done();
+        });
+    }, ^ {
+        @synchronized(self) {
+            completionCount++;
+        }
+        dispatch_semaphore_signal(semaphore);
+    });
+    XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    [NSThread sleepForTimeInterval:0.1];
+    @synchronized(self) {
+        XCTAssertEqual(completionCount, 1);
+        XCTAssertEqual(maximumInProgressCount, 3);
+        XCTAssertEqualObjects(doneItems, [NSSet setWithArray:items]);
+    }
+}
+
+- (void) testAsyncForEachSynchronousWork {
+    // Work that finishes right away, and a limit larger than the item count:
+    __block NSInteger workCount = 0;
+    __block NSInteger completionCount = 0;
+    XGAsyncForEach(@[ @1, @2, @3 ], 10, ^ (id item, dispatch_block_t done) {
+        workCount++;
+        done();
+    }, ^ {
+        completionCount++;
+    });
+    XCTAssertEqual(workCount, 3);
+    XCTAssertEqual(completionCount, 1);
+
+    // No items:
+    completionCount = 0;
+    XGAsyncForEach(@[], 2, ^ (id item, dispatch_block_t done) {
+        XCTFail(@"There's no work.");
+        done();
+    }, ^ {
+        completionCount++;
+    });
+    XCTAssertEqual(completionCount, 1);
+}
+
+- (void) testDeferredFlushAll {
+    dispatch_queue_t storeQueue = dispatch_queue_create("io.branch.xcode-github.test", DISPATCH_QUEUE_CONCURRENT);
+    __block NSInteger keptSaveCount = 0;
+    __block NSInteger releasedSaveCount = 0;
+    XGDeferredFlush *kept =
+        [[XGDeferredFlush alloc] initWithDelay:60.0 storeQueue:storeQueue save:^{ keptSaveCount++; }];
+    __weak XGDeferredFlush *weakReleased = nil;
+    @autoreleasepool {
+        XGDeferredFlush *released =
+            [[XGDeferredFlush alloc] initWithDelay:60.0 storeQueue:storeQueue save:^{ releasedSaveCount++; }];
+        [released setNeedsFlush];
+        weakReleased = released;
+    }
+
+    // The instances aren't kept alive for the exit flush, and only live ones are flushed:
+    XCTAssertNil(weakReleased);
+    [kept setNeedsFlush];
+    [XGDeferredFlush flushAll];
+    XCTAssertEqual(keptSaveCount, 1);
+    XCTAssertEqual(releasedSaveCount, 0);
+
+    // Nothing changed since, so there's nothing to save:
+    [XGDeferredFlush flushAll];
+    XCTAssertEqual(keptSaveCount, 1);
+}
+
+- (void) testRefreshTracker {
+    XGRefreshTracker *tracker = [XGRefreshTracker new];
+    NSNumber *first = [tracker beginRefreshForKey:@"server-a"];
+    XCTAssertNotNil(first);
+    XCTAssertTrue([tracker isCurrentRefresh:first forKey:@"server-a"]);
+
+    // A busy key is skipped, but other keys aren't held up:
+    XCTAssertNil([tracker beginRefreshForKey:@"server-a"]);
+    NSNumber *other = [tracker beginRefreshForKey:@"server-b"];
+    XCTAssertNotNil(other);
+    XCTAssertFalse([tracker isCurrentRefresh:other forKey:@"server-a"]);
+
+    // Once the first refresh ends its timeout no longer applies, even after a newer refresh starts:
+    [tracker endRefreshForKey:@"server-a"];
+    XCTAssertFalse([tracker isCurrentRefresh:first forKey:@"server-a"]);
+    NSNumber *second = [tracker beginRefreshForKey:@"server-a"];
+    XCTAssertNotNil(second);
+    XCTAssertNotEqualObjects(first, second);
+    XCTAssertFalse([tracker isCurrentRefresh:first forKey:@"server-a"]);
+    XCTAssertTrue([tracker isCurrentRefresh:second forKey:@"server-a"]);
+    XCTAssertTrue([tracker isCurrentRefresh:other forKey:@"server-b"]);
+}
+
+@end
@@ -18,4 +18,69 @@ NS_ASSUME_NONNULL_BEGIN
 
 FOUNDATION_EXPORT NSString* XGDurationStringFromTimeInterval(NSTimeInterval timeInterval);
 
+/// Runs `block` asynchronously on `queue`, or immediately on the current thread if `queue` is nil.
+FOUNDATION_EXPORT void XGDispatchOnQueue(dispatch_queue_t _Nullable queue, dispatch_block_t block);
+
+/**
+ Calls `work` for each item with at most `limit` items in progress at a time, without blocking a
+ thread per item. Each `work` block must call its `done` block exactly once when it's finished.
+ The `completion` block is called once all items are done.
+*/
+FOUNDATION_EXPORT void XGAsyncForEach(
+    NSArray*_Nonnull items,
+    NSInteger limit,
+    void (^_Nonnull work)(id _Nonnull item, dispatch_block_t _Nonnull done),
+    dispatch_block_t _Nonnull completion
+);
+
+#pragma mark - XGDeferredFlush
+
+/**
+ Batches the writes of a store that changes often. The store calls `setNeedsFlush` after each
+ change and the changes are saved by one call of the save block, at most `delay` seconds later.
+ Unsaved changes are also saved when the process exits.
+
+ The store's changes are made on `storeQueue`. A flush waits for the changes already queued there.
+ The save block is called on a private serial queue, so saves never overlap. Changes made while
+ the block runs cause another save.
+*/
+@interface XGDeferredFlush : NSObject
+- (instancetype) initWithDelay:(NSTimeInterval)delay
+                    storeQueue:(dispatch_queue_t)storeQueue
+                          save:(dispatch_block_t)saveBlock NS_DESIGNATED_INITIALIZER;
+- (instancetype) init NS_UNAVAILABLE;
++ (instancetype) new NS_UNAVAILABLE;
+
+/// Marks the store as changed and schedules a save if one isn't scheduled.
+- (void) setNeedsFlush;
+
+/// Saves any changes now, waiting for the save to finish.
+- (void) flush;
+
+/// Saves the changes of every instance that's still alive. This is called when the process exits.
++ (void) flushAll;
+
+/// Forgets the unsaved changes, as when the store is cleared.
+- (void) cancel;
+@end
+
+#pragma mark - XGRefreshTracker
+
+/**
+ Keeps track of the refreshes that are in progress, one at a time for each key, like a server
+ name. Each refresh gets a number so that the work of an old refresh, like its timeout, can tell
+ that a newer refresh has started.
+*/
+@interface XGRefreshTracker : NSObject
+
+/// Starts a refresh of `key` and returns its number, or nil if `key` is still being refreshed.
+- (NSNumber*_Nullable) beginRefreshForKey:(NSString*)key;
+
+/// Ends the refresh of `key`, so that it can be refreshed again.
+- (void) endRefreshForKey:(NSString*)key;
+
+/// Returns YES if `refresh` is the refresh of `key` that's in progress.
+- (BOOL) isCurrentRefresh:(NSNumber*)refresh forKey:(NSString*)key;
+@end
+
 NS_ASSUME_NONNULL_END
@@ -61,3 +61,182 @@ NSString* XGDurationStringFromTimeInterval(NSTimeInterval timeInterval) {
 
     return result;
 }
+
+#pragma mark - Asynchronous Helpers
+
+void XGDispatchOnQueue(dispatch_queue_t _Nullable queue, dispatch_block_t block) {
+    if (queue)
+        dispatch_async(queue, block);
+    else
+        block();
+}
+
+void XGAsyncForEach(
+        NSArray*_Nonnull items,
+        NSInteger limit,
+        void (^_Nonnull work)(id _Nonnull item, dispatch_block_t _Nonnull done),
+        dispatch_block_t _Nonnull completion
+    ) {
+    if (items.count == 0) {
+        completion();
+        return;
+    }
+    // The index of the next item and the number of items done are guarded by `lock`:
+    NSObject *lock = [NSObject new];
+    __block NSUInteger nextIndex = 0;
+    __block NSUInteger doneCount = 0;
+    __block void (^startNext)(void) = nil;
+    void (^startNextBlock)(void) = ^ {
+        id item = nil;
+        @synchronized(lock) {
+            if (nextIndex >= items.count) return;
+            item = items[nextIndex++];
+        }
+        work(item, ^{
+            BOOL isFinished = NO;
+            @synchronized(lock) {
+                isFinished = (++doneCount == items.count);
+            }
+            if (isFinished) {
+                startNext = nil;
+                completion();
+            } else {
+                startNext();
+            }
+        });
+    };
+    startNext = startNextBlock;
+    NSInteger count = MIN(MAX(1, limit), (NSInteger) items.count);
+    for (NSInteger i = 0; i < count; i++) startNext();
+}
+
+#pragma mark - XGDeferredFlush
+
+@interface XGDeferredFlush () {
+    NSTimeInterval _delay;
+    dispatch_block_t _saveBlock;
+    dispatch_queue_t _storeQueue;
+    dispatch_queue_t _queue;
+    BOOL _isDirty;
+    BOOL _flushIsScheduled;
+}
+@end
+
+/// Flushes the live instances when the process exits. One handler serves every instance.
+static void XGDeferredFlushAtExit(void) {
+    [XGDeferredFlush flushAll];
+}
+
+@implementation XGDeferredFlush
+
++ (NSHashTable<XGDeferredFlush*>*) liveInstances {
+    static NSHashTable *liveInstances = nil;
+    static dispatch_once_t onceToken = 0;
+    dispatch_once(&onceToken, ^{
+        liveInstances = [NSHashTable weakObjectsHashTable];
+        atexit(XGDeferredFlushAtExit);
+    });
+    return liveInstances;
+}
+
++ (void) flushAll {
+    NSHashTable *liveInstances = [self liveInstances];
+    NSArray<XGDeferredFlush*>*instances = nil;
+    @synchronized(liveInstances) {
+        instances = liveInstances.allObjects;
+    }
+    for (XGDeferredFlush *instance in instances)
+        [instance flush];
+}
+
+- (instancetype) initWithDelay:(NSTimeInterval)delay
+                    storeQueue:(dispatch_queue_t)storeQueue
+                          save:(dispatch_block_t)saveBlock {
+    self = [super init];
+    if (!self) return self;
+    _delay = delay;
+    _storeQueue = storeQueue;
+    _saveBlock = [saveBlock copy];
+    _queue = dispatch_queue_create("io.branch.xcode-github.deferred-flush", DISPATCH_QUEUE_SERIAL);
+    NSHashTable *liveInstances = [self.class liveInstances];
+    @synchronized(liveInstances) {
+        [liveInstances addObject:self];
+    }
+    return self;
+}
+
+- (void) setNeedsFlush {
+    @synchronized(self) {
+        _isDirty = YES;
+        if (_flushIsScheduled) return;
+        _flushIsScheduled = YES;
+    }
+    __weak __typeof(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_delay * NSEC_PER_SEC)), _queue, ^{
+        [weakSelf saveIfDirty];
+    });
+}
+
+- (void) flush {
+    dispatch_barrier_sync(_storeQueue, ^{});
+    dispatch_sync(_queue, ^{ [self saveIfDirty]; });
+}
+
+/// Called on the queue. The flags are cleared before the save so that a change made during
+/// the save marks the store dirty again.
+- (void) saveIfDirty {
+    @synchronized(self) {
+        _flushIsScheduled = NO;
+        if (!_isDirty) return;
+        _isDirty = NO;
+    }
+    _saveBlock();
+}
+
+- (void) cancel {
+    @synchronized(self) {
+        _isDirty = NO;
+    }
+}
+
+@end
+
+#pragma mark - XGRefreshTracker
+
+@interface XGRefreshTracker () {
+    NSMutableDictionary<NSString*, NSNumber*>*_refreshes; // Key to refresh number.
+    NSInteger _refreshNumber;
+}
+@end
+
+@implementation XGRefreshTracker
+
+- (instancetype) init {
+    self = [super init];
+    if (!self) return self;
+    _refreshes = [NSMutableDictionary new];
+    return self;
+}
+
+- (NSNumber*) beginRefreshForKey:(NSString*)key {
+    @synchronized(self) {
+        if (_refreshes[key]) return nil;
+        NSNumber *refresh = @(++_refreshNumber);
+        _refreshes[key] = refresh;
+        return refresh;
+    }
+}
+
+- (void) endRefreshForKey:(NSString*)key {
+    @synchronized(self) {
+        [_refreshes removeObjectForKey:key];
+    }
+}
+
+- (BOOL) isCurrentRefresh:(NSNumber*)refresh forKey:(NSString*)key {
+    @synchronized(self) {
+        return [_refreshes[key] isEqualToNumber:refresh];
+    }
+}
+
+@end
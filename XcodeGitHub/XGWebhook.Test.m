@@ -0,0 +1,153 @@
+/**
+ @file          XGWebhook.Test.m
+ @package       xcode-github
+ @brief         Tests for XGWebhook.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "BNCTestCase.h"
+#import "XGWebhook.h"
+#import <CommonCrypto/CommonHMAC.h>
+
+// Recorded GitHub deliveries, trimmed to the fields that are used:
+
+static NSString*const kPullRequestPayload =
+    @"{\"action\":\"synchronize\",\"number\":12,"
+     "\"pull_request\":{\"url\":\"https://api.github.com/repos/owner/repo/pulls/12\","
+       "\"number\":12,\"state\":\"open\",\"title\":\"Fix the thing\",\"body\":\"\","
+       "\"head\":{\"label\":\"owner:fix-thing\",\"ref\":\"fix-thing\","
+         "\"sha\":\"0d1a26e67d8f5eaf1f6ba5c57fc3c7d91ac0fd1c\","
+         "\"repo\":{\"name\":\"repo\",\"full_name\":\"owner/repo\"}},"
+       "\"base\":{\"ref\":\"master\",\"repo\":{\"name\":\"repo\",\"full_name\":\"owner/repo\"}}},"
+     "\"repository\":{\"name\":\"repo\",\"full_name\":\"owner/repo\"}}";
+
+static NSString*const kPushPayload =
+    @"{\"ref\":\"refs/heads/fix-thing\","
+     "\"before\":\"6113728f27ae82c7b1a177c8d03f9e96e0adf246\","
+     "\"after\":\"0d1a26e67d8f5eaf1f6ba5c57fc3c7d91ac0fd1c\","
+     "\"repository\":{\"name\":\"repo\",\"full_name\":\"owner/repo\"}}";
+
+static NSString*const kPingPayload =
+    @"{\"zen\":\"Keep it logically awesome.\",\"hook_id\":1,"
+     "\"repository\":{\"name\":\"repo\",\"full_name\":\"owner/repo\"}}";
+
+@interface XGWebhookTest : BNCTestCase
+@end
+
+@implementation XGWebhookTest
+
++ (NSString*) signatureForData:(NSData*)data secret:(NSString*)secret {
+    NSData *key = [secret dataUsingEncoding:NSUTF8StringEncoding];
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CCHmac(kCCHmacAlgSHA256, key.bytes, key.length, data.bytes, data.length, digest);
+    NSMutableString *string = [NSMutableString stringWithString:@"sha256="];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) [string appendFormat:@"%02x", digest[i]];
+    return string;
+}
+
+- (NSInteger) postData:(NSData*)data headers:(NSDictionary<NSString*, NSString*>*)headers port:(uint16_t)port {
+    NSURL *URL = [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/", port]];
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:URL];
+    request.HTTPMethod = @"POST";
+    request.HTTPBody = data;
+    for (NSString *name in headers) [request setValue:headers[name] forHTTPHeaderField:name];
+
+    __block NSInteger statusCode = 0;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [[[NSURLSession sharedSession] dataTaskWithRequest:request
+        completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            statusCode = [(NSHTTPURLResponse*) response statusCode];
+            dispatch_semaphore_signal(semaphore);
+        }] resume];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return statusCode;
+}
+
+- (NSInteger) postPayload:(NSString*)payload
+                    event:(NSString*)event
+                   secret:(NSString*)secret
+                     port:(uint16_t)port {
+    NSData *data = [payload dataUsingEncoding:NSUTF8StringEncoding];
+    return [self postData:data headers:@{
+        @"Content-Type":        @"application/json",
+        @"X-GitHub-Event":      event,
+        @"X-Hub-Signature-256": [self.class signatureForData:data secret:secret],
+    } port:port];
+}
+
+- (void) testSignature {
+    NSData *data = [@"payload" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *signature = [self.class signatureForData:data secret:@"secret"];
+    XCTAssertTrue(XGWebhookSignatureIsValid(data, signature, @"secret"));
+    XCTAssertFalse(XGWebhookSignatureIsValid(data, signature, @"wrong"));
+    XCTAssertFalse(XGWebhookSignatureIsValid(data, @"sha256=00", @"secret"));
+    XCTAssertFalse(XGWebhookSignatureIsValid(data, nil, @"secret"));
+    XCTAssertFalse(XGWebhookSignatureIsValid(data, signature, @""));
+}
+
+- (void) testListener {
+    NSMutableArray<XGWebhookEvent*>*events = [NSMutableArray new];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Events"];
+    expectation.expectedFulfillmentCount = 2;
+    XGWebhookListener *listener =
+        [[XGWebhookListener alloc] initWithSecret:@"secret" handler:^(XGWebhookEvent*event) {
+            @synchronized(events) {
+                [events addObject:event];
+            }
+            [expectation fulfill];
+        }];
+    XCTAssertNil([listener startWithPort:0]);
+    XCTAssertTrue(listener.port > 0);
+
+    XCTAssertEqual([self postPayload:kPingPayload event:@"ping" secret:@"secret" port:listener.port], 200);
+    XCTAssertEqual([self postPayload:kPullRequestPayload event:@"pull_request" secret:@"wrong" port:listener.port], 401);
+    XCTAssertEqual([self postPayload:kPullRequestPayload event:@"pull_request" secret:@"secret" port:listener.port], 202);
+    XCTAssertEqual([self postPayload:kPushPayload event:@"push" secret:@"secret" port:listener.port], 202);
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+    [listener stop];
+
+    XCTAssertEqual(events.count, 2);
+    XGWebhookEvent *event = events[0];
+    XCTAssertEqual(event.type, XGWebhookEventTypePullRequest);
+    XCTAssertEqualObjects(event.action, @"synchronize");
+    XCTAssertEqualObjects(event.repository, @"owner/repo");
+    XCTAssertEqualObjects(event.pullRequest.number, @"12");
+    XCTAssertEqualObjects(event.pullRequest.branch, @"fix-thing");
+    XCTAssertEqualObjects(event.pullRequest.sha, @"0d1a26e67d8f5eaf1f6ba5c57fc3c7d91ac0fd1c");
+    XCTAssertEqualObjects(event.pullRequest.state, @"open");
+
+    event = events[1];
+    XCTAssertEqual(event.type, XGWebhookEventTypePush);
+    XCTAssertEqualObjects(event.branch, @"fix-thing");
+    XCTAssertEqualObjects(event.repository, @"owner/repo");
+}
+
+- (void) testListenerRefusesEarly {
+    XGWebhookListener *listener =
+        [[XGWebhookListener alloc] initWithSecret:@"secret" handler:^(XGWebhookEvent*event) {
+            XCTFail(@"Unexpected event %@.", event);
+        }];
+    XCTAssertEqual(listener.maximumPayloadLength, 1024*1024);
+    listener.maximumPayloadLength = 200;
+    XCTAssertNil([listener startWithPort:0]);
+
+    // Unsigned and oversized deliveries are refused before their body is checked:
+    NSData *data = [kPingPayload dataUsingEncoding:NSUTF8StringEncoding];
+    NSInteger statusCode =
+        [self postData:data headers:@{ @"X-GitHub-Event": @"ping" } port:listener.port];
+    XCTAssertEqual(statusCode, 401);
+
+    data = [kPullRequestPayload dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertGreaterThan(data.length, 200);
+    statusCode = [self postData:data headers:@{
+        @"X-GitHub-Event":      @"pull_request",
+        @"X-Hub-Signature-256": [self.class signatureForData:data secret:@"secret"],
+    } port:listener.port];
+    XCTAssertEqual(statusCode, 413);
+    [listener stop];
+}
+
+@end
@@ -0,0 +1,82 @@
+/**
+ @file          XGWebhook.h
+ @package       xcode-github
+ @brief         Receives GitHub webhook events.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+#import "XGGitHubPullRequest.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Checks a GitHub webhook signature. The signature is the value of the `X-Hub-Signature-256`
+ header ("sha256=<hex>") or the older `X-Hub-Signature` header ("sha1=<hex>").
+*/
+FOUNDATION_EXPORT BOOL XGWebhookSignatureIsValid(NSData* body, NSString*_Nullable signature, NSString* secret);
+
+#pragma mark XGWebhookEvent
+
+typedef NS_ENUM(NSInteger, XGWebhookEventType) {
+    XGWebhookEventTypeOther = 0,
+    XGWebhookEventTypePing,
+    XGWebhookEventTypePullRequest,
+    XGWebhookEventTypePush,
+};
+
+@interface XGWebhookEvent : NSObject
+@property (assign, readonly) XGWebhookEventType type;
+@property (strong, readonly) NSString*_Nullable action;         // Like 'opened' or 'synchronize'.
+@property (strong, readonly) NSString*_Nullable repository;     // The full name, like 'owner/repo'.
+@property (strong, readonly) XGGitHubPullRequest*_Nullable pullRequest; // For pull_request events.
+@property (strong, readonly) NSString*_Nullable branch;         // For push events.
+
+/// Returns the event for an `X-GitHub-Event` name and its JSON payload, or nil if it can't be read.
++ (instancetype _Nullable) eventWithName:(NSString*)name payload:(NSData*)payload;
+@end
+
+#pragma mark - XGWebhookListener
+
+/**
+ Listens for GitHub webhook deliveries with an embedded HTTP server.
+
+ Deliveries with a bad signature are refused. Good deliveries are answered right away and the
+ event handler is called afterwards, one event at a time, on the listener's queue.
+
+ Deliveries without a signature or with a body larger than `maximumPayloadLength` are refused
+ before their body is read. The embedded server isn't hardened for the open internet, so by
+ default it only accepts connections from this host. Put it behind a reverse proxy, like nginx,
+ that forwards the deliveries from GitHub.
+*/
+@interface XGWebhookListener : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
++ (instancetype) new NS_UNAVAILABLE;
+
+- (instancetype) initWithSecret:(NSString*)secret
+                        handler:(void (^)(XGWebhookEvent*event))handler NS_DESIGNATED_INITIALIZER;
+
+/// Starts listening on `port` for connections from this host. Zero picks any free port.
+- (NSError*_Nullable) startWithPort:(uint16_t)port;
+
+/**
+ Starts listening on `port`. Zero picks any free port.
+
+ @param port        The TCP port.
+ @param localOnly   If NO, connections from other hosts are accepted too.
+*/
+- (NSError*_Nullable) startWithPort:(uint16_t)port localOnly:(BOOL)localOnly;
+- (void) stop;
+
+/// The port the listener is listening on, or zero if it isn't running.
+@property (assign, readonly) uint16_t port;
+
+/// The largest delivery that is accepted. The default is 1 MB.
+@property (assign) NSUInteger maximumPayloadLength;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,191 @@
+/**
+ @file          XGWebhook.m
+ @package       xcode-github
+ @brief         Receives GitHub webhook events.
+
+ @author        Edward Smith
+ @date          October 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import "XGWebhook.h"
+#import "XGHTTPServer.h"
+#import "BNCLog.h"
+#import <CommonCrypto/CommonHMAC.h>
+
+BOOL XGWebhookSignatureIsValid(NSData* body, NSString*_Nullable signature, NSString* secret) {
+    CCHmacAlgorithm algorithm = kCCHmacAlgSHA256;
+    size_t digestLength = CC_SHA256_DIGEST_LENGTH;
+    NSString *prefix = @"sha256=";
+    if ([signature hasPrefix:@"sha1="]) {
+        algorithm = kCCHmacAlgSHA1;
+        digestLength = CC_SHA1_DIGEST_LENGTH;
+        prefix = @"sha1=";
+    }
+    if (secret.length == 0 || ![signature hasPrefix:prefix]) return NO;
+
+    NSData *key = [secret dataUsingEncoding:NSUTF8StringEncoding];
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CCHmac(algorithm, key.bytes, key.length, body.bytes, body.length, digest);
+
+    NSString *hex = [signature substringFromIndex:prefix.length].lowercaseString;
+    if (hex.length != digestLength * 2) return NO;
+
+    // Compare every byte so that the time taken doesn't give away the digest:
+    const char *hexBytes = hex.UTF8String;
+    uint8_t difference = 0;
+    for (size_t i = 0; i < digestLength; i++) {
+        unsigned int byte = 0;
+        if (sscanf(hexBytes + i*2, "%2x", &byte) != 1) return NO;
+        difference |= (uint8_t) byte ^ digest[i];
+    }
+    return (difference == 0);
+}
+
+#pragma mark XGWebhookEvent
+
+@interface XGWebhookEvent ()
+@property (assign) XGWebhookEventType type;
+@property (strong) NSString*_Nullable action;
+@property (strong) NSString*_Nullable repository;
+@property (strong) XGGitHubPullRequest*_Nullable pullRequest;
+@property (strong) NSString*_Nullable branch;
+@end
+
+@implementation XGWebhookEvent
+
++ (instancetype) eventWithName:(NSString*)name payload:(NSData*)payload {
+    NSError *error = nil;
+    NSDictionary *dictionary = [NSJSONSerialization JSONObjectWithData:payload options:0 error:&error];
+    if (![dictionary isKindOfClass:NSDictionary.class]) {
+        BNCLogError(@"Can't read the '%@' webhook payload: %@.", name, error);
+        return nil;
+    }
+
+    XGWebhookEvent *event = [XGWebhookEvent new];
+    NSString *action = dictionary[@"action"];
+    if ([action isKindOfClass:NSString.class]) event.action = action;
+    NSString *repository = dictionary[@"repository"][@"full_name"];
+    if ([repository isKindOfClass:NSString.class]) event.repository = repository;
+
+    if ([name isEqualToString:@"ping"]) {
+        event.type = XGWebhookEventTypePing;
+    } else
+    if ([name isEqualToString:@"pull_request"]) {
+        // The payload's PR is the same as the one from the REST API:
+        NSDictionary *pr = dictionary[@"pull_request"];
+        if (![pr isKindOfClass:NSDictionary.class]) return nil;
+        event.type = XGWebhookEventTypePullRequest;
+        event.pullRequest = [[XGGitHubPullRequest alloc] initWithDictionary:pr];
+        if (!event.pullRequest.number) return nil;
+    } else
+    if ([name isEqualToString:@"push"]) {
+        NSString *ref = dictionary[@"ref"];
+        if (![ref isKindOfClass:NSString.class]) return nil;
+        event.type = XGWebhookEventTypePush;
+        NSString *prefix = @"refs/heads/";
+        if ([ref hasPrefix:prefix]) event.branch = [ref substringFromIndex:prefix.length];
+    } else {
+        event.type = XGWebhookEventTypeOther;
+    }
+    return event;
+}
+
+- (NSString*) description {
+    NSString *subject = (self.pullRequest) ? [@"PR#" stringByAppendingString:self.pullRequest.number] : self.branch;
+    return [NSString stringWithFormat:@"<%@ %p %ld %@ %@ %@>",
+        NSStringFromClass(self.class), (void*) self, (long) self.type, self.repository, self.action, subject];
+}
+
+@end
+
+#pragma mark - XGWebhookListener
+
+@interface XGWebhookListener () {
+    NSString *_secret;
+    void (^_handler)(XGWebhookEvent*event);
+    dispatch_queue_t _queue;
+    XGHTTPServer *_server;
+}
+@end
+
+@implementation XGWebhookListener
+
+- (instancetype) initWithSecret:(NSString*)secret handler:(void (^)(XGWebhookEvent*event))handler {
+    self = [super init];
+    if (!self) return self;
+    _secret = [secret copy];
+    _handler = [handler copy];
+    _queue = dispatch_queue_create("io.branch.xcode-github.webhook", DISPATCH_QUEUE_SERIAL);
+    __weak __typeof(self) weakSelf = self;
+    _server = [[XGHTTPServer alloc] initWithHandler:^ XGHTTPResponse*(XGHTTPRequest*request) {
+        __strong __typeof(weakSelf) strongSelf = weakSelf;
+        if (!strongSelf) return [XGHTTPResponse responseWithStatusCode:503];
+        return [strongSelf responseForRequest:request];
+    }];
+    _server.headerHandler = ^ XGHTTPResponse*(XGHTTPRequest*request) {
+        return [XGWebhookListener responseForHeadersOfRequest:request];
+    };
+    _server.maximumBodyLength = 1024*1024;
+    _server.maximumConnectionCount = 8;
+    return self;
+}
+
+- (uint16_t) port {
+    return _server.port;
+}
+
+- (NSUInteger) maximumPayloadLength {
+    return _server.maximumBodyLength;
+}
+
+- (void) setMaximumPayloadLength:(NSUInteger)maximumPayloadLength {
+    _server.maximumBodyLength = maximumPayloadLength;
+}
+
+- (NSError*) startWithPort:(uint16_t)port {
+    return [self startWithPort:port localOnly:YES];
+}
+
+- (NSError*) startWithPort:(uint16_t)port localOnly:(BOOL)localOnly {
+    return [_server startWithPort:port localOnly:localOnly];
+}
+
+- (void) stop {
+    [_server stop];
+}
+
+/// Refuses what can't be a delivery before its body is read.
++ (XGHTTPResponse*) responseForHeadersOfRequest:(XGHTTPRequest*)request {
+    if (![request.method isEqualToString:@"POST"])
+        return [XGHTTPResponse responseWithStatusCode:405];
+    if (!request.headers[@"x-hub-signature-256"] && !request.headers[@"x-hub-signature"]) {
+        BNCLogWarning(@"Refused a webhook delivery without a signature.");
+        return [XGHTTPResponse responseWithStatusCode:401];
+    }
+    return nil;
+}
+
+- (XGHTTPResponse*) responseForRequest:(XGHTTPRequest*)request {
+    XGHTTPResponse *response = [self.class responseForHeadersOfRequest:request];
+    if (response) return response;
+
+    NSString *signature = request.headers[@"x-hub-signature-256"] ?: request.headers[@"x-hub-signature"];
+    if (!XGWebhookSignatureIsValid(request.body, signature, _secret)) {
+        BNCLogWarning(@"Refused a webhook delivery with a bad signature.");
+        return [XGHTTPResponse responseWithStatusCode:401];
+    }
+
+    NSString *name = request.headers[@"x-github-event"];
+    XGWebhookEvent *event = (name.length) ? [XGWebhookEvent eventWithName:name payload:request.body] : nil;
+    if (!event) return [XGHTTPResponse responseWithStatusCode:400];
+    BNCLogDebug(@"Webhook event %@ (delivery %@).", event, request.headers[@"x-github-delivery"]);
+    if (event.type == XGWebhookEventTypePing || event.type == XGWebhookEventTypeOther)
+        return [XGHTTPResponse responseWithStatusCode:200];
+
+    // GitHub gives up on a delivery after ten seconds, so answer now and do the work later:
+    dispatch_async(_queue, ^{ self->_handler(event); });
+    return [XGHTTPResponse responseWithStatusCode:202];
+}
+
+@end
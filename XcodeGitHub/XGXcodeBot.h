@@ -63,7 +63,6 @@ NS_ASSUME_NONNULL_BEGIN
     "trigger-error"
 */
 @property (strong, readonly) NSString*_Nullable result;
-@property (strong, readonly) NSDictionary*_Nullable dictionary;
 @property (strong, readonly) NSError*_Nullable  error;
 
 @property (strong, readonly) NSDate*_Nullable queuedDate;
@@ -100,6 +99,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (strong, readonly) NSString*_Nullable name;
 @property (strong, readonly) NSString*_Nullable botID;
+/// The server's revision of the bot. It changes whenever the bot's configuration changes.
+@property (strong, readonly) NSString*_Nullable revision;
 @property (strong, readonly) NSString*_Nonnull  serverName;
 
 /// @brief Repo Information
@@ -117,12 +118,21 @@ NS_ASSUME_NONNULL_BEGIN
 @property (strong, readonly) NSString*_Nullable templateBotName;
 @property (assign, readonly) BOOL botIsFromTemplateBot;
 
-/// The raw bot dictionary.
-@property (strong, readonly) NSDictionary*_Nullable dictionary;
+- (instancetype) initWithServerName:(NSString*_Nullable)serverName
+                         dictionary:(NSDictionary*_Nullable)dictionary
+                         NS_DESIGNATED_INITIALIZER;
 
 + (instancetype) new NS_UNAVAILABLE;
 - (instancetype) init NS_UNAVAILABLE;
 
+/*
+ The network methods come in two flavors: a blocking method that returns its result, and a
+ non-blocking method that calls a completion block with the result.
+
+ The completion block is called asynchronously on `queue`. If `queue` is nil the completion block
+ is called on the network service's queue, so it should be short and must not block.
+*/
+
 /**
  @param xcodeServer The network name of the Xcode server.
  @param error       If not nil, on exit, any error encountered is returned here.
@@ -131,6 +141,49 @@ NS_ASSUME_NONNULL_BEGIN
 + (NSDictionary<NSString*, XGXcodeBot*>*_Nullable) botsForServer:(XGServer*)xcodeServer
                                                     error:(NSError*__autoreleasing _Nullable*_Nullable)error;
 
++ (void) botsForServer:(XGServer*)xcodeServer
+                 queue:(dispatch_queue_t _Nullable)queue
+            completion:(void (^_Nonnull)(NSDictionary<NSString*, XGXcodeBot*>*_Nullable bots, NSError*_Nullable error))completion;
+
+/**
+ Returns the latest status of each bot using a single integration listing from the server, rather
+ than one request per bot. Bots that aren't in the listing, or servers that can't list
+ integrations, fall back to requesting the status of each bot individually, `jobs` at a time.
+
+ Every named bot has a status in the result. A status that couldn't be fetched has its `error` set.
+
+ @param xcodeServer The Xcode server that hosts the bots.
+ @param bots        The bots, as returned by `botsForServer:error:`.
+ @param jobs        The number of concurrent per-bot requests to make if falling back.
+ @param error       If not nil, on exit, any error encountered is returned here.
+ @return A dictionary with a key of the bot name and value of the bot status.
+*/
++ (NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull) botStatusesForServer:(XGServer*)xcodeServer
+                                                    bots:(NSArray<XGXcodeBot*>*)bots
+                                                    jobs:(NSInteger)jobs
+                                                   error:(NSError*__autoreleasing _Nullable*_Nullable)error;
+
++ (void) botStatusesForServer:(XGServer*)xcodeServer
+                         bots:(NSArray<XGXcodeBot*>*)bots
+                         jobs:(NSInteger)jobs
+                        queue:(dispatch_queue_t _Nullable)queue
+                   completion:(void (^_Nonnull)(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull statuses, NSError*_Nullable error))completion;
+
+/**
+ Returns the latest status of each bot, making one request per bot.
+
+ @param bots        The bots to get the status of.
+ @param jobs        The number of requests to have in flight at the same time.
+ @return A dictionary with a key of the bot name and value of the bot status.
+*/
++ (NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull) statusesForBots:(NSArray<XGXcodeBot*>*)bots
+                                                    jobs:(NSInteger)jobs;
+
++ (void) statusesForBots:(NSArray<XGXcodeBot*>*)bots
+                    jobs:(NSInteger)jobs
+                   queue:(dispatch_queue_t _Nullable)queue
+              completion:(void (^_Nonnull)(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull statuses))completion;
+
 + (NSString*_Nonnull) botNameFromPRNumber:(NSString*_Nonnull)number title:(NSString*_Nonnull)title;
 
 - (XGXcodeBot*_Nullable) duplicateBotWithNewName:(NSString*_Nonnull)newBotName
@@ -139,9 +192,24 @@ NS_ASSUME_NONNULL_BEGIN
                           gitHubPullRequestTitle:(NSString*_Nonnull)pullRequestTitle
                                            error:(NSError*__autoreleasing _Nullable*_Nullable)error;
 
+- (void) duplicateBotWithNewName:(NSString*_Nonnull)newBotName
+                      branchName:(NSString*_Nonnull)branchName
+         gitHubPullRequestNumber:(NSString*_Nonnull)pullRequestNumber
+          gitHubPullRequestTitle:(NSString*_Nonnull)pullRequestTitle
+                           queue:(dispatch_queue_t _Nullable)queue
+                      completion:(void (^_Nonnull)(XGXcodeBot*_Nullable bot, NSError*_Nullable error))completion;
+
 - (NSError*_Nullable) startIntegration;
+- (void) startIntegrationWithQueue:(dispatch_queue_t _Nullable)queue
+                        completion:(void (^_Nullable)(NSError*_Nullable error))completion;
+
 - (XGXcodeBotStatus*_Nonnull) status;
+- (void) statusWithQueue:(dispatch_queue_t _Nullable)queue
+              completion:(void (^_Nonnull)(XGXcodeBotStatus*_Nonnull status))completion;
+
 - (NSError*_Nullable) deleteBot;
+- (void) deleteBotWithQueue:(dispatch_queue_t _Nullable)queue
+                 completion:(void (^_Nullable)(NSError*_Nullable error))completion;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -10,6 +10,8 @@
 
 #import "XGXcodeBot.h"
 #import "XGUtility.h"
+#import "XGJSONScanner.h"
+#import "XGBotCache.h"
 #import "BNCLog.h"
 #import "BNCNetworkService.h"
 #import "APFormattedString.h"
@@ -47,8 +49,8 @@
 @property (readwrite) NSNumber*_Nullable integrationNumber;
 @property (readwrite) NSString*_Nullable currentStep;
 @property (readwrite) NSString*_Nullable result;
-@property (readwrite) NSDictionary*_Nullable dictionary;
 @property (readwrite) NSError*_Nullable  error;
++ (instancetype) statusWithNoIntegrationsForBot:(XGXcodeBot*)bot;
 @end
 
 @implementation XGXcodeBotStatus : NSObject
@@ -62,23 +64,24 @@
     self = [super init];
     if (!self) return self;
 
+    // Only the fields that are used are kept. The integration dictionary isn't kept since it can
+    // be large and there's a status for every bot:
     _serverName = [serverName copy];
-    _dictionary = dictionary;
-    _botID = _dictionary[@"bot"][@"_id"];
-    _botName = _dictionary[@"bot"][@"name"];
-    _botTinyID = _dictionary[@"bot"][@"tinyID"];
-    _integrationID = _dictionary[@"_id"];
-    _integrationNumber = _dictionary[@"number"];
-    _result = _dictionary[@"result"];
-    _currentStep = _dictionary[@"currentStep"];
-    _tags = _dictionary[@"tags"];
+    _botID = dictionary[@"bot"][@"_id"];
+    _botName = dictionary[@"bot"][@"name"];
+    _botTinyID = dictionary[@"bot"][@"tinyID"];
+    _integrationID = dictionary[@"_id"];
+    _integrationNumber = dictionary[@"number"];
+    _result = dictionary[@"result"];
+    _currentStep = dictionary[@"currentStep"];
+    _tags = dictionary[@"tags"];
 
     NSDateFormatter *dateFormatter = [NSDateFormatter dateFormatter8601];
-    _queuedDate = [dateFormatter dateFromString:_dictionary[@"queuedDate"]];
-    _startedDate = [dateFormatter dateFromString:_dictionary[@"startedTime"]];
-    _endedDate = [dateFormatter dateFromString:_dictionary[@"endedTime"]];
+    _queuedDate = [dateFormatter dateFromString:dictionary[@"queuedDate"]];
+    _startedDate = [dateFormatter dateFromString:dictionary[@"startedTime"]];
+    _endedDate = [dateFormatter dateFromString:dictionary[@"endedTime"]];
 
-    NSDictionary *summary = _dictionary[@"buildResultSummary"];
+    NSDictionary *summary = dictionary[@"buildResultSummary"];
     _errorCount = summary[@"errorCount"];
     _warningCount = summary[@"warningCount"];
     _analyzerWarningCount = summary[@"analyzerWarningCount"];
@@ -89,6 +92,16 @@
     return self;
 }
 
++ (instancetype) statusWithNoIntegrationsForBot:(XGXcodeBot*)bot {
+    XGXcodeBotStatus *status = [[XGXcodeBotStatus alloc] initWithServerName:bot.serverName dictionary:nil];
+    status.botID = bot.botID;
+    status.botName = bot.name;
+    status.integrationNumber = [NSNumber numberWithInteger:0];
+    status.currentStep = @"no integrations";
+    status.result = @"unknown";
+    return status;
+}
+
 - (NSString*) description {
     return [NSString stringWithFormat:
         @"<%@ %p %@ #%@. Step: '%@' Result: '%@'>",
@@ -252,32 +265,47 @@ _Test Coverage_: 65% (193 tests).
 
 #pragma mark - XGXcodeBot
 
+@interface XGXcodeBot ()
+/// The server the bot was listed from. Its credentials are used for the bot's own requests.
+@property (strong) XGServer*_Nullable xcodeServer;
+@end
+
 @implementation XGXcodeBot
 
+/// Starts a request to an Xcode server. Every Xcode server request goes through here so that it
+/// sends the server's credentials, if it has any.
++ (void) startOperation:(BNCNetworkOperation*)operation server:(XGServer*_Nullable)xcodeServer {
+    if (xcodeServer.user.length > 0)
+        [operation setUser:xcodeServer.user password:xcodeServer.password];
+    [operation start];
+}
+
 - (instancetype) initWithServerName:(NSString *)serverName dictionary:(NSDictionary *)dictionary {
     self = [super init];
     if (!self) return self;
 
+    // Only the fields that are used are kept. The whole bot configuration is fetched again if it's
+    // needed to duplicate the bot:
     _serverName = [serverName copy];
-    _dictionary = dictionary;
-    _name = _dictionary[@"name"];
-    _botID = _dictionary[@"_id"];
+    _name = dictionary[@"name"];
+    _botID = dictionary[@"_id"];
+    _revision = dictionary[@"_rev"];
     @try {
         _sourceControlRepository =
-            _dictionary[@"configuration"]
+            dictionary[@"configuration"]
                 [@"sourceControlBlueprint"]
                 [@"DVTSourceControlWorkspaceBlueprintRemoteRepositoriesKey"]
                 [0]
                 [@"DVTSourceControlWorkspaceBlueprintRemoteRepositoryURLKey"];
         NSDictionary *locations =
-            _dictionary[@"configuration"]
+            dictionary[@"configuration"]
                 [@"sourceControlBlueprint"]
                 [@"DVTSourceControlWorkspaceBlueprintLocationsKey"];
         _sourceControlWorkspaceBlueprintLocationsID = locations.allKeys.firstObject;
 
-        _templateBotName = _dictionary[@"templateBotName"];
-        _pullRequestNumber = _dictionary[@"pullRequestNumber"];
-        _pullRequestTitle = _dictionary[@"pullRequestTitle"];
+        _templateBotName = dictionary[@"templateBotName"];
+        _pullRequestNumber = dictionary[@"pullRequestNumber"];
+        _pullRequestTitle = dictionary[@"pullRequestTitle"];
     }
     @catch(id error) {
         BNCLogError(@"Can't retrieve source control URL: %@", error);
@@ -299,7 +327,7 @@ _Test Coverage_: 65% (193 tests).
             if ([_repoName hasSuffix:@".git"]) {
                 _repoName = [_repoName substringWithRange:NSMakeRange(0, _repoName.length-4)];
             }
-            NSDictionary*locations = _dictionary[@"configuration"][@"sourceControlBlueprint"][@"DVTSourceControlWorkspaceBlueprintLocationsKey"];
+            NSDictionary*locations = dictionary[@"configuration"][@"sourceControlBlueprint"][@"DVTSourceControlWorkspaceBlueprintLocationsKey"];
             for (NSDictionary*location in locations.objectEnumerator) {
                 _branch = location[@"DVTSourceControlBranchIdentifierKey"];
             }
@@ -309,6 +337,74 @@ _Test Coverage_: 65% (193 tests).
     return self;
 }
 
+/// The key paths of the bot JSON that are read when a bot is made.
+static NSArray<NSString*>*XGXcodeBotKeyPaths = nil;
+
+- (instancetype) initWithServerName:(NSString*)serverName
+        scanner:(XGJSONScanner*)scanner
+        range:(NSRange)range
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    static dispatch_once_t onceToken = 0;
+    dispatch_once(&onceToken, ^ {
+        XGXcodeBotKeyPaths = @[
+            @"name",
+            @"_id",
+            @"_rev",
+            @"templateBotName",
+            @"pullRequestNumber",
+            @"pullRequestTitle",
+            @"configuration.sourceControlBlueprint",
+        ];
+    });
+    NSDictionary *values = [scanner valuesForKeyPaths:XGXcodeBotKeyPaths inObjectAtRange:range error:error];
+    if (!values) return nil;
+
+    NSMutableDictionary *summary = [values mutableCopy];
+    summary[@"configuration.sourceControlBlueprint"] = nil;
+    id blueprint = values[@"configuration.sourceControlBlueprint"];
+    if (blueprint) summary[@"configuration"] = @{ @"sourceControlBlueprint": blueprint };
+
+    self = [self initWithServerName:serverName dictionary:summary];
+    return self;
+}
+
+/// The fields that make up a bot, as saved in the bot cache.
+- (NSDictionary<NSString*, NSString*>*) cacheFields {
+    NSMutableDictionary *fields = [NSMutableDictionary new];
+    #define addField(field) \
+        if ([self.field isKindOfClass:NSString.class]) fields[@#field] = self.field;
+    addField(name);
+    addField(botID);
+    addField(revision);
+    addField(repoOwner);
+    addField(repoName);
+    addField(branch);
+    addField(sourceControlRepository);
+    addField(sourceControlWorkspaceBlueprintLocationsID);
+    addField(pullRequestNumber);
+    addField(pullRequestTitle);
+    addField(templateBotName);
+    #undef addField
+    return fields;
+}
+
+- (instancetype) initWithServerName:(NSString*)serverName cacheFields:(NSDictionary<NSString*, NSString*>*)fields {
+    self = [self initWithServerName:serverName dictionary:nil];
+    if (!self) return self;
+    _name = fields[@"name"];
+    _botID = fields[@"botID"];
+    _revision = fields[@"revision"];
+    _repoOwner = fields[@"repoOwner"];
+    _repoName = fields[@"repoName"];
+    _branch = fields[@"branch"];
+    _sourceControlRepository = fields[@"sourceControlRepository"];
+    _sourceControlWorkspaceBlueprintLocationsID = fields[@"sourceControlWorkspaceBlueprintLocationsID"];
+    _pullRequestNumber = fields[@"pullRequestNumber"];
+    _pullRequestTitle = fields[@"pullRequestTitle"];
+    _templateBotName = fields[@"templateBotName"];
+    return self;
+}
+
 + (NSString*) botNameFromPRNumber:(NSString *)number title:(NSString *)title {
     if (!number) number = @"0";
     if (!title) title = @"<No PR Title>";
@@ -322,47 +418,108 @@ _Test Coverage_: 65% (193 tests).
     return newTitle;
 }
 
+#pragma mark - Bots
+
 + (NSDictionary<NSString*, XGXcodeBot*>*_Nullable) botsForServer:(XGServer*)xcodeServer
         error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    __block NSDictionary<NSString*, XGXcodeBot*>* bots = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self botsForServer:xcodeServer queue:nil
+        completion:^(NSDictionary<NSString*, XGXcodeBot*>*_Nullable bots_, NSError*_Nullable error_) {
+            bots = bots_;
+            localError = error_;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    if (error) *error = localError;
+    return bots;
+}
+
++ (void) botsForServer:(XGServer*)xcodeServer
+        queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nonnull)(NSDictionary<NSString*, XGXcodeBot*>*_Nullable bots, NSError*_Nullable error))completion {
+    NSString *serverURLString =
+        [NSString stringWithFormat:@"https://%@:20343/api/bots", xcodeServer.server];
+    NSURL *serverURL = [NSURL URLWithString:serverURLString];
+    if (!serverURL) {
+        NSError *error =
+            [NSError errorWithDomain:NSNetServicesErrorDomain
+                code:NSURLErrorBadURL
+                userInfo:@{
+                    NSLocalizedDescriptionKey:
+                        [NSString stringWithFormat:@"Bad server name '%@'.", xcodeServer.server]
+                }
+            ];
+        BNCLogError(@"Bad server name '%@'.", xcodeServer.server);
+        XGDispatchOnQueue(queue, ^{ completion(nil, error); });
+        return;
+    }
+
+    BNCNetworkOperation *operation =
+        [[BNCNetworkService shared]
+            getOperationWithURL:serverURL completion:^(BNCNetworkOperation *operation) {
+            NSError *error = nil;
+            NSDictionary *bots = [self botsFromOperation:operation server:xcodeServer error:&error];
+            XGDispatchOnQueue(queue, ^{ completion(bots, error); });
+        }];
+    [self startOperation:operation server:xcodeServer];
+}
+
++ (NSDictionary<NSString*, XGXcodeBot*>*_Nullable) botsFromOperation:(BNCNetworkOperation*)operation
+        server:(XGServer*)xcodeServer
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
 
     NSError *localError = nil;
     NSMutableDictionary<NSString*, XGXcodeBot*>* bots = nil;
-    
-    {
-        NSString *serverURLString =
-            [NSString stringWithFormat:@"https://%@:20343/api/bots", xcodeServer.server];
-        NSURL *serverURL = [NSURL URLWithString:serverURLString];
-        if (!serverURL) {
-            localError =
-                [NSError errorWithDomain:NSNetServicesErrorDomain
-                    code:NSURLErrorBadURL
-                    userInfo:@{
-                        NSLocalizedDescriptionKey:
-                            [NSString stringWithFormat:@"Bad server name '%@'.", xcodeServer.server]
-                    }
-                ];
-            BNCLogError(@"Bad server name '%@'.", xcodeServer.server);
-            goto exit;
-        }
-
-        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
-        BNCNetworkOperation *operation =
-            [[BNCNetworkService shared]
-                getOperationWithURL:serverURL completion:^(BNCNetworkOperation *operation) {
-                dispatch_semaphore_signal(semaphore);
-            }];
-        if (xcodeServer.user.length > 0)
-            [operation setUser:xcodeServer.user password:xcodeServer.password];
-        [operation start];
-        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
 
+    {
         if (operation.error) {
             localError = operation.error;
             goto exit;
         }
-        [operation deserializeJSONResponseData];
-        if (operation.error) {
-            localError = operation.error;
+
+        // The bots carry their whole configuration but only a few fields are used, so the
+        // response is scanned for those fields rather than decoded:
+        if ([operation.responseData isKindOfClass:NSData.class]) {
+            XGJSONScanner *scanner = [[XGJSONScanner alloc] initWithData:(NSData*)operation.responseData];
+            NSArray<NSValue*> *ranges = [scanner rangesOfElementsOfArrayForKey:@"results" error:&localError];
+            if (!ranges) goto exit;
+            XGBotCache *cache = [XGBotCache sharedCache];
+            NSMutableSet<NSString*> *botIDs = [NSMutableSet new];
+            NSInteger cachedCount = 0;
+            bots = [NSMutableDictionary new];
+            for (NSValue *range in ranges) {
+                // A bot that hasn't changed since it was last parsed comes from the cache:
+                XGXcodeBot *bot = nil;
+                NSDictionary *revision =
+                    [scanner valuesForKeyPaths:@[ @"_id", @"_rev" ] inObjectAtRange:range.rangeValue error:nil];
+                NSString *botID = revision[@"_id"], *rev = revision[@"_rev"];
+                BOOL isCacheable = [botID isKindOfClass:NSString.class] && [rev isKindOfClass:NSString.class];
+                if (isCacheable) {
+                    [botIDs addObject:botID];
+                    NSDictionary *fields = [cache fieldsForBotID:botID server:xcodeServer.server revision:rev];
+                    if (fields) {
+                        bot = [[XGXcodeBot alloc] initWithServerName:xcodeServer.server cacheFields:fields];
+                        cachedCount++;
+                    }
+                }
+                if (!bot) {
+                    bot = [[XGXcodeBot alloc] initWithServerName:xcodeServer.server
+                        scanner:scanner range:range.rangeValue error:&localError];
+                    if (!bot) {
+                        bots = nil;
+                        goto exit;
+                    }
+                    if (isCacheable)
+                        [cache setFields:bot.cacheFields forBotID:botID server:xcodeServer.server revision:rev];
+                }
+                bot.xcodeServer = xcodeServer;
+                if (bot.name) bots[bot.name] = bot;
+            }
+            [cache removeBotsForServer:xcodeServer.server exceptBotIDs:botIDs];
+            BNCLogDebug(@"Parsed %ld of %ld bots on %@.",
+                (long) (ranges.count - cachedCount), (long) ranges.count, xcodeServer.server);
             goto exit;
         }
 
@@ -378,6 +535,7 @@ _Test Coverage_: 65% (193 tests).
         bots = [NSMutableDictionary new];
         for (NSDictionary *d in results) {
             XGXcodeBot *bot = [[XGXcodeBot alloc] initWithServerName:xcodeServer.server dictionary:d];
+            bot.xcodeServer = xcodeServer;
             if (bot && bot.name) {
                 bots[bot.name] = bot;
             }
@@ -395,29 +553,209 @@ exit:
     return bots;
 }
 
+#pragma mark - Bot Statuses
+
++ (NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull) statusesForBots:(NSArray<XGXcodeBot*>*)bots
+        jobs:(NSInteger)jobs {
+    __block NSDictionary<NSString*, XGXcodeBotStatus*>*statuses = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self statusesForBots:bots jobs:jobs queue:nil
+        completion:^(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull statuses_) {
+            statuses = statuses_;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return statuses;
+}
+
++ (void) statusesForBots:(NSArray<XGXcodeBot*>*)bots
+        jobs:(NSInteger)jobs
+        queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nonnull)(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull statuses))completion {
+    // Fetch the bot statuses one request per bot, at most `jobs` in flight at a time:
+    NSMutableDictionary<NSString*, XGXcodeBotStatus*>*statuses = [NSMutableDictionary new];
+    XGAsyncForEach(bots, jobs, ^ (XGXcodeBot*bot, dispatch_block_t done) {
+        [bot statusWithQueue:nil completion:^(XGXcodeBotStatus*_Nonnull status) {
+            @synchronized(statuses) {
+                if (bot.name) statuses[bot.name] = status;
+            }
+            done();
+        }];
+    }, ^ {
+        XGDispatchOnQueue(queue, ^{ completion(statuses); });
+    });
+}
+
++ (NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull) botStatusesForServer:(XGServer*)xcodeServer
+        bots:(NSArray<XGXcodeBot*>*)bots
+        jobs:(NSInteger)jobs
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    __block NSDictionary<NSString*, XGXcodeBotStatus*>*statuses = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self botStatusesForServer:xcodeServer bots:bots jobs:jobs queue:nil
+        completion:^(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull statuses_, NSError*_Nullable error_) {
+            statuses = statuses_;
+            localError = error_;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    if (error) *error = localError;
+    return statuses;
+}
+
++ (void) botStatusesForServer:(XGServer*)xcodeServer
+        bots:(NSArray<XGXcodeBot*>*)bots
+        jobs:(NSInteger)jobs
+        queue:(dispatch_queue_t _Nullable)queue
+        completion:(void (^_Nonnull)(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull statuses, NSError*_Nullable error))completion {
+
+    void (^finish)(NSMutableDictionary*, NSArray<XGXcodeBot*>*, NSError*) =
+    ^ (NSMutableDictionary*statuses, NSArray<XGXcodeBot*>*remainingBots, NSError*error) {
+        if (remainingBots.count == 0) {
+            XGDispatchOnQueue(queue, ^{ completion(statuses, error); });
+            return;
+        }
+        BNCLogDebug(@"Getting the status of %ld bots individually.", (long) remainingBots.count);
+        [self statusesForBots:remainingBots jobs:jobs queue:nil
+            completion:^(NSDictionary<NSString*, XGXcodeBotStatus*>*_Nonnull botStatuses) {
+                [statuses addEntriesFromDictionary:botStatuses];
+                XGDispatchOnQueue(queue, ^{ completion(statuses, error); });
+            }];
+    };
+
+    if (bots.count == 0) {
+        finish([NSMutableDictionary new], nil, nil);
+        return;
+    }
+
+    // Get the latest integrations for all bots in one listing, newest first. Ask for a few
+    // integrations per bot so that busy bots don't crowd out the quiet ones:
+    NSInteger limit = MAX(100, bots.count * 4);
+    NSString *serverURLString =
+        [NSString stringWithFormat:@"https://%@:20343/api/integrations?last=%ld",
+            xcodeServer.server, (long) limit];
+    NSURL *serverURL = [NSURL URLWithString:serverURLString];
+    if (!serverURL) {
+        NSError *error =
+            [NSError errorWithDomain:NSNetServicesErrorDomain
+                code:NSURLErrorBadURL
+                userInfo:@{
+                    NSLocalizedDescriptionKey:
+                        [NSString stringWithFormat:@"Bad server name '%@'.", xcodeServer.server]
+                }
+            ];
+        BNCLogError(@"Bad server name '%@'.", xcodeServer.server);
+        finish([NSMutableDictionary new], nil, error);
+        return;
+    }
+
+    BNCNetworkOperation *operation =
+        [[BNCNetworkService shared]
+            getOperationWithURL:serverURL completion:^(BNCNetworkOperation *operation) {
+            NSMutableDictionary *statuses = [NSMutableDictionary new];
+            NSMutableArray *remainingBots = [NSMutableArray arrayWithArray:bots];
+            [self addStatusesFromOperation:operation
+                server:xcodeServer
+                statuses:statuses
+                remainingBots:remainingBots];
+            finish(statuses, remainingBots, nil);
+        }];
+    [self startOperation:operation server:xcodeServer];
+}
+
++ (void) addStatusesFromOperation:(BNCNetworkOperation*)operation
+        server:(XGServer*)xcodeServer
+        statuses:(NSMutableDictionary<NSString*, XGXcodeBotStatus*>*)statuses
+        remainingBots:(NSMutableArray<XGXcodeBot*>*)remainingBots {
+
+    if (operation.error || operation.HTTPStatusCode != 200) {
+        BNCLogDebug(@"Can't list integrations on '%@' (%ld): %@. Getting statuses per bot.",
+            xcodeServer.server, (long) operation.HTTPStatusCode, operation.error);
+        return;
+    }
+    [operation deserializeJSONResponseData];
+    NSDictionary *response =
+        ([operation.responseData isKindOfClass:[NSDictionary class]])
+        ? (NSDictionary*) operation.responseData : nil;
+    NSArray *results = response[@"results"];
+    if (operation.error || ![results isKindOfClass:NSArray.class]) {
+        BNCLogDebug(@"Unexpected integration listing from '%@'. Getting statuses per bot.",
+            xcodeServer.server);
+        return;
+    }
+    [self addStatusesFromIntegrations:results
+        server:xcodeServer
+        statuses:statuses
+        remainingBots:remainingBots];
+}
+
++ (void) addStatusesFromIntegrations:(NSArray*)results
+        server:(XGServer*)xcodeServer
+        statuses:(NSMutableDictionary<NSString*, XGXcodeBotStatus*>*)statuses
+        remainingBots:(NSMutableArray<XGXcodeBot*>*)remainingBots {
+
+    // Keep the newest integration for each bot ID:
+    NSMutableDictionary<NSString*, NSDictionary*>*latest = [NSMutableDictionary new];
+    for (NSDictionary *integration in results) {
+        if (![integration isKindOfClass:NSDictionary.class]) continue;
+        NSString *botID = integration[@"bot"][@"_id"];
+        if (![botID isKindOfClass:NSString.class]) continue;
+        NSDictionary *current = latest[botID];
+        if (!current ||
+            [integration[@"number"] integerValue] > [current[@"number"] integerValue])
+            latest[botID] = integration;
+    }
+
+    // The server may cap the listing at fewer integrations than were asked for, so a bot that's
+    // missing from it may just have integrated earlier. Those bots are left for the per-bot requests:
+    for (XGXcodeBot *bot in [remainingBots copy]) {
+        if (!bot.name || !bot.botID) continue;
+        NSDictionary *integration = latest[bot.botID];
+        if (integration) {
+            statuses[bot.name] =
+                [[XGXcodeBotStatus alloc] initWithServerName:xcodeServer.server dictionary:integration];
+            [remainingBots removeObject:bot];
+        }
+    }
+}
+
 - (BOOL) botIsFromTemplateBot {
     return (self.templateBotName.length == 0) ? NO : YES;
 }
 
 - (XGXcodeBotStatus*_Nonnull) status {
+    __block XGXcodeBotStatus *status = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self statusWithQueue:nil completion:^(XGXcodeBotStatus*_Nonnull status_) {
+        status = status_;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return status;
+}
+
+- (void) statusWithQueue:(dispatch_queue_t _Nullable)queue
+              completion:(void (^_Nonnull)(XGXcodeBotStatus*_Nonnull status))completion {
+    NSString *statusString =
+        [NSString stringWithFormat:
+            @"https://%@:20343/api/bots/%@/integrations?last=1",
+                self.serverName, self.botID];
+    NSURL *statusURL = [NSURL URLWithString:statusString];
+
+    BNCNetworkOperation *operation =
+        [[BNCNetworkService shared]
+            getOperationWithURL:statusURL completion:^(BNCNetworkOperation *operation) {
+            XGXcodeBotStatus *status = [self statusFromOperation:operation];
+            XGDispatchOnQueue(queue, ^{ completion(status); });
+        }];
+    [self.class startOperation:operation server:self.xcodeServer];
+}
+
+- (XGXcodeBotStatus*_Nonnull) statusFromOperation:(BNCNetworkOperation*)operation {
     NSError *localError = nil;
     XGXcodeBotStatus *status = nil;
     {
-        NSString *statusString =
-            [NSString stringWithFormat:
-                @"https://%@:20343/api/bots/%@/integrations?last=1",
-                    self.serverName, self.botID];
-        NSURL *statusURL = [NSURL URLWithString:statusString];
-
-        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
-        BNCNetworkOperation *operation =
-            [[BNCNetworkService shared]
-                getOperationWithURL:statusURL completion:^(BNCNetworkOperation *operation) {
-                dispatch_semaphore_signal(semaphore);
-            }];
-        [operation start];
-        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
-
         if (operation.error) {
             localError = operation.error;
             goto exit;
@@ -434,15 +772,8 @@ exit:
         if ([a isKindOfClass:NSArray.class]) {
             if (a.count >= 1)
                 status = [[XGXcodeBotStatus alloc] initWithServerName:self.serverName dictionary:a[0]];
-            else {
-                status = [[XGXcodeBotStatus alloc] initWithServerName:self.serverName dictionary:nil];
-                status.botID = self.botID;
-                status.botName = self.name;
-                status.serverName = self.serverName;
-                status.integrationNumber = [NSNumber numberWithInteger:0];
-                status.currentStep = @"no integrations";
-                status.result = @"unknown";
-            }
+            else
+                status = [XGXcodeBotStatus statusWithNoIntegrationsForBot:self];
             goto exit;
         }
 
@@ -458,13 +789,26 @@ exit:
     return status;
 }
 
+#pragma mark - Bot Changes
+
 - (NSError*_Nullable) deleteBot {
-    NSError *localError = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self deleteBotWithQueue:nil completion:^(NSError*_Nullable error) {
+        localError = error;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return localError;
+}
+
+- (void) deleteBotWithQueue:(dispatch_queue_t _Nullable)queue
+                 completion:(void (^_Nullable)(NSError*_Nullable error))completion {
     NSString *string = [NSString stringWithFormat:
         @"https://%@:20343/api/bots/%@", self.serverName, self.botID];
     NSURL *URL = [NSURL URLWithString:string];
     if (!URL) {
-        localError =
+        NSError *error =
             [NSError errorWithDomain:NSNetServicesErrorDomain
                 code:NSURLErrorBadURL
                 userInfo:@{
@@ -473,29 +817,24 @@ exit:
                 }
             ];
         BNCLogError(@"Bad server name '%@'.", self.serverName);
-        return localError;
+        if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
+        return;
     }
 
-    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
     BNCNetworkOperation *operation =
         [[BNCNetworkService shared]
             getOperationWithURL:URL
             completion:^(BNCNetworkOperation *operation) {
-                dispatch_semaphore_signal(semaphore);
+                NSError *error = operation.error;
+                if (!error && (operation.HTTPStatusCode < 200 || operation.HTTPStatusCode >= 300)) {
+                    error = [NSError errorWithDomain:NSNetServicesErrorDomain
+                        code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
+                            [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
+                }
+                if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
         }];
     operation.request.HTTPMethod = @"DELETE";
-    [operation start];
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
-    if (operation.error) return operation.error;
-
-    if (operation.HTTPStatusCode < 200 || operation.HTTPStatusCode >= 300) {
-        localError = [NSError errorWithDomain:NSNetServicesErrorDomain
-            code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
-                [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
-        return localError;
-    }
-
-    return nil;
+    [self.class startOperation:operation server:self.xcodeServer];
 }
 
 - (XGXcodeBot*_Nullable) duplicateBotWithNewName:(NSString*_Nonnull)newBotName
@@ -503,42 +842,158 @@ exit:
                          gitHubPullRequestNumber:(NSString*_Nonnull)pullRequestNumber
                           gitHubPullRequestTitle:(NSString*_Nonnull)pullRequestTitle
                                            error:(NSError*__autoreleasing _Nullable*_Nullable)error {
-    XGXcodeBot *bot = nil;
+    __block XGXcodeBot *bot = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self duplicateBotWithNewName:newBotName
+        branchName:branchName
+        gitHubPullRequestNumber:pullRequestNumber
+        gitHubPullRequestTitle:pullRequestTitle
+        queue:nil
+        completion:^(XGXcodeBot*_Nullable bot_, NSError*_Nullable error_) {
+            bot = bot_;
+            localError = error_;
+            dispatch_semaphore_signal(semaphore);
+        }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    if (error) *error = localError;
+    return bot;
+}
+
+- (void) duplicateBotWithNewName:(NSString*_Nonnull)newBotName
+                      branchName:(NSString*_Nonnull)branchName
+         gitHubPullRequestNumber:(NSString*_Nonnull)pullRequestNumber
+          gitHubPullRequestTitle:(NSString*_Nonnull)pullRequestTitle
+                           queue:(dispatch_queue_t _Nullable)queue
+                      completion:(void (^_Nonnull)(XGXcodeBot*_Nullable bot, NSError*_Nullable error))completion {
+    void (^duplicate)(NSDictionary*template) = ^ (NSDictionary*template) {
+        [self duplicateBotWithTemplate:template
+            newName:newBotName
+            branchName:branchName
+            gitHubPullRequestNumber:pullRequestNumber
+            gitHubPullRequestTitle:pullRequestTitle
+            queue:queue
+            completion:completion];
+    };
+
+    // The template is prepared once for each revision of the bot:
+    XGBotCache *cache = [XGBotCache sharedCache];
+    NSDictionary *template = (self.botID && self.revision)
+        ? [cache templateForBotID:self.botID server:self.serverName revision:self.revision]
+        : nil;
+    if (template) {
+        duplicate(template);
+        return;
+    }
+
+    // Bots don't keep their configuration, so fetch it for the copy:
+    [self botDictionaryWithCompletion:^(NSDictionary*_Nullable dictionary, NSError*_Nullable error) {
+        if (!dictionary) {
+            XGDispatchOnQueue(queue, ^{ completion(nil, error); });
+            return;
+        }
+        NSDictionary *template = [self.class templateFromBotDictionary:dictionary];
+        NSString *revision = dictionary[@"_rev"];
+        if (self.botID && [revision isKindOfClass:NSString.class])
+            [cache setTemplate:template forBotID:self.botID server:self.serverName revision:revision];
+        duplicate(template);
+    }];
+}
+
+/// Returns the parts of a bot's configuration that are the same for every copy of the bot.
++ (NSDictionary*) templateFromBotDictionary:(NSDictionary*)botDictionary {
+    NSMutableDictionary *template = (__bridge_transfer NSMutableDictionary*)
+        CFPropertyListCreateDeepCopy(
+            kCFAllocatorDefault,
+            (CFDictionaryRef)botDictionary,
+            kCFPropertyListMutableContainers
+    );
+    template[@"configuration"][@"scheduleType"] = @2; // 2: On commit
+    template[@"integration_counter"] = nil;
+    template[@"lastRevisionBlueprint"] = nil;
+    return template;
+}
+
+- (NSURL*_Nullable) URLWithFormat:(NSString*)format error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    NSString *string = [NSString stringWithFormat:format, self.serverName, self.botID];
+    NSURL *URL = [NSURL URLWithString:string];
+    if (!URL) {
+        if (error) *error =
+            [NSError errorWithDomain:NSNetServicesErrorDomain
+                code:NSURLErrorBadURL
+                userInfo:@{
+                    NSLocalizedDescriptionKey:
+                        [NSString stringWithFormat:@"Bad server name '%@'.", self.serverName]
+                }
+            ];
+        BNCLogError(@"Bad server name '%@'.", self.serverName);
+    }
+    return URL;
+}
+
+- (void) botDictionaryWithCompletion:(void (^_Nonnull)(NSDictionary*_Nullable dictionary, NSError*_Nullable error))completion {
+    NSError *error = nil;
+    NSURL *URL = [self URLWithFormat:@"https://%@:20343/api/bots/%@" error:&error];
+    if (!URL) {
+        completion(nil, error);
+        return;
+    }
+    BNCNetworkOperation *operation =
+        [[BNCNetworkService shared]
+            getOperationWithURL:URL completion:^(BNCNetworkOperation *operation) {
+            NSError *error = operation.error;
+            if (!error && operation.HTTPStatusCode != 200) {
+                error = [NSError errorWithDomain:NSNetServicesErrorDomain
+                    code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
+                        [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
+            }
+            if (!error) {
+                [operation deserializeJSONResponseData];
+                error = operation.error;
+            }
+            NSDictionary *dictionary = (id) operation.responseData;
+            if (!error && ![dictionary isKindOfClass:NSDictionary.class]) {
+                error = [NSError errorWithDomain:NSNetServicesErrorDomain
+                    code:NSURLErrorBadServerResponse
+                    userInfo:@{ NSLocalizedDescriptionKey: @"Expected a dictionary." }];
+            }
+            if (error) {
+                BNCLogError(@"Can't fetch bot '%@': %@.", self.name, error);
+                completion(nil, error);
+                return;
+            }
+            completion(dictionary, nil);
+        }];
+    [self.class startOperation:operation server:self.xcodeServer];
+}
+
+- (void) duplicateBotWithTemplate:(NSDictionary*)template
+                          newName:(NSString*_Nonnull)newBotName
+                       branchName:(NSString*_Nonnull)branchName
+          gitHubPullRequestNumber:(NSString*_Nonnull)pullRequestNumber
+           gitHubPullRequestTitle:(NSString*_Nonnull)pullRequestTitle
+                            queue:(dispatch_queue_t _Nullable)queue
+                       completion:(void (^_Nonnull)(XGXcodeBot*_Nullable bot, NSError*_Nullable error))completion {
     NSError *localError = nil;
     {
-        NSString *string =
-            [NSString stringWithFormat:@"https://%@:20343/api/bots/%@/duplicate",
-                self.serverName,
-                self.botID];
-        NSURL *URL = [NSURL URLWithString:string];
-        if (!URL) {
-            localError =
-                [NSError errorWithDomain:NSNetServicesErrorDomain
-                    code:NSURLErrorBadURL
-                    userInfo:@{
-                        NSLocalizedDescriptionKey:
-                            [NSString stringWithFormat:@"Bad server name '%@'.", self.serverName]
-                    }
-                ];
-            BNCLogError(@"Bad server name '%@'.", self.serverName);
-            goto exit;
+        NSURL *URL = [self URLWithFormat:@"https://%@:20343/api/bots/%@/duplicate" error:&localError];
+        if (!URL) goto exit;
+
+        // The template is shared, so only the containers along the path to the branch are copied:
+        NSMutableDictionary *dictionary = [template mutableCopy];
+        NSString *locationID = self.sourceControlWorkspaceBlueprintLocationsID;
+        if (locationID) {
+            NSMutableDictionary *configuration = [dictionary[@"configuration"] mutableCopy];
+            NSMutableDictionary *blueprint = [configuration[@"sourceControlBlueprint"] mutableCopy];
+            NSMutableDictionary *locations =
+                [blueprint[@"DVTSourceControlWorkspaceBlueprintLocationsKey"] mutableCopy];
+            NSMutableDictionary *location = [locations[locationID] mutableCopy];
+            location[@"DVTSourceControlBranchIdentifierKey"] = branchName;
+            locations[locationID] = location;
+            blueprint[@"DVTSourceControlWorkspaceBlueprintLocationsKey"] = locations;
+            configuration[@"sourceControlBlueprint"] = blueprint;
+            dictionary[@"configuration"] = configuration;
         }
-
-        NSMutableDictionary *dictionary = (__bridge_transfer NSMutableDictionary*)
-            CFPropertyListCreateDeepCopy(
-                kCFAllocatorDefault,
-                (CFDictionaryRef)self.dictionary,
-                kCFPropertyListMutableContainers
-        );
-        dictionary[@"configuration"]
-            [@"sourceControlBlueprint"]
-            [@"DVTSourceControlWorkspaceBlueprintLocationsKey"]
-            [self.sourceControlWorkspaceBlueprintLocationsID]
-            [@"DVTSourceControlBranchIdentifierKey"] =
-                branchName;
-        dictionary[@"configuration"][@"scheduleType"] = @2; // 2: On commit
-        dictionary[@"integration_counter"] = nil;
-        dictionary[@"lastRevisionBlueprint"] = nil;
         dictionary[@"name"] = newBotName;
         dictionary[@"templateBotName"] = self.name;
         dictionary[@"pullRequestNumber"] = pullRequestNumber;
@@ -547,17 +1002,35 @@ exit:
         NSData *data = [NSJSONSerialization dataWithJSONObject:dictionary options:0 error:&localError];
         if (localError) goto exit;
 
-        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
         BNCNetworkOperation *operation =
             [[BNCNetworkService shared]
                 postOperationWithURL:URL
                 contentType:@"application/json"
                 data:data
                 completion:^(BNCNetworkOperation *operation) {
-                    dispatch_semaphore_signal(semaphore);
+                    NSError *error = nil;
+                    XGXcodeBot *bot = [self duplicatedBotFromOperation:operation error:&error];
+                    if (!bot) {
+                        XGDispatchOnQueue(queue, ^{ completion(nil, error); });
+                        return;
+                    }
+                    [bot startIntegrationWithQueue:nil completion:^(NSError*_Nullable integrationError) {
+                        XGDispatchOnQueue(queue, ^{ completion(bot, nil); });
+                    }];
             }];
-        [operation start];
-        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+        [self.class startOperation:operation server:self.xcodeServer];
+        return;
+    }
+
+exit:
+    XGDispatchOnQueue(queue, ^{ completion(nil, localError); });
+}
+
+- (XGXcodeBot*_Nullable) duplicatedBotFromOperation:(BNCNetworkOperation*)operation
+        error:(NSError*__autoreleasing _Nullable*_Nullable)error {
+    XGXcodeBot *bot = nil;
+    NSError *localError = nil;
+    {
         if (operation.error) {
             localError = operation.error;
             goto exit;
@@ -575,10 +1048,8 @@ exit:
         NSDictionary *d = (id) operation.responseData;
         if ([d isKindOfClass:NSDictionary.class]) {
             bot = [[XGXcodeBot alloc] initWithServerName:self.serverName dictionary:d];
-            if (bot) {
-                [bot startIntegration];
-                goto exit;
-            }
+            bot.xcodeServer = self.xcodeServer;
+            if (bot) goto exit;
         }
         localError =
             [NSError errorWithDomain:NSNetServicesErrorDomain
@@ -592,12 +1063,23 @@ exit:
 }
 
 - (NSError*) startIntegration {
-    NSError *localError = nil;
+    __block NSError *localError = nil;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self startIntegrationWithQueue:nil completion:^(NSError*_Nullable error) {
+        localError = error;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return localError;
+}
+
+- (void) startIntegrationWithQueue:(dispatch_queue_t _Nullable)queue
+                        completion:(void (^_Nullable)(NSError*_Nullable error))completion {
     NSString *string = [NSString stringWithFormat:
         @"https://%@:20343/api/bots/%@/integrations", self.serverName, self.botID];
     NSURL *URL = [NSURL URLWithString:string];
     if (!URL) {
-        localError =
+        NSError *error =
             [NSError errorWithDomain:NSNetServicesErrorDomain
                 code:NSURLErrorBadURL
                 userInfo:@{
@@ -606,33 +1088,28 @@ exit:
                 }
             ];
         BNCLogError(@"Bad server name '%@'.", self.serverName);
-        return localError;
+        if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
+        return;
     }
 
     NSDictionary *dictionary = @{
         @"shouldClean": @(true)
     };
 
-    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
     BNCNetworkOperation *operation =
         [[BNCNetworkService shared]
             postOperationWithURL:URL
             JSONData:dictionary
             completion:^(BNCNetworkOperation *operation) {
-                dispatch_semaphore_signal(semaphore);
+                NSError *error = operation.error;
+                if (!error && operation.HTTPStatusCode != 201) {
+                    error = [NSError errorWithDomain:NSNetServicesErrorDomain
+                        code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
+                            [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
+                }
+                if (completion) XGDispatchOnQueue(queue, ^{ completion(error); });
         }];
-    [operation start];
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
-    if (operation.error) return operation.error;
-
-    if (operation.HTTPStatusCode != 201) {
-        localError = [NSError errorWithDomain:NSNetServicesErrorDomain
-            code:NSNetServicesInvalidError userInfo:@{NSLocalizedDescriptionKey:
-                [NSString stringWithFormat:@"HTTP Status %ld", (long) operation.HTTPStatusCode]}];
-        return localError;
-    }
-
-    return nil;
+    [self.class startOperation:operation server:self.xcodeServer];
 }
 
 @end
@@ -14,7 +14,11 @@
 #import "BNCNetworkService.h"
 #import "XGCommand.h"
 #import "XGCommandOptions.h"
+#import "XGCycleSnapshot.h"
 #import "XGGitHubPullRequest.h"
+#import "XGGitHubScheduler.h"
+#import "XGNetworkMetrics.h"
+#import "XGUtility.h"
 #import "XGXcodeBot.h"
 
 FOUNDATION_EXPORT NSString*_Nonnull XGVersion(void);
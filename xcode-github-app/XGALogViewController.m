@@ -66,6 +66,8 @@ void XGALogFunction(NSDate*_Nonnull timestamp, BNCLogLevel level, NSString*_Null
 + (void) startLog {
     BNCLogSetOutputFunction(XGALogFunction);
     BNCLogSetDisplayLevel(BNCLogLevelWarning);
+    // The log window keeps the debug messages too, and hides them unless they're asked for:
+    BNCLogSetOutputLevel(BNCLogLevelAll);
     BNCLog(@"%@ version %@(%@).",
         [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleExecutable"],
         [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleShortVersionString"],
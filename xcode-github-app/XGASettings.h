@@ -36,6 +36,9 @@ FOUNDATION_EXPORT NSString*_Nonnull XGACleanString(NSString*_Nullable string);
 @property (assign) BOOL dryRun;
 @property (assign) BOOL showDebugMessages;
 @property (assign) NSTimeInterval refreshSeconds;
+@property (assign) NSInteger connectionsPerHost;            // Concurrent requests to each host
+@property (assign) NSInteger jobs;                          // Concurrent bot status requests
+@property (assign) NSTimeInterval requestTimeoutSeconds;
 @property (copy)   NSString*gitHubToken;
 @property (strong, null_resettable) NSMutableArray<XGAServer*>*servers;
 @property (strong, null_resettable) NSMutableArray<XGAGitHubSyncTask*>*gitHubSyncTasks;
@@ -90,6 +90,9 @@ NSString*_Nonnull XGACleanString(NSString*_Nullable string) {
     self.dryRun = NO;
     self.showDebugMessages = NO;
     self.refreshSeconds = 60.0;
+    self.connectionsPerHost = 4;
+    self.jobs = 4;
+    self.requestTimeoutSeconds = 60.0;
     return self;
 }
 
@@ -190,6 +193,9 @@ NSString*_Nonnull XGACleanString(NSString*_Nullable string) {
     self.dryRun = NO;
     self.showDebugMessages = NO;
     self.refreshSeconds = 60.0;
+    self.connectionsPerHost = 4;
+    self.jobs = 4;
+    self.requestTimeoutSeconds = 60.0;
     self.gitHubToken = @"";
     [self.servers removeAllObjects];
     [self.gitHubSyncTasks removeAllObjects];
@@ -197,6 +203,9 @@ NSString*_Nonnull XGACleanString(NSString*_Nullable string) {
 
 - (void) validate {
     self.refreshSeconds = MAX(15.0, MIN(self.refreshSeconds, 60.0*60.0*24.0*1.0));
+    if (self.connectionsPerHost < 1) self.connectionsPerHost = 4;
+    if (self.jobs < 1) self.jobs = 4;
+    if (self.requestTimeoutSeconds <= 0.0) self.requestTimeoutSeconds = 60.0;
 
     // Assure that servers are unique:
     NSMutableDictionary*d = NSMutableDictionary.new;
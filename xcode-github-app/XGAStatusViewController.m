@@ -20,6 +20,9 @@
 
 @interface XGAStatusViewController () <NSTableViewDelegate, NSPopoverDelegate>
 @property (strong) dispatch_queue_t asyncQueue;
+@property (strong) dispatch_queue_t serverQueue;
+@property (strong) XGRefreshTracker *serverRefreshes; // Keyed by server name.
+@property (strong) NSMutableDictionary<NSString*, NSArray<XGAStatusViewItem*>*>*serverStatusItems; // Main thread only.
 @property (strong) dispatch_source_t statusTimer;
 @property (assign, nonatomic) _Atomic(BOOL) statusIsInProgress;
 @property (strong) XGAStatusPopover*statusPopover;
@@ -35,6 +38,9 @@
 
 #pragma mark - XGAStatusViewController
 
+/// A server that takes longer than this to refresh is shown as not responding.
+static NSTimeInterval const kServerRefreshTimeout = 30.0;
+
 @implementation XGAStatusViewController
 
 + (instancetype) new {
@@ -56,6 +62,8 @@
         status.statusImage = [NSImage imageNamed:@"RoundBlue"];
         status.statusSummary = [APFormattedString boldText:@"< Refreshing >"];
         self.arrayController.content = @[ status ];
+        self.serverRefreshes = [XGRefreshTracker new];
+        self.serverStatusItems = [NSMutableDictionary new];
         [self startStatusUpdates];
         self.tableView.delegate = self;
         [self smartSort:self];
@@ -166,8 +174,8 @@
     [[alert addButtonWithTitle:@"Delete"] setTag:NSModalResponseOK];
     [[alert addButtonWithTitle:@"Cancel"] setTag:NSModalResponseCancel];
     [alert beginSheetModalForWindow:self.window completionHandler:^(NSModalResponse returnCode) {
-        if (returnCode == NSModalResponseOK) {
-            NSError*error = [status.bot deleteBot];
+        if (returnCode != NSModalResponseOK) return;
+        [status.bot deleteBotWithQueue:dispatch_get_main_queue() completion:^(NSError*_Nullable error) {
             if (error) {
                 __auto_type ea = [[NSAlert alloc] init];
                 ea.messageText = [NSString stringWithFormat:@"Error deleting '%@'.", status.botName];
@@ -177,7 +185,7 @@
             } else {
                 [self updateStatusNow];
             }
-        }
+        }];
     }];
 }
 
@@ -319,7 +327,9 @@
 }
 
 - (void) updateStatus {
-    NSTimeInterval kStatusRefreshInterval = [XGASettings shared].refreshSeconds;
+    // Poll less often if the GitHub rate limit would run out before it resets:
+    NSTimeInterval kStatusRefreshInterval =
+        [[XGGitHubScheduler shared] recommendedPollIntervalWithMinimum:[XGASettings shared].refreshSeconds];
     NSTimeInterval elapsed = - [self.lastUpdateDate timeIntervalSinceNow];
     BNCPerformBlockOnMainThreadAsync(^{
         self.updateProgessIndictor.doubleValue = elapsed / kStatusRefreshInterval * 100.0;
@@ -334,24 +344,82 @@
     }
 
     BNCLogDebug(@"Start updateStatus.");
+    BNCNetworkHostConfiguration *hostConfiguration = [BNCNetworkHostConfiguration new];
+    hostConfiguration.maximumConcurrentRequests = XGASettings.shared.connectionsPerHost;
+    hostConfiguration.timeoutInterval = XGASettings.shared.requestTimeoutSeconds;
+    [BNCNetworkService shared].defaultHostConfiguration = hostConfiguration;
     BNCPerformBlockOnMainThreadAsync(^{ self.statusTextField.stringValue = @""; });
     NSMutableDictionary<NSString*, XGServer*>*statusServers = [NSMutableDictionary new];
     for (XGAServer*server in XGASettings.shared.servers) {
         if (server.server.length > 0)
             statusServers[server.server] = server;
     }
-    NSArray<XGAGitHubSyncTask*>* syncTasks = XGASettings.shared.gitHubSyncTasks;
-    for (XGAGitHubSyncTask*task in syncTasks) {
+    NSMutableDictionary<NSString*, NSMutableArray<XGAGitHubSyncTask*>*>*serverSyncTasks =
+        [NSMutableDictionary new];
+    for (XGAGitHubSyncTask*task in XGASettings.shared.gitHubSyncTasks) {
         if (task.xcodeServer.length == 0 || statusServers[task.xcodeServer] == nil)
             continue;
-        [self updateSyncBots:task];
-    }
-    for (XGAServer*server in statusServers.objectEnumerator) {
-        [self updateXcodeServerStatus:server];
+        if (!serverSyncTasks[task.xcodeServer]) serverSyncTasks[task.xcodeServer] = [NSMutableArray new];
+        [serverSyncTasks[task.xcodeServer] addObject:task];
     }
-    if (syncTasks.count == 0 && statusServers.count == 0) {
-        // Update with 'nil' to add content for an empty display:
-        [self updateXcodeServerStatus:nil];
+
+    // Drop the rows of servers that were removed:
+    NSSet<NSString*>*serverNames = [NSSet setWithArray:statusServers.allKeys];
+    BNCPerformBlockOnMainThreadAsync(^{
+        for (NSString *serverName in self.serverStatusItems.allKeys) {
+            if (![serverNames containsObject:serverName])
+                [self.serverStatusItems removeObjectForKey:serverName];
+        }
+        [self showServerStatusItems];
+    });
+
+    // Each server is refreshed on its own so that a slow or unreachable server doesn't hold up
+    // the others. The sync tasks and the display share what's fetched this cycle:
+    XGCycleSnapshot *cycle = [XGCycleSnapshot new];
+    if (!self.serverQueue)
+        self.serverQueue = dispatch_queue_create("io.branch.server_queue", DISPATCH_QUEUE_CONCURRENT);
+    for (XGServer *server in statusServers.objectEnumerator) {
+        NSString *serverName = server.server;
+        NSArray<XGAGitHubSyncTask*>*syncTasks = serverSyncTasks[serverName];
+        NSNumber *refreshNumber = [self.serverRefreshes beginRefreshForKey:serverName];
+        if (!refreshNumber) {
+            BNCLogDebug(@"Still waiting on '%@' from the last refresh.", serverName);
+            continue;
+        }
+
+        // The sync tasks of a server run at the same time, and then its rows are shown:
+        dispatch_group_t syncGroup = dispatch_group_create();
+        for (XGAGitHubSyncTask *task in syncTasks) {
+            dispatch_group_async(syncGroup, self.serverQueue, ^{
+                [self updateSyncBots:task server:server cycle:cycle];
+            });
+        }
+        dispatch_group_notify(syncGroup, self.serverQueue, ^{
+            NSArray *statusItems = [self statusItemsForServer:server cycle:cycle];
+            [self.serverRefreshes endRefreshForKey:serverName];
+            BNCPerformBlockOnMainThreadAsync(^{
+                self.serverStatusItems[serverName] = statusItems;
+                [self showServerStatusItems];
+            });
+        });
+
+        // Only this refresh can time out. A newer refresh of the server has its own timer:
+        dispatch_after(
+            dispatch_time(DISPATCH_TIME_NOW, BNCNanoSecondsFromTimeInterval(kServerRefreshTimeout)),
+            self.asyncQueue, ^{
+            if (![self.serverRefreshes isCurrentRefresh:refreshNumber forKey:serverName]) return;
+            BNCLogWarning(@"Xcode server '%@' isn't responding.", serverName);
+            XGAStatusViewItem *status = [XGAStatusViewItem new];
+            status.server = serverName;
+            status.statusSummary = [APFormattedString boldText:@"Server Not Responding"];
+            status.statusImage = [NSImage imageNamed:@"RoundAlert"];
+            status.statusDetail =
+                [APFormattedString plainText:@"No response after %1.0f seconds.", kServerRefreshTimeout];
+            BNCPerformBlockOnMainThreadAsync(^{
+                self.serverStatusItems[serverName] = @[ status ];
+                [self showServerStatusItems];
+            });
+        });
     }
     BNCLogDebug(@"End updateStatus.");
 
@@ -362,16 +430,37 @@
     self.statusIsInProgress = NO;
 }
 
-- (void) updateSyncBots:(XGAGitHubSyncTask*)syncTask {
+/// Shows the latest status rows of every server. Call on the main thread.
+- (void) showServerStatusItems {
+    NSMutableArray *statusArray = [NSMutableArray new];
+    for (NSArray *items in self.serverStatusItems.objectEnumerator)
+        [statusArray addObjectsFromArray:items];
+    if (statusArray.count == 0) {
+        XGAStatusViewItem *status = [XGAStatusViewItem new];
+        status.statusImage = [NSImage imageNamed:@"RoundBlue"];
+        status.statusSummary = (XGASettings.shared.servers.count)
+            ? [APFormattedString boldText:@"< Refreshing >"]
+            : [APFormattedString boldText:@"< No Xcode servers added yet >"];
+        [statusArray addObject:status];
+    }
+    self.arrayController.content = statusArray;
+}
+
+- (void) updateSyncBots:(XGAGitHubSyncTask*)syncTask server:(XGServer*)server cycle:(XGCycleSnapshot*)cycle {
     NSError*error = nil;
     if (syncTask.xcodeServer.length &&
         syncTask.botNameForTemplate.length) {
         XGCommandOptions*options = [XGCommandOptions new];
         options.xcodeServerName = syncTask.xcodeServer;
+        options.xcodeServerUser = server.user;
+        options.xcodeServerPassword = server.password;
         options.templateBotName = syncTask.botNameForTemplate;
         options.githubAuthToken = XGASettings.shared.gitHubToken;
         options.dryRun = XGASettings.shared.dryRun;
-        error = XGUpdateXcodeBotsWithGitHub(options);
+        options.connectionsPerHost = (int) XGASettings.shared.connectionsPerHost;
+        options.jobs = (int) XGASettings.shared.jobs;
+        options.requestTimeout = XGASettings.shared.requestTimeoutSeconds;
+        error = XGUpdateXcodeBotsWithGitHubInCycle(options, cycle);
         if (error) {
             NSMutableAttributedString*message =
                 [NSAttributedString stringWithStrings:
@@ -387,35 +476,27 @@
     }
 }
 
-- (void) updateXcodeServerStatus:(XGServer*)server {
+- (NSArray<XGAStatusViewItem*>*) statusItemsForServer:(XGServer*)server cycle:(XGCycleSnapshot*)cycle {
     NSError*error = nil;
     NSMutableArray *statusArray = [NSMutableArray new];
-    if (server.server.length > 0) {
-        NSDictionary<NSString*, XGXcodeBot*>* bots = [XGXcodeBot botsForServer:server error:&error];
-        if (error) {
-            XGAStatusViewItem *status = [XGAStatusViewItem new];
-            status.server = server.server;
-            status.statusSummary = [APFormattedString boldText:@"Server Error"];
-            status.statusImage = [NSImage imageNamed:@"RoundAlert"];
-            status.statusDetail = [APFormattedString plainText:@"%@", error.localizedDescription];
-            [statusArray addObject:status];
-        } else {
-            for (XGXcodeBot *bot in bots.objectEnumerator) {
-                XGXcodeBotStatus*botStatus = [bot status];
-                __auto_type item = [XGAStatusViewItem itemWithBot:bot status:botStatus];
-                if (item) [statusArray addObject:item];
-            }
-        }
-    }
-    if (statusArray.count == 0) {
+    NSDictionary<NSString*, XGXcodeBot*>* bots = [cycle botsForServer:server error:&error];
+    NSDictionary<NSString*, XGXcodeBotStatus*>*botStatuses = nil;
+    if (!error) botStatuses = [cycle botStatusesForServer:server jobs:XGASettings.shared.jobs error:&error];
+    if (error) {
         XGAStatusViewItem *status = [XGAStatusViewItem new];
-        status.statusImage = [NSImage imageNamed:@"RoundBlue"];
-        status.statusSummary = [APFormattedString boldText:@"< No Xcode servers added yet >"];
+        status.server = server.server;
+        status.statusSummary = [APFormattedString boldText:@"Server Error"];
+        status.statusImage = [NSImage imageNamed:@"RoundAlert"];
+        status.statusDetail = [APFormattedString plainText:@"%@", error.localizedDescription];
         [statusArray addObject:status];
+    } else {
+        for (XGXcodeBot *bot in bots.objectEnumerator) {
+            XGXcodeBotStatus*botStatus = botStatuses[bot.name];
+            __auto_type item = [XGAStatusViewItem itemWithBot:bot status:botStatus];
+            if (item) [statusArray addObject:item];
+        }
     }
-    BNCPerformBlockOnMainThreadAsync(^{
-        self.arrayController.content = statusArray;
-    });
+    return statusArray;
 }
 
 @end
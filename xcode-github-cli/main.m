@@ -13,6 +13,7 @@
 #include <sysexits.h>
 
 static BNCLogLevel global_logLevel = BNCLogLevelWarning;
+static BOOL global_binaryLogIsOpen = NO;
 
 void LogOutputFunction(
         NSDate*_Nonnull timestamp,
@@ -27,8 +28,8 @@ void LogOutputFunction(
     NSData *data = [message dataUsingEncoding:NSNEXTSTEPStringEncoding];
     if (!data) return;
     int descriptor = (level == BNCLogLevelLog) ? STDOUT_FILENO : STDERR_FILENO;
-    write(descriptor, data.bytes, data.length);
-    write(descriptor, "\n   ", sizeof('\n'));
+    BNCLogWriteToDescriptor(descriptor, data);
+    BNCLogWriteToDescriptor(descriptor, [NSData dataWithBytes:"\n   " length:sizeof('\n')]);
 }
 
 int main(int argc, char*const argv[]) {
@@ -54,6 +55,17 @@ start:
         }
         global_logLevel = MIN(MAX(BNCLogLevelWarning - options.verbosity, BNCLogLevelAll), BNCLogLevelNone);
         BNCLogSetDisplayLevel(global_logLevel);
+        if (options.binaryLogFile.length) {
+            // The binary log keeps every message. It's opened once and stays open between repeats:
+            BNCLogSetOutputLevel(BNCLogLevelAll);
+            if (!global_binaryLogIsOpen) {
+                BNCLogSetOutputToURLBinary([NSURL fileURLWithPath:options.binaryLogFile]);
+                global_binaryLogIsOpen = YES;
+            }
+        } else {
+            // The output function drops what isn't displayed, so don't format those messages:
+            BNCLogSetOutputLevel(global_logLevel);
+        }
         
         if (options.showVersion) {
             BNCLog(@"xcode-github version %@(%@).",
@@ -64,12 +76,34 @@ start:
             goto exit;
         }
 
+        if (options.useGraphQL)
+            XGGitHubPullRequest.graphQLURL = [NSURL URLWithString:@"https://api.github.com/graphql"];
+        [BNCNetworkService shared].defaultHostConfiguration = options.hostConfiguration;
+
+        // Start counting requests before the first one is sent:
+        if (options.metricsFile.length || options.metricsPort)
+            [XGNetworkMetrics shared];
+        if (options.metricsPort && [XGNetworkMetrics shared].serverPort == 0) {
+            NSError *error = [[XGNetworkMetrics shared] startServerWithPort:(uint16_t) options.metricsPort];
+            if (error) {
+                returnCode = EX_UNAVAILABLE;
+                goto exit;
+            }
+            BNCLog(@"Serving network metrics on port %d.", (int) [XGNetworkMetrics shared].serverPort);
+        }
+
         if (options.showStatusOnly) {
             if (XGShowXcodeBotStatus(options) == nil)
                 returnCode = EXIT_SUCCESS;
             goto exit;
         }
 
+        if (options.listenPort) {
+            NSError *error = XGListenForGitHubWebhooks(options);
+            returnCode = [error.userInfo[@"return_code"] intValue];
+            goto exit;
+        }
+
         NSError *error = XGUpdateXcodeBotsWithGitHub(options);
         if (error) {
             returnCode = [error.userInfo[@"return_code"] intValue];
@@ -83,7 +117,11 @@ start:
     }
 
     if (repeatForever) {
-        sleep(60);
+        // Poll less often if the GitHub rate limit would run out before it resets:
+        NSTimeInterval interval = [[XGGitHubScheduler shared] recommendedPollIntervalWithMinimum:60.0];
+        if (interval > 60.0)
+            BNCLogDebug(@"Waiting %1.0f seconds before the next update.", interval);
+        sleep((unsigned int) ceil(interval));
         goto start;
     }
 
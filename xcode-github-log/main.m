@@ -0,0 +1,147 @@
+/**
+ @file          main.m
+ @package       xcode-github
+ @brief         Decodes binary xcode-github logs to text or JSON.
+
+ @author        Edward Smith
+ @date          November 2018
+ @copyright     Copyright © 2018 Branch. All rights reserved.
+*/
+
+#import <Foundation/Foundation.h>
+#import <XcodeGitHub/XcodeGitHub.h>
+#include <getopt.h>
+#include <sysexits.h>
+
+static NSString *const kHelpString =
+@"xcode-github-log - Decodes binary xcode-github logs.\n"
+ "\n"
+ "usage: xcode-github-log [-hj] [log-file ...]\n"
+ "\n"
+ "  Writes each record of a log written by BNCLogSetOutputToURLBinary to standard out. The log\n"
+ "  is read from standard in if no log files are given.\n"
+ "\n"
+ "  -h, --help\n"
+ "      Show help and exit.\n"
+ "\n"
+ "  -j, --json\n"
+ "      Write each record as a JSON object on one line instead of as text.\n"
+ "\n";
+
+static NSDateFormatter *global_dateFormatter = nil;
+
+/// The level's name without its 'BNCLogLevel' prefix, like 'Warning'.
+NSString *NameFromLevel(BNCLogLevel level) {
+    NSString *name = BNCLogStringFromLogLevel(level);
+    NSString *prefix = @"BNCLogLevel";
+    return ([name hasPrefix:prefix]) ? [name substringFromIndex:prefix.length] : name;
+}
+
+NSData *TextFromRecord(BNCLogRecord *record) {
+    NSString *string = [NSString stringWithFormat:@"%@ %@ %@\n",
+        [global_dateFormatter stringFromDate:record.date], NameFromLevel(record.level), record.message];
+    return [string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+NSData *JSONFromRecord(BNCLogRecord *record) {
+    // JSON can't have NaN or infinite numbers:
+    NSMutableArray *arguments = [NSMutableArray new];
+    for (id argument in record.arguments) {
+        if ([argument isKindOfClass:[NSNumber class]] && !isfinite([argument doubleValue]))
+            [arguments addObject:[argument stringValue]];
+        else
+            [arguments addObject:argument];
+    }
+    NSMutableDictionary *dictionary = [NSMutableDictionary new];
+    dictionary[@"date"] = [global_dateFormatter stringFromDate:record.date];
+    dictionary[@"level"] = @(record.level);
+    dictionary[@"file"] = record.file;
+    if (record.file) dictionary[@"line"] = @(record.line);
+    dictionary[@"format"] = record.format;
+    dictionary[@"arguments"] = arguments;
+    dictionary[@"message"] = record.message;
+
+    NSError *error = nil;
+    NSMutableData *data =
+        [[NSJSONSerialization dataWithJSONObject:dictionary options:0 error:&error] mutableCopy];
+    if (error) {
+        NSLog(@"Can't make JSON for record %@: %@.", record, error);
+        return nil;
+    }
+    [data appendBytes:"\n" length:1];
+    return data;
+}
+
+int DecodeLog(NSData *data, NSString *name, BOOL writeJSON) {
+    NSError *error = nil;
+    BNCLogBinaryDecoder *decoder = [[BNCLogBinaryDecoder alloc] initWithData:data error:&error];
+    if (!decoder) {
+        NSLog(@"Can't read '%@': %@", name, error.localizedDescription);
+        return EX_DATAERR;
+    }
+    NSFileHandle *output = [NSFileHandle fileHandleWithStandardOutput];
+    NSArray<BNCLogRecord*> *records = [decoder readRecords:1000];
+    while (records.count) {
+        @autoreleasepool {
+            NSMutableData *text = [NSMutableData new];
+            for (BNCLogRecord *record in records) {
+                NSData *line = (writeJSON) ? JSONFromRecord(record) : TextFromRecord(record);
+                if (line) [text appendData:line];
+            }
+            [output writeData:text];
+            records = [decoder readRecords:1000];
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char*const argv[]) {
+    @autoreleasepool {
+        global_dateFormatter = [[NSDateFormatter alloc] init];
+        global_dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        global_dateFormatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSSSSSX";
+        global_dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+
+        static struct option longOptions[] = {
+            {"help",    no_argument,    NULL, 'h'},
+            {"json",    no_argument,    NULL, 'j'},
+            {0, 0, 0, 0},
+        };
+        BOOL writeJSON = NO;
+        int c = 0;
+        while ((c = getopt_long(argc, argv, "hj", longOptions, NULL)) != -1) {
+            switch (c) {
+            case 'h': {
+                NSData *data = [kHelpString dataUsingEncoding:NSUTF8StringEncoding];
+                write(STDOUT_FILENO, data.bytes, data.length);
+                return EXIT_SUCCESS;
+            }
+            case 'j':
+                writeJSON = YES;
+                break;
+            default:
+                return EX_USAGE;
+            }
+        }
+
+        if (optind >= argc) {
+            NSData *data = [[NSFileHandle fileHandleWithStandardInput] readDataToEndOfFile];
+            return DecodeLog(data, @"standard in", writeJSON);
+        }
+        int returnCode = EXIT_SUCCESS;
+        for (int i = optind; i < argc; i++) {
+            NSString *path = [NSString stringWithUTF8String:argv[i]];
+            NSError *error = nil;
+            NSData *data =
+                [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:&error];
+            if (!data) {
+                NSLog(@"Can't read '%@': %@", path, error.localizedDescription);
+                returnCode = EX_NOINPUT;
+                continue;
+            }
+            int result = DecodeLog(data, path, writeJSON);
+            if (result != EXIT_SUCCESS) returnCode = result;
+        }
+        return returnCode;
+    }
+}